@@ -7,17 +7,13 @@ layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec4 outPos;
 
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
+  uvec4 clusterGrid;
+  vec2 clusterDepth;
   int numLights;
 } ubo;
 
@@ -8,7 +8,7 @@ layout (location = 3) in vec2 fragUv;
 layout (location = 0) out vec4 outColor;
 
 struct PointLight {
-  vec4 position; // ignore w
+  vec4 position; // w is range
   vec4 color; // w is intensity
 };
 
@@ -17,15 +17,28 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
+  uvec4 clusterGrid;
+  vec2 clusterDepth;
   int numLights;
 } ubo;
 
+// light clusters, see LightClusters
+layout(set = 0, binding = 1) readonly buffer LightBuffer {
+  PointLight lights[];
+};
+
+layout(set = 0, binding = 2) readonly buffer ClusterBuffer {
+  uvec2 clusters[]; // offset into lightIndices, count
+};
+
+layout(set = 0, binding = 3) readonly buffer LightIndexBuffer {
+  uint lightIndices[];
+};
+
 layout (set = 1, binding = 1) uniform sampler2D diffuseMap;
 
 layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
+  uint objectStride;
   float brightnessFactor;
 } push;
 
@@ -37,10 +50,25 @@ void main() {
   vec3 cameraPosWorld = ubo.invView[3].xyz;
   vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
 
-  for (int i = 0; i < ubo.numLights; i++) {
-    PointLight light = ubo.pointLights[i];
+  // the cluster this fragment is in, from its screen position and view depth
+  vec4 clipPos = ubo.projection * ubo.view * vec4(fragPosWorld, 1.0);
+  vec2 screenPos = clamp(clipPos.xy / clipPos.w * 0.5 + 0.5, 0.0, 1.0);
+  uvec3 cell = uvec3(
+      min(uvec2(screenPos * vec2(ubo.clusterGrid.xy)), ubo.clusterGrid.xy - 1),
+      uint(clamp(
+          floor(log(max(clipPos.w, 1e-4)) * ubo.clusterDepth.x + ubo.clusterDepth.y),
+          0.0,
+          float(ubo.clusterGrid.z - 1))));
+  uvec2 cluster = clusters[(cell.z * ubo.clusterGrid.y + cell.y) * ubo.clusterGrid.x + cell.x];
+
+  for (uint i = 0; i < cluster.y; i++) {
+    PointLight light = lights[lightIndices[cluster.x + i]];
     vec3 directionToLight = light.position.xyz - fragPosWorld;
-    float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
+    float distanceSquared = dot(directionToLight, directionToLight);
+    // fades to 0 at the light's range so it can be left out of clusters past it
+    float rangeSquared = light.position.w * light.position.w;
+    float fade = clamp(1.0 - pow(distanceSquared / rangeSquared, 2.0), 0.0, 1.0);
+    float attenuation = fade * fade / distanceSquared;
     directionToLight = normalize(directionToLight);
 
     float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
@@ -5,39 +5,50 @@ layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
 
+// per instance, binding 1
+layout(location = 4) in uint objectId;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUv;
 
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
+  uvec4 clusterGrid;
+  vec2 clusterDepth;
   int numLights;
 } ubo;
 
-layout(set = 1, binding = 0) uniform GameObjectBufferData {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
-} gameObject;
+// every object's model and normal matrix, one slot per object id
+layout(std430, set = 1, binding = 0) readonly buffer TransformTable {
+  vec4 columns[];
+} transforms;
 
 layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
+  uint objectStride; // slot size in vec4s
+  float brightnessFactor;
 } push;
 
+mat4 loadMatrix(uint first) {
+  return mat4(
+      transforms.columns[first],
+      transforms.columns[first + 1],
+      transforms.columns[first + 2],
+      transforms.columns[first + 3]);
+}
+
 void main() {
-  vec4 positionWorld = gameObject.modelMatrix * vec4(position, 1.0);
+  uint slot = objectId * push.objectStride;
+  mat4 modelMatrix = loadMatrix(slot);
+  mat4 normalMatrix = loadMatrix(slot + 4);
+
+  vec4 positionWorld = modelMatrix * vec4(position, 1.0);
   gl_Position = ubo.projection * ubo.view * positionWorld;
-  fragNormalWorld = normalize(mat3(gameObject.normalMatrix) * normal);
+  fragNormalWorld = normalize(mat3(normalMatrix) * normal);
   fragPosWorld = positionWorld.xyz;
   fragColor = color;
   fragUv = uv;
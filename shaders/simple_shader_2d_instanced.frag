@@ -0,0 +1,14 @@
+#version 450
+
+layout (location = 0) in vec2 texCoords;
+layout (location = 1) in vec3 fragColor;
+
+layout (location = 0) out vec4 outColor;
+
+layout (set = 1, binding = 1) uniform sampler2D diffuseMap;
+
+void main() {
+  // Sample the color from the diffuse map
+  vec4 diffuseColor = texture(diffuseMap, texCoords);
+  outColor = diffuseColor * vec4(fragColor, 1.0);
+}
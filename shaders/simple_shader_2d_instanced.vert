@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec3 uv;
+
+// per instance, binding 1
+layout(location = 4) in vec4 instanceTransform; // mat2 columns
+layout(location = 5) in vec4 instanceOffset;
+layout(location = 6) in vec4 instanceColor;
+
+layout(location = 0) out vec2 texCoords;
+layout(location = 1) out vec3 fragColor;
+
+const float tiling = 1.0;
+
+void main() {
+  mat2 transform = mat2(instanceTransform.xy, instanceTransform.zw);
+  gl_Position = vec4(transform * position + instanceOffset.xy, instanceOffset.z, 1.0);
+  texCoords = vec2(position.x/2.0 + 0.5, position.y/2.0 + 0.5) * tiling;
+  fragColor = instanceColor.rgb;
+}
@@ -11,7 +11,7 @@ layout(location = 2) out vec3 toCameraVector;
 layout(location = 3) out vec3 fromLightVector;
 
 struct PointLight {
-  vec4 position; // ignore w
+  vec4 position; // w is range
   vec4 color; // w is intensity
 };
 
@@ -19,12 +19,16 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
-  vec3 cameraPos;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
+  uvec4 clusterGrid;
+  vec2 clusterDepth;
   int numLights;
 } ubo;
 
+layout(set = 0, binding = 1) readonly buffer LightBuffer {
+  PointLight lights[];
+};
+
 layout(set = 1, binding = 0) uniform GameObjectBufferData {
     mat4 modelMatrix;
     mat4 normalMatrix;
@@ -43,6 +47,8 @@ void main() {
     clipSpace = ubo.projection * ubo.view * positionWorld;
     gl_Position = clipSpace;
     texCoords = vec2(position.x/2.0 + 0.5, position.y/2.0 + 0.5) * tiling;
-    toCameraVector = ubo.cameraPos - positionWorld.xyz;
-    fromLightVector = positionWorld.xyz - ubo.pointLights[0].position.xyz;
+    toCameraVector = ubo.invView[3].xyz - positionWorld.xyz;
+    fromLightVector = ubo.numLights > 0
+        ? positionWorld.xyz - lights[0].position.xyz
+        : vec3(0.0, 1.0, 0.0);
 }
\ No newline at end of file
@@ -1,26 +1,18 @@
 #include "app.hpp"
+#include "framework/core/nile_system_scheduler.hpp"
 #include "framework/systems/lights/point_light_system.hpp"
 
 namespace nile{
 
-App2D::App2D() {
+App2D::App2D(const AppSettings &settings)
+    : nileWindow{WIDTH, HEIGHT, "Nile Engine 2D", settings.headless},
+      nileRenderer{nileWindow, nileDevice, settings.frameSettings} {
   globalPool =
       NileDescriptorPool::Builder(nileDevice)
           .setMaxSets(NileSwapChain::MAX_FRAMES_IN_FLIGHT)
           .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NileSwapChain::MAX_FRAMES_IN_FLIGHT)
           .build();
-  
-  // build frame descriptor pools
-  framePools.resize(NileSwapChain::MAX_FRAMES_IN_FLIGHT);
-  auto framePoolBuilder = NileDescriptorPool::Builder(nileDevice)
-                                .setMaxSets(1000)
-                                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
-                                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
-                                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
-  for (int i = 0; i < framePools.size(); i++) {
-    framePools[i] = framePoolBuilder.build();
-  }         
-    
+
   globalSetLayout =
       NileDescriptorSetLayout::Builder(nileDevice)
           .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
@@ -44,14 +36,14 @@ App2D::App2D() {
   }
   std::cout << "Alignment: " << nileDevice.properties.limits.minUniformBufferOffsetAlignment << "\n";
   std::cout << "atom size: " << nileDevice.properties.limits.nonCoherentAtomSize << "\n";
+
+  // pipelines are created on the job system threads while the app keeps loading
+  nileDevice.getPipelineRegistry().setJobSystem(&jobSystem);
 }
 
-App2D::~App2D() {}
+App2D::~App2D() { nileDevice.getPipelineRegistry().setJobSystem(nullptr); }
 
-void App2D::start() {
-  loadGameObjects();
-  loop();
-}
+void App2D::start() { loop(); }
 
 void App2D::loop() {
 
@@ -60,10 +52,17 @@ void App2D::loop() {
     nileRenderer.getSwapChainRenderPass(),
     globalSetLayout->getDescriptorSetLayout()
   };
+  loadGameObjects();
+
+  ui.frame_settings = nileRenderer.getFrameSettings();
+  ui.gpu_profiler = &nileRenderer.getGpuProfiler();
   auto currentTime = std::chrono::high_resolution_clock::now();
   while (!nileWindow.shouldClose()) {
     // Poll and handle events (inputs, window resize, etc.)
-    glfwPollEvents();
+    {
+      NILE_PROFILE_ZONE("glfwPollEvents");
+      glfwPollEvents();
+    }
 
     auto newTime = std::chrono::high_resolution_clock::now();
     float frameTime =
@@ -71,19 +70,29 @@ void App2D::loop() {
     currentTime = newTime;
 
     //Start the Dear ImGui frame 
+    ui.matrices_recomputed = gameObjectManager.getBufferStats().matricesRecomputed;
+    ui.bytes_flushed = gameObjectManager.getBufferStats().bytesFlushed;
+    ui.draw_calls = renderSystem2D.getDrawStats().drawCalls;
+    ui.instances_drawn = renderSystem2D.getDrawStats().instances;
+    ui.descriptor_sets_written = descriptorCache.getStats().setsWritten;
+    ui.descriptor_sets_live = descriptorCache.getStats().liveSets;
+    ui.pacing_wait_ms = nileRenderer.getPacingStats().waitMs;
+    ui.pacing_spin_ms = nileRenderer.getPacingStats().spinMs;
     ui.startUI();
+    nileRenderer.setFrameSettings(ui.frame_settings);
 
     if (auto commandBuffer = nileRenderer.beginFrame()) {
       int frameIndex = nileRenderer.getFrameIndex();
-      framePools[frameIndex]->resetPool();
+      descriptorCache.beginFrame(frameIndex);
       FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
-          *framePools[frameIndex],
-          gameObjectManager.gameObjects};
+          descriptorCache,
+          gameObjectManager};
+      frameInfo.gpuProfiler = &nileRenderer.getGpuProfiler();
 
       gameObjectManager.updateBuffer(frameIndex);
       // render
@@ -105,17 +114,17 @@ void App2D::loop() {
 
 void App2D::loadGameObjects() {
 
-  auto& viewerObject = gameObjectManager.createGameObject();
-  viewerObject.transform.translation.z = -2.5f;
+  auto viewerObject = gameObjectManager.createGameObject();
+  viewerObject.transform().translation.z = -2.5f;
 
   std::shared_ptr<NileModel> nileModel = 
       NileModel::createModelFromFile(nileDevice, "resources/models/quad.obj");
   std::shared_ptr<NileTexture> marbleTexture =
       NileTexture::createTextureFromFile(nileDevice, "../resources/images/missing.png");
-  auto& floor = gameObjectManager.createGameObject();
-  floor.model = nileModel;
-  floor.transform.translation = {0.f, .5f, 0.f};
-  floor.transform.scale = {1.f, 0.2f, 1.f};
+  auto floor = gameObjectManager.createGameObject();
+  floor.render().model = nileModel;
+  floor.transform().translation = {0.f, .5f, 0.f};
+  floor.transform().scale = {1.f, 0.2f, 1.f};
 
   NileModel::Builder meshBuilder{};
   meshBuilder.vertices = {
@@ -127,32 +136,30 @@ void App2D::loadGameObjects() {
   };
   meshBuilder.indices = {0, 1, 2, 0};
   auto tile2 = std::make_shared<NileModel>(nileDevice, meshBuilder);
-  auto& square2 = gameObjectManager.createGameObject();
-  square2.model = tile2;
-  square2.color = glm::vec3(1.f);
+  auto square2 = gameObjectManager.createGameObject();
+  square2.render().model = tile2;
+  square2.render().color = glm::vec3(1.f);
 }
 
-App3D::App3D() {
+App3D::App3D(const AppSettings &settings)
+    : nileWindow{WIDTH, HEIGHT, "Nile Engine 3D", settings.headless},
+      nileRenderer{nileWindow, nileDevice, settings.frameSettings} {
   globalPool =
       NileDescriptorPool::Builder(nileDevice)
           .setMaxSets(NileSwapChain::MAX_FRAMES_IN_FLIGHT)
           .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NileSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(
+              VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+              LightClusters::DESCRIPTORS_PER_SET * NileSwapChain::MAX_FRAMES_IN_FLIGHT)
           .build();
-  
-  // build frame descriptor pools
-  framePools.resize(NileSwapChain::MAX_FRAMES_IN_FLIGHT);
-  auto framePoolBuilder = NileDescriptorPool::Builder(nileDevice)
-                                .setMaxSets(1000)
-                                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
-                                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
-                                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
-  for (int i = 0; i < framePools.size(); i++) {
-    framePools[i] = framePoolBuilder.build();
-  }         
-    
+
+  // bindings 1 to 3 are the light clusters, see LightClusters
   globalSetLayout =
       NileDescriptorSetLayout::Builder(nileDevice)
           .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
           .build();
 
   for (int i = 0; i < uboBuffers.size(); i++) {
@@ -165,22 +172,25 @@ App3D::App3D() {
     uboBuffers[i]->map();
   }
 
+  lightClusters =
+      std::make_unique<LightClusters>(nileDevice, *globalSetLayout, *globalPool, MAX_FRAMES);
   for (int i = 0; i < globalDescriptorSets.size(); i++) {
     auto bufferInfo = uboBuffers[i]->descriptorInfo();
     NileDescriptorWriter(*globalSetLayout, *globalPool)
         .writeBuffer(0, &bufferInfo)
         .build(globalDescriptorSets[i]);
+    lightClusters->writeDescriptors(i, globalDescriptorSets[i]);
   }
   std::cout << "Alignment: " << nileDevice.properties.limits.minUniformBufferOffsetAlignment << "\n";
   std::cout << "atom size: " << nileDevice.properties.limits.nonCoherentAtomSize << "\n";
-}
 
-void App3D::start() {
-  loadGameObjects();
-  loop();
+  // pipelines are created on the job system threads while the app keeps loading
+  nileDevice.getPipelineRegistry().setJobSystem(&jobSystem);
 }
 
-App3D::~App3D() {}
+void App3D::start() { loop(); }
+
+App3D::~App3D() { nileDevice.getPipelineRegistry().setJobSystem(nullptr); }
 
 void App3D::loop() {
 
@@ -192,13 +202,101 @@ void App3D::loop() {
       nileDevice,
       nileRenderer.getSwapChainRenderPass(),
       globalSetLayout->getDescriptorSetLayout()};
+  // the systems' pipelines are still being created, the first frame waits for them
+  loadGameObjects();
 
-  auto& viewerObject = gameObjectManager.createGameObject();
-  viewerObject.transform.translation.z = -2.5f;
-
+  auto viewerObject = gameObjectManager.createGameObject();
+  viewerObject.transform().translation.z = -2.5f;
+
+  // Frame update and render order comes from what each system reads and writes
+  GlobalUbo ubo{};
+  NileSystemScheduler scheduler{gameObjectManager, jobSystem};
+  scheduler
+      .addSystem("point light update",
+                 [&](FrameInfo &frameInfo) {
+                   pointLightSystem.update(frameInfo, ubo, *lightClusters);
+                 })
+      .reads<PointLightComponent>()
+      .writes<TransformComponent>()
+      .writesResource("global ubo");
+  scheduler
+      .addSystem("global ubo upload",
+                 [&](FrameInfo &frameInfo) {
+                   uboBuffers[frameInfo.frameIndex]->writeToBuffer(&ubo);
+                   uboBuffers[frameInfo.frameIndex]->flush();
+                 })
+      .readsResource("global ubo");
+  // final step of update is updating the game objects buffer data, it clears the dirty flags
+  scheduler
+      .addSystem("object buffer",
+                 [&](FrameInfo &frameInfo) { gameObjectManager.updateBuffer(frameInfo.frameIndex); })
+      .writes<TransformComponent>()
+      .reads<RenderComponent>()
+      .writesResource("object buffer");
+  scheduler
+      .addSystem("frustum cull",
+                 [&](FrameInfo &frameInfo) {
+                   gameObjectManager.cull(frameInfo.camera.getFrustum());
+                 })
+      .reads<RenderComponent>()
+      .readsResource("object buffer")
+      .writesResource("visibility");
+
+  // render systems only read components and record into the frame's command buffer in the
+  // order they are added here, culling records a compute pass so it comes before the render pass
+  // systems binding the global set read "global ubo", the light update rewrites the set's light
+  // buffers when they grow
+  scheduler
+      .addSystem("cull 3d", [&](FrameInfo &frameInfo) { renderSystem3D.cull(frameInfo); })
+      .mainThread()
+      .reads<RenderComponent, MirrorComponent, StaticComponent>()
+      .readsResource("object buffer")
+      .readsResource("visibility")
+      .readsResource("global ubo")
+      .writesResource("command buffer");
+  // inside the pass frameInfo.commandBuffer is a secondary buffer, render 3d records its
+  // batches into more of them on the job system threads
+  scheduler
+      .addSystem("begin render pass",
+                 [&](FrameInfo &frameInfo) {
+                   nileRenderer.beginSwapChainRenderPass(
+                       frameInfo.commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                   commandRecorder.beginPass(frameInfo, nileRenderer);
+                 })
+      .mainThread()
+      .writesResource("command buffer");
+  scheduler
+      .addSystem("render 3d",
+                 [&](FrameInfo &frameInfo) { renderSystem3D.renderGameObjects(frameInfo); })
+      .mainThread()
+      .reads<RenderComponent, MirrorComponent, StaticComponent>()
+      .readsResource("object buffer")
+      .readsResource("global ubo")
+      .writesResource("command buffer");
+  scheduler
+      .addSystem("render point lights",
+                 [&](FrameInfo &frameInfo) { pointLightSystem.render(frameInfo); })
+      .mainThread()
+      .reads<TransformComponent, PointLightComponent>()
+      .writesResource("command buffer");
+  scheduler
+      .addSystem("render ui",
+                 [&](FrameInfo &frameInfo) {
+                   ui.renderUI(frameInfo.commandBuffer, nileRenderer);
+                   commandRecorder.endPass(frameInfo);
+                   nileRenderer.endSwapChainRenderPass(frameInfo.commandBuffer);
+                 })
+      .mainThread()
+      .writesResource("command buffer");
+
+  ui.frame_settings = nileRenderer.getFrameSettings();
+  ui.gpu_profiler = &nileRenderer.getGpuProfiler();
   auto currentTime = std::chrono::high_resolution_clock::now();
   while (!nileWindow.shouldClose()) {
-    glfwPollEvents();
+    {
+      NILE_PROFILE_ZONE("glfwPollEvents");
+      glfwPollEvents();
+    }
 
     auto newTime = std::chrono::high_resolution_clock::now();
     float frameTime =
@@ -206,50 +304,61 @@ void App3D::loop() {
     currentTime = newTime;
 
     cameraController.moveInPlaneXYZ(nileWindow.getGLFWwindow(), frameTime, viewerObject);
-    camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+    const auto &viewerTransform = viewerObject.readTransform();
+    camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
     float aspect = nileRenderer.getAspectRatio();
     camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
     // Start the DearImgui frame
+    ui.matrices_recomputed = gameObjectManager.getBufferStats().matricesRecomputed;
+    ui.bytes_flushed = gameObjectManager.getBufferStats().bytesFlushed;
+    ui.draw_calls = renderSystem3D.getDrawStats().drawCalls;
+    ui.instances_drawn = renderSystem3D.getDrawStats().instances;
+    ui.triangles_drawn = renderSystem3D.getDrawStats().triangles;
+    ui.objects_tested = gameObjectManager.getCullStats().tested;
+    ui.objects_visible = gameObjectManager.getCullStats().visible;
+    ui.descriptor_sets_written = descriptorCache.getStats().setsWritten;
+    ui.descriptor_sets_live = descriptorCache.getStats().liveSets;
+    ui.secondary_buffers = commandRecorder.getStats().secondaryBuffers;
+    ui.parallel_ranges = commandRecorder.getStats().parallelRanges;
+    ui.cached_draw_calls = renderSystem3D.getDrawStats().cachedDrawCalls;
+    const auto pipelineStats = nileDevice.getPipelineCache().getStats();
+    ui.pipelines_created = pipelineStats.pipelinesCreated;
+    ui.pipeline_creation_ms = pipelineStats.creationMs;
+    ui.pipeline_cache_warm = pipelineStats.isWarm;
+    ui.pipeline_registry_hits = nileDevice.getPipelineRegistry().getStats().hits;
+    ui.lights = lightClusters->getStats().lights;
+    ui.max_lights_per_cluster = lightClusters->getStats().maxLightsPerCluster;
+    ui.pacing_wait_ms = nileRenderer.getPacingStats().waitMs;
+    ui.pacing_spin_ms = nileRenderer.getPacingStats().spinMs;
     ui.startUI();
+    nileRenderer.setFrameSettings(ui.frame_settings);
+    renderSystem3D.setCullingMode(static_cast<CullingMode>(ui.culling_mode));
+    renderSystem3D.setLodQuality(ui.lod_pixel_error, nileRenderer.getSwapChainExtent().height);
 
     if (auto commandBuffer = nileRenderer.beginFrame()) {
       int frameIndex = nileRenderer.getFrameIndex();
-      framePools[frameIndex]->resetPool();
+      descriptorCache.beginFrame(frameIndex);
+      commandRecorder.beginFrame(frameIndex);
       FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
-          *framePools[frameIndex],
-          gameObjectManager.gameObjects};
+          descriptorCache,
+          gameObjectManager,
+          &commandRecorder};
+      frameInfo.gpuProfiler = &nileRenderer.getGpuProfiler();
 
-      // update
-      GlobalUbo ubo{};
+      // update and render
+      ubo = GlobalUbo{};
       ubo.projection = camera.getProjection();
       ubo.view = camera.getView();
       ubo.inverseView = camera.getInverseView();
-      pointLightSystem.update(frameInfo, ubo);
-      uboBuffers[frameIndex]->writeToBuffer(&ubo);
-      uboBuffers[frameIndex]->flush();
-
-      // final step of upate is updating the game objects buffer data
-      // The render functions MUST not change a game objects transform data
-      gameObjectManager.updateBuffer(frameIndex);
-
-      // render
-      nileRenderer.beginSwapChainRenderPass(commandBuffer);
+      scheduler.run(frameInfo);
 
-      // order here matters
-      renderSystem3D.renderGameObjects(frameInfo);
-      pointLightSystem.render(frameInfo);
-
-      // Rendering UI
-      ui.renderUI(commandBuffer, nileRenderer);
-
-      nileRenderer.endSwapChainRenderPass(commandBuffer);
       nileRenderer.endFrame();
     }
   }
@@ -262,10 +371,26 @@ void App3D::loadGameObjects() {
       NileModel::createModelFromFile(nileDevice, "resources/models/quad.obj");
   std::shared_ptr<NileTexture> marbleTexture =
       NileTexture::createTextureFromFile(nileDevice, "../resources/images/missing.png");
-  auto& floor = gameObjectManager.createGameObject();
-  floor.model = nileModel;
-  floor.transform.translation = {0.f, .5f, 0.f};
-  floor.transform.scale = {6.f, 1.f, 6.f};
+  auto floor = gameObjectManager.createGameObject();
+  floor.render().model = nileModel;
+  floor.transform().translation = {0.f, .5f, 0.f};
+  floor.transform().scale = {6.f, 1.f, 6.f};
+  floor.add<StaticComponent>();
+
+  // dense enough for their levels of detail to show, see RenderSystem3D::setLodQuality
+  std::shared_ptr<NileModel> flatVaseModel =
+      NileModel::createModelFromFile(nileDevice, "resources/models/flat_vase.obj", 4);
+  auto flatVase = gameObjectManager.createGameObject();
+  flatVase.render().model = flatVaseModel;
+  flatVase.transform().translation = {-.5f, .5f, 0.f};
+  flatVase.transform().scale = {3.f, 1.5f, 3.f};
+
+  std::shared_ptr<NileModel> smoothVaseModel =
+      NileModel::createModelFromFile(nileDevice, "resources/models/smooth_vase.obj", 4);
+  auto smoothVase = gameObjectManager.createGameObject();
+  smoothVase.render().model = smoothVaseModel;
+  smoothVase.transform().translation = {.5f, .5f, 0.f};
+  smoothVase.transform().scale = {3.f, 1.5f, 3.f};
   
   std::vector<glm::vec3> lightColors{
       {1.f, .1f, .1f},
@@ -277,17 +402,17 @@ void App3D::loadGameObjects() {
   };
 
   for (int i = 0; i < lightColors.size(); i++) {
-    auto& pointLight = gameObjectManager.makePointLight(0.2f);
-    pointLight.color = lightColors[i];
+    auto pointLight = gameObjectManager.makePointLight(0.2f);
+    pointLight.get<PointLightComponent>().color = lightColors[i];
     auto rotateLight = glm::rotate(
         glm::mat4(1.f),
         (i * glm::two_pi<float>()) / lightColors.size(),
         {0.f, -1.f, 0.f});
-    pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+    pointLight.transform().translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
   }
-  auto& pointLight = gameObjectManager.makePointLight(0.2f);
-  pointLight.color = {1.f, 0.f, 0.f};
-  pointLight.transform.translation = {0.f, -1.f, 0.f};
+  auto pointLight = gameObjectManager.makePointLight(0.2f);
+  pointLight.get<PointLightComponent>().color = {1.f, 0.f, 0.f};
+  pointLight.transform().translation = {0.f, -1.f, 0.f};
 
 }
 
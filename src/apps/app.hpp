@@ -1,15 +1,20 @@
 #pragma once
 
+#include "framework/core/nile_command_recorder.hpp"
+#include "framework/core/nile_descriptor_cache.hpp"
 #include "framework/core/nile_descriptors.hpp"
 #include "framework/core/nile_device.hpp"
 #include "framework/core/nile_game_object.hpp"
+#include "framework/core/nile_job_system.hpp"
 #include "framework/core/nile_renderer.hpp"
 #include "framework/core/nile_window.hpp"
 #include "framework/core/nile_buffer.hpp"
 #include "framework/core/nile_camera.hpp"
 #include "framework/core/nile_model.hpp"
+#include "framework/core/nile_profiler.hpp"
 #include "framework/ui/simple_ui.hpp"
 #include "framework/input/keyboard.hpp"
+#include "framework/systems/lights/light_clusters.hpp"
 #include "framework/systems/rendering/render_system.hpp"
 
 // libs
@@ -28,13 +33,19 @@
 #include <vector>
 
 namespace nile{
+
+// Set by main from the command line, every app passes them on to its window and renderer
+struct AppSettings {
+  NileWindow::Headless headless{};
+  NileRenderer::FrameSettings frameSettings{};
+};
   
 class App2D {
  public:
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
 
-  App2D();
+  App2D(const AppSettings &settings = {});
   virtual ~App2D();
 
   App2D(const App2D &) = delete;
@@ -42,19 +53,21 @@ class App2D {
 
   static constexpr int MAX_FRAMES = NileSwapChain::MAX_FRAMES_IN_FLIGHT;
 
-  NileWindow nileWindow{WIDTH, HEIGHT, "Nile Engine 2D"};
+  NileWindow nileWindow;
   NileDevice nileDevice{nileWindow};
-  NileRenderer nileRenderer{nileWindow, nileDevice};
+  NileRenderer nileRenderer;
   
   // note: order of declaration matters
   std::unique_ptr<NileDescriptorPool> globalPool{};
   std::unique_ptr<NileDescriptorSetLayout> globalSetLayout{};
-  std::vector<std::unique_ptr<NileDescriptorPool>> framePools;
+  NileDescriptorCache descriptorCache{nileDevice};
   
   std::vector<std::unique_ptr<NileBuffer>> uboBuffers{MAX_FRAMES};
   std::vector<VkDescriptorSet> globalDescriptorSets{MAX_FRAMES};
   
   NileGameObjectManager gameObjectManager{nileDevice};
+  NileJobSystem jobSystem{};
+  NileCommandRecorder commandRecorder{nileDevice, jobSystem};
   
 
   // RenderSystem2D renderSystem2D{
@@ -83,7 +96,7 @@ class App3D {
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
 
-  App3D();
+  App3D(const AppSettings &settings = {});
   virtual ~App3D();
 
   App3D(const App3D &) = delete;
@@ -91,19 +104,23 @@ class App3D {
 
   static constexpr int MAX_FRAMES = NileSwapChain::MAX_FRAMES_IN_FLIGHT;
 
-  NileWindow nileWindow{WIDTH, HEIGHT, "Nile Engine 3D"};
+  NileWindow nileWindow;
   NileDevice nileDevice{nileWindow};
-  NileRenderer nileRenderer{nileWindow, nileDevice};
+  NileRenderer nileRenderer;
 
   // note: order of declarations matters
   std::unique_ptr<NileDescriptorPool> globalPool{};
 
   std::unique_ptr<NileDescriptorSetLayout> globalSetLayout{};
-  std::vector<std::unique_ptr<NileDescriptorPool>> framePools;
+  NileDescriptorCache descriptorCache{nileDevice};
   NileGameObjectManager gameObjectManager{nileDevice};
+  NileJobSystem jobSystem{};
+  NileCommandRecorder commandRecorder{nileDevice, jobSystem};
 
   std::vector<std::unique_ptr<NileBuffer>> uboBuffers{MAX_FRAMES};
   std::vector<VkDescriptorSet> globalDescriptorSets{MAX_FRAMES};
+  // point lights, bound next to the ubo in the global descriptor sets
+  std::unique_ptr<LightClusters> lightClusters{};
 
   SimpleUI ui{
     nileDevice,
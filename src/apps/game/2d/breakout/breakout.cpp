@@ -6,7 +6,7 @@
 namespace nile
 {
     
-Breakout::Breakout() {}
+Breakout::Breakout(const AppSettings &settings) : App2D{settings} {}
 
 Breakout::~Breakout() {}
 
@@ -28,7 +28,8 @@ void Breakout::loop()
         gameObjectManager,
         nileRenderer.getSwapChainRenderPass(),
         globalSetLayout->getDescriptorSetLayout(), 
-        nr_particles
+        nr_particles,
+        &jobSystem
     };
 
     SimpleCollisionSystem simpleCollision;
@@ -37,7 +38,10 @@ void Breakout::loop()
 
     while (!nileWindow.shouldClose())
     {
-        glfwPollEvents();
+        {
+            NILE_PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
 
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime =
@@ -47,40 +51,49 @@ void Breakout::loop()
         if (auto commandBuffer = nileRenderer.beginFrame())
         {
             int frameIndex = nileRenderer.getFrameIndex();
-            framePools[frameIndex]->resetPool();
+            descriptorCache.beginFrame(frameIndex);
+            commandRecorder.beginFrame(frameIndex);
             FrameInfo frameInfo{
                 frameIndex,
                 frameTime,
                 commandBuffer,
                 camera,
                 globalDescriptorSets[frameIndex],
-                *framePools[frameIndex],
-                gameObjectManager.gameObjects};
+                descriptorCache,
+                gameObjectManager,
+                &commandRecorder};
+            frameInfo.gpuProfiler = &nileRenderer.getGpuProfiler();
 
-            //gameObjectManager.updateBuffer(frameIndex);
-            // render
-            nileRenderer.beginSwapChainRenderPass(commandBuffer);
+            gameObjectManager.updateBuffer(frameIndex);
+            // render, the particles are recorded into secondary buffers in parallel
+            nileRenderer.beginSwapChainRenderPass(
+                commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            commandRecorder.beginPass(frameInfo, nileRenderer);
 
             renderSystem2D.renderGameObjects(frameInfo);
 
             particleGenerator.render(frameInfo);
 
-            playerController.moveInPlaneXY(
-                nileWindow.getGLFWwindow(), 
-                frameInfo.frameTime, 
-                gameObjectManager.gameObjects.at(player->getId())
-            );
-            // Player presses the space bar
-            action(
-                nileWindow.getGLFWwindow(), 
-                gameObjectManager.gameObjects.at(ballobj->getId())
-            );
-            updateBallPos(0.05f, WIDTH / 800.0f);
-            particleGenerator.update(0.05f, *ballobj, 2, glm::vec2(ballobj->ball->radius / 2.0f));
+            {
+                NILE_PROFILE_ZONE("player and ball");
+                playerController.moveInPlaneXY(
+                    nileWindow.getGLFWwindow(), 
+                    frameInfo.frameTime, 
+                    player
+                );
+                // Player presses the space bar
+                action(
+                    nileWindow.getGLFWwindow(), 
+                    ballobj
+                );
+                updateBallPos(0.05f, WIDTH / 800.0f);
+            }
+            particleGenerator.update(0.05f, ballobj, 2, glm::vec2(ballobj.get<BallComponent>().radius / 2.0f));
 
 
             // Check for collisions
-            simpleCollision.doCollisions(frameInfo, *ballobj, *player, this->Levels, Level);
+            simpleCollision.doCollisions(frameInfo, ballobj, player, this->Levels, Level);
+            commandRecorder.endPass(frameInfo);
             nileRenderer.endSwapChainRenderPass(commandBuffer);
             nileRenderer.endFrame();
         }
@@ -129,21 +142,21 @@ void Breakout::loadGameObjects()
     
     std::shared_ptr<NileTexture> smileyFace = 
         NileTexture::createTextureFromFile(nileDevice, "../resources/breakout/images/awesomeFace.png");
-    ballobj = &gameObjectManager.makeBall();
-    ballobj->model = createCircleSprite(nileDevice, 22);
-    ballobj->color = glm::vec3(1.0f);
-    ballobj->transform2d.translation = {0.0f, .84f, 0.f};
-    ballobj->diffuseMap = smileyFace;
+    ballobj = gameObjectManager.makeBall();
+    ballobj.render().model = createCircleSprite(nileDevice, 22);
+    ballobj.render().color = glm::vec3(1.0f);
+    ballobj.transform2d().translation = {0.0f, .84f, 0.f};
+    ballobj.render().diffuseMap = smileyFace;
 
     
     std::shared_ptr<NileTexture> paddle = 
         NileTexture::createTextureFromFile(nileDevice, "../resources/breakout/images/paddle.png");
-    player = &gameObjectManager.createGameObject();
-    player->model = createRectangleSprite(nileDevice, 100.0f / 50, 20.0f / 10);
-    player->transform2d.scale ={.2f, .05f};
-    player->transform2d.translation = {0.0f, .94f, 0.f};
-    player->color = glm::vec3(1.0f);
-    player->diffuseMap = paddle; 
+    player = gameObjectManager.createGameObject();
+    player.render().model = createRectangleSprite(nileDevice, 100.0f / 50, 20.0f / 10);
+    player.transform2d().scale ={.2f, .05f};
+    player.transform2d().translation = {0.0f, .94f, 0.f};
+    player.render().color = glm::vec3(1.0f);
+    player.render().diffuseMap = paddle; 
     
     loadGameLevels();
 }
@@ -231,37 +244,39 @@ std::unique_ptr<NileModel> Breakout::createRectangleSprite(NileDevice& device, f
 
 void Breakout::updateBallPos(float dt, unsigned int window_width)
 {
+    auto& transform2d = ballobj.transform2d();
+    auto& rigidBody2d = ballobj.rigidBody2d();
     // if not stuck to player board
-    if (!ballobj->ball->stuck)
+    if (!ballobj.get<BallComponent>().stuck)
     {
         //move the ball
-        ballobj->transform2d.translation += glm::vec3(ballobj->rigidBody2d.velocity * dt, 0.f);
+        transform2d.translation += glm::vec3(rigidBody2d.velocity * dt, 0.f);
         // check if outside window bounds; if so, reverse velocity and restore at correct position
-        if (ballobj->transform2d.translation.x <= -1.0f)
+        if (transform2d.translation.x <= -1.0f)
         {
-            ballobj->rigidBody2d.velocity.x = -ballobj->rigidBody2d.velocity.x;
-            ballobj->transform2d.translation.x = -1.0f;
+            rigidBody2d.velocity.x = -rigidBody2d.velocity.x;
+            transform2d.translation.x = -1.0f;
         }
-        else if (ballobj->transform2d.translation.x + ballobj->transform2d.scale.x >= window_width)
+        else if (transform2d.translation.x + transform2d.scale.x >= window_width)
         {
-            ballobj->rigidBody2d.velocity.x = -ballobj->rigidBody2d.velocity.x;
-            ballobj->transform2d.translation.x = window_width - ballobj->transform2d.scale.x;
+            rigidBody2d.velocity.x = -rigidBody2d.velocity.x;
+            transform2d.translation.x = window_width - transform2d.scale.x;
         }
-        if (ballobj->transform2d.translation.y <= -1.0f)
+        if (transform2d.translation.y <= -1.0f)
         {
-            ballobj->rigidBody2d.velocity.y = -ballobj->rigidBody2d.velocity.y;
-            ballobj->transform2d.translation.y = -1.0f;
+            rigidBody2d.velocity.y = -rigidBody2d.velocity.y;
+            transform2d.translation.y = -1.0f;
         }
-        else if (ballobj->transform2d.translation.y + ballobj->transform2d.scale.y >= window_width)
+        else if (transform2d.translation.y + transform2d.scale.y >= window_width)
         {
             // Reset
-            // ballobj->rigidBody2d.velocity.y = ballobj->rigidBody2d.velocity.y * -1;
-            // ballobj->transform2d.translation.y = .7f;
-            //ballobj->ball->stuck = !ballobj->ball->stuck;
+            // rigidBody2d.velocity.y = rigidBody2d.velocity.y * -1;
+            // transform2d.translation.y = .7f;
+            //ballobj.get<BallComponent>().stuck = !ballobj.get<BallComponent>().stuck;
         }
     } else 
     {
-        ballobj->transform2d.translation.x = player->transform2d.translation.x;
+        transform2d.translation.x = player.transform2d().translation.x;
     }
 }
 
@@ -269,7 +284,7 @@ void Breakout::action(
     GLFWwindow* window, NileGameObject &gameObject)
 {
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-        gameObject.ball->stuck = false;
+        gameObject.get<BallComponent>().stuck = false;
     }
 }
 
@@ -344,13 +359,14 @@ void GameLevel::init(NileDevice& device,
 
     // background
     glm::vec2 size(width/4, height/4);
-    auto& bg = gom.createGameObject();
-    bg.model = square;
-    bg.color = glm::vec3(1.0f);
-    bg.diffuseMap = texture;
-    bg.transform2d.translation = {0, 0, 0.01f}; 
-    bg.transform2d.scale = size;
+    auto bg = gom.createGameObject();
+    bg.render().model = square;
+    bg.render().color = glm::vec3(1.0f);
+    bg.render().diffuseMap = texture;
+    bg.transform2d().translation = {0, 0, 0.01f}; 
+    bg.transform2d().scale = size;
     bg.setIsHidden(!isCurrentLevel);
+    bg.add<StaticComponent>();
 
     // Initialize level tiles based on tileData
     for (unsigned int y = 0; y < height; ++y)
@@ -363,15 +379,17 @@ void GameLevel::init(NileDevice& device,
                 glm::vec3 pos(unit_width * x - .93f, unit_height * y - .95f, 0.f);
                 glm::vec2 size(unit_width, unit_height);
                 
-                auto& obj = gom.createGameObject();
-                obj.diffuseMap = blockSolid;
-                obj.transform2d.translation = pos;
-                obj.transform2d.scale = size;
-                obj.color = glm::vec3(0.8f, 0.8f, 0.7f);
-                obj.isSolid = true;
-                obj.model = square;
+                auto obj = gom.createGameObject();
+                obj.render().diffuseMap = blockSolid;
+                obj.transform2d().translation = pos;
+                obj.transform2d().scale = size;
+                obj.render().color = glm::vec3(0.8f, 0.8f, 0.7f);
+                // solid bricks are never destroyed
+                obj.add<BrickComponent>().isSolid = true;
+                obj.add<StaticComponent>();
+                obj.render().model = square;
                 obj.setIsHidden(!isCurrentLevel);
-                bricks.push_back(obj.getId());
+                bricks.push_back(obj);
             }
             else if (tileData[y][x] > 1)
             {
@@ -388,14 +406,15 @@ void GameLevel::init(NileDevice& device,
                 glm::vec3 pos(unit_width * x - .93f, unit_height * y - .95f, 0.f);
                 glm::vec2 size(unit_width, unit_height);
 
-                auto& obj = gom.createGameObject();
-                obj.diffuseMap = block;
-                obj.transform2d.translation = pos;
-                obj.transform2d.scale = size;
-                obj.color = color;
-                obj.model = square;
+                auto obj = gom.createGameObject();
+                obj.render().diffuseMap = block;
+                obj.transform2d().translation = pos;
+                obj.transform2d().scale = size;
+                obj.render().color = color;
+                obj.render().model = square;
+                obj.add<BrickComponent>();
                 obj.setIsHidden(!isCurrentLevel);
-                bricks.push_back(obj.getId());
+                bricks.push_back(obj);
             }
         }
     }
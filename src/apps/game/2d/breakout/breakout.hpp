@@ -1,4 +1,4 @@
-//#pragma once
+#pragma once
 
 #include "apps/app.hpp"
 
@@ -15,7 +15,7 @@ namespace nile
 class Breakout : public App2D
 {
 public:
-    Breakout();
+    Breakout(const AppSettings &settings = {});
     ~Breakout() override;
 
     void loop() override;
@@ -34,8 +34,8 @@ private:
    
    KeyboardMovementController ballController{};
 
-   NileGameObject* player;
-   NileGameObject* ballobj;
+   NileGameObject player;
+   NileGameObject ballobj;
 private:
    std::vector<GameLevel> Levels;
    unsigned int           Level;
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "apps/app.hpp"
 
 #include "framework/systems/physics/gravity_system.hpp"
@@ -12,19 +14,19 @@ private:
     std::unique_ptr<NileModel>  createCircleSprite(NileDevice& device, unsigned int numSides);
     std::unique_ptr<NileModel>  createSquareSprite(NileDevice& device, glm::vec3 offset);
 
-    std::vector<NileGameObject*> vectorField{};
-    std::vector<NileGameObject*> physObjects{};
+    std::vector<NileGameObject> vectorField{};
+    std::vector<NileGameObject> physObjects{};
 
     void loadGameObjects() override;
 public:
-    Gravity();
+    Gravity(const AppSettings &settings = {});
     ~Gravity() override;
 
     void loop() override; 
     void start() override;
 };
 
-Gravity::Gravity(){}
+Gravity::Gravity(const AppSettings &settings) : App2D{settings} {}
 
 Gravity::~Gravity(){}
 
@@ -86,55 +88,58 @@ void Gravity::loadGameObjects() {
     std::shared_ptr<NileModel> circle = createCircleSprite(nileDevice, 22);
 
     // create physics objects
-    auto& blue = gameObjectManager.createGameObject();
-    blue.transform2d.scale = glm::vec2{.05f};
-    blue.transform2d.translation = {.5f, .5f};
-    blue.color = {0.f, 0.f, 1.f};
-    blue.rigidBody2d.velocity = {-.5f, .0f};
-    blue.model = circle;
-    physObjects.push_back(&blue);
-
-    auto& red = gameObjectManager.createGameObject();
-    red.transform2d.scale = glm::vec2{.05f};
-    red.transform2d.translation = {-.45f, -.25f};
-    red.color = {1.f, 0.f, 0.f};
-    red.rigidBody2d.velocity = {.5f, .0f};
-    red.model = circle;
-    physObjects.push_back(&red);
+    auto blue = gameObjectManager.createGameObject();
+    blue.transform2d().scale = glm::vec2{.05f};
+    blue.transform2d().translation = {.5f, .5f};
+    blue.render().color = {0.f, 0.f, 1.f};
+    blue.rigidBody2d().velocity = {-.5f, .0f};
+    blue.render().model = circle;
+    physObjects.push_back(blue);
+
+    auto red = gameObjectManager.createGameObject();
+    red.transform2d().scale = glm::vec2{.05f};
+    red.transform2d().translation = {-.45f, -.25f};
+    red.render().color = {1.f, 0.f, 0.f};
+    red.rigidBody2d().velocity = {.5f, .0f};
+    red.render().model = circle;
+    physObjects.push_back(red);
 
     // create vector field
     int gridCount = 30;
     for (int i = 0; i < gridCount; i++) {
         for (int j = 0; j < gridCount; j++) {
-            auto& vf = gameObjectManager.createGameObject();
-            vf.transform2d.scale = glm::vec2(0.005f);
-            vf.transform2d.translation = {
+            auto vf = gameObjectManager.createGameObject();
+            vf.transform2d().scale = glm::vec2(0.005f);
+            vf.transform2d().translation = {
                 -1.0f + (i + 0.5f) * 2.0f / gridCount,
                 -1.0f + (j + 0.5f) * 2.0f / gridCount,
             };
-            vf.color = {1.f, 1.f, 1.f};
-            vf.model = square;
-            vf.isVectorField = true;
-            vectorField.push_back(&vf);
+            vf.render().color = {1.f, 1.f, 1.f};
+            vf.render().model = square;
+            vectorField.push_back(vf);
         }
 
     }
 }
 
 void Gravity::loop() {
-    GravityPhysicsSystem gravitySystem{0.81f};
-    Vec2FieldSystem vecFieldSystem{};
+    GravityPhysicsSystem gravitySystem{0.81f, &jobSystem};
+    Vec2FieldSystem vecFieldSystem{&jobSystem};
     RenderSystem2D rendersys{
         nileDevice,
         nileRenderer.getSwapChainRenderPass(),
         globalSetLayout->getDescriptorSetLayout()
     };
+    loadGameObjects();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
 
     while (!nileWindow.shouldClose())
     {
-        glfwPollEvents();
+        {
+            NILE_PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime =
             std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -143,19 +148,21 @@ void Gravity::loop() {
         if (auto commandBuffer = nileRenderer.beginFrame()) {
             
             int frameIndex = nileRenderer.getFrameIndex();
-            framePools[frameIndex]->resetPool();
+            descriptorCache.beginFrame(frameIndex);
             FrameInfo frameInfo{
                 frameIndex,
                 frameTime,
                 commandBuffer,
                 camera,
                 globalDescriptorSets[frameIndex],
-                *framePools[frameIndex],
-                gameObjectManager.gameObjects};
+                descriptorCache,
+                gameObjectManager};
+            frameInfo.gpuProfiler = &nileRenderer.getGpuProfiler();
 
             // update systems
             gravitySystem.update(physObjects, 1.f / 60, 5);
-            vecFieldSystem.update(gravitySystem, gameObjectManager.gameObjects, vectorField);
+            vecFieldSystem.update(gravitySystem, physObjects, vectorField);
+            gameObjectManager.updateBuffer(frameIndex);
 
             // render system
             nileRenderer.beginSwapChainRenderPass(commandBuffer);
@@ -168,7 +175,6 @@ void Gravity::loop() {
 }
 
 void Gravity::start(){
-    loadGameObjects();
     loop();
 }
 
@@ -1,13 +1,16 @@
+#pragma once
+
 #include "apps/app.hpp"
 
 #include "framework/systems/lights/point_light_system.hpp"
 #include "framework/systems/mirror/mirror_system.hpp"
+#include "framework/core/nile_render_graph.hpp"
 
 namespace nile{
 class Mirror : public App3D {
 
 public:
-  Mirror();
+  Mirror(const AppSettings &settings = {});
   ~Mirror() override;
 
   void loop() override;
@@ -15,28 +18,56 @@ public:
 
 private:
   void loadGameObjects() override;
+  void createRenderGraph();
+
   NileGameObject::id_t target = 0;
+
+  NileRenderGraph renderGraph{nileDevice};
+  NileRenderGraph::ImageId reflectionImage = 0;
+  NileRenderGraph::PassId reflectionPass = 0;
+  NileRenderGraph::PassId scenePass = 0;
 };
 
-Mirror::Mirror() { 
-}
+Mirror::Mirror(const AppSettings &settings) : App3D{settings} {}
 
 void Mirror::start() {
-  nileRenderer.createOffScreen();
-  loadGameObjects();
+  createRenderGraph();
   loop();
 }
 
+void Mirror::createRenderGraph() {
+  const VkExtent2D reflectionExtent{512, 512};
+  reflectionImage =
+      renderGraph.createImage("reflection", {reflectionExtent, VK_FORMAT_R8G8B8A8_UNORM});
+  auto reflectionDepth = renderGraph.createImage(
+      "reflection depth", {reflectionExtent, renderGraph.findDepthFormat()});
+
+  reflectionPass = renderGraph.addPass("reflection")
+                       .writesColor(reflectionImage, {{0.01f, 0.01f, 0.01f, 1.0f}})
+                       .writesDepth(reflectionDepth)
+                       .recordsSecondaryBuffers();
+  scenePass = renderGraph.addSwapChainPass("scene")
+                  .samples(reflectionImage)
+                  .recordsSecondaryBuffers();
+  renderGraph.compile();
+
+  auto &stats = renderGraph.getStats();
+  std::cout << "Render graph: " << stats.passes << " passes, " << stats.culledPasses
+            << " culled, " << stats.barriersPerFrame << " barriers per frame, "
+            << stats.memoryBytes << " bytes of images (" << stats.unaliasedBytes
+            << " without aliasing)\n";
+}
+
 Mirror::~Mirror() {}
 
 void Mirror::loop() {
   RenderSystem3D objMirrored{
       nileDevice,
-      nileRenderer.getOffScreenRenderPass(),
+      renderGraph.getRenderPass(reflectionPass),
       globalSetLayout->getDescriptorSetLayout()};
   PointLightSystem pointLightMirrored{
       nileDevice,
-      nileRenderer.getOffScreenRenderPass(),
+      renderGraph.getRenderPass(reflectionPass),
       globalSetLayout->getDescriptorSetLayout()};
   RenderSystem3D objSystem{
       nileDevice,
@@ -51,13 +82,33 @@ void Mirror::loop() {
       nileRenderer.getSwapChainRenderPass(),
       globalSetLayout->getDescriptorSetLayout()
   };
+  loadGameObjects();
 
-  auto& viewerObject = gameObjectManager.createGameObject();
-  viewerObject.transform.translation.z = -2.5f;
-
+  renderGraph.setExecute(reflectionPass, [&](FrameInfo &frameInfo) {
+    objMirrored.renderGameObjects(frameInfo);
+    pointLightMirrored.render(frameInfo);
+  });
+  renderGraph.setExecute(scenePass, [&](FrameInfo &frameInfo) {
+    // order here matters
+    objSystem.renderGameObjects(frameInfo);
+    pointLightSystem.render(frameInfo);
+    mirrorSystem.renderMirrorPlane(frameInfo);
+
+    //Rendering UI
+    ui.renderUI(frameInfo.commandBuffer, nileRenderer);
+  });
+
+  auto viewerObject = gameObjectManager.createGameObject();
+  viewerObject.transform().translation.z = -2.5f;
+
+  ui.frame_settings = nileRenderer.getFrameSettings();
+  ui.gpu_profiler = &nileRenderer.getGpuProfiler();
   auto currentTime = std::chrono::high_resolution_clock::now();
   while (!nileWindow.shouldClose()) {
-    glfwPollEvents();
+    {
+      NILE_PROFILE_ZONE("glfwPollEvents");
+      glfwPollEvents();
+    }
 
     auto newTime = std::chrono::high_resolution_clock::now();
     float frameTime =
@@ -65,26 +116,35 @@ void Mirror::loop() {
     currentTime = newTime;
 
     cameraController.moveInPlaneXYZ(nileWindow.getGLFWwindow(), frameTime, viewerObject);
-    camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+    const auto &viewerTransform = viewerObject.readTransform();
+    camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
     float aspect = nileRenderer.getAspectRatio();
     camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
     // Start the DearImgui frame
+    ui.triangles_drawn = objSystem.getDrawStats().triangles;
+    ui.pacing_wait_ms = nileRenderer.getPacingStats().waitMs;
+    ui.pacing_spin_ms = nileRenderer.getPacingStats().spinMs;
     ui.startUI();
+    nileRenderer.setFrameSettings(ui.frame_settings);
+    objSystem.setLodQuality(ui.lod_pixel_error, nileRenderer.getSwapChainExtent().height);
 
     if (auto commandBuffer = nileRenderer.beginFrame()) 
     {
       int frameIndex = nileRenderer.getFrameIndex();
-      framePools[frameIndex]->resetPool();
+      descriptorCache.beginFrame(frameIndex);
+      commandRecorder.beginFrame(frameIndex);
       FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
-          *framePools[frameIndex],
-          gameObjectManager.gameObjects};
+          descriptorCache,
+          gameObjectManager,
+          &commandRecorder};
+      frameInfo.gpuProfiler = &nileRenderer.getGpuProfiler();
 
       // update
       GlobalUbo ubo{};
@@ -92,7 +152,7 @@ void Mirror::loop() {
       ubo.view = camera.getView();
       ubo.inverseView = camera.getInverseView();
 
-      pointLightSystem.update(frameInfo, ubo);
+      pointLightSystem.update(frameInfo, ubo, *lightClusters);
       
       uboBuffers[frameIndex]->writeToBuffer(&ubo);
       uboBuffers[frameIndex]->flush();
@@ -100,27 +160,13 @@ void Mirror::loop() {
       // final step of upate is updating the game objects buffer data
       // The render functions MUST not change a game objects transform data
       gameObjectManager.updateBuffer(frameIndex);
+      gameObjectManager.cull(camera.getFrustum());
 
       // objSystem.updateSceneObject(target, frameInfo);
+      objSystem.cull(frameInfo);
 
-      // offscreen
-      nileRenderer.beginOffScreenRenderPass(commandBuffer);
-      objMirrored.renderGameObjects(frameInfo);
-      pointLightMirrored.render(frameInfo);
-      nileRenderer.endOffScreenRenderPass(commandBuffer);
-
-      // render
-      nileRenderer.beginSwapChainRenderPass(commandBuffer);
-
-      // order here matters
-      objSystem.renderGameObjects(frameInfo);
-      pointLightSystem.render(frameInfo);      
-      mirrorSystem.renderMirrorPlane(frameInfo);
-
-      //Rendering UI
-      ui.renderUI(commandBuffer, nileRenderer);
-
-      nileRenderer.endSwapChainRenderPass(commandBuffer);
+      // the reflection pass, then the scene sampling it
+      renderGraph.execute(frameInfo, nileRenderer);
       nileRenderer.endFrame();
     }
   }
@@ -132,24 +178,23 @@ void Mirror::loadGameObjects() {
 
   std::shared_ptr<NileModel> plane = 
       NileModel::createModelFromFile(nileDevice, "resources/models/quad.obj");
-  auto& tile = gameObjectManager.createGameObject();
-  tile.model = plane;
-  tile.transform.translation = {-.6f, .25f, 0.f};
-  tile.transform.scale = {6.f, 1.f, 6.f};
-  tile.transform.rotation.z += 3.16f;
-  tile.transform.rotation.y += 3.f;
-  tile.reflectionTexture = nileRenderer.nileOffScreen;
-  tile.isMirror = true;
+  auto tile = gameObjectManager.createGameObject();
+  tile.render().model = plane;
+  tile.transform().translation = {-.6f, .25f, 0.f};
+  tile.transform().scale = {6.f, 1.f, 6.f};
+  tile.transform().rotation.z += 3.16f;
+  tile.transform().rotation.y += 3.f;
+  tile.add<MirrorComponent>().reflectionImage = renderGraph.getImageInfo(reflectionImage);
 
   std::shared_ptr<NileTexture> modelTexture =
         NileTexture::createTextureFromFile(nileDevice, "../resources/images/dragon.png");
   std::shared_ptr<NileModel> model = 
-      NileModel::createModelFromFile(nileDevice, "resources/models/dragon.obj");
-  auto& dragon = gameObjectManager.createGameObject();
-  dragon.model = model;
-  dragon.diffuseMap = modelTexture;
-  dragon.transform.translation = {0.f, -1.25f, 0.f};
-  dragon.transform.scale = {3.f, -1.f, 3.f};
+      NileModel::createModelFromFile(nileDevice, "resources/models/dragon.obj", 4);
+  auto dragon = gameObjectManager.createGameObject();
+  dragon.render().model = model;
+  dragon.render().diffuseMap = modelTexture;
+  dragon.transform().translation = {0.f, -1.25f, 0.f};
+  dragon.transform().scale = {3.f, -1.f, 3.f};
   target = dragon.getId();
   
   std::vector<glm::vec3> lightColors{
@@ -162,18 +207,18 @@ void Mirror::loadGameObjects() {
   };
 
   for (int i = 0; i < lightColors.size(); i++) {
-    auto& pointLight = gameObjectManager.makePointLight(0.2f);
-    pointLight.color = lightColors[i];
+    auto pointLight = gameObjectManager.makePointLight(0.2f);
+    pointLight.get<PointLightComponent>().color = lightColors[i];
     auto rotateLight = glm::rotate(
         glm::mat4(1.f),
         (i * glm::two_pi<float>()) / lightColors.size(),
         {0.f, -1.f, 0.f});
-    pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -2.99f, 1.f, 1.f));
+    pointLight.transform().translation = glm::vec3(rotateLight * glm::vec4(-1.f, -2.99f, 1.f, 1.f));
   }
 
-  auto& pointLight = gameObjectManager.makePointLight(0.2f);
-  pointLight.color = glm::vec3(1.f);
-  pointLight.transform.translation = {0.f, -2.99f, 0.f};
-  pointLight.transform.scale = glm::vec3(.3f);
+  auto pointLight = gameObjectManager.makePointLight(0.2f);
+  pointLight.get<PointLightComponent>().color = glm::vec3(1.f);
+  pointLight.transform().translation = {0.f, -2.99f, 0.f};
+  pointLight.transform().scale = glm::vec3(.3f);
 }
 } // namespace nile
@@ -1,10 +1,12 @@
+#pragma once
+
 #include "apps/app.hpp"
 
 namespace nile{
     class Skybox : public App3D {
 
     public:
-    Skybox();
+    Skybox(const AppSettings &settings = {});
     ~Skybox() override;
 
     void loop() override;
@@ -15,12 +17,11 @@ namespace nile{
 
     };
 
-    Skybox::Skybox() {}
+    Skybox::Skybox(const AppSettings &settings) : App3D{settings} {}
 
     Skybox::~Skybox() {}
 
     void Skybox::start() {
-        loadGameObjects();
         loop();
     }
 
@@ -30,16 +31,22 @@ namespace nile{
             nileDevice,
             nileRenderer.getSwapChainRenderPass(),
             globalSetLayout->getDescriptorSetLayout()};
+        loadGameObjects();
 
-        auto& viewerObject = gameObjectManager.createGameObject();
+        auto viewerObject = gameObjectManager.createGameObject();
 
-        viewerObject.transform.translation.z = -2.5f;
+        viewerObject.transform().translation.z = -2.5f;
 
+        ui.frame_settings = nileRenderer.getFrameSettings();
+        ui.gpu_profiler = &nileRenderer.getGpuProfiler();
         auto currentTime = std::chrono::high_resolution_clock::now();
 
         while (!nileWindow.shouldClose())
         {
-            glfwPollEvents();
+            {
+                NILE_PROFILE_ZONE("glfwPollEvents");
+                glfwPollEvents();
+            }
 
             auto newTime = std::chrono::high_resolution_clock::now();
 
@@ -48,27 +55,30 @@ namespace nile{
             currentTime = newTime;
 
             cameraController.moveInPlaneXYZ(nileWindow.getGLFWwindow(), frameTime, viewerObject);
-            camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+            const auto &viewerTransform = viewerObject.readTransform();
+            camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
             float aspect = nileRenderer.getAspectRatio();
 
             camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
             ui.startUI();
+            nileRenderer.setFrameSettings(ui.frame_settings);
 
             if (auto commandBuffer = nileRenderer.beginFrame())
             {
                 int frameIndex = nileRenderer.getFrameIndex();
-                framePools[frameIndex]->resetPool();
+                descriptorCache.beginFrame(frameIndex);
                 FrameInfo frameInfo{
                     frameIndex,
                     frameTime,
                     commandBuffer,
                     camera,
                     globalDescriptorSets[frameIndex],
-                    *framePools[frameIndex],
-                    gameObjectManager.gameObjects
+                    descriptorCache,
+                    gameObjectManager
                 };
+                frameInfo.gpuProfiler = &nileRenderer.getGpuProfiler();
 
                 // update
                 GlobalUbo ubo{};
@@ -79,6 +89,8 @@ namespace nile{
                 uboBuffers[frameIndex]->flush();
 
                 gameObjectManager.updateBuffer(frameIndex);
+                gameObjectManager.cull(camera.getFrustum());
+                renderSystem3D.cull(frameInfo);
 
                 nileRenderer.beginSwapChainRenderPass(commandBuffer);
 
@@ -97,10 +109,10 @@ namespace nile{
         void Skybox::loadGameObjects() {
             std::shared_ptr<NileModel> floor_mesh =
                 NileModel::createModelFromFile(nileDevice, "resources/models/quad.obj");
-            auto& floor = gameObjectManager.createGameObject();
-            floor.model = floor_mesh;
-            floor.transform.translation = {0.f, .25f, 0.f};
-            floor.transform.scale = {3.f, 1.f, 3.f};
+            auto floor = gameObjectManager.createGameObject();
+            floor.render().model = floor_mesh;
+            floor.transform().translation = {0.f, .25f, 0.f};
+            floor.transform().scale = {3.f, 1.f, 3.f};
 
         }
 
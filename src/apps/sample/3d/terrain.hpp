@@ -1,3 +1,5 @@
+#pragma once
+
 #include "apps/app.hpp"
 
 #include "framework/systems/lights/point_light_system.hpp"
@@ -7,7 +9,7 @@ namespace nile{
 class Terrain : public App3D {
 
 public:
-  Terrain();
+  Terrain(const AppSettings &settings = {});
   ~Terrain() override;
 
   void loop() override;
@@ -18,13 +20,9 @@ private:
   NileGameObject::id_t obj_id = 0;
 };
 
-Terrain::Terrain() { 
-}
+Terrain::Terrain(const AppSettings &settings) : App3D{settings} {}
 
-void Terrain::start() {
-  loadGameObjects();
-  loop();
-}
+void Terrain::start() { loop(); }
 
 Terrain::~Terrain() {}
 
@@ -37,12 +35,19 @@ void Terrain::loop() {
       nileDevice,
       nileRenderer.getSwapChainRenderPass(),
       globalSetLayout->getDescriptorSetLayout()};
-  auto& viewerObject = gameObjectManager.createGameObject();
-  viewerObject.transform.translation.z = -2.5f;
+  loadGameObjects();
+
+  auto viewerObject = gameObjectManager.createGameObject();
+  viewerObject.transform().translation.z = -2.5f;
 
+  ui.frame_settings = nileRenderer.getFrameSettings();
+  ui.gpu_profiler = &nileRenderer.getGpuProfiler();
   auto currentTime = std::chrono::high_resolution_clock::now();
   while (!nileWindow.shouldClose()) {
-    glfwPollEvents();
+    {
+      NILE_PROFILE_ZONE("glfwPollEvents");
+      glfwPollEvents();
+    }
 
     auto newTime = std::chrono::high_resolution_clock::now();
     float frameTime =
@@ -50,26 +55,29 @@ void Terrain::loop() {
     currentTime = newTime;
 
     cameraController.moveInPlaneXYZ(nileWindow.getGLFWwindow(), frameTime, viewerObject);
-    camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+    const auto &viewerTransform = viewerObject.readTransform();
+    camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
 
     float aspect = nileRenderer.getAspectRatio();
     camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
     // Start the DearImgui frame
     ui.startUI();
+    nileRenderer.setFrameSettings(ui.frame_settings);
 
     if (auto commandBuffer = nileRenderer.beginFrame()) 
     {
       int frameIndex = nileRenderer.getFrameIndex();
-      framePools[frameIndex]->resetPool();
+      descriptorCache.beginFrame(frameIndex);
       FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
           globalDescriptorSets[frameIndex],
-          *framePools[frameIndex],
-          gameObjectManager.gameObjects};
+          descriptorCache,
+          gameObjectManager};
+      frameInfo.gpuProfiler = &nileRenderer.getGpuProfiler();
 
       // update
       GlobalUbo ubo{};
@@ -77,7 +85,7 @@ void Terrain::loop() {
       ubo.view = camera.getView();
       ubo.inverseView = camera.getInverseView();
       if (ui.enable_point_lights) {
-        pointLightSystem.update(frameInfo, ubo);
+        pointLightSystem.update(frameInfo, ubo, *lightClusters);
       }
       uboBuffers[frameIndex]->writeToBuffer(&ubo);
       uboBuffers[frameIndex]->flush();
@@ -85,10 +93,12 @@ void Terrain::loop() {
       // final step of upate is updating the game objects buffer data
       // The render functions MUST not change a game objects transform data
       gameObjectManager.updateBuffer(frameIndex);
+      gameObjectManager.cull(camera.getFrustum());
 
       // gameObjectManager.updateFromScene(obj_id, ui.terrain_pos, ui.terrain_rot, ui.set_show_model);
 
       // render
+      renderSystem3D.cull(frameInfo);
       nileRenderer.beginSwapChainRenderPass(commandBuffer);
 
       // order here matters
@@ -116,28 +126,31 @@ void Terrain::loadGameObjects() {
     0,
     0,
     nullptr, 
-    "../resources/images/heightMap.png"};
+    "../resources/images/heightMap.png",
+    &jobSystem};
     
 
   std::shared_ptr<NileModel> mesh = proceduralTerrain.mesh;
   std::shared_ptr<NileTexture> simpleTexture =
       NileTexture::createTextureFromFile(nileDevice, "../resources/images/simple.png");
-  auto& terrain = gameObjectManager.createGameObject();
-  terrain.model = mesh;
-  terrain.transform.translation = {ui.terrain_pos.x, -ui.terrain_pos.y, ui.terrain_pos.z};
-  terrain.transform.scale = {1.5f, 1.f, 1.5f};
-  terrain.transform.rotation = {ui.terrain_rot.x, ui.terrain_rot.y, ui.terrain_rot.z};
-  // terrain.color  = {6.f, 1.f, 6.f};
-  // terrain.diffuseMap = simpleTexture;
+  auto terrain = gameObjectManager.createGameObject();
+  terrain.render().model = mesh;
+  terrain.transform().translation = {ui.terrain_pos.x, -ui.terrain_pos.y, ui.terrain_pos.z};
+  terrain.transform().scale = {1.5f, 1.f, 1.5f};
+  terrain.transform().rotation = {ui.terrain_rot.x, ui.terrain_rot.y, ui.terrain_rot.z};
+  terrain.add<StaticComponent>();
+  // terrain.render().color  = {6.f, 1.f, 6.f};
+  // terrain.render().diffuseMap = simpleTexture;
   obj_id = terrain.getId();
 
   std::shared_ptr<NileModel> floorModel = 
       NileModel::createModelFromFile(nileDevice, "resources/models/quad.obj");
-  auto& floor = gameObjectManager.createGameObject();
-  floor.model = floorModel;
-  floor.transform.translation = {0.f, .25f, 0.f};
-  floor.transform.scale = {3.f, 1.f, 3.f};
-  // floor.color  = {6.f, 1.f, 6.f};
+  auto floor = gameObjectManager.createGameObject();
+  floor.render().model = floorModel;
+  floor.transform().translation = {0.f, .25f, 0.f};
+  floor.transform().scale = {3.f, 1.f, 3.f};
+  floor.add<StaticComponent>();
+  // floor.render().color  = {6.f, 1.f, 6.f};
   
   std::vector<glm::vec3> lightColors{
       {1.f, .1f, .1f},
@@ -149,17 +162,17 @@ void Terrain::loadGameObjects() {
   };
 
   for (int i = 0; i < lightColors.size(); i++) {
-    auto& pointLight = gameObjectManager.makePointLight(0.2f);
-    pointLight.color = lightColors[i];
+    auto pointLight = gameObjectManager.makePointLight(0.2f);
+    pointLight.get<PointLightComponent>().color = lightColors[i];
     auto rotateLight = glm::rotate(
         glm::mat4(1.f),
         (i * glm::two_pi<float>()) / lightColors.size(),
         {0.f, -1.f, 0.f});
-    pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+    pointLight.transform().translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
   }
 
-  auto& pointLight = gameObjectManager.makePointLight(0.2f);
-  pointLight.color = glm::vec3(1.f);
-  pointLight.transform.translation = {0.f, -1.f, 0.f};
+  auto pointLight = gameObjectManager.makePointLight(0.2f);
+  pointLight.get<PointLightComponent>().color = glm::vec3(1.f);
+  pointLight.transform().translation = {0.f, -1.f, 0.f};
 }
 } // namespace nile
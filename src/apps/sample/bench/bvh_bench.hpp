@@ -0,0 +1,231 @@
+#pragma once
+
+#include "framework/core/nile_bvh.hpp"
+#include "framework/core/nile_camera.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace nile
+{
+
+// Times building, refitting and querying NileBvh with 1k, 10k and 100k boxes spread at a
+// constant density, next to a brute force loop over the same boxes. Needs no window or device,
+// run with --bench-bvh.
+class BvhBench
+{
+public:
+    void run();
+
+private:
+    static constexpr int REPEATS = 5;
+    static constexpr int QUERY_COUNT = 1000;
+
+    struct Scene {
+        std::vector<BoundingBox> boxes;
+        std::vector<BoundingBox> movedBoxes;   // jittered inside the fat margin
+        std::vector<BoundingBox> farBoxes;     // moved far enough to be reinserted
+        std::vector<BoundingBox> queryBoxes;
+        std::vector<glm::vec3> rayOrigins;
+        std::vector<glm::vec3> rayDirections;
+        float worldSize = 0.f;
+    };
+
+    static Scene makeScene(size_t count, std::mt19937& rng);
+    static BoundingBox boxAround(const glm::vec3& center, float halfSize);
+    static bool overlaps(const BoundingBox& a, const BoundingBox& b);
+
+    // best of REPEATS, in milliseconds. setup runs untimed before every repeat.
+    double time(const std::function<void()>& setup, const std::function<void()>& body);
+    void report(const char* name, size_t count, double ms, size_t operations);
+};
+
+BoundingBox BvhBench::boxAround(const glm::vec3& center, float halfSize)
+{
+    return {center - glm::vec3(halfSize), center + glm::vec3(halfSize)};
+}
+
+bool BvhBench::overlaps(const BoundingBox& a, const BoundingBox& b)
+{
+    return a.minCorner.x <= b.maxCorner.x && a.maxCorner.x >= b.minCorner.x &&
+           a.minCorner.y <= b.maxCorner.y && a.maxCorner.y >= b.minCorner.y &&
+           a.minCorner.z <= b.maxCorner.z && a.maxCorner.z >= b.minCorner.z;
+}
+
+BvhBench::Scene BvhBench::makeScene(size_t count, std::mt19937& rng)
+{
+    // about one object per 64 cubic units whatever the count
+    Scene scene{};
+    scene.worldSize = std::cbrt(static_cast<float>(count)) * 4.f;
+    std::uniform_real_distribution<float> position(0.f, scene.worldSize);
+    std::uniform_real_distribution<float> halfSize(0.1f, 1.f);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+    std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec3 center{position(rng), position(rng), position(rng)};
+        const float size = halfSize(rng);
+        scene.boxes.push_back(boxAround(center, size));
+        scene.movedBoxes.push_back(
+            boxAround(center + glm::vec3{jitter(rng), jitter(rng), jitter(rng)}, size));
+        scene.farBoxes.push_back(boxAround({position(rng), position(rng), position(rng)}, size));
+    }
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        scene.queryBoxes.push_back(boxAround({position(rng), position(rng), position(rng)}, 4.f));
+        scene.rayOrigins.push_back({position(rng), position(rng), position(rng)});
+        scene.rayDirections.push_back(
+            glm::normalize(glm::vec3{direction(rng), direction(rng), direction(rng)} + 1e-3f));
+    }
+    return scene;
+}
+
+void BvhBench::run()
+{
+    std::mt19937 rng{1234};
+    std::printf("%-24s %8s %10s %12s\n", "operation", "objects", "ms", "ns/op");
+
+    for (size_t count : {size_t{1000}, size_t{10000}, size_t{100000}}) {
+        const Scene scene = makeScene(count, rng);
+        NileBvh bvh{};
+        std::vector<int32_t> proxies(count);
+        size_t hits = 0;
+
+        auto build = [&]() {
+            for (size_t i = 0; i < count; i++) {
+                proxies[i] = bvh.insert(scene.boxes[i], static_cast<uint32_t>(i));
+            }
+        };
+
+        report("insert", count, time([&]() { bvh.clear(); }, build), count);
+        report(
+            "refit in margin",
+            count,
+            time(
+                [&]() {
+                    bvh.clear();
+                    build();
+                },
+                [&]() {
+                    for (size_t i = 0; i < count; i++) bvh.move(proxies[i], scene.movedBoxes[i]);
+                }),
+            count);
+        report(
+            "refit reinsert",
+            count,
+            time(
+                [&]() {
+                    bvh.clear();
+                    build();
+                },
+                [&]() {
+                    for (size_t i = 0; i < count; i++) bvh.move(proxies[i], scene.farBoxes[i]);
+                }),
+            count);
+
+        bvh.clear();
+        build();
+        auto noSetup = []() {};
+        report(
+            "aabb query",
+            count,
+            time(noSetup,
+                 [&]() {
+                     for (const auto& query : scene.queryBoxes) {
+                         bvh.queryOverlap(query, [&](uint32_t) { hits++; });
+                     }
+                 }),
+            QUERY_COUNT);
+        report(
+            "aabb brute force",
+            count,
+            time(noSetup,
+                 [&]() {
+                     for (const auto& query : scene.queryBoxes) {
+                         for (const auto& box : scene.boxes) {
+                             if (overlaps(box, query)) hits++;
+                         }
+                     }
+                 }),
+            QUERY_COUNT);
+        report(
+            "sphere query",
+            count,
+            time(noSetup,
+                 [&]() {
+                     for (const auto& query : scene.queryBoxes) {
+                         bvh.querySphere({query.center(), 4.f}, [&](uint32_t) { hits++; });
+                     }
+                 }),
+            QUERY_COUNT);
+        report(
+            "ray query",
+            count,
+            time(noSetup,
+                 [&]() {
+                     for (int i = 0; i < QUERY_COUNT; i++) {
+                         bvh.queryRay(
+                             scene.rayOrigins[i],
+                             scene.rayDirections[i],
+                             scene.worldSize * 0.25f,
+                             [&](uint32_t) { hits++; });
+                     }
+                 }),
+            QUERY_COUNT);
+
+        // a camera in one corner looking at the middle of the scene
+        NileCamera camera{};
+        camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.1f, scene.worldSize);
+        camera.setViewTarget(glm::vec3(0.f), glm::vec3(scene.worldSize * 0.5f));
+        const NileFrustum frustum = camera.getFrustum();
+        report(
+            "frustum query",
+            count,
+            time(noSetup, [&]() { bvh.queryFrustum(frustum, [&](uint32_t) { hits++; }); }),
+            1);
+        report(
+            "frustum brute force",
+            count,
+            time(noSetup,
+                 [&]() {
+                     for (const auto& box : scene.boxes) {
+                         if (frustum.intersects(box)) hits++;
+                     }
+                 }),
+            1);
+
+        // keeps the query loops from being optimized away
+        std::printf("%-24s %8zu height %d, %zu hits\n", "tree", count, bvh.getHeight(), hits);
+    }
+}
+
+double BvhBench::time(const std::function<void()>& setup, const std::function<void()>& body)
+{
+    double best = 0.0;
+    for (int i = 0; i < REPEATS; i++) {
+        setup();
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = i == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+void BvhBench::report(const char* name, size_t count, double ms, size_t operations)
+{
+    std::printf("%-24s %8zu %10.3f %12.1f\n", name, count, ms, ms * 1e6 / operations);
+}
+
+} // namespace nile
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "framework/core/nile_job_system.hpp"
+#include "framework/systems/physics/gravity_system.hpp"
+#include "framework/systems/physics/vec2_field_system.hpp"
+#include "framework/systems/terrain/heights_generator_system.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nile
+{
+
+// Times the parallel engine workloads with 1..N threads and prints the speedup over one thread.
+// Needs no window or device, run with --bench-jobs.
+class JobSystemBench
+{
+public:
+    void run();
+
+private:
+    static constexpr int REPEATS = 5;
+
+    struct Workload {
+        std::string name;
+        std::function<void(NileJobSystem&)> body;
+    };
+
+    // best of REPEATS, in milliseconds
+    double time(NileJobSystem& jobs, const std::function<void(NileJobSystem&)>& body);
+};
+
+void JobSystemBench::run()
+{
+    const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // n-body gravity, the pair loop of GravityPhysicsSystem
+    std::vector<glm::vec2> positions(2048);
+    std::vector<glm::vec2> velocities(positions.size());
+    std::vector<float> masses(positions.size(), 1.0f);
+    for (size_t i = 0; i < positions.size(); i++) {
+        positions[i] = {std::cos(i * 0.37f) * (1.0f + i * 1e-3f), std::sin(i * 0.37f)};
+    }
+
+    // 256x256 field lines around 16 bodies
+    std::vector<TransformComponent2d> field(256 * 256);
+    std::vector<TransformComponent2d*> fieldTransforms;
+    for (size_t i = 0; i < field.size(); i++) {
+        field[i].translation = {(i % 256) / 128.0f - 1.0f, (i / 256) / 128.0f - 1.0f};
+        fieldTransforms.push_back(&field[i]);
+    }
+    std::vector<glm::vec2> bodyPositions(positions.begin(), positions.begin() + 16);
+    std::vector<float> bodyMasses(bodyPositions.size(), 1.0f);
+
+    // terrain heights, one row per chunk like ProceduralTerrain::generateTerrain
+    constexpr int TERRAIN_SIZE = 32;
+    HeightsGenerator heightsGenerator{0, 0, TERRAIN_SIZE, 1234};
+    std::vector<float> heights(TERRAIN_SIZE * TERRAIN_SIZE);
+
+    std::vector<Workload> workloads{
+        {"gravity 2048 bodies",
+         [&](NileJobSystem& jobs) {
+             GravityPhysicsSystem gravity{0.81f, &jobs};
+             gravity.stepBodies(positions, velocities, masses, 1.0f / 600);
+         }},
+        {"vector field 65536 lines",
+         [&](NileJobSystem& jobs) {
+             GravityPhysicsSystem gravity{0.81f};
+             Vec2FieldSystem fieldSystem{&jobs};
+             fieldSystem.updateField(gravity, bodyPositions, bodyMasses, fieldTransforms);
+         }},
+        {"terrain 32x32 heights",
+         [&](NileJobSystem& jobs) {
+             jobs.parallelFor(TERRAIN_SIZE, 1, [&](uint32_t begin, uint32_t end) {
+                 for (uint32_t z = begin; z < end; z++) {
+                     for (int x = 0; x < TERRAIN_SIZE; x++) {
+                         heights[z * TERRAIN_SIZE + x] = heightsGenerator.generateHeight(x, z);
+                     }
+                 }
+             });
+         }},
+        {"4096 chained jobs",
+         [&](NileJobSystem& jobs) {
+             // 64 chains of 64 tiny jobs, each waiting on the previous one in its chain
+             std::vector<NileJobCounter> links(64 * 64);
+             for (int chain = 0; chain < 64; chain++) {
+                 for (int step = 0; step < 64; step++) {
+                     NileJobCounter& link = links[chain * 64 + step];
+                     auto job = []() {};
+                     if (step == 0) {
+                         jobs.submit(job, &link);
+                     } else {
+                         jobs.submitAfter(links[chain * 64 + step - 1], job, &link);
+                     }
+                 }
+             }
+             for (auto& link : links) {
+                 jobs.wait(link);
+             }
+         }},
+    };
+
+    std::printf("%-28s %8s %10s %8s\n", "workload", "threads", "ms", "speedup");
+    for (auto& workload : workloads) {
+        double singleThreaded = 0.0;
+        for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+            NileJobSystem jobs{threads - 1};
+            const double ms = time(jobs, workload.body);
+            if (threads == 1) singleThreaded = ms;
+            std::printf(
+                "%-28s %8u %10.3f %7.2fx\n",
+                workload.name.c_str(),
+                threads,
+                ms,
+                singleThreaded / ms);
+        }
+    }
+}
+
+double JobSystemBench::time(NileJobSystem& jobs, const std::function<void(NileJobSystem&)>& body)
+{
+    body(jobs);  // warm up
+    double best = 0.0;
+    for (int i = 0; i < REPEATS; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body(jobs);
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = i == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+} // namespace nile
@@ -0,0 +1,55 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <limits>
+
+namespace nile{
+
+// Axis aligned box, empty until the first point is added
+struct BoundingBox {
+  glm::vec3 minCorner{std::numeric_limits<float>::max()};
+  glm::vec3 maxCorner{std::numeric_limits<float>::lowest()};
+
+  bool isEmpty() const { return minCorner.x > maxCorner.x; }
+
+  void expand(const glm::vec3 &point) {
+    minCorner = glm::min(minCorner, point);
+    maxCorner = glm::max(maxCorner, point);
+  }
+
+  glm::vec3 center() const { return (minCorner + maxCorner) * 0.5f; }
+  glm::vec3 extents() const { return (maxCorner - minCorner) * 0.5f; }
+
+  // Box around this one after transform, each axis of the result takes the absolute
+  // contribution of every rotated and scaled input axis
+  BoundingBox transformed(const glm::mat4 &transform) const {
+    const glm::vec3 newCenter = glm::vec3(transform * glm::vec4(center(), 1.f));
+    const glm::vec3 halfSize = extents();
+    const glm::vec3 newHalfSize = glm::abs(glm::vec3(transform[0])) * halfSize.x +
+                                  glm::abs(glm::vec3(transform[1])) * halfSize.y +
+                                  glm::abs(glm::vec3(transform[2])) * halfSize.z;
+    return {newCenter - newHalfSize, newCenter + newHalfSize};
+  }
+};
+
+struct BoundingSphere {
+  glm::vec3 center{};
+  float radius = 0.f;
+
+  // Sphere around this one after transform, the radius grows with the largest axis scale
+  BoundingSphere transformed(const glm::mat4 &transform) const {
+    const float scale = std::max(
+        {glm::length(glm::vec3(transform[0])),
+         glm::length(glm::vec3(transform[1])),
+         glm::length(glm::vec3(transform[2]))});
+    return {glm::vec3(transform * glm::vec4(center, 1.f)), radius * scale};
+  }
+};
+
+}  // namespace nile
@@ -48,6 +48,7 @@ NileBuffer::NileBuffer(
 
 NileBuffer::~NileBuffer() {
   unmap();
+  nileDevice.retireHandle((uint64_t)(buffer));
   vkDestroyBuffer(nileDevice.device(), buffer, nullptr);
   vkFreeMemory(nileDevice.device(), memory, nullptr);
 }
@@ -180,6 +181,34 @@ VkResult NileBuffer::flushIndex(int index) {
   return flush(alignmentSize, index * alignmentSize); 
 }
 
+/**
+ * Flush several runs of consecutive indices with a single vkFlushMappedMemoryRanges call
+ *
+ * @param ranges Runs of indices, each covering [firstIndex, firstIndex + count)
+ *
+ * @return VkResult of the flush call
+ */
+VkResult NileBuffer::flushIndexRanges(const std::vector<IndexRange> &ranges) {
+  assert(
+    alignmentSize % nileDevice.properties.limits.nonCoherentAtomSize == 0 &&
+    "Cannot use NileBuffer::flushIndexRanges if alignmentSize isn't a multiple of Device Limits "
+    "nonCoherentAtomSize");
+  if (ranges.empty()) return VK_SUCCESS;
+
+  std::vector<VkMappedMemoryRange> mappedRanges(ranges.size());
+  for (size_t i = 0; i < ranges.size(); i++) {
+    assert(ranges[i].firstIndex + ranges[i].count <= instanceCount && "Flush range out of bounds");
+    mappedRanges[i].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mappedRanges[i].memory = memory;
+    mappedRanges[i].offset = ranges[i].firstIndex * alignmentSize;
+    mappedRanges[i].size = ranges[i].count * alignmentSize;
+  }
+  return vkFlushMappedMemoryRanges(
+      nileDevice.device(),
+      static_cast<uint32_t>(mappedRanges.size()),
+      mappedRanges.data());
+}
+
 /**
  * Create a buffer info descriptor
  *
@@ -2,10 +2,18 @@
 
 #include "nile_device.hpp"
 
+// std
+#include <vector>
+
 namespace nile{
 
 class NileBuffer {
  public:
+  struct IndexRange {
+    uint32_t firstIndex;
+    uint32_t count;
+  };
+
   NileBuffer(
       NileDevice& device,
       VkDeviceSize instanceSize,
@@ -30,6 +38,7 @@ class NileBuffer {
 
   void writeToIndex(void* data, int index);
   VkResult flushIndex(int index);
+  VkResult flushIndexRanges(const std::vector<IndexRange>& ranges);
   VkDescriptorBufferInfo descriptorInfoForIndex(int index);
   VkResult invalidateIndex(int index);
 
@@ -37,7 +46,7 @@ class NileBuffer {
   void* getMappedMemory() const { return mapped; }
   uint32_t getInstanceCount() const { return instanceCount; }
   VkDeviceSize getInstanceSize() const { return instanceSize; }
-  VkDeviceSize getAlignmentSize() const { return instanceSize; }
+  VkDeviceSize getAlignmentSize() const { return alignmentSize; }
   VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
   VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
   VkDeviceSize getBufferSize() const { return bufferSize; }
@@ -0,0 +1,253 @@
+#include "nile_bvh.hpp"
+
+// std
+#include <algorithm>
+#include <utility>
+
+namespace nile{
+
+namespace {
+
+BoundingBox merge(const BoundingBox &a, const BoundingBox &b) {
+  return {glm::min(a.minCorner, b.minCorner), glm::max(a.maxCorner, b.maxCorner)};
+}
+
+bool contains(const BoundingBox &outer, const BoundingBox &inner) {
+  return outer.minCorner.x <= inner.minCorner.x && outer.minCorner.y <= inner.minCorner.y &&
+         outer.minCorner.z <= inner.minCorner.z && outer.maxCorner.x >= inner.maxCorner.x &&
+         outer.maxCorner.y >= inner.maxCorner.y && outer.maxCorner.z >= inner.maxCorner.z;
+}
+
+// surface area, the insertion cost of the surface area heuristic
+float area(const BoundingBox &box) {
+  const glm::vec3 size = box.maxCorner - box.minCorner;
+  return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+}  // namespace
+
+int32_t NileBvh::insert(const BoundingBox &box, uint32_t userData) {
+  const int32_t proxy = allocateNode();
+  nodes[proxy].box = {box.minCorner - glm::vec3(margin), box.maxCorner + glm::vec3(margin)};
+  nodes[proxy].userData = userData;
+  nodes[proxy].height = 0;
+  insertLeaf(proxy);
+  leafCount++;
+  return proxy;
+}
+
+void NileBvh::remove(int32_t proxy) {
+  assert(proxy >= 0 && proxy < static_cast<int32_t>(nodes.size()) && nodes[proxy].isLeaf());
+  removeLeaf(proxy);
+  freeNode(proxy);
+  leafCount--;
+}
+
+bool NileBvh::move(int32_t proxy, const BoundingBox &box) {
+  assert(proxy >= 0 && proxy < static_cast<int32_t>(nodes.size()) && nodes[proxy].isLeaf());
+  if (contains(nodes[proxy].box, box)) return false;
+
+  removeLeaf(proxy);
+  nodes[proxy].box = {box.minCorner - glm::vec3(margin), box.maxCorner + glm::vec3(margin)};
+  insertLeaf(proxy);
+  return true;
+}
+
+void NileBvh::clear() {
+  nodes.clear();
+  root = NULL_NODE;
+  freeList = NULL_NODE;
+  leafCount = 0;
+}
+
+bool NileBvh::rayHits(
+    const BoundingBox &box,
+    const glm::vec3 &origin,
+    const glm::vec3 &inverseDirection,
+    float maxDistance) {
+  // slab test, infinite inverse components sort themselves out through the min/max
+  float entry = 0.f;
+  float exit = maxDistance;
+  for (int axis = 0; axis < 3; axis++) {
+    float t1 = (box.minCorner[axis] - origin[axis]) * inverseDirection[axis];
+    float t2 = (box.maxCorner[axis] - origin[axis]) * inverseDirection[axis];
+    if (t1 > t2) std::swap(t1, t2);
+    entry = std::max(entry, t1);
+    exit = std::min(exit, t2);
+    if (entry > exit) return false;
+  }
+  return true;
+}
+
+int32_t NileBvh::allocateNode() {
+  if (freeList == NULL_NODE) {
+    nodes.emplace_back();
+    return static_cast<int32_t>(nodes.size() - 1);
+  }
+  const int32_t index = freeList;
+  freeList = nodes[index].parent;
+  nodes[index] = Node{};
+  return index;
+}
+
+void NileBvh::freeNode(int32_t index) {
+  nodes[index].parent = freeList;
+  nodes[index].child1 = NULL_NODE;
+  nodes[index].child2 = NULL_NODE;
+  nodes[index].height = -1;
+  freeList = index;
+}
+
+void NileBvh::insertLeaf(int32_t leaf) {
+  if (root == NULL_NODE) {
+    root = leaf;
+    nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // walk down to the cheapest sibling, a branch costs its grown area plus what every node
+  // above it grows by
+  const BoundingBox leafBox = nodes[leaf].box;
+  int32_t index = root;
+  while (!nodes[index].isLeaf()) {
+    const Node &node = nodes[index];
+    const float nodeArea = area(node.box);
+    const float combinedArea = area(merge(node.box, leafBox));
+
+    const float cost = 2.f * combinedArea;
+    const float inheritedCost = 2.f * (combinedArea - nodeArea);
+
+    auto childCost = [&](int32_t child) {
+      const BoundingBox grown = merge(leafBox, nodes[child].box);
+      if (nodes[child].isLeaf()) return area(grown) + inheritedCost;
+      return area(grown) - area(nodes[child].box) + inheritedCost;
+    };
+    const float cost1 = childCost(node.child1);
+    const float cost2 = childCost(node.child2);
+
+    if (cost < cost1 && cost < cost2) break;
+    index = cost1 < cost2 ? node.child1 : node.child2;
+  }
+  const int32_t sibling = index;
+
+  // a new parent takes the sibling's place
+  const int32_t oldParent = nodes[sibling].parent;
+  const int32_t newParent = allocateNode();
+  nodes[newParent].parent = oldParent;
+  nodes[newParent].box = merge(leafBox, nodes[sibling].box);
+  nodes[newParent].height = nodes[sibling].height + 1;
+  nodes[newParent].child1 = sibling;
+  nodes[newParent].child2 = leaf;
+  nodes[sibling].parent = newParent;
+  nodes[leaf].parent = newParent;
+
+  if (oldParent == NULL_NODE) {
+    root = newParent;
+  } else if (nodes[oldParent].child1 == sibling) {
+    nodes[oldParent].child1 = newParent;
+  } else {
+    nodes[oldParent].child2 = newParent;
+  }
+
+  refitAncestors(nodes[leaf].parent);
+}
+
+void NileBvh::removeLeaf(int32_t leaf) {
+  if (leaf == root) {
+    root = NULL_NODE;
+    return;
+  }
+
+  // the sibling takes the parent's place
+  const int32_t parent = nodes[leaf].parent;
+  const int32_t grandParent = nodes[parent].parent;
+  const int32_t sibling =
+      nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+  if (grandParent == NULL_NODE) {
+    root = sibling;
+    nodes[sibling].parent = NULL_NODE;
+    freeNode(parent);
+    return;
+  }
+
+  if (nodes[grandParent].child1 == parent) {
+    nodes[grandParent].child1 = sibling;
+  } else {
+    nodes[grandParent].child2 = sibling;
+  }
+  nodes[sibling].parent = grandParent;
+  freeNode(parent);
+
+  refitAncestors(grandParent);
+}
+
+void NileBvh::refitAncestors(int32_t index) {
+  while (index != NULL_NODE) {
+    index = balance(index);
+
+    Node &node = nodes[index];
+    node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+    node.box = merge(nodes[node.child1].box, nodes[node.child2].box);
+    index = node.parent;
+  }
+}
+
+int32_t NileBvh::balance(int32_t indexA) {
+  Node &a = nodes[indexA];
+  if (a.isLeaf() || a.height < 2) return indexA;
+
+  const int32_t indexB = a.child1;
+  const int32_t indexC = a.child2;
+  Node &b = nodes[indexB];
+  Node &c = nodes[indexC];
+  const int32_t heightDifference = c.height - b.height;
+
+  // rotate the taller child up and make A its first child
+  auto rotateUp = [&](int32_t indexUp, Node &up, const Node &other, bool upIsChild2) {
+    const int32_t indexF = up.child1;
+    const int32_t indexG = up.child2;
+    Node &f = nodes[indexF];
+    Node &g = nodes[indexG];
+
+    up.child1 = indexA;
+    up.parent = a.parent;
+    a.parent = indexUp;
+    if (up.parent == NULL_NODE) {
+      root = indexUp;
+    } else if (nodes[up.parent].child1 == indexA) {
+      nodes[up.parent].child1 = indexUp;
+    } else {
+      nodes[up.parent].child2 = indexUp;
+    }
+
+    // the taller grandchild stays under up, the shorter one moves to A
+    const bool keepF = f.height > g.height;
+    const int32_t indexKept = keepF ? indexF : indexG;
+    const int32_t indexMoved = keepF ? indexG : indexF;
+    up.child2 = indexKept;
+    if (upIsChild2) {
+      a.child2 = indexMoved;
+    } else {
+      a.child1 = indexMoved;
+    }
+    nodes[indexMoved].parent = indexA;
+
+    a.box = merge(other.box, nodes[indexMoved].box);
+    a.height = 1 + std::max(other.height, nodes[indexMoved].height);
+    up.box = merge(a.box, nodes[indexKept].box);
+    up.height = 1 + std::max(a.height, nodes[indexKept].height);
+  };
+
+  if (heightDifference > 1) {
+    rotateUp(indexC, c, b, true);
+    return indexC;
+  }
+  if (heightDifference < -1) {
+    rotateUp(indexB, b, c, false);
+    return indexB;
+  }
+  return indexA;
+}
+
+}  // namespace nile
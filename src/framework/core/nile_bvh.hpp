@@ -0,0 +1,151 @@
+#pragma once
+
+#include "nile_bounds.hpp"
+#include "nile_frustum.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace nile{
+
+// Dynamic AABB tree. Every leaf holds a "fat" box, the inserted box grown by a margin, so small
+// movements only need the fat box to be checked and the tree is restructured when an object
+// leaves it. Inner nodes are kept balanced with rotations, so queries stay logarithmic while
+// objects come and go.
+//
+// Queries call visit(userData) for every leaf whose fat box passes the test, without
+// allocating. The visitor may return false to stop the query early. Results are conservative,
+// callers that need exact answers test the objects themselves.
+class NileBvh {
+ public:
+  static constexpr int32_t NULL_NODE = -1;
+
+  explicit NileBvh(float margin = 0.1f) : margin{margin} {}
+
+  NileBvh(const NileBvh &) = delete;
+  NileBvh &operator=(const NileBvh &) = delete;
+
+  // Returns the proxy that identifies this leaf in move and remove
+  int32_t insert(const BoundingBox &box, uint32_t userData);
+  void remove(int32_t proxy);
+
+  // Returns true when the box left its fat box and the leaf was reinserted
+  bool move(int32_t proxy, const BoundingBox &box);
+
+  void clear();
+
+  uint32_t getUserData(int32_t proxy) const { return nodes[proxy].userData; }
+  const BoundingBox &getFatBox(int32_t proxy) const { return nodes[proxy].box; }
+  size_t size() const { return leafCount; }
+  int32_t getHeight() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+  template <typename Visitor>
+  void queryOverlap(const BoundingBox &box, Visitor &&visit) const {
+    traverse([&](const BoundingBox &nodeBox) { return overlaps(nodeBox, box); }, visit);
+  }
+
+  template <typename Visitor>
+  void querySphere(const BoundingSphere &sphere, Visitor &&visit) const {
+    const float radiusSquared = sphere.radius * sphere.radius;
+    traverse(
+        [&](const BoundingBox &nodeBox) {
+          const glm::vec3 closest = glm::clamp(sphere.center, nodeBox.minCorner, nodeBox.maxCorner);
+          const glm::vec3 offset = closest - sphere.center;
+          return glm::dot(offset, offset) <= radiusSquared;
+        },
+        visit);
+  }
+
+  template <typename Visitor>
+  void queryFrustum(const NileFrustum &frustum, Visitor &&visit) const {
+    traverse([&](const BoundingBox &nodeBox) { return frustum.intersects(nodeBox); }, visit);
+  }
+
+  // Leaves hit by the segment from origin along direction up to maxDistance, in tree order
+  template <typename Visitor>
+  void queryRay(
+      const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, Visitor &&visit) const {
+    const glm::vec3 inverseDirection = 1.f / direction;
+    traverse(
+        [&](const BoundingBox &nodeBox) {
+          return rayHits(nodeBox, origin, inverseDirection, maxDistance);
+        },
+        visit);
+  }
+
+ private:
+  // deep enough for any balanced tree of 32 bit proxies
+  static constexpr int MAX_STACK = 256;
+
+  struct Node {
+    BoundingBox box{};
+    uint32_t userData = 0;
+    int32_t parent = NULL_NODE;  // next free node while the node is on the free list
+    int32_t child1 = NULL_NODE;
+    int32_t child2 = NULL_NODE;
+    int32_t height = -1;  // 0 for leaves, -1 for free nodes
+
+    bool isLeaf() const { return child1 == NULL_NODE; }
+  };
+
+  static bool overlaps(const BoundingBox &a, const BoundingBox &b) {
+    return a.minCorner.x <= b.maxCorner.x && a.maxCorner.x >= b.minCorner.x &&
+           a.minCorner.y <= b.maxCorner.y && a.maxCorner.y >= b.minCorner.y &&
+           a.minCorner.z <= b.maxCorner.z && a.maxCorner.z >= b.minCorner.z;
+  }
+
+  static bool rayHits(
+      const BoundingBox &box,
+      const glm::vec3 &origin,
+      const glm::vec3 &inverseDirection,
+      float maxDistance);
+
+  template <typename Test, typename Visitor>
+  void traverse(Test &&test, Visitor &visit) const {
+    if (root == NULL_NODE) return;
+
+    int32_t stack[MAX_STACK];
+    int count = 0;
+    stack[count++] = root;
+    while (count > 0) {
+      const Node &node = nodes[stack[--count]];
+      if (!test(node.box)) continue;
+
+      if (node.isLeaf()) {
+        if constexpr (std::is_void_v<std::invoke_result_t<Visitor &, uint32_t>>) {
+          visit(node.userData);
+        } else if (!visit(node.userData)) {
+          return;
+        }
+      } else {
+        assert(count + 2 <= MAX_STACK && "Bvh query stack overflow");
+        stack[count++] = node.child1;
+        stack[count++] = node.child2;
+      }
+    }
+  }
+
+  int32_t allocateNode();
+  void freeNode(int32_t index);
+  void insertLeaf(int32_t leaf);
+  void removeLeaf(int32_t leaf);
+  int32_t balance(int32_t index);
+  // refits boxes and heights from index up to the root
+  void refitAncestors(int32_t index);
+
+  float margin;
+  std::vector<Node> nodes;
+  int32_t root = NULL_NODE;
+  int32_t freeList = NULL_NODE;
+  size_t leafCount = 0;
+};
+
+}  // namespace nile
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "nile_frustum.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -26,6 +28,9 @@ class NileCamera {
   const glm::mat4& getInverseView() const { return inverseViewMatrix; }
   const glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
 
+  // World space view volume of the current projection and view
+  NileFrustum getFrustum() const { return NileFrustum::fromMatrix(projectionMatrix * viewMatrix); }
+
  private:
   glm::mat4 projectionMatrix{1.f};
   glm::mat4 viewMatrix{1.f};
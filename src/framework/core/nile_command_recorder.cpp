@@ -0,0 +1,187 @@
+#include "nile_command_recorder.hpp"
+
+#include "nile_frame_info.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace nile{
+
+NileCommandRecorder::NileCommandRecorder(NileDevice &device, NileJobSystem &jobSystem)
+    : device{device}, jobSystem{jobSystem} {
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+  pools.resize(NileSwapChain::MAX_FRAMES_IN_FLIGHT);
+  for (auto &framePools : pools) {
+    framePools.resize(jobSystem.getThreadCount());
+    for (auto &threadPool : framePools) {
+      if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &threadPool.pool) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to create recording command pool!");
+      }
+    }
+  }
+}
+
+NileCommandRecorder::~NileCommandRecorder() {
+  // destroying a pool frees its command buffers
+  for (auto &framePools : pools) {
+    for (auto &threadPool : framePools) {
+      vkDestroyCommandPool(device.device(), threadPool.pool, nullptr);
+    }
+  }
+}
+
+void NileCommandRecorder::beginFrame(int frameIndex) {
+  assert(!isPassStarted && "Can't begin a frame while a pass is recording");
+  this->frameIndex = frameIndex;
+  for (auto &threadPool : pools[frameIndex]) {
+    vkResetCommandPool(device.device(), threadPool.pool, 0);
+    threadPool.used = 0;
+  }
+  stats = {};
+}
+
+void NileCommandRecorder::beginPass(FrameInfo &frameInfo, const NileRenderer &renderer) {
+  assert(!isPassStarted && "Pass already recording into secondary command buffers");
+  pass = renderer.getActivePass();
+  assert(
+      pass.contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS &&
+      "Render pass was not begun for secondary command buffers");
+
+  isPassStarted = true;
+  primaryBuffer = frameInfo.commandBuffer;
+  passBuffers.clear();
+  frameInfo.commandBuffer = beginSecondary();
+}
+
+void NileCommandRecorder::endPass(FrameInfo &frameInfo) {
+  assert(isPassStarted && "Can't end a pass that was not begun");
+  endSecondary(frameInfo.commandBuffer);
+  passBuffers.push_back(frameInfo.commandBuffer);
+
+  vkCmdExecuteCommands(
+      primaryBuffer, static_cast<uint32_t>(passBuffers.size()), passBuffers.data());
+  stats.secondaryBuffers += static_cast<uint32_t>(passBuffers.size());
+
+  frameInfo.commandBuffer = primaryBuffer;
+  isPassStarted = false;
+}
+
+void NileCommandRecorder::record(
+    FrameInfo &frameInfo, uint32_t count, uint32_t grainSize, const RecordFunc &func) {
+  if (count == 0) return;
+
+  // at most one range per thread, every range pays for its own binds
+  grainSize = std::max(grainSize, 1u);
+  const uint32_t maxRanges =
+      std::min((count + grainSize - 1) / grainSize, jobSystem.getThreadCount());
+  const uint32_t rangeSize = (count + maxRanges - 1) / maxRanges;
+  const uint32_t rangeCount = (count + rangeSize - 1) / rangeSize;
+  if (!isPassStarted || rangeCount == 1) {
+    func(frameInfo.commandBuffer, 0, count);
+    return;
+  }
+
+  // what was recorded inline so far runs before the ranges
+  endSecondary(frameInfo.commandBuffer);
+  passBuffers.push_back(frameInfo.commandBuffer);
+
+  rangeBuffers.assign(rangeCount, VK_NULL_HANDLE);
+  jobSystem.parallelFor(rangeCount, 1, [&](uint32_t firstRange, uint32_t lastRange) {
+    for (uint32_t range = firstRange; range < lastRange; range++) {
+      const uint32_t begin = range * rangeSize;
+      const uint32_t end = std::min(begin + rangeSize, count);
+      VkCommandBuffer commandBuffer = beginSecondary();
+      func(commandBuffer, begin, end);
+      endSecondary(commandBuffer);
+      rangeBuffers[range] = commandBuffer;
+    }
+  });
+  passBuffers.insert(passBuffers.end(), rangeBuffers.begin(), rangeBuffers.end());
+  stats.parallelRanges += rangeCount;
+
+  frameInfo.commandBuffer = beginSecondary();
+}
+
+void NileCommandRecorder::execute(FrameInfo &frameInfo, VkCommandBuffer commandBuffer) {
+  assert(isPassStarted && "Can only execute secondary command buffers inside a pass");
+  endSecondary(frameInfo.commandBuffer);
+  passBuffers.push_back(frameInfo.commandBuffer);
+  passBuffers.push_back(commandBuffer);
+  frameInfo.commandBuffer = beginSecondary();
+}
+
+void NileCommandRecorder::setViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+  VkViewport viewport{};
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+VkCommandBuffer NileCommandRecorder::beginSecondary() {
+  auto &threadPool = pools[frameIndex][jobSystem.getThreadIndex()];
+  if (threadPool.used == threadPool.buffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = threadPool.pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+    threadPool.buffers.push_back(commandBuffer);
+  }
+  VkCommandBuffer commandBuffer = threadPool.buffers[threadPool.used++];
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = pass.renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = pass.framebuffer;
+  inheritanceInfo.pipelineStatistics = pass.pipelineStatistics;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                    VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording secondary command buffer!");
+  }
+
+  setViewportAndScissor(commandBuffer, pass.extent);
+  return commandBuffer;
+}
+
+void NileCommandRecorder::endSecondary(VkCommandBuffer commandBuffer) {
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record secondary command buffer!");
+  }
+}
+
+void recordDraws(
+    FrameInfo &frameInfo,
+    uint32_t count,
+    uint32_t grainSize,
+    const NileCommandRecorder::RecordFunc &func) {
+  if (frameInfo.commandRecorder != nullptr) {
+    frameInfo.commandRecorder->record(frameInfo, count, grainSize, func);
+  } else if (count > 0) {
+    func(frameInfo.commandBuffer, 0, count);
+  }
+}
+
+}  // namespace nile
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "nile_device.hpp"
+#include "nile_job_system.hpp"
+#include "nile_renderer.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace nile{
+
+struct FrameInfo;
+
+// Records the contents of a render pass into secondary command buffers, so draws can be recorded
+// on the job system's threads. Every thread has its own command pool per frame in flight. A pool
+// is only used by its thread and is reset as a whole once its frame's fence was waited on.
+//
+// Between beginPass and endPass frameInfo.commandBuffer is a secondary buffer owned by the
+// calling thread, so systems that record inline keep working unchanged. record() closes it,
+// records its ranges in parallel and opens a new one. endPass executes all of them in the order
+// they were recorded.
+class NileCommandRecorder {
+ public:
+  using RecordFunc =
+      std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)>;
+
+  // Counted since the last beginFrame
+  struct Stats {
+    uint32_t secondaryBuffers = 0;
+    uint32_t parallelRanges = 0;
+  };
+
+  NileCommandRecorder(NileDevice &device, NileJobSystem &jobSystem);
+  ~NileCommandRecorder();
+
+  NileCommandRecorder(const NileCommandRecorder &) = delete;
+  NileCommandRecorder &operator=(const NileCommandRecorder &) = delete;
+
+  // Resets the frame's pools, call after NileRenderer::beginFrame
+  void beginFrame(int frameIndex);
+
+  // Call right after renderer began a pass with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+  void beginPass(FrameInfo &frameInfo, const NileRenderer &renderer);
+  // Executes the pass's secondary buffers and gives frameInfo its primary buffer back, call
+  // before the renderer ends the pass
+  void endPass(FrameInfo &frameInfo);
+
+  // Calls func over [0, count) in ranges of at least grainSize, each recorded into its own
+  // secondary buffer on whichever thread picks it up. Only the render pass, viewport and scissor
+  // are set up front, func binds everything else itself and must only read shared state.
+  // Outside of a pass, or when it fits in one range, it is recorded into frameInfo.commandBuffer.
+  void record(FrameInfo &frameInfo, uint32_t count, uint32_t grainSize, const RecordFunc &func);
+
+  // Executes a secondary buffer recorded elsewhere, e.g. by NileStaticBatch, at this point of
+  // the pass. It has to inherit the pass's render pass.
+  void execute(FrameInfo &frameInfo, VkCommandBuffer commandBuffer);
+
+  // The pass between beginPass and endPass, nullptr outside of it
+  const NileRenderer::ActivePass *getActivePass() const {
+    return isPassStarted ? &pass : nullptr;
+  }
+
+  const Stats &getStats() const { return stats; }
+
+  // Dynamic state is not inherited from the primary buffer, every secondary sets its own
+  static void setViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent);
+
+ private:
+  struct ThreadPool {
+    VkCommandPool pool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> buffers;
+    size_t used = 0;
+  };
+
+  // from the calling thread's pool, inheriting the current pass
+  VkCommandBuffer beginSecondary();
+  void endSecondary(VkCommandBuffer commandBuffer);
+
+  NileDevice &device;
+  NileJobSystem &jobSystem;
+  // indexed by frame, then by thread
+  std::vector<std::vector<ThreadPool>> pools;
+  int frameIndex = 0;
+
+  bool isPassStarted = false;
+  VkCommandBuffer primaryBuffer = VK_NULL_HANDLE;
+  NileRenderer::ActivePass pass{};
+  std::vector<VkCommandBuffer> passBuffers;  // in execution order
+  std::vector<VkCommandBuffer> rangeBuffers;
+  Stats stats{};
+};
+
+// Records through frameInfo's command recorder when it has one, inline otherwise
+void recordDraws(
+    FrameInfo &frameInfo,
+    uint32_t count,
+    uint32_t grainSize,
+    const NileCommandRecorder::RecordFunc &func);
+
+}  // namespace nile
@@ -0,0 +1,222 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nile{
+
+// Type erased interface so the store can drop every component of a game object at once
+class NileComponentPoolBase {
+ public:
+  using id_t = unsigned int;
+
+  virtual ~NileComponentPoolBase() = default;
+
+  virtual bool contains(id_t id) const = 0;
+  virtual void remove(id_t id) = 0;
+};
+
+// Component types the system running on the current thread declared. Set by
+// NileSystemScheduler in debug builds; pool lookups outside of it assert, which catches
+// undeclared accesses that could race with another system. pool<const T>() is a read and
+// pool<T>() a write, so a system that only declared reads of T can't write it either.
+struct NileComponentAccess {
+  std::vector<size_t> reads;
+  std::vector<size_t> writes;
+
+  bool allows(size_t type, bool write) const {
+    auto declared = [type](const std::vector<size_t> &types) {
+      return std::find(types.begin(), types.end(), type) != types.end();
+    };
+    return declared(writes) || (!write && declared(reads));
+  }
+};
+
+inline thread_local const NileComponentAccess *currentComponentAccess = nullptr;
+
+// Sparse set: components of one type live packed in a dense array, with a sparse
+// id -> dense index table in front of it. Iterating a pool touches only the objects that
+// own the component, in linear memory order. Removal swaps the last element into the hole,
+// so references into a pool are invalidated by add/remove of the same component type.
+template <typename T>
+class NileComponentPool : public NileComponentPoolBase {
+ public:
+  static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+  template <typename... Args>
+  T &emplace(id_t id, Args &&...args) {
+    assert(!contains(id) && "Component already attached to game object");
+    if (id >= sparse.size()) {
+      sparse.resize(id + 1, npos);
+    }
+    sparse[id] = static_cast<uint32_t>(dense.size());
+    dense.push_back(id);
+    return components.emplace_back(std::forward<Args>(args)...);
+  }
+
+  bool contains(id_t id) const override { return id < sparse.size() && sparse[id] != npos; }
+
+  void remove(id_t id) override {
+    if (!contains(id)) return;
+    uint32_t index = sparse[id];
+    uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+    if (index != last) {
+      dense[index] = dense[last];
+      components[index] = std::move(components[last]);
+      sparse[dense[index]] = index;
+    }
+    dense.pop_back();
+    components.pop_back();
+    sparse[id] = npos;
+  }
+
+  T &get(id_t id) {
+    assert(contains(id) && "Game object does not have this component");
+    return components[sparse[id]];
+  }
+  const T &get(id_t id) const {
+    assert(contains(id) && "Game object does not have this component");
+    return components[sparse[id]];
+  }
+
+  T *tryGet(id_t id) { return contains(id) ? &components[sparse[id]] : nullptr; }
+  const T *tryGet(id_t id) const { return contains(id) ? &components[sparse[id]] : nullptr; }
+
+  size_t size() const { return dense.size(); }
+  const std::vector<id_t> &ids() const { return dense; }
+  std::vector<T> &data() { return components; }
+  const std::vector<T> &data() const { return components; }
+
+ private:
+  std::vector<uint32_t> sparse{};
+  std::vector<id_t> dense{};
+  std::vector<T> components{};
+};
+
+// The pool of T, read only when T is const
+template <typename T>
+using NileComponentPoolOf = std::conditional_t<
+    std::is_const_v<T>,
+    const NileComponentPool<std::remove_const_t<T>>,
+    NileComponentPool<T>>;
+
+// Iterates every game object that owns all of Ts, const Ts are passed as const references.
+// The smallest pool drives the loop and the others are probed through their sparse tables,
+// so a system pays only for the objects it actually processes. Components must not be added
+// to or removed from the viewed pools while iterating.
+template <typename... Ts>
+class NileView {
+ public:
+  using id_t = NileComponentPoolBase::id_t;
+
+  explicit NileView(NileComponentPoolOf<Ts> &...pools) : pools{&pools...} {}
+
+  // func is called as func(id, Ts&...)
+  template <typename Func>
+  void each(Func &&func) {
+    if constexpr (sizeof...(Ts) == 1) {
+      auto &pool = *std::get<0>(pools);
+      auto &ids = pool.ids();
+      auto &data = pool.data();
+      for (size_t i = 0; i < ids.size(); i++) {
+        func(ids[i], data[i]);
+      }
+    } else {
+      const std::vector<id_t> &ids = smallestPoolIds();
+      for (size_t i = 0; i < ids.size(); i++) {
+        id_t id = ids[i];
+        if ((std::get<NileComponentPoolOf<Ts> *>(pools)->contains(id) && ...)) {
+          func(id, std::get<NileComponentPoolOf<Ts> *>(pools)->get(id)...);
+        }
+      }
+    }
+  }
+
+  // upper bound on the number of objects visited
+  size_t sizeHint() const { return smallestPoolIds().size(); }
+
+ private:
+  const std::vector<id_t> &smallestPoolIds() const {
+    const std::vector<id_t> *smallest = nullptr;
+    ((smallest = (smallest == nullptr ||
+                  std::get<NileComponentPoolOf<Ts> *>(pools)->size() < smallest->size())
+                     ? &std::get<NileComponentPoolOf<Ts> *>(pools)->ids()
+                     : smallest),
+     ...);
+    return *smallest;
+  }
+
+  std::tuple<NileComponentPoolOf<Ts> *...> pools;
+};
+
+class NileComponentStore {
+ public:
+  using id_t = NileComponentPoolBase::id_t;
+
+  NileComponentStore() = default;
+  NileComponentStore(const NileComponentStore &) = delete;
+  NileComponentStore &operator=(const NileComponentStore &) = delete;
+
+  // pool<const T>() for reading, pool<T>() for writing
+  template <typename T>
+  NileComponentPoolOf<T> &pool() {
+    using Component = std::remove_const_t<T>;
+    size_t index = typeIndex<Component>();
+    assert(
+        (currentComponentAccess == nullptr ||
+         currentComponentAccess->allows(index, !std::is_const_v<T>)) &&
+        "System accessed a component type it did not declare, or wrote one it only reads");
+    if (index >= pools.size()) {
+      pools.resize(index + 1);
+    }
+    if (pools[index] == nullptr) {
+      pools[index] = std::make_unique<NileComponentPool<Component>>();
+    }
+    return *static_cast<NileComponentPool<Component> *>(pools[index].get());
+  }
+
+  template <typename... Ts>
+  NileView<Ts...> view() {
+    return NileView<Ts...>(pool<Ts>()...);
+  }
+
+  // Like removeAll, not checked against the running system's declared accesses
+  template <typename T>
+  bool contains(id_t id) const {
+    size_t index = typeIndex<T>();
+    return index < pools.size() && pools[index] != nullptr && pools[index]->contains(id);
+  }
+
+  void removeAll(id_t id) {
+    for (auto &pool : pools) {
+      if (pool != nullptr) pool->remove(id);
+    }
+  }
+
+  // Small dense id per component type, also used by the scheduler for access declarations
+  template <typename T>
+  static size_t typeIndex() {
+    static const size_t index = nextTypeIndex();
+    return index;
+  }
+
+ private:
+  static size_t nextTypeIndex() {
+    // types may be seen for the first time on different threads
+    static std::atomic<size_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::vector<std::unique_ptr<NileComponentPoolBase>> pools{};
+};
+
+}  // namespace nile
@@ -0,0 +1,67 @@
+#include "nile_compute_pipeline.hpp"
+
+#include "nile_pipeline_registry.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+
+namespace nile{
+
+NileComputePipeline::NileComputePipeline(
+    NileDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout)
+    : nileDevice{device} {
+  createComputePipeline(compFilepath, pipelineLayout);
+}
+
+NileComputePipeline::~NileComputePipeline() {
+  vkDestroyPipeline(nileDevice.device(), computePipeline, nullptr);
+}
+
+void NileComputePipeline::createComputePipeline(
+    const std::string& compFilepath, VkPipelineLayout pipelineLayout) {
+  assert(
+      pipelineLayout != VK_NULL_HANDLE &&
+      "Cannot create compute pipeline: no pipelineLayout provided");
+
+  VkShaderModule compShaderModule = nileDevice.getPipelineRegistry().getShaderModule(compFilepath);
+
+  VkPipelineShaderStageCreateInfo shaderStage{};
+  shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  shaderStage.module = compShaderModule;
+  shaderStage.pName = "main";
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage = shaderStage;
+  pipelineInfo.layout = pipelineLayout;
+  pipelineInfo.basePipelineIndex = -1;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+  auto& pipelineCache = nileDevice.getPipelineCache();
+  auto start = std::chrono::steady_clock::now();
+  if (vkCreateComputePipelines(
+          nileDevice.device(),
+          pipelineCache.getCache(),
+          1,
+          &pipelineInfo,
+          nullptr,
+          &computePipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline");
+  }
+  pipelineCache.recordCreation(
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+void NileComputePipeline::bind(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+}
+
+void NileComputePipeline::dispatch(VkCommandBuffer commandBuffer, uint32_t count, uint32_t groupSize) {
+  if (count == 0) return;
+  vkCmdDispatch(commandBuffer, (count + groupSize - 1) / groupSize, 1, 1);
+}
+
+}  // namespace nile
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "nile_device.hpp"
+
+// std
+#include <string>
+
+namespace nile{
+
+// Compute counterpart of NilePipeline, built from a single compiled compute shader
+class NileComputePipeline {
+ public:
+  NileComputePipeline(
+      NileDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+  ~NileComputePipeline();
+
+  NileComputePipeline(const NileComputePipeline&) = delete;
+  NileComputePipeline& operator=(const NileComputePipeline&) = delete;
+
+  void bind(VkCommandBuffer commandBuffer);
+
+  // Dispatches enough workgroups of groupSize invocations to cover count
+  void dispatch(VkCommandBuffer commandBuffer, uint32_t count, uint32_t groupSize);
+
+ private:
+  void createComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+
+  NileDevice& nileDevice;
+  VkPipeline computePipeline;
+};
+}  // namespace nile
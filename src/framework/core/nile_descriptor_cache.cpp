@@ -0,0 +1,215 @@
+#include "nile_descriptor_cache.hpp"
+
+#include "nile_utils.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace nile{
+
+namespace {
+
+// dispatchable and non dispatchable handles both fit 64 bits
+template <typename T>
+uint64_t handleBits(T handle) {
+  return (uint64_t)(handle);
+}
+
+enum KeyTag : uint64_t { BUFFER_WRITE = 1, IMAGE_WRITE = 2 };
+
+// every write adds a tag, its binding, the buffer or image view and two more words to the key,
+// which starts with the layout
+constexpr size_t WRITE_WORDS = 5;
+
+bool refersTo(const std::vector<uint64_t> &key, const std::vector<uint64_t> &handles) {
+  auto isRetired = [&](uint64_t word) {
+    return std::find(handles.begin(), handles.end(), word) != handles.end();
+  };
+  for (size_t i = 1; i + WRITE_WORDS <= key.size(); i += WRITE_WORDS) {
+    if (isRetired(key[i + 2])) return true;
+    if (key[i] == IMAGE_WRITE && isRetired(key[i + 3])) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+// *************** Descriptor Cache Writer *********************
+
+NileDescriptorCache::Writer::Writer(NileDescriptorCache &cache, NileDescriptorSetLayout &setLayout)
+    : cache{cache}, setLayout{setLayout} {
+  key.push_back(handleBits(setLayout.getDescriptorSetLayout()));
+}
+
+NileDescriptorCache::Writer &NileDescriptorCache::Writer::writeBuffer(
+    uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
+  key.insert(
+      key.end(),
+      {BUFFER_WRITE,
+       binding,
+       handleBits(bufferInfo->buffer),
+       bufferInfo->offset,
+       bufferInfo->range});
+  bufferWrites.push_back({binding, bufferInfo});
+  return *this;
+}
+
+NileDescriptorCache::Writer &NileDescriptorCache::Writer::writeImage(
+    uint32_t binding, VkDescriptorImageInfo *imageInfo) {
+  key.insert(
+      key.end(),
+      {IMAGE_WRITE,
+       binding,
+       handleBits(imageInfo->imageView),
+       handleBits(imageInfo->sampler),
+       static_cast<uint64_t>(imageInfo->imageLayout)});
+  imageWrites.push_back({binding, imageInfo});
+  return *this;
+}
+
+bool NileDescriptorCache::Writer::build(VkDescriptorSet &set) {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.dropRetiredHandles();
+  auto &frame = cache.frames[cache.currentFrame];
+
+  auto [it, inserted] = frame.entries.try_emplace(key);
+  Entry &entry = it->second;
+  entry.lastUsed = frame.frameNumber;
+  if (!inserted) {
+    cache.stats.setsReused++;
+    set = entry.set;
+    return true;
+  }
+
+  if (!cache.allocate(setLayout, entry)) {
+    frame.entries.erase(it);
+    return false;
+  }
+  NileDescriptorWriter writer{setLayout, *cache.pools[entry.poolIndex]};
+  for (auto &[binding, bufferInfo] : bufferWrites) {
+    writer.writeBuffer(binding, bufferInfo);
+  }
+  for (auto &[binding, imageInfo] : imageWrites) {
+    writer.writeImage(binding, imageInfo);
+  }
+  writer.overwrite(entry.set);
+
+  cache.stats.setsWritten++;
+  cache.stats.liveSets++;
+  set = entry.set;
+  return true;
+}
+
+// *************** Descriptor Cache *********************
+
+size_t NileDescriptorCache::KeyHash::operator()(const std::vector<uint64_t> &key) const {
+  size_t seed = 0;
+  for (uint64_t word : key) {
+    hashCombine(seed, word);
+  }
+  return seed;
+}
+
+NileDescriptorCache::NileDescriptorCache(NileDevice &device, uint32_t frameCount)
+    : nileDevice{device}, frames(frameCount) {
+  addPool();
+}
+
+void NileDescriptorCache::beginFrame(int frameIndex) {
+  assert(frameIndex >= 0 && frameIndex < static_cast<int>(frames.size()) && "Invalid frame index");
+
+  std::lock_guard<std::mutex> lock(mutex);
+  currentFrame = frameIndex;
+  dropRetiredHandles();
+  auto &frame = frames[frameIndex];
+  frame.frameNumber++;
+
+  // this slot's previous frame has finished on the gpu, its stale sets can go back to the pools
+  std::vector<std::vector<VkDescriptorSet>> stale(pools.size());
+  for (const auto &entry : frame.retiredEntries) {
+    stale[entry.poolIndex].push_back(entry.set);
+  }
+  frame.retiredEntries.clear();
+  for (auto it = frame.entries.begin(); it != frame.entries.end();) {
+    if (frame.frameNumber - it->second.lastUsed > EVICT_AFTER_FRAMES) {
+      stale[it->second.poolIndex].push_back(it->second.set);
+      it = frame.entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  uint32_t liveSets = 0;
+  for (auto &sets : frames) {
+    liveSets += static_cast<uint32_t>(sets.entries.size());
+  }
+  stats = {};
+  stats.liveSets = liveSets;
+
+  for (size_t i = 0; i < stale.size(); i++) {
+    if (!stale[i].empty()) pools[i]->freeDescriptors(stale[i]);
+  }
+}
+
+void NileDescriptorCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &frame : frames) {
+    frame.entries.clear();
+    frame.retiredEntries.clear();
+  }
+  for (auto &pool : pools) {
+    pool->resetPool();
+  }
+  stats.liveSets = 0;
+}
+
+void NileDescriptorCache::dropRetiredHandles() {
+  if (!nileDevice.takeRetiredHandles(retiredHandles)) return;
+  for (auto &frame : frames) {
+    for (auto it = frame.entries.begin(); it != frame.entries.end();) {
+      if (refersTo(it->first, retiredHandles)) {
+        frame.retiredEntries.push_back(it->second);
+        it = frame.entries.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  retiredHandles.clear();
+}
+
+bool NileDescriptorCache::allocate(NileDescriptorSetLayout &setLayout, Entry &entry) {
+  const VkDescriptorSetLayout layout = setLayout.getDescriptorSetLayout();
+  if (pools.back()->allocateDescriptor(layout, entry.set)) {
+    entry.poolIndex = pools.size() - 1;
+    return true;
+  }
+
+  // earlier pools may have room again after evictions
+  for (size_t i = 0; i + 1 < pools.size(); i++) {
+    if (pools[i]->allocateDescriptor(layout, entry.set)) {
+      entry.poolIndex = i;
+      return true;
+    }
+  }
+
+  addPool();
+  entry.poolIndex = pools.size() - 1;
+  return pools.back()->allocateDescriptor(layout, entry.set);
+}
+
+void NileDescriptorCache::addPool() {
+  pools.push_back(
+      NileDescriptorPool::Builder(nileDevice)
+          .setMaxSets(1000)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2000)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 100)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000)
+          .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+          .build());
+}
+
+}  // namespace nile
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "nile_descriptors.hpp"
+#include "nile_device.hpp"
+#include "nile_swap_chain.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace nile{
+
+// Descriptor sets that live across frames, looked up by the layout and the exact buffer ranges
+// and images written to them. A set is only allocated and written the first time a combination is
+// seen in a frame slot, every later frame binds the same set. Changing an object's texture or
+// buffer slot changes its key, the old set is freed once no frame has used it for a while.
+// Sets that refer to a destroyed buffer or image view are dropped before the next lookup, a new
+// object handed the same handle value would match their key otherwise, see
+// NileDevice::retireHandle.
+//
+// Each frame in flight keeps its own sets, so a set is only freed or reused by the frame slot
+// whose fence has already been waited on.
+class NileDescriptorCache {
+ public:
+  // Counted since the last beginFrame
+  struct Stats {
+    uint32_t setsWritten = 0;
+    uint32_t setsReused = 0;
+    uint32_t liveSets = 0;
+  };
+
+  class Writer {
+   public:
+    Writer(NileDescriptorCache &cache, NileDescriptorSetLayout &setLayout);
+
+    Writer &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
+    Writer &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+
+    // Returns the cached set for these writes, allocating and writing it on a miss
+    bool build(VkDescriptorSet &set);
+
+   private:
+    NileDescriptorCache &cache;
+    NileDescriptorSetLayout &setLayout;
+    std::vector<uint64_t> key;
+    std::vector<std::pair<uint32_t, VkDescriptorBufferInfo *>> bufferWrites;
+    std::vector<std::pair<uint32_t, VkDescriptorImageInfo *>> imageWrites;
+  };
+
+  // sets not used by their frame slot for this many frames are freed
+  static constexpr uint64_t EVICT_AFTER_FRAMES = 120;
+
+  NileDescriptorCache(
+      NileDevice &device, uint32_t frameCount = NileSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+  NileDescriptorCache(const NileDescriptorCache &) = delete;
+  NileDescriptorCache &operator=(const NileDescriptorCache &) = delete;
+
+  // Call once the frame's fence was waited on and before any set is requested for it
+  void beginFrame(int frameIndex);
+
+  Writer writer(NileDescriptorSetLayout &setLayout) { return Writer{*this, setLayout}; }
+
+  // Drops every set, e.g. after the images they point at were recreated
+  void clear();
+
+  const Stats &getStats() const { return stats; }
+
+ private:
+  struct KeyHash {
+    size_t operator()(const std::vector<uint64_t> &key) const;
+  };
+
+  struct Entry {
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    size_t poolIndex = 0;
+    uint64_t lastUsed = 0;
+  };
+
+  struct FrameSets {
+    std::unordered_map<std::vector<uint64_t>, Entry, KeyHash> entries;
+    uint64_t frameNumber = 0;
+    // dropped sets the slot's last frame may still use, freed at its next beginFrame
+    std::vector<Entry> retiredEntries;
+  };
+
+  bool allocate(NileDescriptorSetLayout &setLayout, Entry &entry);
+  void addPool();
+  void dropRetiredHandles();
+
+  NileDevice &nileDevice;
+  std::vector<FrameSets> frames;
+  int currentFrame = 0;
+
+  // grown by one pool whenever the last one is full
+  std::vector<std::unique_ptr<NileDescriptorPool>> pools;
+  std::vector<uint64_t> retiredHandles;
+
+  // render systems may record from several threads
+  std::mutex mutex;
+  Stats stats{};
+};
+
+}  // namespace nile
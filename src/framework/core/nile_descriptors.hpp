@@ -25,6 +25,8 @@ class NileDescriptorSetLayout {
    private:
     NileDevice &nileDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+
+    friend class NilePipelineRegistry;
   };
 
   NileDescriptorSetLayout(
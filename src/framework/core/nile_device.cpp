@@ -1,5 +1,7 @@
 #include "nile_device.hpp"
 
+#include "nile_pipeline_registry.hpp"
+
 // std headers
 #include <cstring>
 #include <iostream>
@@ -48,15 +50,21 @@ void DestroyDebugUtilsMessengerEXT(
 
 // class member functions
 NileDevice::NileDevice(NileWindow &window) : window{window} {
+  if (!isHeadless()) deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  pipelineCache = std::make_unique<NilePipelineCache>(device_, properties, PIPELINE_CACHE_FILE);
+  pipelineRegistry = std::make_unique<NilePipelineRegistry>(*this);
 }
 
 NileDevice::~NileDevice() {
+  pipelineRegistry.reset();
+  pipelineCache->save();
+  pipelineCache.reset();
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -149,8 +157,14 @@ void NileDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
-  VkPhysicalDeviceFeatures deviceFeatures = {};
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  enabledFeatures.samplerAnisotropy = VK_TRUE;
+  // for the gpu profiler's optional pipeline statistics, which secondary buffers inherit
+  if (supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries) {
+    enabledFeatures.pipelineStatisticsQuery = VK_TRUE;
+    enabledFeatures.inheritedQueries = VK_TRUE;
+  }
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -158,7 +172,7 @@ void NileDevice::createLogicalDevice() {
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-  createInfo.pEnabledFeatures = &deviceFeatures;
+  createInfo.pEnabledFeatures = &enabledFeatures;
   createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -193,15 +207,19 @@ void NileDevice::createCommandPool() {
   }
 }
 
-void NileDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void NileDevice::createSurface() {
+  if (isHeadless()) return;
+  window.createWindowSurface(instance, &surface_);
+}
 
 bool NileDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // offscreen images need nothing from a surface
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -260,11 +278,13 @@ bool NileDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> NileDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions{};
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -331,8 +351,14 @@ QueueFamilyIndices NileDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
+    // nothing is presented headless, the graphics queue stands in for the present one
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (isHeadless()) {
+      presentSupport =
+          indices.graphicsFamilyHasValue && static_cast<int>(indices.graphicsFamily) == i;
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -389,6 +415,22 @@ VkFormat NileDevice::findSupportedFormat(
   throw std::runtime_error("failed to find supported format!");
 }
 
+void NileDevice::retireHandle(uint64_t handle) {
+  if (handle == 0) return;
+  std::lock_guard<std::mutex> lock(retiredMutex);
+  retiredHandles.push_back(handle);
+  hasRetiredHandles.store(true, std::memory_order_release);
+}
+
+bool NileDevice::takeRetiredHandles(std::vector<uint64_t> &handles) {
+  if (!hasRetiredHandles.load(std::memory_order_acquire)) return false;
+  std::lock_guard<std::mutex> lock(retiredMutex);
+  handles.insert(handles.end(), retiredHandles.begin(), retiredHandles.end());
+  retiredHandles.clear();
+  hasRetiredHandles.store(false, std::memory_order_release);
+  return !handles.empty();
+}
+
 uint32_t NileDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -1,13 +1,19 @@
 #pragma once
 
+#include "nile_pipeline_cache.hpp"
 #include "nile_window.hpp"
 
 // std lib headers
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace nile{
 
+class NilePipelineRegistry;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -41,11 +47,28 @@ class NileDevice {
 
   VkCommandPool getCommandPool() { return commandPool; }
   VkDevice device() { return device_; }
+  // VK_NULL_HANDLE when headless, which also leaves out VK_KHR_swapchain
   VkSurfaceKHR surface() { return surface_; }
+  bool isHeadless() const { return window.isHeadless(); }
+  const NileWindow::Headless &getHeadless() const { return window.getHeadless(); }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
 
+  // Pass getPipelineCache().getCache() to every pipeline creation, it is saved to
+  // PIPELINE_CACHE_FILE in the working directory when the device is destroyed
+  static constexpr const char *PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+  NilePipelineCache &getPipelineCache() { return *pipelineCache; }
+  NilePipelineRegistry &getPipelineRegistry() { return *pipelineRegistry; }
+
+  // Buffers and image views report their handles as they are destroyed. The driver may hand the
+  // same values to new objects, so NileDescriptorCache drops the sets that refer to them.
+  void retireHandle(uint64_t handle);
+  // Moves the handles retired since the last call into handles, false when there were none
+  bool takeRetiredHandles(std::vector<uint64_t> &handles);
+
   VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
+  // samplerAnisotropy, plus pipelineStatisticsQuery and inheritedQueries where supported
+  const VkPhysicalDeviceFeatures &getEnabledFeatures() const { return enabledFeatures; }
   VkInstance getInstance() { return instance; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
@@ -108,12 +131,20 @@ class NileDevice {
   VkCommandPool commandPool;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkPhysicalDeviceFeatures enabledFeatures{};
+  std::unique_ptr<NilePipelineCache> pipelineCache;
+  std::unique_ptr<NilePipelineRegistry> pipelineRegistry;
+
+  // objects may be destroyed on the job system threads
+  std::mutex retiredMutex;
+  std::vector<uint64_t> retiredHandles;
+  std::atomic<bool> hasRetiredHandles{false};
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  std::vector<const char *> deviceExtensions{};
 };
 
 }  // namespace nile
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "nile_camera.hpp"
-#include "nile_descriptors.hpp"
+#include "nile_descriptor_cache.hpp"
 #include "nile_game_object.hpp"
 
 // lib
@@ -9,10 +9,12 @@
 
 namespace nile{
 
-#define MAX_LIGHTS 10
+class NileCommandRecorder;
+class NileGpuProfiler;
 
+// Lights are stored in a storage buffer and binned into view space clusters, see LightClusters
 struct PointLight {
-  glm::vec4 position{};  // ignore w
+  glm::vec4 position{};  // w is the range past which the light is ignored
   glm::vec4 color{};     // w is intensity
 };
 
@@ -21,8 +23,9 @@ struct GlobalUbo {
   glm::mat4 view{1.f};
   glm::mat4 inverseView{1.f};
   glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .02f};  // w is intensity
-  PointLight pointLights[MAX_LIGHTS];
-  int numLights;
+  glm::uvec4 clusterGrid{1, 1, 1, 0};  // clusters along x, y and depth
+  glm::vec2 clusterDepth{0.f};  // a view depth's slice is log(depth) * x + y
+  int numLights = 0;
 };
 
 struct FrameInfo {
@@ -31,8 +34,15 @@ struct FrameInfo {
   VkCommandBuffer commandBuffer;
   NileCamera &camera;
   VkDescriptorSet globalDescriptorSet;
-  NileDescriptorPool &frameDescriptorPool;
-  NileGameObject::Map &gameObjects;
+  NileDescriptorCache &descriptorCache;
+  NileGameObjectManager &gameObjects;
+  // set when draws may be recorded into secondary buffers in parallel, see recordDraws
+  NileCommandRecorder *commandRecorder = nullptr;
+  // times NileGpuScope, left out of the profile when null
+  NileGpuProfiler *gpuProfiler = nullptr;
+  // changes when globalDescriptorSet was written again, which invalidates recorded buffers
+  // that bind it, see LightClusters::getDescriptorRevision
+  uint64_t globalDescriptorRevision = 0;
 };
 
 }  // namespace nile
@@ -0,0 +1,54 @@
+#include "nile_frame_pacer.hpp"
+
+// std
+#include <algorithm>
+#include <thread>
+
+namespace nile{
+
+// bounds of the spin margin, wide enough for coarse timers without spinning whole frames
+constexpr auto MIN_SPIN_MARGIN = std::chrono::microseconds(200);
+constexpr auto MAX_SPIN_MARGIN = std::chrono::milliseconds(4);
+
+void NileFramePacer::setTargetFps(float fps) {
+  if (fps == targetFps) return;
+  targetFps = std::max(fps, 0.f);
+  period = targetFps > 0.f ? std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(1.0 / targetFps))
+                           : Clock::duration{};
+  nextFrame = Clock::time_point{};
+}
+
+void NileFramePacer::wait() {
+  stats = {};
+  if (period == Clock::duration{}) return;
+
+  const auto start = Clock::now();
+  if (nextFrame == Clock::time_point{} || start >= nextFrame) {
+    nextFrame = start + period;
+    return;
+  }
+
+  const auto wakeUp = nextFrame - spinMargin;
+  if (start < wakeUp) {
+    std::this_thread::sleep_until(wakeUp);
+    // grows right away when a sleep overshoots and shrinks slowly otherwise
+    const auto late = Clock::now() - wakeUp;
+    spinMargin = std::clamp<Clock::duration>(
+        std::max<Clock::duration>(late * 2, spinMargin - spinMargin / 16),
+        MIN_SPIN_MARGIN,
+        MAX_SPIN_MARGIN);
+  }
+
+  const auto spinStart = Clock::now();
+  while (Clock::now() < nextFrame) {
+    std::this_thread::yield();
+  }
+
+  const auto end = Clock::now();
+  stats.waitMs = std::chrono::duration<double, std::milli>(end - start).count();
+  stats.spinMs = std::chrono::duration<double, std::milli>(end - spinStart).count();
+  nextFrame += period;
+}
+
+}  // namespace nile
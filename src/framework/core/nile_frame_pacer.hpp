@@ -0,0 +1,40 @@
+#pragma once
+
+// std
+#include <chrono>
+
+namespace nile{
+
+// Holds frames to a target rate independently of the present mode, e.g. a steady 90 fps with
+// IMMEDIATE presents instead of whatever the GPU manages. Waits sleep while the next frame is
+// further away than the scheduler's wakeup jitter and spin for the rest, so frames start on
+// time without burning a core for the whole wait. The spin margin follows how late sleeps
+// actually wake up.
+class NileFramePacer {
+ public:
+  // 0 turns pacing off
+  void setTargetFps(float fps);
+  float getTargetFps() const { return targetFps; }
+
+  // Blocks until the next frame is due. A frame that is already late starts right away and
+  // the ones after it are paced from there rather than rushed to catch up.
+  void wait();
+
+  // Time the last wait blocked for, and the part of it spent spinning
+  struct Stats {
+    double waitMs = 0.0;
+    double spinMs = 0.0;
+  };
+  const Stats &getStats() const { return stats; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  float targetFps = 0.f;
+  Clock::duration period{};
+  Clock::time_point nextFrame{};
+  Clock::duration spinMargin = std::chrono::milliseconds(1);
+  Stats stats{};
+};
+
+}  // namespace nile
@@ -0,0 +1,194 @@
+#include "nile_frustum.hpp"
+
+// std
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NILE_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NILE_CULL_SSE
+#endif
+
+namespace nile{
+
+namespace {
+
+#if defined(NILE_CULL_AVX)
+constexpr size_t kLanes = 8;
+using vfloat = __m256;
+inline vfloat vset(float v) { return _mm256_set1_ps(v); }
+inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+inline vfloat vcmpge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+inline int vmask(vfloat a) { return _mm256_movemask_ps(a); }
+#elif defined(NILE_CULL_SSE)
+constexpr size_t kLanes = 4;
+using vfloat = __m128;
+inline vfloat vset(float v) { return _mm_set1_ps(v); }
+inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+inline vfloat vcmpge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+inline int vmask(vfloat a) { return _mm_movemask_ps(a); }
+#else
+constexpr size_t kLanes = 1;
+#endif
+
+}  // namespace
+
+// *************** Frustum *********************
+
+NileFrustum NileFrustum::fromMatrix(const glm::mat4 &viewProjection) {
+  // rows of the matrix, glm stores columns
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = {
+        viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]};
+  }
+
+  NileFrustum frustum{};
+  frustum.planes[PLANE_LEFT] = rows[3] + rows[0];
+  frustum.planes[PLANE_RIGHT] = rows[3] - rows[0];
+  frustum.planes[PLANE_BOTTOM] = rows[3] + rows[1];
+  frustum.planes[PLANE_TOP] = rows[3] - rows[1];
+  frustum.planes[PLANE_NEAR] = rows[2];
+  frustum.planes[PLANE_FAR] = rows[3] - rows[2];
+  for (auto &plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+bool NileFrustum::intersects(const BoundingSphere &sphere) const {
+  for (const auto &plane : planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+  }
+  return true;
+}
+
+bool NileFrustum::intersects(const BoundingBox &box) const {
+  const glm::vec3 center = box.center();
+  const glm::vec3 extents = box.extents();
+  for (const auto &plane : planes) {
+    // distance from the center to the box corner furthest along the plane normal
+    const float reach = glm::dot(glm::abs(glm::vec3(plane)), extents);
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -reach) return false;
+  }
+  return true;
+}
+
+// *************** Cull Batch *********************
+
+const size_t NileCullBatch::LANES = kLanes;
+
+void NileCullBatch::clear() {
+  for (auto *values :
+       {&sphereX, &sphereY, &sphereZ, &sphereRadius, &boxX, &boxY, &boxZ, &extentX, &extentY,
+        &extentZ}) {
+    values->clear();
+  }
+}
+
+void NileCullBatch::reserve(size_t count) {
+  for (auto *values :
+       {&sphereX, &sphereY, &sphereZ, &sphereRadius, &boxX, &boxY, &boxZ, &extentX, &extentY,
+        &extentZ}) {
+    values->reserve(count);
+  }
+}
+
+void NileCullBatch::push(
+    const BoundingBox &box, const BoundingSphere &sphere, const glm::mat4 &transform) {
+  const BoundingSphere worldSphere = sphere.transformed(transform);
+  sphereX.push_back(worldSphere.center.x);
+  sphereY.push_back(worldSphere.center.y);
+  sphereZ.push_back(worldSphere.center.z);
+  sphereRadius.push_back(worldSphere.radius);
+
+  const BoundingBox worldBox = box.transformed(transform);
+  const glm::vec3 center = worldBox.center();
+  const glm::vec3 extents = worldBox.extents();
+  boxX.push_back(center.x);
+  boxY.push_back(center.y);
+  boxZ.push_back(center.z);
+  extentX.push_back(extents.x);
+  extentY.push_back(extents.y);
+  extentZ.push_back(extents.z);
+}
+
+uint32_t NileCullBatch::cull(const NileFrustum &frustum, uint8_t *visible) const {
+  const auto &planes = frustum.getPlanes();
+  const size_t count = size();
+  uint32_t visibleCount = 0;
+  size_t i = 0;
+
+#if defined(NILE_CULL_AVX) || defined(NILE_CULL_SSE)
+  // broadcast once, the same planes are used for every object
+  vfloat normalX[NileFrustum::PLANE_COUNT], normalY[NileFrustum::PLANE_COUNT];
+  vfloat normalZ[NileFrustum::PLANE_COUNT], distance[NileFrustum::PLANE_COUNT];
+  vfloat absNormalX[NileFrustum::PLANE_COUNT], absNormalY[NileFrustum::PLANE_COUNT];
+  vfloat absNormalZ[NileFrustum::PLANE_COUNT];
+  for (size_t p = 0; p < planes.size(); p++) {
+    normalX[p] = vset(planes[p].x);
+    normalY[p] = vset(planes[p].y);
+    normalZ[p] = vset(planes[p].z);
+    distance[p] = vset(planes[p].w);
+    absNormalX[p] = vset(std::abs(planes[p].x));
+    absNormalY[p] = vset(std::abs(planes[p].y));
+    absNormalZ[p] = vset(std::abs(planes[p].z));
+  }
+  const vfloat zero = vset(0.f);
+
+  for (; i + kLanes <= count; i += kLanes) {
+    const vfloat sx = vload(&sphereX[i]);
+    const vfloat sy = vload(&sphereY[i]);
+    const vfloat sz = vload(&sphereZ[i]);
+    const vfloat sr = vload(&sphereRadius[i]);
+    const vfloat bx = vload(&boxX[i]);
+    const vfloat by = vload(&boxY[i]);
+    const vfloat bz = vload(&boxZ[i]);
+    const vfloat ex = vload(&extentX[i]);
+    const vfloat ey = vload(&extentY[i]);
+    const vfloat ez = vload(&extentZ[i]);
+
+    // all bits set while no plane has the sphere or the box fully outside
+    vfloat inside = vcmpge(zero, zero);
+    for (size_t p = 0; p < planes.size(); p++) {
+      const vfloat sphereDistance = vadd(
+          vadd(vmul(normalX[p], sx), vmul(normalY[p], sy)),
+          vadd(vmul(normalZ[p], sz), vadd(distance[p], sr)));
+      const vfloat boxDistance = vadd(
+          vadd(vmul(normalX[p], bx), vmul(normalY[p], by)),
+          vadd(vmul(normalZ[p], bz), distance[p]));
+      const vfloat boxReach =
+          vadd(vadd(vmul(absNormalX[p], ex), vmul(absNormalY[p], ey)), vmul(absNormalZ[p], ez));
+      inside = vand(inside, vcmpge(sphereDistance, zero));
+      inside = vand(inside, vcmpge(vadd(boxDistance, boxReach), zero));
+    }
+
+    const int mask = vmask(inside);
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+      visibleCount += visible[i + lane];
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    const BoundingSphere sphere{{sphereX[i], sphereY[i], sphereZ[i]}, sphereRadius[i]};
+    const glm::vec3 center{boxX[i], boxY[i], boxZ[i]};
+    const glm::vec3 extents{extentX[i], extentY[i], extentZ[i]};
+    const BoundingBox box{center - extents, center + extents};
+    const bool inside = frustum.intersects(sphere) && frustum.intersects(box);
+    visible[i] = inside ? 1 : 0;
+    visibleCount += visible[i];
+  }
+  return visibleCount;
+}
+
+}  // namespace nile
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "nile_bounds.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace nile{
+
+// The six planes of a view volume, pointing inwards, with xyz normalized so that
+// dot(plane, vec4(p, 1)) is the signed distance of p
+class NileFrustum {
+ public:
+  enum Plane {
+    PLANE_LEFT = 0,
+    PLANE_RIGHT,
+    PLANE_BOTTOM,
+    PLANE_TOP,
+    PLANE_NEAR,
+    PLANE_FAR,
+    PLANE_COUNT
+  };
+
+  NileFrustum() = default;
+
+  // Planes of projection * view, for a [0, 1] depth range
+  static NileFrustum fromMatrix(const glm::mat4 &viewProjection);
+
+  bool intersects(const BoundingSphere &sphere) const;
+  bool intersects(const BoundingBox &box) const;
+
+  const std::array<glm::vec4, PLANE_COUNT> &getPlanes() const { return planes; }
+
+ private:
+  std::array<glm::vec4, PLANE_COUNT> planes{};
+};
+
+// Structure of arrays input for culling many objects against one frustum. Each object is
+// tested with both its world space sphere and box and is culled when either lies fully outside
+// a plane, several objects at a time with SSE (or AVX when built with USE_AVX). Targets
+// without SSE use the scalar path.
+class NileCullBatch {
+ public:
+  // number of objects tested per SIMD iteration
+  static const size_t LANES;
+
+  void clear();
+  void reserve(size_t count);
+  // Model space bounds, moved to world space with transform
+  void push(const BoundingBox &box, const BoundingSphere &sphere, const glm::mat4 &transform);
+  size_t size() const { return sphereX.size(); }
+
+  // Writes 1 to visible[i] for every object that intersects frustum and 0 for the rest,
+  // returns the number of visible objects
+  uint32_t cull(const NileFrustum &frustum, uint8_t *visible) const;
+
+ private:
+  std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+  std::vector<float> boxX, boxY, boxZ;
+  std::vector<float> extentX, extentY, extentZ;
+};
+
+}  // namespace nile
@@ -1,5 +1,8 @@
 #include "nile_game_object.hpp"
 
+#include "nile_profiler.hpp"
+
+#include <algorithm>
 #include <numeric>
 
 namespace nile{
@@ -61,85 +64,220 @@ glm::mat3 TransformComponent::normalMatrix() {
   };
 }
 
-NileGameObject& NileGameObjectManager::makeBall(float radius, glm::vec2 velocity) {
-    auto& gameObj = createGameObject();
-    gameObj.ball = std::make_unique<BallComponent>();
-    gameObj.ball->radius = radius;
-    gameObj.transform2d.scale.x = radius * 2;
-    gameObj.transform2d.scale.y = radius * 2;
-    gameObj.rigidBody2d.velocity = velocity;
+NileGameObject NileGameObjectManager::makeBall(float radius, glm::vec2 velocity) {
+    auto gameObj = createGameObject();
+    gameObj.add<BallComponent>().radius = radius;
+    gameObj.transform2d().scale.x = radius * 2;
+    gameObj.transform2d().scale.y = radius * 2;
+    gameObj.rigidBody2d().velocity = velocity;
     return gameObj;
 }
 
-NileGameObject& NileGameObjectManager::makePointLight(
+NileGameObject NileGameObjectManager::makePointLight(
     float intensity, float radius, glm::vec3 color) {
-  auto& gameObj = createGameObject();
-  gameObj.color = color;
-  gameObj.transform.scale.x = radius;
-  gameObj.pointLight = std::make_unique<PointLightComponent>();
-  gameObj.pointLight->lightIntensity = intensity;
+  auto gameObj = createGameObject();
+  gameObj.transform().scale.x = radius;
+  auto& pointLight = gameObj.add<PointLightComponent>();
+  pointLight.lightIntensity = intensity;
+  pointLight.color = color;
   return gameObj;
 }
 
-NileGameObject& NileGameObjectManager::makeWater(float intensity) {
-    auto& gameObj = createGameObject();
-    gameObj.water = std::make_unique<WaterComponent>();
-    gameObj.water->rippleIntensity = intensity;
+NileGameObject NileGameObjectManager::makeWater(float intensity) {
+    auto gameObj = createGameObject();
+    gameObj.add<WaterComponent>().rippleIntensity = intensity;
     return gameObj;
 }
 
-NileGameObject& NileGameObjectManager::makeParticle(
+NileGameObject NileGameObjectManager::makeParticle(
     float Life, glm::vec2 Position, glm::vec2 Velocity, glm::vec4 Color
 ) {
-    auto& gameObj = createGameObject();
-    gameObj.particle = std::make_unique<ParticleComponent>();
-    gameObj.color = Color;
-    gameObj.transform2d.translation.x = Position.x;
-    gameObj.transform2d.translation.y = Position.y;
-    gameObj.isParticle = true;
-    gameObj.particle->Life = Life;
-    gameObj.rigidBody2d.velocity = Velocity;
+    auto gameObj = createGameObject();
+    auto& particle = gameObj.add<ParticleComponent>();
+    particle.Life = Life;
+    gameObj.render().color = Color;
+    gameObj.transform2d().translation.x = Position.x;
+    gameObj.transform2d().translation.y = Position.y;
+    gameObj.rigidBody2d().velocity = Velocity;
     return gameObj;
 }
 
-NileGameObjectManager::NileGameObjectManager(NileDevice& device) {
-    // including nonCoherentAtomSize allows us to flush a specific index at once
-    int alignment = std::lcm(
-        device.properties.limits.nonCoherentAtomSize,
-        device.properties.limits.minUniformBufferOffsetAlignment);
+NileGameObjectManager::NileGameObjectManager(NileDevice& device) : nileDevice{device} {
     for (int i = 0; i < uboBuffers.size(); i++) {
-        uboBuffers[i] = std::make_unique<NileBuffer>(
-            device,
-            sizeof(GameObjectBufferData),
-            NileGameObjectManager::MAX_GAME_OBJECTS,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-            alignment);
-        uboBuffers[i]->map();
+        createUboBuffer(i, BUFFER_CHUNK_SIZE);
     }
 
     textureDefault = NileTexture::createTextureFromFile(device, "../resources/images/missing.png");
     dudvDefault = NileTexture::createTextureFromFile(device, "../resources/images/waterDUDV.png");
 }
 
+void NileGameObjectManager::createUboBuffer(int frameIndex, uint32_t instanceCount) {
+    // including nonCoherentAtomSize allows us to flush a specific index at once. The same buffer
+    // is bound as a uniform buffer per object and as the storage buffer transform table.
+    int alignment = std::lcm(
+        nileDevice.properties.limits.nonCoherentAtomSize,
+        nileDevice.properties.limits.minUniformBufferOffsetAlignment);
+    uboBuffers[frameIndex] = std::make_unique<NileBuffer>(
+        nileDevice,
+        sizeof(GameObjectBufferData),
+        instanceCount,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        alignment);
+    uboBuffers[frameIndex]->map();
+}
+
+NileGameObject NileGameObjectManager::createGameObject() {
+    NileGameObject::id_t id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    } else {
+        id = static_cast<NileGameObject::id_t>(slots.size());
+        slots.emplace_back();
+    }
+    slots[id].alive = true;
+    objectCount++;
+
+    auto gameObject = NileGameObject{id, slots[id].generation, *this};
+    gameObject.add<TransformComponent>();
+    return gameObject;
+}
+
+void NileGameObjectManager::destroyGameObject(NileGameObject gameObject) {
+    assert(isAlive(gameObject) && "Game object already destroyed");
+    if (gameObject.id < bvhProxies.size() && bvhProxies[gameObject.id] != NileBvh::NULL_NODE) {
+        bvh.remove(bvhProxies[gameObject.id]);
+        bvhProxies[gameObject.id] = NileBvh::NULL_NODE;
+    }
+    if (components.contains<StaticComponent>(gameObject.id)) staticVersion++;
+    components.removeAll(gameObject.id);
+    auto& slot = slots[gameObject.id];
+    slot.alive = false;
+    slot.generation++;
+    freeIds.push_back(gameObject.id);
+    objectCount--;
+}
+
 void NileGameObjectManager::updateBuffer(int frameIndex) {
-  // copy model matrix and normal matrix for each gameObj into
+  NILE_PROFILE_ZONE("updateBuffer");
+  // a freshly grown buffer holds nothing yet, so every object has to be written
+  bool uploadAll = false;
+  if (uboBuffers[frameIndex]->getInstanceCount() < slots.size()) {
+    uint32_t chunks = (static_cast<uint32_t>(slots.size()) + BUFFER_CHUNK_SIZE - 1) / BUFFER_CHUNK_SIZE;
+    createUboBuffer(frameIndex, chunks * BUFFER_CHUNK_SIZE);
+    uploadAll = true;
+  }
+
+  // recompute matrices of every changed transform in one SIMD batch
+  if (matrixCache.size() < slots.size()) {
+    matrixCache.resize(slots.size());
+  }
+  transformBatch.clear();
+  staleIds.clear();
+  view<TransformComponent>().each([&](NileGameObject::id_t id, TransformComponent& transform) {
+    if ((transform.dirtyFrames & TransformComponent::MATRICES_STALE) == 0) return;
+    transform.dirtyFrames &= ~TransformComponent::MATRICES_STALE;
+    transformBatch.push(transform.translation, transform.rotation, transform.scale);
+    staleIds.push_back(id);
+  });
+  batchModelMatrices.resize(staleIds.size());
+  batchNormalMatrices.resize(staleIds.size());
+  transformBatch.computeMatrices(batchModelMatrices.data(), batchNormalMatrices.data());
+  for (size_t i = 0; i < staleIds.size(); i++) {
+    matrixCache[staleIds[i]].modelMatrix = batchModelMatrices[i];
+    matrixCache[staleIds[i]].normalMatrix = batchNormalMatrices[i];
+    updateBounds(staleIds[i]);
+  }
+
+  // copy model matrix and normal matrix for each changed gameObj into
   // buffer for this frame
-  for (auto& kv : gameObjects) {
-    auto& obj = kv.second;
-    GameObjectBufferData data{};
-    data.modelMatrix = obj.transform.mat4();
-    data.normalMatrix = obj.transform.normalMatrix();
-    uboBuffers[frameIndex]->writeToIndex(&data, kv.first);
+  const uint32_t frameBit = 1u << frameIndex;
+  dirtyIds.clear();
+  view<TransformComponent>().each([&](NileGameObject::id_t id, TransformComponent& transform) {
+    if (!uploadAll && (transform.dirtyFrames & frameBit) == 0) return;
+    transform.dirtyFrames &= ~frameBit;
+    uboBuffers[frameIndex]->writeToIndex(&matrixCache[id], id);
+    dirtyIds.push_back(id);
+  });
+
+  // coalesce neighbouring ids so a moving group of objects costs one flush range
+  std::sort(dirtyIds.begin(), dirtyIds.end());
+  flushRanges.clear();
+  for (auto id : dirtyIds) {
+    if (!flushRanges.empty() &&
+        flushRanges.back().firstIndex + flushRanges.back().count == id) {
+      flushRanges.back().count++;
+    } else {
+      flushRanges.push_back({id, 1});
+    }
+  }
+  uboBuffers[frameIndex]->flushIndexRanges(flushRanges);
+
+  bufferStats.matricesRecomputed = static_cast<uint32_t>(staleIds.size());
+  bufferStats.flushRanges = static_cast<uint32_t>(flushRanges.size());
+  bufferStats.bytesFlushed = dirtyIds.size() * uboBuffers[frameIndex]->getAlignmentSize();
+}
+
+void NileGameObjectManager::updateBounds(NileGameObject::id_t id) {
+  if (bvhProxies.size() < slots.size()) {
+    bvhProxies.resize(slots.size(), NileBvh::NULL_NODE);
+  }
+  int32_t& proxy = bvhProxies[id];
+  const auto* render = pool<const RenderComponent>().tryGet(id);
+  if (render == nullptr || render->model == nullptr || render->model->getBoundingBox().isEmpty()) {
+    if (proxy != NileBvh::NULL_NODE) {
+      bvh.remove(proxy);
+      proxy = NileBvh::NULL_NODE;
+    }
+    return;
+  }
+
+  const BoundingBox box =
+      render->model->getBoundingBox().transformed(matrixCache[id].modelMatrix);
+  if (proxy == NileBvh::NULL_NODE) {
+    proxy = bvh.insert(box, id);
+  } else {
+    bvh.move(proxy, box);
+  }
+}
+
+void NileGameObjectManager::cull(const NileFrustum& frustum) {
+  NILE_PROFILE_ZONE("frustum cull");
+  // everything the bvh holds starts out culled, the query only reaches nodes in the frustum
+  visibility.assign(slots.size(), 1);
+  for (size_t id = 0; id < bvhProxies.size(); id++) {
+    if (bvhProxies[id] != NileBvh::NULL_NODE) visibility[id] = 0;
+  }
+
+  auto& renders = pool<const RenderComponent>();
+  cullBatch.clear();
+  cullIds.clear();
+  bvh.queryFrustum(frustum, [&](uint32_t id) {
+    // the tree only catches up with render component changes on the next transform change
+    const auto* render = renders.tryGet(id);
+    if (render == nullptr || render->model == nullptr || render->isHidden) return;
+    cullBatch.push(
+        render->model->getBoundingBox(),
+        render->model->getBoundingSphere(),
+        matrixCache[id].modelMatrix);
+    cullIds.push_back(id);
+  });
+
+  cullResults.resize(cullIds.size());
+  cullStats.tested = static_cast<uint32_t>(cullIds.size());
+  cullStats.visible = cullBatch.cull(frustum, cullResults.data());
+  for (size_t i = 0; i < cullIds.size(); i++) {
+    visibility[cullIds[i]] = cullResults[i];
   }
-  uboBuffers[frameIndex]->flush();
 }
 
 VkDescriptorBufferInfo NileGameObject::getBufferInfo(int frameIndex) {
-    return gameObjectManager.getBufferInfoForGameObject(frameIndex, id);
+    return gameObjectManager->getBufferInfoForGameObject(frameIndex, id);
 }
 
-NileGameObject::NileGameObject(id_t objId, const NileGameObjectManager& manager)
-    : id{objId}, gameObjectManager{manager} {}
+NileGameObject::NileGameObject(
+    id_t objId, uint32_t objGeneration, NileGameObjectManager& manager)
+    : id{objId}, generation{objGeneration}, gameObjectManager{&manager} {}
 
 }  // namespace nile
\ No newline at end of file
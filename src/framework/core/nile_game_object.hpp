@@ -1,24 +1,40 @@
 #pragma once
 
+#include "nile_bvh.hpp"
+#include "nile_component_store.hpp"
+#include "nile_frustum.hpp"
 #include "nile_model.hpp"
 #include "nile_swap_chain.hpp"
 #include "nile_texture.hpp"
-#include "nile_off_screen.hpp"
+#include "nile_transform_batch.hpp"
 
 // libs
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
+#include <cassert>
 #include <memory>
-#include <unordered_map>
+#include <type_traits>
 
 namespace nile{
 
 struct TransformComponent {
+  static constexpr uint32_t ALL_FRAMES_DIRTY = ~0u;
+  // set until the manager has recomputed the cached matrices, frames use the low bits
+  static constexpr uint32_t MATRICES_STALE = 1u << 31;
+
   glm::vec3 translation{};
   glm::vec3 scale{1.f, 1.f, 1.f};
   glm::vec3 rotation{};
 
+  // One bit per frame in flight whose object buffer still holds stale matrices, plus
+  // MATRICES_STALE.
+  // NileGameObject::transform() marks the transform dirty, code that writes through a view
+  // has to call markDirty() itself.
+  uint32_t dirtyFrames = ALL_FRAMES_DIRTY;
+
+  void markDirty() { dirtyFrames = ALL_FRAMES_DIRTY; }
+
   // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
   // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
   // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
@@ -61,10 +77,29 @@ struct BallComponent
 struct WaterComponent
 {
   float rippleIntensity = 1.0f;
+  std::shared_ptr<NileTexture> normalMap = nullptr;
+  std::shared_ptr<NileTexture> depthMap = nullptr;
+  std::shared_ptr<NileTexture> dudvMap = nullptr;
+  // rendered by the NileRenderGraph passes WaterSystem::addMapPasses declares, WaterSystem
+  // throws if they were not set
+  VkDescriptorImageInfo reflectionImage{};
+  VkDescriptorImageInfo refractionImage{};
+};
+
+struct MirrorComponent
+{
+  // rendered by a NileRenderGraph pass
+  VkDescriptorImageInfo reflectionImage{};
+};
+
+struct BrickComponent
+{
+  bool isSolid = false;
 };
 
 struct PointLightComponent {
   float lightIntensity = 1.0f;
+  glm::vec3 color{1.f};
 };
 
 struct RigidBodyComponent2d {
@@ -72,61 +107,100 @@ struct RigidBodyComponent2d {
   float mass{1.0f};
 };
 
+// Everything a render system needs to draw an object
+struct RenderComponent {
+  std::shared_ptr<NileModel> model{};
+  std::shared_ptr<NileTexture> diffuseMap = nullptr;
+  glm::vec3 color{};
+  bool isHidden = false;
+};
+
+// Tags an object whose draw never changes, render systems record it once into a cached command
+// buffer. Moving a 3D static object is fine, anything else they bake into the recording (its
+// RenderComponent, or its 2D transform) only shows up after markStaticChanged.
+struct StaticComponent {};
+
 struct GameObjectBufferData {
   glm::mat4 modelMatrix{1.f};
   glm::mat4 normalMatrix{1.f};
 };
 
+// How a render system points its shaders at an object's slot in the object buffer.
+// PerObjectSet writes a descriptor set per object, DynamicOffset binds one
+// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC set per frame and picks the slot with a dynamic offset.
+enum class ObjectBufferMode { PerObjectSet, DynamicOffset };
+
+inline VkDescriptorType objectBufferDescriptorType(ObjectBufferMode mode) {
+  return mode == ObjectBufferMode::DynamicOffset ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+                                                 : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+}
+
 class NileGameObjectManager;    // forward declare game object manager class
 
+// Lightweight handle to a game object. The object's data lives in the manager's per-type
+// component pools, so handles are cheap to copy and pass around by value. The generation
+// lets the manager recycle ids while still detecting handles to destroyed objects.
 class NileGameObject {
  public:
-  using id_t = unsigned int;
-  using Map = std::unordered_map<id_t, NileGameObject>;
+  using id_t = NileComponentStore::id_t;
+
+  NileGameObject() = default;
 
-  NileGameObject(NileGameObject &&) = default;
-  NileGameObject(const NileGameObject &) = delete;
-  NileGameObject &operator=(const NileGameObject &) = delete;
-  NileGameObject &operator=(NileGameObject &&) = delete;
+  id_t getId() const { return id; }
+  uint32_t getGeneration() const { return generation; }
 
-  id_t getId() { return id; }
-  
-  void setIsHidden(bool set_show_model) { isHidden = set_show_model; }
-  bool getIsHidden() { return isHidden; }
+  // false for default constructed handles and handles to destroyed objects
+  bool valid() const;
+
+  bool operator==(const NileGameObject &other) const {
+    return id == other.id && generation == other.generation &&
+           gameObjectManager == other.gameObjectManager;
+  }
+
+  // get<const T>() and tryGet<const T>() for systems that only declared reads of T
+  template <typename T>
+  bool has() const;
+  template <typename T>
+  T &get();
+  template <typename T>
+  T *tryGet();
+  template <typename T, typename... Args>
+  T &add(Args &&...args);
+  template <typename T>
+  void remove();
+
+  // Components most objects carry; attached on first access. Do not call these while
+  // iterating a view over the same component type if the object may not have it yet.
+  // assumes the caller writes to it, see TransformComponent::dirtyFrames
+  TransformComponent &transform() {
+    auto &transform = getOrAdd<TransformComponent>();
+    transform.markDirty();
+    return transform;
+  }
+  // for reads that leave the transform clean, e.g. a camera following the object; the object
+  // must already have one
+  const TransformComponent &readTransform() const;
+  TransformComponent2d &transform2d() { return getOrAdd<TransformComponent2d>(); }
+  RigidBodyComponent2d &rigidBody2d() { return getOrAdd<RigidBodyComponent2d>(); }
+  RenderComponent &render() { return getOrAdd<RenderComponent>(); }
+
+  void setIsHidden(bool set_show_model) { render().isHidden = set_show_model; }
+  bool getIsHidden() { return render().isHidden; }
 
   VkDescriptorBufferInfo getBufferInfo(int frameIndex);
 
-  glm::vec3 color{};
-  bool isSolid = false;
-  bool isMirror = false;
-  bool isParticle = false;
-  bool Destroyed = false;
-  bool isVectorField = false;
-  
-  TransformComponent transform{};
-  TransformComponent2d transform2d{};
-  RigidBodyComponent2d rigidBody2d{};
-
-  // Optional pointer components
-  std::shared_ptr<NileModel> model{};
-  std::shared_ptr<NileTexture> diffuseMap = nullptr;
-  std::shared_ptr<NileTexture> normalMap = nullptr;
-  std::shared_ptr<NileTexture> depthMap = nullptr;
-  std::shared_ptr<NileTexture> dudvMap = nullptr;
-  std::shared_ptr<NileOffScreen> reflectionTexture = nullptr;
-  std::shared_ptr<NileOffScreen> refractionTexture = nullptr;
-  std::unique_ptr<PointLightComponent> pointLight = nullptr;
-  std::unique_ptr<WaterComponent> water = nullptr;
-  std::unique_ptr<BallComponent> ball = nullptr;
-  std::unique_ptr<ParticleComponent> particle = nullptr;
-  
  private:
-  NileGameObject(id_t objId, const NileGameObjectManager &manager);
+  NileGameObject(id_t objId, uint32_t objGeneration, NileGameObjectManager &manager);
 
-  id_t id;
-  bool isHidden = false;
+  template <typename T>
+  T &getOrAdd() {
+    T *component = tryGet<T>();
+    return component != nullptr ? *component : add<T>();
+  }
 
-  const NileGameObjectManager &gameObjectManager;
+  id_t id = 0;
+  uint32_t generation = 0;
+  NileGameObjectManager *gameObjectManager = nullptr;
 
   friend class NileGameObjectManager;
 };
@@ -147,12 +221,13 @@ void init(
     NileGameObjectManager& gom, 
     const std::vector<std::vector<unsigned int>>& tileData,
     unsigned int levelWidth, unsigned int levelHeight, bool isCurrentLevel);
-    std::vector<NileGameObject::id_t> bricks;
+    std::vector<NileGameObject> bricks;
 };
 
 class NileGameObjectManager {
   public:
-   static constexpr int MAX_GAME_OBJECTS = 1000;
+   // per object GPU buffers grow by whole chunks once the id range outgrows them
+   static constexpr uint32_t BUFFER_CHUNK_SIZE = 1024;
 
    NileGameObjectManager(NileDevice &device);
    NileGameObjectManager(const NileGameObjectManager &) = delete;
@@ -160,42 +235,230 @@ class NileGameObjectManager {
    NileGameObjectManager(NileGameObjectManager &&) = delete;
    NileGameObjectManager &operator=(NileGameObjectManager &&) = delete;
 
-   NileGameObject &createGameObject() {
-    assert(currentId < MAX_GAME_OBJECTS && "Max game object count exceeded!");
-    auto gameObject = NileGameObject{currentId++, *this};
-    auto gameObjectId = gameObject.getId();
-    gameObject.diffuseMap = textureDefault;
-    gameObject.normalMap = textureDefault;
-    gameObject.depthMap = textureDefault;
-    gameObject.dudvMap = dudvDefault;
-    gameObjects.emplace(gameObjectId, std::move(gameObject));
-    return gameObjects.at(gameObjectId);
+   // O(1); reuses the most recently freed id when there is one
+   NileGameObject createGameObject();
+
+   // Drops all components and frees the id. Existing handles to the object become invalid.
+   void destroyGameObject(NileGameObject gameObject);
+
+   bool isAlive(const NileGameObject &gameObject) const {
+    return gameObject.id < slots.size() && slots[gameObject.id].alive &&
+           slots[gameObject.id].generation == gameObject.generation;
    }
 
-   NileGameObject &makePointLight(
+   NileGameObject get(NileGameObject::id_t id) {
+    assert(id < slots.size() && slots[id].alive && "Game object id is not alive");
+    return NileGameObject{id, slots[id].generation, *this};
+   }
+
+   NileGameObject makePointLight(
       float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
 
-   NileGameObject &makeBall(float radius = .025f, glm::vec2 velocity = {.09f, -.09f});
+   NileGameObject makeBall(float radius = .025f, glm::vec2 velocity = {.09f, -.09f});
 
-   NileGameObject &makeWater(float rippleIntensity = 1.f);
+   NileGameObject makeWater(float rippleIntensity = 1.f);
 
-   NileGameObject &makeParticle(
+   NileGameObject makeParticle(
     float Life = 0.0f, glm::vec2 Position = glm::vec2(0.0f), glm::vec2 Velocity = glm::vec2(0.0f), glm::vec4 Color = glm::vec4(1.0f));
 
+   // Iterate all objects that own every component in Ts, e.g.
+   // view<TransformComponent, RenderComponent>().each([](auto id, auto &transform, auto &render) {});
+   template <typename... Ts>
+   NileView<Ts...> view() {
+     return components.view<Ts...>();
+   }
+
+   // pool<const T>() for systems that only declared reads of T
+   template <typename T>
+   NileComponentPoolOf<T> &pool() {
+     return components.pool<T>();
+   }
+
+   template <typename T, typename... Args>
+   T &addComponent(NileGameObject::id_t id, Args &&...args) {
+     T &component = components.pool<T>().emplace(id, std::forward<Args>(args)...);
+     // drawable objects fall back to the placeholder textures until the app assigns its own
+     if constexpr (std::is_same_v<T, RenderComponent>) {
+       if (component.diffuseMap == nullptr) component.diffuseMap = textureDefault;
+     } else if constexpr (std::is_same_v<T, WaterComponent>) {
+       if (component.normalMap == nullptr) component.normalMap = textureDefault;
+       if (component.depthMap == nullptr) component.depthMap = textureDefault;
+       if (component.dudvMap == nullptr) component.dudvMap = dudvDefault;
+     }
+     if constexpr (std::is_same_v<T, StaticComponent>) staticVersion++;
+     return component;
+   }
+
+   template <typename T>
+   void removeComponent(NileGameObject::id_t id) {
+     if constexpr (std::is_same_v<T, StaticComponent>) {
+       if (components.pool<T>().contains(id)) staticVersion++;
+     }
+     components.pool<T>().remove(id);
+   }
+
+   // Bumped whenever the set of static objects changes, render systems re-record their static
+   // draws when it differs from the version they recorded
+   uint64_t getStaticVersion() const { return staticVersion; }
+   void markStaticChanged() { staticVersion++; }
+
+   // Work done by the last updateBuffer call
+   struct BufferStats {
+     uint32_t matricesRecomputed = 0;
+     uint32_t flushRanges = 0;
+     VkDeviceSize bytesFlushed = 0;
+   };
+
+   // Objects tested and left visible by the last cull call
+   struct CullStats {
+     // drawable objects in the tree leaves the frustum query reached, tested one by one
+     uint32_t tested = 0;
+     uint32_t visible = 0;
+   };
+
+   size_t size() const { return objectCount; }
+
+   // number of ids handed out so far, live or free; ids are always below this
+   uint32_t idRange() const { return static_cast<uint32_t>(slots.size()); }
+
    VkDescriptorBufferInfo getBufferInfoForGameObject(
         int frameIndex, NileGameObject::id_t gameObjectId) const {
+      assert(
+          gameObjectId < uboBuffers[frameIndex]->getInstanceCount() &&
+          "Game object buffer too small, call updateBuffer before recording");
       return uboBuffers[frameIndex]->descriptorInfoForIndex(gameObjectId);
     }
 
+    // One slot sized view of the start of this frame's buffer, for a dynamic uniform buffer
+    // binding. The object is then picked with getDynamicOffset when binding the set.
+    VkDescriptorBufferInfo getDynamicBufferInfo(int frameIndex) const {
+      return uboBuffers[frameIndex]->descriptorInfo(uboBuffers[frameIndex]->getAlignmentSize(), 0);
+    }
+
+    uint32_t getDynamicOffset(int frameIndex, NileGameObject::id_t gameObjectId) const {
+      assert(
+          gameObjectId < uboBuffers[frameIndex]->getInstanceCount() &&
+          "Game object buffer too small, call updateBuffer before recording");
+      return static_cast<uint32_t>(gameObjectId * uboBuffers[frameIndex]->getAlignmentSize());
+    }
+
+    // This frame's whole buffer as a storage buffer, indexed by object id in the shaders. Slots
+    // are getTransformTableStride bytes apart, which is the uniform buffer alignment and not
+    // necessarily sizeof(GameObjectBufferData).
+    VkDescriptorBufferInfo getTransformTableInfo(int frameIndex) const {
+      return uboBuffers[frameIndex]->descriptorInfo();
+    }
+
+    VkDeviceSize getTransformTableStride() const { return uboBuffers[0]->getAlignmentSize(); }
+
+    // Also grows this frame's buffer if objects were created since it was last sized. Only the
+    // buffer for frameIndex is touched, which the GPU is done with once its fence was waited on.
+    // Objects whose transform changed are refit in the bvh.
     void updateBuffer(int frameIndex);
 
-    NileGameObject::Map gameObjects{};
+    const BufferStats &getBufferStats() const { return bufferStats; }
+
+    // Model and normal matrix computed by the last updateBuffer call. Render systems should
+    // use these rather than calling TransformComponent::mat4() again.
+    const GameObjectBufferData &getMatrices(NileGameObject::id_t gameObjectId) const {
+      assert(
+          gameObjectId < matrixCache.size() &&
+          "No cached matrices for game object, call updateBuffer before recording");
+      return matrixCache[gameObjectId];
+    }
+
+    // World space boxes of every object with a model, keyed by object id. An object enters the
+    // tree, moves in it or leaves it in the updateBuffer after its transform changed, so a model
+    // assigned later is picked up with the next transform change.
+    const NileBvh &getBvh() const { return bvh; }
+
+    // Tests the bounds of the objects the bvh finds in frustum, with the matrices of the last
+    // updateBuffer call. Render systems skip objects it left outside until the next call,
+    // objects that are not in the bvh are always visible.
+    void cull(const NileFrustum &frustum);
+
+    bool isVisible(NileGameObject::id_t gameObjectId) const {
+      return gameObjectId >= visibility.size() || visibility[gameObjectId] != 0;
+    }
+
+    const CullStats &getCullStats() const { return cullStats; }
+
     std::vector<std::unique_ptr<NileBuffer>> uboBuffers{NileSwapChain::MAX_FRAMES_IN_FLIGHT};
 
     private:
-    NileGameObject::id_t currentId = 0;
+    struct Slot {
+      uint32_t generation = 0;
+      bool alive = false;
+    };
+
+    void createUboBuffer(int frameIndex, uint32_t instanceCount);
+    void updateBounds(NileGameObject::id_t id);
+
+    NileDevice &nileDevice;
+    NileComponentStore components{};
+    std::vector<Slot> slots{};
+    std::vector<NileGameObject::id_t> freeIds{};
+    size_t objectCount = 0;
+
+    // matrices indexed by id, recomputed in batches for objects whose transform changed
+    std::vector<GameObjectBufferData> matrixCache{};
+    NileTransformBatch transformBatch{};
+    std::vector<NileGameObject::id_t> staleIds{};
+    std::vector<glm::mat4> batchModelMatrices{};
+    std::vector<glm::mat4> batchNormalMatrices{};
+
+    NileBvh bvh{};
+    std::vector<int32_t> bvhProxies{};  // indexed by id
+
+    // visibility indexed by id, written by cull
+    NileCullBatch cullBatch{};
+    std::vector<NileGameObject::id_t> cullIds{};
+    std::vector<uint8_t> cullResults{};
+    std::vector<uint8_t> visibility{};
+    CullStats cullStats{};
+
+    uint64_t staticVersion = 0;
+    std::vector<NileGameObject::id_t> dirtyIds{};
+    std::vector<NileBuffer::IndexRange> flushRanges{};
+    BufferStats bufferStats{};
     std::shared_ptr<NileTexture> textureDefault;
     std::shared_ptr<NileTexture> dudvDefault;
 };
 
+inline bool NileGameObject::valid() const {
+  return gameObjectManager != nullptr && gameObjectManager->isAlive(*this);
+}
+
+template <typename T>
+bool NileGameObject::has() const {
+  return gameObjectManager->pool<const T>().contains(id);
+}
+
+inline const TransformComponent &NileGameObject::readTransform() const {
+  assert(valid() && "Accessing a destroyed game object");
+  return gameObjectManager->pool<const TransformComponent>().get(id);
+}
+
+template <typename T>
+T &NileGameObject::get() {
+  assert(valid() && "Accessing a destroyed game object");
+  return gameObjectManager->pool<T>().get(id);
+}
+
+template <typename T>
+T *NileGameObject::tryGet() {
+  return gameObjectManager->pool<T>().tryGet(id);
+}
+
+template <typename T, typename... Args>
+T &NileGameObject::add(Args &&...args) {
+  assert(valid() && "Accessing a destroyed game object");
+  return gameObjectManager->addComponent<T>(id, std::forward<Args>(args)...);
+}
+
+template <typename T>
+void NileGameObject::remove() {
+  gameObjectManager->removeComponent<T>(id);
+}
+
 }  // namespace nile
@@ -0,0 +1,185 @@
+#include "nile_gpu_profiler.hpp"
+
+#include "nile_frame_info.hpp"
+#include "nile_swap_chain.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace nile{
+
+constexpr uint32_t MAX_QUERIES = 2 + 2 * NileGpuProfiler::MAX_SCOPES;
+
+// results come back in the order of the bits, as PipelineStatistics lists them
+constexpr VkQueryPipelineStatisticFlags STATISTIC_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+constexpr uint32_t STATISTIC_COUNT = 5;
+
+NileGpuProfiler::NileGpuProfiler(NileDevice &device) : device{device} {
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(
+      device.getPhysicalDevice(), &familyCount, families.data());
+  const uint32_t validBits =
+      families[device.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+  timestampMask = validBits >= 64 ? ~uint64_t{0} : (uint64_t{1} << validBits) - 1;
+  nsPerTick = device.properties.limits.timestampPeriod;
+  statisticsSupported = device.getEnabledFeatures().pipelineStatisticsQuery &&
+                        device.getEnabledFeatures().inheritedQueries;
+  history.assign(HISTORY_LENGTH, 0.f);
+  if (!isSupported()) return;
+
+  frames.resize(NileSwapChain::MAX_FRAMES_IN_FLIGHT);
+  for (auto &frame : frames) {
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = MAX_QUERIES;
+    if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &frame.timestamps) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    if (!statisticsSupported) continue;
+    poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    poolInfo.queryCount = 1;
+    poolInfo.pipelineStatistics = STATISTIC_FLAGS;
+    if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &frame.statistics) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline statistics query pool!");
+    }
+  }
+}
+
+NileGpuProfiler::~NileGpuProfiler() {
+  for (auto &frame : frames) {
+    vkDestroyQueryPool(device.device(), frame.timestamps, nullptr);
+    if (frame.statistics != VK_NULL_HANDLE) {
+      vkDestroyQueryPool(device.device(), frame.statistics, nullptr);
+    }
+  }
+}
+
+VkQueryPipelineStatisticFlags NileGpuProfiler::getPipelineStatisticFlags() const {
+  return current != nullptr && current->hasStatistics ? STATISTIC_FLAGS : 0;
+}
+
+void NileGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, int frameIndex) {
+  if (!isSupported()) return;
+  assert(current == nullptr && "Can't begin a frame while another one is profiled");
+  Frame &frame = frames[frameIndex];
+  if (frame.isPending) readResults(frame);
+
+  frame.scopes.clear();
+  frame.hasStatistics = statisticsSupported && statisticsRequested;
+  frame.isPending = false;
+  current = &frame;
+  depth = 0;
+
+  vkCmdResetQueryPool(commandBuffer, frame.timestamps, 0, MAX_QUERIES);
+  if (frame.hasStatistics) {
+    vkCmdResetQueryPool(commandBuffer, frame.statistics, 0, 1);
+    vkCmdBeginQuery(commandBuffer, frame.statistics, 0, 0);
+  }
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestamps, 0);
+}
+
+void NileGpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+  if (current == nullptr) return;
+  assert(depth == 0 && "Every scope must end before the frame does");
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current->timestamps, 1);
+  if (current->hasStatistics) vkCmdEndQuery(commandBuffer, current->statistics, 0);
+  current->isPending = true;
+  current = nullptr;
+}
+
+uint32_t NileGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string &name) {
+  if (current == nullptr || current->scopes.size() == MAX_SCOPES) return NO_SCOPE;
+  const auto scope = static_cast<uint32_t>(current->scopes.size());
+  current->scopes.push_back({name, depth++});
+  vkCmdWriteTimestamp(
+      commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current->timestamps, 2 + scope * 2);
+  return scope;
+}
+
+void NileGpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (current == nullptr || scope == NO_SCOPE) return;
+  assert(!current->scopes[scope].isClosed && "Scope ended twice");
+  current->scopes[scope].isClosed = true;
+  depth--;
+  vkCmdWriteTimestamp(
+      commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current->timestamps, 3 + scope * 2);
+}
+
+void NileGpuProfiler::readResults(Frame &frame) {
+  // each query's value followed by whether it is available, the frame's fence has signaled so
+  // only scopes that were never closed can be missing
+  const auto queryCount = static_cast<uint32_t>(2 + frame.scopes.size() * 2);
+  results.resize(queryCount * 2);
+  vkGetQueryPoolResults(
+      device.device(),
+      frame.timestamps,
+      0,
+      queryCount,
+      results.size() * sizeof(uint64_t),
+      results.data(),
+      2 * sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+  auto isAvailable = [&](uint32_t query) { return results[query * 2 + 1] != 0; };
+  auto value = [&](uint32_t query) { return results[query * 2]; };
+
+  if (isAvailable(0) && isAvailable(1)) {
+    frameMs = toMs(value(0), value(1));
+    history[historyOffset] = static_cast<float>(frameMs);
+    historyOffset = (historyOffset + 1) % HISTORY_LENGTH;
+  }
+
+  timings.clear();
+  for (uint32_t s = 0; s < frame.scopes.size(); s++) {
+    const uint32_t begin = 2 + s * 2;
+    if (!isAvailable(begin) || !isAvailable(begin + 1)) continue;
+    timings.push_back(
+        {frame.scopes[s].name, frame.scopes[s].depth, toMs(value(begin), value(begin + 1))});
+  }
+
+  hasStatistics = false;
+  if (!frame.hasStatistics) return;
+  uint64_t counts[STATISTIC_COUNT + 1]{};
+  vkGetQueryPoolResults(
+      device.device(),
+      frame.statistics,
+      0,
+      1,
+      sizeof(counts),
+      counts,
+      sizeof(counts),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+  if (counts[STATISTIC_COUNT] == 0) return;
+  statistics = {counts[0], counts[1], counts[2], counts[3], counts[4]};
+  hasStatistics = true;
+}
+
+double NileGpuProfiler::toMs(uint64_t begin, uint64_t end) const {
+  // the counter may wrap within its valid bits
+  const uint64_t ticks = (end - begin) & timestampMask;
+  return static_cast<double>(ticks) * nsPerTick / 1e6;
+}
+
+NileGpuScope::NileGpuScope(FrameInfo &frameInfo, const std::string &name)
+    : frameInfo{frameInfo} {
+  if (frameInfo.gpuProfiler != nullptr) {
+    scope = frameInfo.gpuProfiler->beginScope(frameInfo.commandBuffer, name);
+  }
+}
+
+NileGpuScope::~NileGpuScope() {
+  if (frameInfo.gpuProfiler != nullptr) {
+    frameInfo.gpuProfiler->endScope(frameInfo.commandBuffer, scope);
+  }
+}
+
+}  // namespace nile
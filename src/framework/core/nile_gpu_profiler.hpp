@@ -0,0 +1,136 @@
+#pragma once
+
+#include "nile_device.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nile{
+
+struct FrameInfo;
+
+// GPU time of the frame and of named scopes inside it, from VK_QUERY_TYPE_TIMESTAMP queries.
+// Every frame in flight has its own query pool, which is read back once the frame's fence was
+// waited on before it is reused, so reading never stalls and results lag the frames in flight.
+//
+// The renderer begins and ends the frame and times every render pass itself, systems open
+// NileGpuScope around what they record. Scopes are opened and closed on the recording thread
+// in nested order, further scopes than MAX_SCOPES in a frame are left out.
+//
+// Pipeline statistics (vertex and fragment shader invocations, ...) over the whole frame are
+// optional, they need the pipelineStatisticsQuery and inheritedQueries device features.
+class NileGpuProfiler {
+ public:
+  static constexpr uint32_t MAX_SCOPES = 64;
+  static constexpr uint32_t HISTORY_LENGTH = 120;
+  static constexpr uint32_t NO_SCOPE = ~0u;
+
+  struct ScopeTiming {
+    std::string name;
+    uint32_t depth = 0;  // number of scopes it is nested in
+    double ms = 0.0;
+  };
+
+  struct PipelineStatistics {
+    uint64_t inputVertices = 0;
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+    uint64_t computeInvocations = 0;
+  };
+
+  explicit NileGpuProfiler(NileDevice &device);
+  ~NileGpuProfiler();
+
+  NileGpuProfiler(const NileGpuProfiler &) = delete;
+  NileGpuProfiler &operator=(const NileGpuProfiler &) = delete;
+
+  // false when the graphics queue can't write timestamps, every call is a no-op then
+  bool isSupported() const { return timestampMask != 0; }
+  bool supportsPipelineStatistics() const { return statisticsSupported; }
+
+  // Takes effect with the next beginFrame
+  void setPipelineStatistics(bool enabled) { statisticsRequested = enabled; }
+  // What the current frame's statistics query counts, secondary buffers executed during the
+  // frame have to inherit it
+  VkQueryPipelineStatisticFlags getPipelineStatisticFlags() const;
+
+  // Reads the results the frame's pool held from its last use and resets it, call right after
+  // beginning the frame's primary buffer once its fence was waited on
+  void beginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+  // Call before ending the primary buffer
+  void endFrame(VkCommandBuffer commandBuffer);
+
+  // Returns NO_SCOPE when nothing is recorded for it, endScope ignores that
+  uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string &name);
+  void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  // Of the latest frame read back, scopes in the order they were opened
+  double getFrameMs() const { return frameMs; }
+  const std::vector<ScopeTiming> &getTimings() const { return timings; }
+  const PipelineStatistics &getPipelineStatistics() const { return statistics; }
+  bool hasPipelineStatistics() const { return hasStatistics; }
+  // Frame times in ms, oldest at getHistoryOffset() as ImGui::PlotLines takes them
+  const std::vector<float> &getHistory() const { return history; }
+  uint32_t getHistoryOffset() const { return historyOffset; }
+
+ private:
+  struct Scope {
+    std::string name;
+    uint32_t depth = 0;
+    bool isClosed = false;
+  };
+
+  // The frame's begin and end take the first two queries, every scope the next two
+  struct Frame {
+    VkQueryPool timestamps = VK_NULL_HANDLE;
+    VkQueryPool statistics = VK_NULL_HANDLE;
+    std::vector<Scope> scopes;
+    bool hasStatistics = false;
+    bool isPending = false;
+  };
+
+  void readResults(Frame &frame);
+  double toMs(uint64_t begin, uint64_t end) const;
+
+  NileDevice &device;
+  std::vector<Frame> frames;
+  Frame *current = nullptr;
+  uint32_t depth = 0;
+
+  uint64_t timestampMask = 0;
+  double nsPerTick = 1.0;
+  bool statisticsSupported = false;
+  bool statisticsRequested = false;
+
+  double frameMs = 0.0;
+  std::vector<ScopeTiming> timings;
+  PipelineStatistics statistics{};
+  bool hasStatistics = false;
+  std::vector<float> history;
+  uint32_t historyOffset = 0;
+  std::vector<uint64_t> results;
+};
+
+// Times what is recorded into frameInfo.commandBuffer while it lives. The end is written into
+// whatever buffer frameInfo holds by then, so a scope around NileCommandRecorder::record covers
+// its parallel ranges as well. Does nothing when frameInfo has no gpuProfiler.
+class NileGpuScope {
+ public:
+  NileGpuScope(FrameInfo &frameInfo, const std::string &name);
+  ~NileGpuScope();
+
+  NileGpuScope(const NileGpuScope &) = delete;
+  NileGpuScope &operator=(const NileGpuScope &) = delete;
+
+ private:
+  FrameInfo &frameInfo;
+  uint32_t scope = NileGpuProfiler::NO_SCOPE;
+};
+
+}  // namespace nile
@@ -0,0 +1,54 @@
+#include "nile_instance_buffer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+namespace nile{
+
+NileInstanceBuffer::NileInstanceBuffer(
+    NileDevice &device,
+    VkDeviceSize instanceSize,
+    uint32_t initialCapacity,
+    VkBufferUsageFlags usage)
+    : nileDevice{device}, instanceSize{instanceSize}, usage{usage} {
+  buffers.resize(NileSwapChain::MAX_FRAMES_IN_FLIGHT);
+  for (int i = 0; i < buffers.size(); i++) {
+    createBuffer(i, initialCapacity);
+  }
+}
+
+void NileInstanceBuffer::createBuffer(int frameIndex, uint32_t capacity) {
+  buffers[frameIndex] = std::make_unique<NileBuffer>(
+      nileDevice,
+      instanceSize,
+      capacity,
+      usage,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  buffers[frameIndex]->map();
+}
+
+void NileInstanceBuffer::write(int frameIndex, const void *instances, uint32_t count) {
+  if (count == 0) return;
+
+  reserve(frameIndex, count);
+  buffers[frameIndex]->writeToBuffer(const_cast<void *>(instances), instanceSize * count);
+}
+
+void NileInstanceBuffer::reserve(int frameIndex, uint32_t count) {
+  assert(frameIndex < buffers.size() && "Frame index out of range");
+  if (count <= buffers[frameIndex]->getInstanceCount()) return;
+
+  uint32_t capacity = std::max(buffers[frameIndex]->getInstanceCount(), 1u);
+  while (capacity < count) capacity *= 2;
+  createBuffer(frameIndex, capacity);
+}
+
+void NileInstanceBuffer::bind(
+    VkCommandBuffer commandBuffer, int frameIndex, uint32_t binding, uint32_t firstInstance) {
+  VkBuffer buffer = buffers[frameIndex]->getBuffer();
+  VkDeviceSize offset = buffers[frameIndex]->getAlignmentSize() * firstInstance;
+  vkCmdBindVertexBuffers(commandBuffer, binding, 1, &buffer, &offset);
+}
+
+}  // namespace nile
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "nile_buffer.hpp"
+#include "nile_device.hpp"
+#include "nile_swap_chain.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace nile{
+
+// Per frame buffer of per instance data for instanced draws. Each frame in flight has its own
+// host coherent buffer, rewritten every frame and grown when a frame needs more room. Bound as an
+// instance rate vertex buffer by default, other usages such as storage buffers written by compute
+// passes can be added through usage.
+class NileInstanceBuffer {
+ public:
+  NileInstanceBuffer(
+      NileDevice &device,
+      VkDeviceSize instanceSize,
+      uint32_t initialCapacity = 1024,
+      VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+  NileInstanceBuffer(const NileInstanceBuffer &) = delete;
+  NileInstanceBuffer &operator=(const NileInstanceBuffer &) = delete;
+
+  // Replaces this frame's contents. Only call after the frame's fence was waited on, since the
+  // buffer may be recreated.
+  void write(int frameIndex, const void *instances, uint32_t count);
+
+  // Grows this frame's buffer to hold count instances without writing it, for buffers the GPU
+  // fills. The contents are undefined when it grows.
+  void reserve(int frameIndex, uint32_t count);
+
+  // Binds this frame's buffer to the instance rate vertex binding, starting at firstInstance
+  void bind(
+      VkCommandBuffer commandBuffer, int frameIndex, uint32_t binding = 1, uint32_t firstInstance = 0);
+
+  VkBuffer getBuffer(int frameIndex) const { return buffers[frameIndex]->getBuffer(); }
+  VkDescriptorBufferInfo descriptorInfo(int frameIndex) { return buffers[frameIndex]->descriptorInfo(); }
+
+ private:
+  void createBuffer(int frameIndex, uint32_t capacity);
+
+  NileDevice &nileDevice;
+  VkDeviceSize instanceSize;
+  VkBufferUsageFlags usage;
+  std::vector<std::unique_ptr<NileBuffer>> buffers;
+};
+
+}  // namespace nile
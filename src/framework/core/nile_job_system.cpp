@@ -0,0 +1,215 @@
+#include "nile_job_system.hpp"
+
+#include "nile_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <string>
+
+namespace nile{
+
+namespace {
+
+// which system and queue the current thread belongs to
+thread_local const NileJobSystem *currentSystem = nullptr;
+thread_local uint32_t currentIndex = 0;
+
+}  // namespace
+
+uint32_t NileJobSystem::defaultWorkerCount() {
+  const uint32_t cores = std::thread::hardware_concurrency();
+  return cores > 1 ? cores - 1 : 0;
+}
+
+NileJobSystem::NileJobSystem(uint32_t workerCount) {
+  currentSystem = this;
+  currentIndex = 0;
+
+  for (uint32_t i = 0; i <= workerCount; i++) {
+    queues.push_back(std::make_unique<WorkQueue>());
+  }
+  workers.reserve(workerCount);
+  for (uint32_t i = 1; i <= workerCount; i++) {
+    workers.emplace_back(&NileJobSystem::workerLoop, this, i);
+  }
+}
+
+NileJobSystem::~NileJobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    stopping = true;
+  }
+  wakeCondition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  if (currentSystem == this) {
+    currentSystem = nullptr;
+  }
+}
+
+void NileJobSystem::submit(std::function<void()> func, NileJobCounter *counter) {
+  if (counter != nullptr) {
+    counter->pending.fetch_add(1, std::memory_order_relaxed);
+  }
+  enqueue(currentQueueIndex(), {std::move(func), counter});
+  wakeWorkers(1);
+}
+
+void NileJobSystem::submitAfter(
+    NileJobCounter &dependency, std::function<void()> func, NileJobCounter *counter) {
+  if (counter != nullptr) {
+    counter->pending.fetch_add(1, std::memory_order_relaxed);
+  }
+  {
+    std::lock_guard<std::mutex> lock(dependency.mutex);
+    if (!dependency.done()) {
+      dependency.continuations.push_back({std::move(func), counter});
+      return;
+    }
+  }
+  enqueue(currentQueueIndex(), {std::move(func), counter});
+  wakeWorkers(1);
+}
+
+void NileJobSystem::wait(NileJobCounter &counter) {
+  const uint32_t index = currentQueueIndex();
+  while (!counter.done()) {
+    if (!tryRunJob(index)) {
+      std::this_thread::yield();
+    }
+  }
+  // the job that finished the counter may still be releasing its continuations
+  std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+bool NileJobSystem::runPendingJob() { return tryRunJob(currentQueueIndex()); }
+
+void NileJobSystem::parallelFor(
+    uint32_t count,
+    uint32_t grainSize,
+    const std::function<void(uint32_t begin, uint32_t end)> &func) {
+  if (count == 0) return;
+  grainSize = std::max(grainSize, 1u);
+  if (workers.empty() || count <= grainSize) {
+    func(0, count);
+    return;
+  }
+
+  // a few chunks per thread so stealing can even out uneven work
+  const uint32_t chunkCount =
+      std::min((count + grainSize - 1) / grainSize, getThreadCount() * 4);
+  const uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+  NileJobCounter counter;
+  const uint32_t index = currentQueueIndex();
+  uint32_t submitted = 0;
+  for (uint32_t begin = chunkSize; begin < count; begin += chunkSize) {
+    const uint32_t end = std::min(begin + chunkSize, count);
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    enqueue(index, {[&func, begin, end]() { func(begin, end); }, &counter});
+    submitted++;
+  }
+  wakeWorkers(submitted);
+
+  func(0, std::min(chunkSize, count));
+  wait(counter);
+}
+
+void NileJobSystem::workerLoop(uint32_t index) {
+  currentSystem = this;
+  currentIndex = index;
+  NILE_PROFILE_THREAD("worker " + std::to_string(index));
+
+  while (true) {
+    if (tryRunJob(index)) continue;
+
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wakeCondition.wait(lock, [this]() {
+      return stopping || queuedJobs.load(std::memory_order_acquire) > 0;
+    });
+    if (stopping) return;
+  }
+}
+
+uint32_t NileJobSystem::currentQueueIndex() const {
+  // threads the system does not own share the main thread's queue
+  return currentSystem == this ? currentIndex : 0;
+}
+
+void NileJobSystem::enqueue(uint32_t queueIndex, NileJob job) {
+  auto &queue = *queues[queueIndex];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(std::move(job));
+  }
+  queuedJobs.fetch_add(1, std::memory_order_release);
+}
+
+void NileJobSystem::wakeWorkers(uint32_t count) {
+  if (workers.empty() || count == 0) return;
+
+  // taking the lock orders the queuedJobs increment with a worker about to sleep
+  { std::lock_guard<std::mutex> lock(wakeMutex); }
+  if (count == 1) {
+    wakeCondition.notify_one();
+  } else {
+    wakeCondition.notify_all();
+  }
+}
+
+bool NileJobSystem::tryRunJob(uint32_t queueIndex) {
+  if (queuedJobs.load(std::memory_order_acquire) == 0) return false;
+
+  NileJob job;
+  bool found = false;
+  {
+    // own jobs are taken newest first, they are the most likely to still be in cache
+    auto &own = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      found = true;
+    }
+  }
+  for (size_t i = 1; !found && i < queues.size(); i++) {
+    auto &victim = *queues[(queueIndex + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      found = true;
+    }
+  }
+  if (!found) return false;
+
+  queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+  execute(job);
+  return true;
+}
+
+void NileJobSystem::execute(NileJob &job) {
+  job.func();
+  if (job.counter != nullptr) {
+    finish(*job.counter);
+  }
+}
+
+void NileJobSystem::finish(NileJobCounter &counter) {
+  std::vector<NileJob> released;
+  {
+    std::lock_guard<std::mutex> lock(counter.mutex);
+    if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      released.swap(counter.continuations);
+    }
+  }
+
+  const uint32_t index = currentQueueIndex();
+  for (auto &job : released) {
+    enqueue(index, std::move(job));
+  }
+  wakeWorkers(static_cast<uint32_t>(released.size()));
+}
+
+}  // namespace nile
@@ -0,0 +1,107 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nile{
+
+class NileJobCounter;
+
+struct NileJob {
+  std::function<void()> func;
+  NileJobCounter *counter = nullptr;
+};
+
+// Number of submitted jobs that have not finished yet. Jobs can be submitted to run once a
+// counter reaches zero, which is how dependencies between jobs are expressed.
+class NileJobCounter {
+ public:
+  NileJobCounter() = default;
+  NileJobCounter(const NileJobCounter &) = delete;
+  NileJobCounter &operator=(const NileJobCounter &) = delete;
+
+  bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+  uint32_t value() const { return pending.load(std::memory_order_acquire); }
+
+ private:
+  friend class NileJobSystem;
+
+  std::atomic<uint32_t> pending{0};
+  // guards the decrement to zero as well, so a finished counter is never touched again
+  std::mutex mutex;
+  std::vector<NileJob> continuations;
+};
+
+// Fixed pool of worker threads, one per core besides the thread that created the system.
+// Each thread owns a deque: it pushes and pops its own jobs at the back and idle threads steal
+// from the front of the others. The creating thread takes part whenever it waits on a counter.
+class NileJobSystem {
+ public:
+  static uint32_t defaultWorkerCount();
+
+  explicit NileJobSystem(uint32_t workerCount = defaultWorkerCount());
+  ~NileJobSystem();
+
+  NileJobSystem(const NileJobSystem &) = delete;
+  NileJobSystem &operator=(const NileJobSystem &) = delete;
+
+  // workers plus the main thread
+  uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+  // Index of the calling thread below getThreadCount(), 0 for the main thread and for threads
+  // the system does not own
+  uint32_t getThreadIndex() const { return currentQueueIndex(); }
+
+  void submit(std::function<void()> func, NileJobCounter *counter = nullptr);
+
+  // Queues func once dependency reaches zero. counter is incremented right away, so waiting on
+  // it also covers jobs that have not been released yet.
+  void submitAfter(
+      NileJobCounter &dependency, std::function<void()> func, NileJobCounter *counter = nullptr);
+
+  // Runs queued jobs on the calling thread until counter reaches zero
+  void wait(NileJobCounter &counter);
+
+  // Runs one queued job on the calling thread, false when there was nothing to run
+  bool runPendingJob();
+
+  // Calls func(begin, end) over [0, count) in chunks of at least grainSize and returns once all
+  // chunks are done. Small ranges and systems without workers run inline.
+  void parallelFor(
+      uint32_t count,
+      uint32_t grainSize,
+      const std::function<void(uint32_t begin, uint32_t end)> &func);
+
+ private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<NileJob> jobs;
+  };
+
+  void workerLoop(uint32_t index);
+  uint32_t currentQueueIndex() const;
+  void enqueue(uint32_t queueIndex, NileJob job);
+  void wakeWorkers(uint32_t count);
+  bool tryRunJob(uint32_t queueIndex);
+  void execute(NileJob &job);
+  void finish(NileJobCounter &counter);
+
+  // queue 0 belongs to the thread that created the system
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> workers;
+
+  std::atomic<uint32_t> queuedJobs{0};
+  std::mutex wakeMutex;
+  std::condition_variable wakeCondition;
+  bool stopping = false;
+};
+
+}  // namespace nile
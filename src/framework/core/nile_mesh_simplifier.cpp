@@ -0,0 +1,370 @@
+#include "nile_mesh_simplifier.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace nile{
+
+void NileMeshSimplifier::Quadric::addPlane(const glm::dvec4 &plane) {
+  const double a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+  m[0] += a * a;
+  m[1] += a * b;
+  m[2] += a * c;
+  m[3] += a * d;
+  m[4] += b * b;
+  m[5] += b * c;
+  m[6] += b * d;
+  m[7] += c * c;
+  m[8] += c * d;
+  m[9] += d * d;
+}
+
+NileMeshSimplifier::Quadric &NileMeshSimplifier::Quadric::operator+=(const Quadric &other) {
+  for (int i = 0; i < 10; i++) m[i] += other.m[i];
+  return *this;
+}
+
+double NileMeshSimplifier::Quadric::evaluate(const glm::vec3 &position) const {
+  // v^T Q v with v = (x, y, z, 1)
+  const double x = position.x, y = position.y, z = position.z;
+  return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x + m[4] * y * y +
+         2 * m[5] * y * z + 2 * m[6] * y + m[7] * z * z + 2 * m[8] * z + m[9];
+}
+
+NileMeshSimplifier::NileMeshSimplifier(
+    const std::vector<glm::vec3> &positions,
+    const std::vector<uint32_t> &indices,
+    const std::vector<glm::vec2> &uvs,
+    const std::vector<glm::vec3> &normals)
+    : positions{positions}, uvs{uvs}, normals{normals}, indices{indices} {
+  assert(indices.size() % 3 == 0 && "Meshes are simplified as triangle lists");
+  assert((uvs.empty() || uvs.size() == positions.size()) && "One uv per position");
+  assert((normals.empty() || normals.size() == positions.size()) && "One normal per position");
+  const size_t triangleCount = indices.size() / 3;
+  isTriangleAlive.assign(triangleCount, false);
+
+  quadrics.resize(positions.size());
+  vertexTriangles.resize(positions.size());
+  isBorder.assign(positions.size(), false);
+  versions.assign(positions.size(), 0);
+  weldPositions();
+
+  // unit planes, so a quadric measures squared distances whatever the triangle size
+  for (uint32_t t = 0; t < triangleCount; t++) {
+    const uint32_t a = corner(t, 0);
+    const uint32_t b = corner(t, 1);
+    const uint32_t c = corner(t, 2);
+    // two corners at one position, nothing to draw at any level
+    if (a == b || b == c || c == a) continue;
+    isTriangleAlive[t] = true;
+    aliveTriangles++;
+
+    const glm::dvec3 normal = glm::cross(
+        glm::dvec3{positions[b] - positions[a]}, glm::dvec3{positions[c] - positions[a]});
+    const double length = glm::length(normal);
+    if (length > 0.0) {
+      const glm::dvec3 unit = normal / length;
+      Quadric plane{};
+      plane.addPlane({unit, -glm::dot(unit, glm::dvec3{positions[a]})});
+      for (int i = 0; i < 3; i++) quadrics[corner(t, i)] += plane;
+    }
+    for (int i = 0; i < 3; i++) vertexTriangles[corner(t, i)].push_back(t);
+  }
+
+  addBorderAndSeamPlanes();
+
+  for (uint32_t t = 0; t < triangleCount; t++) {
+    if (!isTriangleAlive[t]) continue;
+    for (int i = 0; i < 3; i++) {
+      const uint32_t a = corner(t, i);
+      const uint32_t b = corner(t, (i + 1) % 3);
+      pushCollapse(a, b);
+      pushCollapse(b, a);
+    }
+  }
+}
+
+void NileMeshSimplifier::weldPositions() {
+  // vertices that share a position end up next to each other once sorted by it
+  std::vector<uint32_t> order(positions.size());
+  std::iota(order.begin(), order.end(), 0);
+  auto lessThan = [&](uint32_t a, uint32_t b) {
+    const glm::vec3 &pa = positions[a];
+    const glm::vec3 &pb = positions[b];
+    if (pa.x != pb.x) return pa.x < pb.x;
+    if (pa.y != pb.y) return pa.y < pb.y;
+    return pa.z < pb.z;
+  };
+  std::sort(order.begin(), order.end(), lessThan);
+
+  welded.resize(positions.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    const bool isShared = i > 0 && positions[order[i]] == positions[order[i - 1]];
+    welded[order[i]] = isShared ? welded[order[i - 1]] : order[i];
+  }
+}
+
+void NileMeshSimplifier::addBorderAndSeamPlanes() {
+  struct EdgeUse {
+    uint32_t triangle;
+    uint32_t uses;
+    bool isSeam;
+  };
+  auto edgeKey = [](uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+  };
+  auto vertexAt = [&](uint32_t triangle, uint32_t weldedVertex) {
+    for (int i = 0; i < 3; i++) {
+      if (corner(triangle, i) == weldedVertex) return indices[triangle * 3 + i];
+    }
+    return weldedVertex;
+  };
+
+  std::unordered_map<uint64_t, EdgeUse> edges{};
+  edges.reserve(indices.size());
+  for (uint32_t t = 0; t < isTriangleAlive.size(); t++) {
+    if (!isTriangleAlive[t]) continue;
+    for (int i = 0; i < 3; i++) {
+      const uint32_t a = corner(t, i);
+      const uint32_t b = corner(t, (i + 1) % 3);
+      auto [edge, isFirst] = edges.try_emplace(edgeKey(a, b), EdgeUse{t, 0, false});
+      edge->second.uses++;
+      if (isFirst) continue;
+      // the triangles on either side of a uv seam use different vertices at its ends
+      const uint32_t other = edge->second.triangle;
+      edge->second.isSeam |= !sameUv(indices[t * 3 + i], vertexAt(other, a)) ||
+                             !sameUv(indices[t * 3 + (i + 1) % 3], vertexAt(other, b));
+    }
+  }
+
+  // a plane through the edge, upright on its triangle, keeps the edge's ends on its line
+  for (const auto &[key, edge] : edges) {
+    const bool isBorderEdge = edge.uses == 1;
+    if (!isBorderEdge && !edge.isSeam) continue;
+    const uint32_t a = static_cast<uint32_t>(key >> 32);
+    const uint32_t b = static_cast<uint32_t>(key);
+    if (isBorderEdge) {
+      isBorder[a] = true;
+      isBorder[b] = true;
+    }
+
+    const uint32_t t = edge.triangle;
+    const glm::dvec3 p0{positions[corner(t, 0)]};
+    const glm::dvec3 faceNormal = glm::cross(
+        glm::dvec3{positions[corner(t, 1)]} - p0, glm::dvec3{positions[corner(t, 2)]} - p0);
+    const glm::dvec3 normal =
+        glm::cross(glm::dvec3{positions[b]} - glm::dvec3{positions[a]}, faceNormal);
+    const double length = glm::length(normal);
+    if (length == 0.0) continue;
+    const glm::dvec3 unit = normal / length;
+    Quadric plane{};
+    plane.addPlane({unit, -glm::dot(unit, glm::dvec3{positions[a]})});
+    quadrics[a] += plane;
+    quadrics[b] += plane;
+  }
+}
+
+void NileMeshSimplifier::pushCollapse(uint32_t from, uint32_t to) {
+  Quadric quadric = quadrics[from];
+  quadric += quadrics[to];
+  const double cost = std::max(quadric.evaluate(positions[to]), 0.0);
+  queue.push({cost, from, to, versions[from], versions[to]});
+}
+
+bool NileMeshSimplifier::hasVertex(uint32_t triangle, uint32_t vertex) const {
+  return corner(triangle, 0) == vertex || corner(triangle, 1) == vertex ||
+         corner(triangle, 2) == vertex;
+}
+
+bool NileMeshSimplifier::isValid(const Collapse &collapse, WedgeMap &wedges) const {
+  uint32_t edgeTriangles = 0;
+  for (uint32_t t : vertexTriangles[collapse.from]) {
+    if (!isTriangleAlive[t] || !hasVertex(t, collapse.from)) continue;
+    if (hasVertex(t, collapse.to)) {
+      edgeTriangles++;
+      continue;
+    }
+
+    // the triangles that stay must not fold over
+    glm::vec3 before[3];
+    glm::vec3 after[3];
+    for (int i = 0; i < 3; i++) {
+      const uint32_t vertex = corner(t, i);
+      before[i] = positions[vertex];
+      after[i] = vertex == collapse.from ? positions[collapse.to] : positions[vertex];
+    }
+    const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+    const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+    if (glm::dot(normalBefore, normalAfter) <= 0.f) return false;
+
+    // nor land on one the kept vertex already has, closing a tetrahedron into a flat pair
+    const uint32_t first = corner(t, 0) == collapse.from ? corner(t, 1) : corner(t, 0);
+    const uint32_t second = corner(t, 2) == collapse.from ? corner(t, 1) : corner(t, 2);
+    for (uint32_t other : vertexTriangles[collapse.to]) {
+      if (isTriangleAlive[other] && hasVertex(other, collapse.to) && hasVertex(other, first) &&
+          hasVertex(other, second)) {
+        return false;
+      }
+    }
+  }
+  if (edgeTriangles == 0) return false;
+  // a border vertex moving inwards would pull the border with it
+  if (isBorder[collapse.from] && edgeTriangles != 1) return false;
+  return isLinkValid(collapse, edgeTriangles) && mapWedges(collapse, wedges);
+}
+
+bool NileMeshSimplifier::isLinkValid(const Collapse &collapse, uint32_t edgeTriangles) const {
+  // The link condition: the only vertices next to both ends are the ones opposite the edge,
+  // otherwise the collapse pinches the surface into an edge or vertex more than two sides share
+  auto neighbors = [&](uint32_t vertex) {
+    std::vector<uint32_t> result{};
+    for (uint32_t t : vertexTriangles[vertex]) {
+      if (!isTriangleAlive[t] || !hasVertex(t, vertex)) continue;
+      for (int i = 0; i < 3; i++) {
+        if (corner(t, i) != vertex) result.push_back(corner(t, i));
+      }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  };
+  const std::vector<uint32_t> fromNeighbors = neighbors(collapse.from);
+  const std::vector<uint32_t> toNeighbors = neighbors(collapse.to);
+
+  uint32_t shared = 0;
+  auto to = toNeighbors.begin();
+  for (uint32_t vertex : fromNeighbors) {
+    to = std::lower_bound(to, toNeighbors.end(), vertex);
+    if (to != toNeighbors.end() && *to == vertex) shared++;
+  }
+  return shared == edgeTriangles;
+}
+
+bool NileMeshSimplifier::mapWedges(const Collapse &collapse, WedgeMap &wedges) const {
+  auto vertexAt = [&](uint32_t triangle, uint32_t weldedVertex) {
+    for (int i = 0; i < 3; i++) {
+      if (corner(triangle, i) == weldedVertex) return indices[triangle * 3 + i];
+    }
+    return weldedVertex;
+  };
+  auto find = [&](uint32_t vertex) {
+    return std::find_if(
+        wedges.begin(), wedges.end(), [&](const auto &wedge) { return wedge.first == vertex; });
+  };
+
+  // each triangle along the edge pairs up the vertices on its side of any seam
+  wedges.clear();
+  for (uint32_t t : vertexTriangles[collapse.from]) {
+    if (!isTriangleAlive[t] || !hasVertex(t, collapse.from) || !hasVertex(t, collapse.to)) {
+      continue;
+    }
+    const uint32_t from = vertexAt(t, collapse.from);
+    const uint32_t to = vertexAt(t, collapse.to);
+    auto wedge = find(from);
+    if (wedge == wedges.end()) {
+      wedges.push_back({from, to});
+    } else if (wedge->second != to) {
+      return false;
+    }
+  }
+
+  // The other vertices at the removed position are split from a paired one by a hard normal and
+  // follow the pair of the closest normal. One across a uv seam that doesn't run along the edge
+  // has no vertex at the kept position that would keep its texture in place.
+  const size_t pairedCount = wedges.size();
+  for (uint32_t t : vertexTriangles[collapse.from]) {
+    if (!isTriangleAlive[t] || !hasVertex(t, collapse.from)) continue;
+    const uint32_t from = vertexAt(t, collapse.from);
+    if (find(from) != wedges.end()) continue;
+
+    const std::pair<uint32_t, uint32_t> *closest = nullptr;
+    float closestDistance = 0.f;
+    for (size_t i = 0; i < pairedCount; i++) {
+      if (!sameUv(from, wedges[i].first)) continue;
+      float distance = 0.f;
+      if (!normals.empty()) {
+        const glm::vec3 difference = normals[from] - normals[wedges[i].first];
+        distance = glm::dot(difference, difference);
+      }
+      if (closest == nullptr || distance < closestDistance) {
+        closest = &wedges[i];
+        closestDistance = distance;
+      }
+    }
+    if (closest == nullptr) return false;
+    wedges.push_back({from, closest->second});
+  }
+  return true;
+}
+
+void NileMeshSimplifier::apply(const Collapse &collapse, const WedgeMap &wedges) {
+  const uint32_t from = collapse.from;
+  const uint32_t to = collapse.to;
+  for (uint32_t t : vertexTriangles[from]) {
+    if (!isTriangleAlive[t] || !hasVertex(t, from)) continue;
+    if (hasVertex(t, to)) {
+      isTriangleAlive[t] = false;
+      aliveTriangles--;
+      continue;
+    }
+    for (int i = 0; i < 3; i++) {
+      uint32_t &vertex = indices[t * 3 + i];
+      if (welded[vertex] != from) continue;
+      for (const auto &[removed, kept] : wedges) {
+        if (removed == vertex) {
+          vertex = kept;
+          break;
+        }
+      }
+    }
+    vertexTriangles[to].push_back(t);
+  }
+  vertexTriangles[from].clear();
+  auto &kept = vertexTriangles[to];
+  kept.erase(
+      std::remove_if(kept.begin(), kept.end(), [&](uint32_t t) { return !isTriangleAlive[t]; }),
+      kept.end());
+  quadrics[to] += quadrics[from];
+  versions[from]++;
+  versions[to]++;
+  error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+
+  // every edge around the kept vertex changed its cost
+  for (uint32_t t : vertexTriangles[to]) {
+    if (!isTriangleAlive[t]) continue;
+    for (int i = 0; i < 3; i++) {
+      const uint32_t neighbor = corner(t, i);
+      if (neighbor == to) continue;
+      pushCollapse(neighbor, to);
+      pushCollapse(to, neighbor);
+    }
+  }
+}
+
+std::vector<uint32_t> NileMeshSimplifier::simplify(size_t targetIndexCount) {
+  WedgeMap wedges{};
+  while (aliveTriangles * 3 > targetIndexCount && !queue.empty()) {
+    const Collapse collapse = queue.top();
+    queue.pop();
+    if (collapse.fromVersion != versions[collapse.from] ||
+        collapse.toVersion != versions[collapse.to]) {
+      continue;
+    }
+    if (!isValid(collapse, wedges)) continue;
+    apply(collapse, wedges);
+  }
+
+  std::vector<uint32_t> result{};
+  result.reserve(aliveTriangles * 3);
+  for (size_t t = 0; t < isTriangleAlive.size(); t++) {
+    if (!isTriangleAlive[t]) continue;
+    result.insert(result.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+  }
+  return result;
+}
+
+}  // namespace nile
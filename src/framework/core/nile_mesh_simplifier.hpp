@@ -0,0 +1,100 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace nile{
+
+// Quadric error metric edge collapse (Garland and Heckbert). Every position accumulates the
+// planes of the triangles around it, and the edge whose collapse moves the surface the least by
+// that measure goes first. Collapses move a vertex onto the other end of its edge rather than to
+// a new position, so every level of detail indexes the original vertices.
+//
+// Vertices that share a position, split by a hard normal or a uv seam, are welded into one for
+// the topology and collapse together: each of them is replaced by the vertex at the kept position
+// on the same side of the seam. Open borders and uv seams only collapse along themselves and add
+// planes through their edges to the quadrics, so they keep their shape and meshes don't tear.
+// Collapses that would fold a triangle over or make the surface non-manifold are skipped.
+class NileMeshSimplifier {
+ public:
+  // uvs and normals are optional, one per position, and decide which vertices lie on a seam
+  NileMeshSimplifier(
+      const std::vector<glm::vec3> &positions,
+      const std::vector<uint32_t> &indices,
+      const std::vector<glm::vec2> &uvs = {},
+      const std::vector<glm::vec3> &normals = {});
+
+  NileMeshSimplifier(const NileMeshSimplifier &) = delete;
+  NileMeshSimplifier &operator=(const NileMeshSimplifier &) = delete;
+
+  // Carries on collapsing from where the last call stopped until at most targetIndexCount
+  // indices are left, or nothing more can collapse. Returns the remaining triangles.
+  std::vector<uint32_t> simplify(size_t targetIndexCount);
+
+  // Largest distance estimate of the collapses so far, in the units of the positions
+  float getError() const { return error; }
+
+ private:
+  // Symmetric 4x4 matrix, the upper triangle row by row
+  struct Quadric {
+    double m[10]{};
+
+    void addPlane(const glm::dvec4 &plane);
+    Quadric &operator+=(const Quadric &other);
+    double evaluate(const glm::vec3 &position) const;
+  };
+
+  // from and to are welded vertices, the first vertex at each position
+  struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+  };
+
+  // which vertex at the kept position replaces each vertex at the removed one
+  using WedgeMap = std::vector<std::pair<uint32_t, uint32_t>>;
+
+  void weldPositions();
+  void addBorderAndSeamPlanes();
+  void pushCollapse(uint32_t from, uint32_t to);
+  bool isValid(const Collapse &collapse, WedgeMap &wedges) const;
+  bool mapWedges(const Collapse &collapse, WedgeMap &wedges) const;
+  bool isLinkValid(const Collapse &collapse, uint32_t edgeTriangles) const;
+  void apply(const Collapse &collapse, const WedgeMap &wedges);
+  uint32_t corner(uint32_t triangle, int i) const { return welded[indices[triangle * 3 + i]]; }
+  bool hasVertex(uint32_t triangle, uint32_t vertex) const;
+  bool sameUv(uint32_t a, uint32_t b) const { return uvs.empty() || uvs[a] == uvs[b]; }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> uvs;
+  std::vector<glm::vec3> normals;
+  std::vector<uint32_t> indices;
+  // the first vertex sharing each vertex's position, adjacency and quadrics are kept for it
+  std::vector<uint32_t> welded;
+  std::vector<bool> isTriangleAlive;
+  size_t aliveTriangles = 0;
+
+  std::vector<Quadric> quadrics;
+  // triangles around each welded vertex, including ones that have collapsed since
+  std::vector<std::vector<uint32_t>> vertexTriangles;
+  std::vector<bool> isBorder;
+  // bumped when a vertex's quadric changes, queued collapses of older versions are skipped
+  std::vector<uint32_t> versions;
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+  float error = 0.f;
+};
+
+}  // namespace nile
@@ -1,5 +1,6 @@
 #include "nile_model.hpp"
 
+#include "nile_mesh_simplifier.hpp"
 #include "nile_utils.hpp"
 
 // libs
@@ -9,8 +10,10 @@
 #include <glm/gtx/hash.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <iostream>
 #include <unordered_map>
 //#include <type_traits>
 
@@ -34,12 +37,16 @@ namespace nile{
 NileModel::NileModel(NileDevice &device, const NileModel::Builder &builder) : nileDevice{device} {
   createVertexBuffers(builder.vertices);
   createIndexBuffers(builder.indices);
+  setLods(builder);
+  setBounds(builder);
 }
 
 NileModel::NileModel(NileDevice &device, const NileModel::Builder &builder, std::shared_ptr<Material> material) 
 : nileDevice{device}, material{material} {
   createVertexBuffers(builder.vertices);
   createIndexBuffers(builder.indices);
+  setLods(builder);
+  setBounds(builder);
   if(material != nullptr) {
     material->create();
   }
@@ -49,6 +56,8 @@ NileModel::NileModel(NileDevice &device, const NileModel::Builder &builder, std:
 : nileDevice{device}, texturePack{texturePack} {
   createVertexBuffers(builder.vertices);
   createIndexBuffers(builder.indices);
+  setLods(builder);
+  setBounds(builder);
   if(texturePack != nullptr) {
     texturePack->create();
   }
@@ -57,9 +66,16 @@ NileModel::NileModel(NileDevice &device, const NileModel::Builder &builder, std:
 NileModel::~NileModel() {}
 
 std::unique_ptr<NileModel> NileModel::createModelFromFile(
-    NileDevice &device, const std::string &filepath) {
+    NileDevice &device, const std::string &filepath, uint32_t maxLodCount) {
   Builder builder{};
   builder.loadModel(ENGINE_DIR + filepath);
+  if (maxLodCount > 1) {
+    const uint32_t lodCount = builder.generateLods(maxLodCount);
+    if (lodCount < maxLodCount) {
+      std::cout << filepath << ": simplified into " << lodCount << " of " << maxLodCount
+                << " levels of detail" << std::endl;
+    }
+  }
   return std::make_unique<NileModel>(device, builder);
 }
 
@@ -154,12 +170,110 @@ void NileModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
     nileDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
 }
 
-void NileModel::draw(VkCommandBuffer commandBuffer) {
+void NileModel::draw(
+    VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod) {
+  if (hasIndexBuffer) {
+    const Lod &level = lods[lod];
+    vkCmdDrawIndexed(
+        commandBuffer, level.indexCount, instanceCount, level.firstIndex, 0, firstInstance);
+  } else {
+    vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
+  }
+}
+
+void NileModel::drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) {
   if (hasIndexBuffer) {
-    vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+    vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, 1, 0);
   } else {
-    vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    vkCmdDrawIndirect(commandBuffer, buffer, offset, 1, 0);
+  }
+}
+
+VkDrawIndexedIndirectCommand NileModel::getIndirectCommand(
+    uint32_t instanceCount, uint32_t lod) const {
+  // zero offsets without indices, so the same words also work as {vertexCount, instanceCount, 0, 0}
+  VkDrawIndexedIndirectCommand command{};
+  command.indexCount = hasIndexBuffer ? lods[lod].indexCount : vertexCount;
+  command.instanceCount = instanceCount;
+  command.firstIndex = hasIndexBuffer ? lods[lod].firstIndex : 0;
+  return command;
+}
+
+uint32_t NileModel::selectLod(float pixelsPerUnit) const {
+  // errors grow with every level
+  for (uint32_t lod = getLodCount() - 1; lod > 0; lod--) {
+    if (lods[lod].error * pixelsPerUnit <= 1.f) return lod;
+  }
+  return 0;
+}
+
+void NileModel::setLods(const Builder &builder) {
+  lods = builder.lods;
+  if (lods.empty()) lods.push_back({0, indexCount, 0.f});
+  for (const auto &lod : lods) {
+    assert(lod.firstIndex + lod.indexCount <= indexCount && "Level of detail past the indices");
+  }
+}
+
+void NileModel::setBounds(const Builder &builder) {
+  if (builder.boundingBox.isEmpty()) {
+    computeBounds(builder.vertices, boundingBox, boundingSphere);
+    return;
+  }
+  boundingBox = builder.boundingBox;
+  boundingSphere = builder.boundingSphere;
+}
+
+void NileModel::computeBounds(
+    const std::vector<Vertex> &vertices, BoundingBox &box, BoundingSphere &sphere) {
+  box = {};
+  sphere = {};
+  for (const auto &vertex : vertices) {
+    box.expand(vertex.position);
+  }
+  if (box.isEmpty()) return;
+
+  // centered on the box, a little looser than the minimal sphere but cheap to build
+  sphere.center = box.center();
+  for (const auto &vertex : vertices) {
+    sphere.radius = std::max(sphere.radius, glm::length(vertex.position - sphere.center));
+  }
+}
+
+void NileModel::Builder::computeBounds() {
+  NileModel::computeBounds(vertices, boundingBox, boundingSphere);
+}
+
+uint32_t NileModel::Builder::generateLods(uint32_t maxLodCount, float reduction) {
+  assert(lods.empty() && "Levels of detail were already generated");
+  assert(reduction > 0.f && reduction < 1.f && "Every level must have fewer triangles");
+  const uint32_t fullIndexCount = static_cast<uint32_t>(indices.size());
+  lods.push_back({0, fullIndexCount, 0.f});
+
+  std::vector<glm::vec3> positions(vertices.size());
+  std::vector<glm::vec2> uvs(vertices.size());
+  std::vector<glm::vec3> normals(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    positions[i] = vertices[i].position;
+    uvs[i] = vertices[i].uv;
+    normals[i] = vertices[i].normal;
+  }
+  NileMeshSimplifier simplifier{positions, indices, uvs, normals};
+
+  // every level carries on from the one before, so their errors only grow
+  for (uint32_t level = 1; level < maxLodCount; level++) {
+    const uint32_t previousCount = lods.back().indexCount;
+    const auto target = static_cast<size_t>(previousCount * reduction);
+    std::vector<uint32_t> levelIndices = simplifier.simplify(target - target % 3);
+    if (levelIndices.size() > previousCount * 0.9f || levelIndices.empty()) break;
+
+    lods.push_back(
+        {static_cast<uint32_t>(indices.size()),
+         static_cast<uint32_t>(levelIndices.size()),
+         simplifier.getError()});
+    indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
   }
+  return static_cast<uint32_t>(lods.size());
 }
 
 void NileModel::bind(VkCommandBuffer commandBuffer) {
@@ -245,6 +359,7 @@ void NileModel::Builder::loadModel(const std::string &filepath) {
       indices.push_back(uniqueVertices[vertex]);
     }
   }
+  computeBounds();
 }
 
 }  // namespace nile
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "nile_bounds.hpp"
 #include "nile_buffer.hpp"
 #include "nile_device.hpp"
 
@@ -44,11 +45,35 @@ class NileModel {
     }
   };
 
+  // A range of the index buffer drawing the model at a lower detail. error is how far, in model
+  // space units, its surface may lie from the full detail one.
+  struct Lod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.f;
+  };
+
   struct Builder {
     std::vector<Vertex> vertices{};
     std::vector<uint32_t> indices{};
+    // finest first, filled by generateLods. Without any the model has one level, all indices.
+    std::vector<Lod> lods{};
+
+    // model space bounds of vertices, filled by computeBounds
+    BoundingBox boundingBox{};
+    BoundingSphere boundingSphere{};
 
     void loadModel(const std::string &filepath);
+
+    // Call once the vertices are final, loadModel does so itself. Models built from a builder
+    // without bounds compute them on creation.
+    void computeBounds();
+
+    // Simplifies the mesh into up to maxLodCount levels, each with about reduction times the
+    // triangles of the one before, and appends their indices after the full detail ones. Stops
+    // early once a level can't get much smaller. Returns how many levels there are, the full
+    // detail one included.
+    uint32_t generateLods(uint32_t maxLodCount = 4, float reduction = .5f);
   };
 
   NileModel(NileDevice &device, const NileModel::Builder &builder);
@@ -59,11 +84,32 @@ class NileModel {
   NileModel(const NileModel &) = delete;
   NileModel &operator=(const NileModel &) = delete;
 
+  // maxLodCount above 1 generates levels of detail while loading, see Builder::generateLods.
+  // Meshes that can't be simplified that far are reported and keep the levels they got.
   static std::unique_ptr<NileModel> createModelFromFile(
-      NileDevice &device, const std::string &filepath);
+      NileDevice &device, const std::string &filepath, uint32_t maxLodCount = 1);
 
   void bind(VkCommandBuffer commandBuffer);
-  void draw(VkCommandBuffer commandBuffer);
+  void draw(
+      VkCommandBuffer commandBuffer,
+      uint32_t instanceCount = 1,
+      uint32_t firstInstance = 0,
+      uint32_t lod = 0);
+
+  // Indirect draws read a command written by getIndirectCommand from buffer at offset. For
+  // models without indices the first four fields are read as a VkDrawIndirectCommand.
+  void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset);
+  VkDrawIndexedIndirectCommand getIndirectCommand(uint32_t instanceCount, uint32_t lod = 0) const;
+
+  uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+  const Lod &getLod(uint32_t lod) const { return lods[lod]; }
+  // The coarsest level whose error stays within a pixel, given how many pixels a model space
+  // unit covers where the model is drawn
+  uint32_t selectLod(float pixelsPerUnit) const;
+
+  // model space bounds of the vertices
+  const BoundingBox &getBoundingBox() const { return boundingBox; }
+  const BoundingSphere &getBoundingSphere() const { return boundingSphere; }
 
   std::shared_ptr<Material> getMaterial() { return material; }
   std::shared_ptr<MaterialPack> getMaterialPack() { return texturePack; }
@@ -72,6 +118,10 @@ class NileModel {
   void createVertexBuffers(const std::vector<Vertex> &vertices);
   void createVertexBuffers(const std::vector<Vertex2D> &vertices);
   void createIndexBuffers(const std::vector<uint32_t> &indices);
+  void setLods(const Builder &builder);
+  void setBounds(const Builder &builder);
+  static void computeBounds(
+      const std::vector<Vertex> &vertices, BoundingBox &box, BoundingSphere &sphere);
 
     NileDevice &nileDevice;
     std::shared_ptr<Material> material;
@@ -83,6 +133,9 @@ class NileModel {
   bool hasIndexBuffer = false;
   std::unique_ptr<NileBuffer> indexBuffer;
   uint32_t indexCount;
+  std::vector<Lod> lods;
 
+  BoundingBox boundingBox{};
+  BoundingSphere boundingSphere{};
 };
 }  // namespace nile
@@ -1,9 +1,11 @@
 #include "nile_pipeline.hpp"
 
 #include "nile_model.hpp"
+#include "nile_pipeline_registry.hpp"
 
 // std
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -23,12 +25,73 @@ NilePipeline::NilePipeline(
   createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
 }
 
+// PipelineConfigInfo can't be copied as is because its create infos point into itself, the copy
+// a queued creation works from points into the copy instead
+static std::unique_ptr<PipelineConfigInfo> copyConfigInfo(const PipelineConfigInfo& configInfo) {
+  auto copy = std::make_unique<PipelineConfigInfo>();
+  copy->bindingDescriptions = configInfo.bindingDescriptions;
+  copy->attributeDescriptions = configInfo.attributeDescriptions;
+  copy->viewportInfo = configInfo.viewportInfo;
+  copy->inputAssemblyInfo = configInfo.inputAssemblyInfo;
+  copy->rasterizationInfo = configInfo.rasterizationInfo;
+  copy->multisampleInfo = configInfo.multisampleInfo;
+  copy->colorBlendAttachment = configInfo.colorBlendAttachment;
+  copy->colorBlendInfo = configInfo.colorBlendInfo;
+  copy->depthStencilInfo = configInfo.depthStencilInfo;
+  copy->dynamicStateEnables = configInfo.dynamicStateEnables;
+  copy->dynamicStateInfo = configInfo.dynamicStateInfo;
+  copy->pipelineLayout = configInfo.pipelineLayout;
+  copy->renderPass = configInfo.renderPass;
+  copy->subpass = configInfo.subpass;
+
+  if (configInfo.colorBlendInfo.pAttachments == &configInfo.colorBlendAttachment) {
+    copy->colorBlendInfo.pAttachments = &copy->colorBlendAttachment;
+  }
+  if (configInfo.dynamicStateInfo.pDynamicStates == configInfo.dynamicStateEnables.data()) {
+    copy->dynamicStateInfo.pDynamicStates = copy->dynamicStateEnables.data();
+  }
+  return copy;
+}
+
+NilePipeline::NilePipeline(
+    NileDevice& device,
+    const std::string& vertFilepath,
+    const std::string& fragFilepath,
+    const PipelineConfigInfo& configInfo,
+    NileJobSystem& jobSystem)
+    : nileDevice{device}, jobSystem{&jobSystem} {
+  built.store(false, std::memory_order_relaxed);
+  std::shared_ptr<PipelineConfigInfo> config = copyConfigInfo(configInfo);
+  jobSystem.submit(
+      [this, vertFilepath, fragFilepath, config]() {
+        // a throw would end the worker thread, the error is handed to whoever binds instead
+        try {
+          createGraphicsPipeline(vertFilepath, fragFilepath, *config);
+          built.store(true, std::memory_order_release);
+        } catch (...) {
+          buildError = std::current_exception();
+        }
+      },
+      &buildCounter);
+}
+
 NilePipeline::~NilePipeline() {
-  vkDestroyShaderModule(nileDevice.device(), vertShaderModule, nullptr);
-  vkDestroyShaderModule(nileDevice.device(), fragShaderModule, nullptr);
+  if (jobSystem != nullptr) jobSystem->wait(buildCounter);
   vkDestroyPipeline(nileDevice.device(), graphicsPipeline, nullptr);
 }
 
+void NilePipeline::waitUntilBuilt() {
+  if (isBuilt()) return;
+  if (jobSystem != nullptr) jobSystem->wait(buildCounter);
+  if (buildError) std::rethrow_exception(buildError);
+}
+
+void NilePipeline::detachJobSystem() {
+  if (jobSystem == nullptr) return;
+  jobSystem->wait(buildCounter);
+  jobSystem = nullptr;
+}
+
 std::vector<char> NilePipeline::readFile(const std::string& filepath) {
   std::string enginePath = ENGINE_DIR + filepath;
   std::ifstream file{enginePath, std::ios::ate | std::ios::binary};
@@ -58,11 +121,9 @@ void NilePipeline::createGraphicsPipeline(
       configInfo.renderPass != VK_NULL_HANDLE &&
       "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
-  auto vertCode = readFile(vertFilepath);
-  auto fragCode = readFile(fragFilepath);
-
-  createShaderModule(vertCode, &vertShaderModule);
-  createShaderModule(fragCode, &fragShaderModule);
+  // the modules are shared with every pipeline built from the same files
+  VkShaderModule vertShaderModule = nileDevice.getPipelineRegistry().getShaderModule(vertFilepath);
+  VkShaderModule fragShaderModule = nileDevice.getPipelineRegistry().getShaderModule(fragFilepath);
 
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -110,29 +171,23 @@ void NilePipeline::createGraphicsPipeline(
   pipelineInfo.basePipelineIndex = -1;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+  auto& pipelineCache = nileDevice.getPipelineCache();
+  auto start = std::chrono::steady_clock::now();
   if (vkCreateGraphicsPipelines(
           nileDevice.device(),
-          VK_NULL_HANDLE,
+          pipelineCache.getCache(),
           1,
           &pipelineInfo,
           nullptr,
           &graphicsPipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline");
   }
-}
-
-void NilePipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
-  VkShaderModuleCreateInfo createInfo{};
-  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  createInfo.codeSize = code.size();
-  createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-  if (vkCreateShaderModule(nileDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create shader module");
-  }
+  pipelineCache.recordCreation(
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 }
 
 void NilePipeline::bind(VkCommandBuffer commandBuffer) {
+  waitUntilBuilt();
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 }
 
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "nile_device.hpp"
+#include "nile_job_system.hpp"
 
 // std
+#include <atomic>
+#include <exception>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,6 +33,8 @@ struct PipelineConfigInfo {
   uint32_t subpass = 0;
 };
 
+// Usually obtained through NilePipelineRegistry::getPipeline, which shares identical pipelines
+// between systems. Shader modules always come from the device's registry.
 class NilePipeline {
  public:
   NilePipeline(
@@ -36,29 +42,51 @@ class NilePipeline {
       const std::string& vertFilepath,
       const std::string& fragFilepath,
       const PipelineConfigInfo& configInfo);
+  // Queues the creation on jobSystem and returns right away, jobSystem must outlive the pipeline
+  NilePipeline(
+      NileDevice& device,
+      const std::string& vertFilepath,
+      const std::string& fragFilepath,
+      const PipelineConfigInfo& configInfo,
+      NileJobSystem& jobSystem);
   ~NilePipeline();
 
   NilePipeline(const NilePipeline&) = delete;
   NilePipeline& operator=(const NilePipeline&) = delete;
 
+  // Waits for a queued creation the first time, see waitUntilBuilt
   void bind(VkCommandBuffer commandBuffer);
 
+  bool isBuilt() const { return built.load(std::memory_order_acquire); }
+
+  // Returns once the pipeline exists, running other jobs on the calling thread while its creation
+  // is still queued or running. Rethrows the error if the creation failed.
+  void waitUntilBuilt();
+
   static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
   static void enableAlphaBlending(PipelineConfigInfo& configInfo);
 
- private:
+  // Reads a file relative to the engine directory, e.g. compiled shaders
   static std::vector<char> readFile(const std::string& filepath);
 
+ private:
   void createGraphicsPipeline(
       const std::string& vertFilepath,
       const std::string& fragFilepath,
       const PipelineConfigInfo& configInfo);
 
-  void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+  // waits for the queued creation and stops using the job system, see NilePipelineRegistry
+  void detachJobSystem();
 
   NileDevice& nileDevice;
-  VkPipeline graphicsPipeline;
-  VkShaderModule vertShaderModule;
-  VkShaderModule fragShaderModule;
+  VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+
+  // only set for queued creations
+  NileJobSystem* jobSystem = nullptr;
+  NileJobCounter buildCounter;
+  std::atomic<bool> built{true};
+  std::exception_ptr buildError;
+
+  friend class NilePipelineRegistry;
 };
 }  // namespace nile
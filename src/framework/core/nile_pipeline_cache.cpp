@@ -0,0 +1,124 @@
+#include "nile_pipeline_cache.hpp"
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace nile{
+
+// VK_PIPELINE_CACHE_HEADER_VERSION_ONE: header size, header version, vendor id, device id and
+// the pipeline cache uuid, all tightly packed
+static constexpr size_t CACHE_HEADER_SIZE = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+
+NilePipelineCache::NilePipelineCache(
+    VkDevice device, const VkPhysicalDeviceProperties &properties, std::string filepath)
+    : device{device}, filepath{std::move(filepath)} {
+  std::vector<char> data = readCacheFile(this->filepath);
+  if (!data.empty() && !isCompatible(data, properties)) {
+    std::cout << "Pipeline cache: " << this->filepath << " is from another device or driver"
+              << std::endl;
+    data.clear();
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = data.size();
+  cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+  if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+  stats.isWarm = !data.empty();
+  stats.bytesLoaded = data.size();
+}
+
+NilePipelineCache::~NilePipelineCache() { vkDestroyPipelineCache(device, cache, nullptr); }
+
+void NilePipelineCache::save() {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) {
+    std::cerr << "Pipeline cache: failed to get the cache size" << std::endl;
+    return;
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+    std::cerr << "Pipeline cache: failed to get the cache data" << std::endl;
+    return;
+  }
+  data.resize(size);
+
+  // written next to the old file first, so a crash while saving never leaves half a cache
+  const std::string tempPath = filepath + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      std::cerr << "Pipeline cache: failed to open " << tempPath << " for writing" << std::endl;
+      return;
+    }
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file.good()) {
+      std::cerr << "Pipeline cache: failed to write " << tempPath << std::endl;
+      std::remove(tempPath.c_str());
+      return;
+    }
+  }
+  // replaces the old file in one step, also on Windows where std::rename won't overwrite
+  std::error_code error;
+  std::filesystem::rename(tempPath, filepath, error);
+  if (error) {
+    std::cerr << "Pipeline cache: failed to replace " << filepath << ": " << error.message()
+              << std::endl;
+    std::remove(tempPath.c_str());
+    return;
+  }
+
+  const Stats current = getStats();
+  std::cout << "Pipeline cache: " << (current.isWarm ? "warm" : "cold") << " start, "
+            << current.pipelinesCreated << " pipelines created in " << current.creationMs
+            << " ms, saved " << data.size() << " bytes to " << filepath << std::endl;
+}
+
+void NilePipelineCache::recordCreation(double ms) {
+  std::lock_guard<std::mutex> lock{statsMutex};
+  stats.pipelinesCreated++;
+  stats.creationMs += ms;
+}
+
+NilePipelineCache::Stats NilePipelineCache::getStats() const {
+  std::lock_guard<std::mutex> lock{statsMutex};
+  return stats;
+}
+
+bool NilePipelineCache::isCompatible(
+    const std::vector<char> &data, const VkPhysicalDeviceProperties &properties) {
+  if (data.size() < CACHE_HEADER_SIZE) return false;
+
+  uint32_t header[4];
+  std::memcpy(header, data.data(), sizeof(header));
+  const uint32_t headerSize = header[0];
+  const uint32_t headerVersion = header[1];
+  if (headerSize < CACHE_HEADER_SIZE || headerSize > data.size()) return false;
+  if (headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return false;
+  if (header[2] != properties.vendorID || header[3] != properties.deviceID) return false;
+  return std::memcmp(
+             data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+std::vector<char> NilePipelineCache::readCacheFile(const std::string &filepath) {
+  // a missing file is the normal first run
+  std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+  if (!file.is_open()) return {};
+
+  std::vector<char> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(data.data(), static_cast<std::streamsize>(data.size()));
+  if (!file) return {};
+  return data;
+}
+
+}  // namespace nile
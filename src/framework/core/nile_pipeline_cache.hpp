@@ -0,0 +1,61 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nile{
+
+// The device's VkPipelineCache, shared by every pipeline creation. It starts from the file a
+// previous run saved when that file was written by the same driver on the same device, and from
+// empty otherwise (a cold start). save() writes it back, NileDevice does so on shutdown.
+class NilePipelineCache {
+ public:
+  // Pipeline creation since startup, to compare cold and warm starts
+  struct Stats {
+    bool isWarm = false;
+    size_t bytesLoaded = 0;
+    uint32_t pipelinesCreated = 0;
+    double creationMs = 0.0;
+  };
+
+  NilePipelineCache(
+      VkDevice device, const VkPhysicalDeviceProperties &properties, std::string filepath);
+  ~NilePipelineCache();
+
+  NilePipelineCache(const NilePipelineCache &) = delete;
+  NilePipelineCache &operator=(const NilePipelineCache &) = delete;
+
+  VkPipelineCache getCache() const { return cache; }
+
+  // Replaces the file with the cache's current contents and prints the startup stats. Failures
+  // are reported and leave the old file, it runs from NileDevice's destructor so never throws.
+  void save();
+
+  // Called by the pipeline classes with the time a vkCreate*Pipelines call took, from any thread
+  void recordCreation(double ms);
+  Stats getStats() const;
+
+  // Whether data starts with a VK_PIPELINE_CACHE_HEADER_VERSION_ONE header for this device and
+  // driver. Drivers are supposed to reject foreign data themselves, not all of them do.
+  static bool isCompatible(
+      const std::vector<char> &data, const VkPhysicalDeviceProperties &properties);
+
+ private:
+  static std::vector<char> readCacheFile(const std::string &filepath);
+
+  VkDevice device;
+  std::string filepath;
+  VkPipelineCache cache = VK_NULL_HANDLE;
+
+  mutable std::mutex statsMutex;
+  Stats stats{};
+};
+
+}  // namespace nile
@@ -0,0 +1,295 @@
+#include "nile_pipeline_registry.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace nile{
+
+namespace {
+
+// Keys are the raw bytes of the fields that go into a create info, pointers left out. Comparing
+// whole keys rather than only their hashes means two different configs can never collide.
+class KeyWriter {
+ public:
+  template <typename T>
+  KeyWriter &add(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "Keys are built from plain values");
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    return *this;
+  }
+
+  KeyWriter &add(const std::string &value) {
+    add(value.size());
+    key.append(value);
+    return *this;
+  }
+
+  KeyWriter &add(const VkStencilOpState &state) {
+    return add(state.failOp)
+        .add(state.passOp)
+        .add(state.depthFailOp)
+        .add(state.compareOp)
+        .add(state.compareMask)
+        .add(state.writeMask)
+        .add(state.reference);
+  }
+
+  const std::string &peek() const { return key; }
+  std::string take() { return std::move(key); }
+
+ private:
+  std::string key;
+};
+
+}  // namespace
+
+static std::string pipelineKey(
+    const std::string &vertFilepath,
+    const std::string &fragFilepath,
+    const PipelineConfigInfo &configInfo) {
+  KeyWriter key{};
+  key.add(vertFilepath).add(fragFilepath);
+
+  key.add(configInfo.bindingDescriptions.size());
+  for (const auto &binding : configInfo.bindingDescriptions) {
+    key.add(binding.binding).add(binding.stride).add(binding.inputRate);
+  }
+  key.add(configInfo.attributeDescriptions.size());
+  for (const auto &attribute : configInfo.attributeDescriptions) {
+    key.add(attribute.location).add(attribute.binding).add(attribute.format).add(attribute.offset);
+  }
+
+  const auto &inputAssembly = configInfo.inputAssemblyInfo;
+  key.add(inputAssembly.topology).add(inputAssembly.primitiveRestartEnable);
+
+  const auto &viewport = configInfo.viewportInfo;
+  key.add(viewport.viewportCount).add(viewport.scissorCount);
+
+  const auto &rasterization = configInfo.rasterizationInfo;
+  key.add(rasterization.depthClampEnable)
+      .add(rasterization.rasterizerDiscardEnable)
+      .add(rasterization.polygonMode)
+      .add(rasterization.cullMode)
+      .add(rasterization.frontFace)
+      .add(rasterization.depthBiasEnable)
+      .add(rasterization.depthBiasConstantFactor)
+      .add(rasterization.depthBiasClamp)
+      .add(rasterization.depthBiasSlopeFactor)
+      .add(rasterization.lineWidth);
+
+  const auto &multisample = configInfo.multisampleInfo;
+  key.add(multisample.rasterizationSamples)
+      .add(multisample.sampleShadingEnable)
+      .add(multisample.minSampleShading)
+      .add(multisample.alphaToCoverageEnable)
+      .add(multisample.alphaToOneEnable);
+
+  const auto &blendAttachment = configInfo.colorBlendAttachment;
+  key.add(blendAttachment.blendEnable)
+      .add(blendAttachment.srcColorBlendFactor)
+      .add(blendAttachment.dstColorBlendFactor)
+      .add(blendAttachment.colorBlendOp)
+      .add(blendAttachment.srcAlphaBlendFactor)
+      .add(blendAttachment.dstAlphaBlendFactor)
+      .add(blendAttachment.alphaBlendOp)
+      .add(blendAttachment.colorWriteMask);
+
+  const auto &colorBlend = configInfo.colorBlendInfo;
+  key.add(colorBlend.logicOpEnable)
+      .add(colorBlend.logicOp)
+      .add(colorBlend.attachmentCount)
+      .add(colorBlend.blendConstants);
+
+  const auto &depthStencil = configInfo.depthStencilInfo;
+  key.add(depthStencil.depthTestEnable)
+      .add(depthStencil.depthWriteEnable)
+      .add(depthStencil.depthCompareOp)
+      .add(depthStencil.depthBoundsTestEnable)
+      .add(depthStencil.stencilTestEnable)
+      .add(depthStencil.front)
+      .add(depthStencil.back)
+      .add(depthStencil.minDepthBounds)
+      .add(depthStencil.maxDepthBounds);
+
+  key.add(configInfo.dynamicStateEnables.size());
+  for (auto state : configInfo.dynamicStateEnables) key.add(state);
+
+  key.add(configInfo.pipelineLayout).add(configInfo.renderPass).add(configInfo.subpass);
+  return key.take();
+}
+
+NilePipelineRegistry::NilePipelineRegistry(NileDevice &device) : device{device} {}
+
+NilePipelineRegistry::~NilePipelineRegistry() {
+  setJobSystem(nullptr);
+  // pipelines first, they are built from everything else
+  pipelines.clear();
+  computePipelines.clear();
+  for (auto &[key, pipelineLayout] : pipelineLayouts) {
+    vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+  }
+  setLayouts.clear();
+  for (auto &[filepath, shaderModule] : shaderModules) {
+    vkDestroyShaderModule(device.device(), shaderModule, nullptr);
+  }
+}
+
+void NilePipelineRegistry::setJobSystem(NileJobSystem *jobSystem) {
+  std::vector<std::shared_ptr<NilePipeline>> queued{};
+  {
+    std::lock_guard<std::recursive_mutex> lock{mutex};
+    this->jobSystem = jobSystem;
+    for (auto &[key, pipeline] : pipelines) queued.push_back(pipeline);
+  }
+  // the queued creations look up shader modules, so wait without holding the lock
+  for (auto &pipeline : queued) pipeline->detachJobSystem();
+}
+
+VkShaderModule NilePipelineRegistry::getShaderModule(const std::string &filepath) {
+  {
+    std::lock_guard<std::recursive_mutex> lock{mutex};
+    auto it = shaderModules.find(filepath);
+    if (it != shaderModules.end()) {
+      stats.hits++;
+      return it->second;
+    }
+  }
+
+  // pipelines created in parallel load their modules in parallel too, the first one to finish
+  // a given path wins and the others throw theirs away
+  VkShaderModule shaderModule = createShaderModule(filepath);
+  std::lock_guard<std::recursive_mutex> lock{mutex};
+  auto [it, inserted] = shaderModules.try_emplace(filepath, shaderModule);
+  if (!inserted) {
+    vkDestroyShaderModule(device.device(), shaderModule, nullptr);
+    stats.hits++;
+    return it->second;
+  }
+  stats.shaderModules++;
+  return shaderModule;
+}
+
+std::shared_ptr<NileDescriptorSetLayout> NilePipelineRegistry::getDescriptorSetLayout(
+    const NileDescriptorSetLayout::Builder &builder) {
+  // the builder keeps its bindings in a hash map, sort them so the order doesn't matter
+  std::vector<VkDescriptorSetLayoutBinding> bindings{};
+  for (const auto &[binding, layoutBinding] : builder.bindings) bindings.push_back(layoutBinding);
+  std::sort(bindings.begin(), bindings.end(), [](const auto &a, const auto &b) {
+    return a.binding < b.binding;
+  });
+  KeyWriter key{};
+  for (const auto &binding : bindings) {
+    key.add(binding.binding)
+        .add(binding.descriptorType)
+        .add(binding.descriptorCount)
+        .add(binding.stageFlags);
+  }
+
+  std::lock_guard<std::recursive_mutex> lock{mutex};
+  auto it = setLayouts.find(key.peek());
+  if (it != setLayouts.end()) {
+    stats.hits++;
+    return it->second;
+  }
+  auto setLayout = std::make_shared<NileDescriptorSetLayout>(device, builder.bindings);
+  setLayouts.emplace(key.take(), setLayout);
+  stats.setLayouts++;
+  return setLayout;
+}
+
+VkPipelineLayout NilePipelineRegistry::getPipelineLayout(
+    const std::vector<VkDescriptorSetLayout> &setLayouts,
+    const std::vector<VkPushConstantRange> &pushConstantRanges) {
+  KeyWriter key{};
+  key.add(setLayouts.size());
+  for (auto setLayout : setLayouts) key.add(setLayout);
+  for (const auto &range : pushConstantRanges) {
+    key.add(range.stageFlags).add(range.offset).add(range.size);
+  }
+
+  std::lock_guard<std::recursive_mutex> lock{mutex};
+  auto [it, inserted] = pipelineLayouts.try_emplace(key.take(), VK_NULL_HANDLE);
+  if (!inserted) {
+    stats.hits++;
+    return it->second;
+  }
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+  pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &it->second) !=
+      VK_SUCCESS) {
+    pipelineLayouts.erase(it);
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+  stats.pipelineLayouts++;
+  return it->second;
+}
+
+std::shared_ptr<NilePipeline> NilePipelineRegistry::getPipeline(
+    const std::string &vertFilepath,
+    const std::string &fragFilepath,
+    const PipelineConfigInfo &configInfo) {
+  std::string key = pipelineKey(vertFilepath, fragFilepath, configInfo);
+
+  std::lock_guard<std::recursive_mutex> lock{mutex};
+  auto it = pipelines.find(key);
+  if (it != pipelines.end()) {
+    stats.hits++;
+    return it->second;
+  }
+  // with a job system this only queues the creation
+  auto pipeline =
+      jobSystem != nullptr
+          ? std::make_shared<NilePipeline>(
+                device, vertFilepath, fragFilepath, configInfo, *jobSystem)
+          : std::make_shared<NilePipeline>(device, vertFilepath, fragFilepath, configInfo);
+  pipelines.emplace(std::move(key), pipeline);
+  stats.pipelines++;
+  return pipeline;
+}
+
+std::shared_ptr<NileComputePipeline> NilePipelineRegistry::getComputePipeline(
+    const std::string &compFilepath, VkPipelineLayout pipelineLayout) {
+  KeyWriter keyWriter{};
+  std::string key = keyWriter.add(compFilepath).add(pipelineLayout).take();
+
+  std::lock_guard<std::recursive_mutex> lock{mutex};
+  auto it = computePipelines.find(key);
+  if (it != computePipelines.end()) {
+    stats.hits++;
+    return it->second;
+  }
+  auto pipeline = std::make_shared<NileComputePipeline>(device, compFilepath, pipelineLayout);
+  computePipelines.emplace(std::move(key), pipeline);
+  stats.pipelines++;
+  return pipeline;
+}
+
+NilePipelineRegistry::Stats NilePipelineRegistry::getStats() const {
+  std::lock_guard<std::recursive_mutex> lock{mutex};
+  return stats;
+}
+
+VkShaderModule NilePipelineRegistry::createShaderModule(const std::string &filepath) {
+  auto code = NilePipeline::readFile(filepath);
+
+  VkShaderModuleCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(device.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module");
+  }
+  return shaderModule;
+}
+
+}  // namespace nile
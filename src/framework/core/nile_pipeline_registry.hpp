@@ -0,0 +1,86 @@
+#pragma once
+
+#include "nile_compute_pipeline.hpp"
+#include "nile_descriptors.hpp"
+#include "nile_device.hpp"
+#include "nile_job_system.hpp"
+#include "nile_pipeline.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nile{
+
+// Deduplicates the GPU objects systems build their pipelines from. Shader modules are keyed by
+// path, descriptor set layouts by their bindings, pipeline layouts by their set layouts and push
+// constant ranges, and pipelines by their shaders plus every field of PipelineConfigInfo, so
+// systems asking for the same thing share one object.
+//
+// Everything lives until the registry is destroyed, which NileDevice does before destroying the
+// device. Callers must not destroy what they get back. Safe to call from any thread.
+class NilePipelineRegistry {
+ public:
+  // created counts unique objects, hits the requests that were served from the registry
+  struct Stats {
+    uint32_t shaderModules = 0;
+    uint32_t setLayouts = 0;
+    uint32_t pipelineLayouts = 0;
+    uint32_t pipelines = 0;
+    uint32_t hits = 0;
+  };
+
+  explicit NilePipelineRegistry(NileDevice &device);
+  ~NilePipelineRegistry();
+
+  NilePipelineRegistry(const NilePipelineRegistry &) = delete;
+  NilePipelineRegistry &operator=(const NilePipelineRegistry &) = delete;
+
+  // Graphics pipelines requested while a job system is set are created on its threads, so
+  // getPipeline returns before they exist and the first bind waits for them. Set it back to
+  // nullptr before the job system is destroyed and while no frame is recorded, that waits for the
+  // creations still queued.
+  void setJobSystem(NileJobSystem *jobSystem);
+
+  // filepath is relative to the engine directory, like NilePipeline::readFile
+  VkShaderModule getShaderModule(const std::string &filepath);
+
+  std::shared_ptr<NileDescriptorSetLayout> getDescriptorSetLayout(
+      const NileDescriptorSetLayout::Builder &builder);
+
+  VkPipelineLayout getPipelineLayout(
+      const std::vector<VkDescriptorSetLayout> &setLayouts,
+      const std::vector<VkPushConstantRange> &pushConstantRanges = {});
+
+  std::shared_ptr<NilePipeline> getPipeline(
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      const PipelineConfigInfo &configInfo);
+
+  std::shared_ptr<NileComputePipeline> getComputePipeline(
+      const std::string &compFilepath, VkPipelineLayout pipelineLayout);
+
+  Stats getStats() const;
+
+ private:
+  VkShaderModule createShaderModule(const std::string &filepath);
+
+  NileDevice &device;
+  NileJobSystem *jobSystem = nullptr;
+
+  // shader modules are looked up while pipelines are created, so the lock is recursive. Module
+  // and pipeline creation themselves happen outside of it, they run on several threads at once.
+  mutable std::recursive_mutex mutex;
+  std::unordered_map<std::string, VkShaderModule> shaderModules;
+  std::unordered_map<std::string, std::shared_ptr<NileDescriptorSetLayout>> setLayouts;
+  std::unordered_map<std::string, VkPipelineLayout> pipelineLayouts;
+  std::unordered_map<std::string, std::shared_ptr<NilePipeline>> pipelines;
+  std::unordered_map<std::string, std::shared_ptr<NileComputePipeline>> computePipelines;
+  Stats stats{};
+};
+
+}  // namespace nile
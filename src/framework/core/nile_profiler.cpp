@@ -0,0 +1,176 @@
+#include "nile_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace nile{
+
+struct NileProfiler::State {
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // guards buffers, which only ever grows
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+  // frames get a row of their own, written by the thread calling frame()
+  ThreadBuffer *frames = nullptr;
+  uint64_t lastFrameNs = 0;
+  uint32_t frameCount = 0;
+
+  std::string tracePath = "trace.json";
+  uint32_t traceFrameCount = 0;
+  std::atomic<bool> isDumpRequested{false};
+};
+
+thread_local NileProfiler::ThreadBuffer *NileProfiler::currentBuffer = nullptr;
+
+namespace {
+
+std::string escape(const std::string &text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+}  // namespace
+
+NileProfiler::State &NileProfiler::state() {
+  static State instance{};
+  return instance;
+}
+
+uint64_t NileProfiler::now() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - state().start)
+                                   .count());
+}
+
+void NileProfiler::ThreadBuffer::push(const char *name, uint64_t beginNs, uint64_t endNs) {
+  // the slot is written before head moves past it, readers drop slots head may have reached
+  const uint64_t index = head.load(std::memory_order_relaxed);
+  Event &event = events[index % EVENTS_PER_THREAD];
+  event.name.store(name, std::memory_order_relaxed);
+  event.beginNs.store(beginNs, std::memory_order_relaxed);
+  event.endNs.store(endNs, std::memory_order_relaxed);
+  head.store(index + 1, std::memory_order_release);
+}
+
+NileProfiler::ThreadBuffer *NileProfiler::registerBuffer(const std::string &name) {
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto &buffer = s.buffers.emplace_back(std::make_unique<ThreadBuffer>());
+  buffer->threadId = static_cast<uint32_t>(s.buffers.size());
+  buffer->name = name;
+  return buffer.get();
+}
+
+NileProfiler::ThreadBuffer &NileProfiler::threadBuffer() {
+  if (currentBuffer == nullptr) currentBuffer = registerBuffer("thread");
+  return *currentBuffer;
+}
+
+void NileProfiler::record(const char *name, uint64_t beginNs, uint64_t endNs) {
+  threadBuffer().push(name, beginNs, endNs);
+}
+
+void NileProfiler::setThreadName(const std::string &name) {
+  if (currentBuffer == nullptr) {
+    currentBuffer = registerBuffer(name);
+    return;
+  }
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  currentBuffer->name = name;
+}
+
+void NileProfiler::setTraceOutput(const std::string &path, uint32_t frameCount) {
+  auto &s = state();
+  s.tracePath = path;
+  s.traceFrameCount = frameCount;
+}
+
+void NileProfiler::requestDump() {
+  state().isDumpRequested.store(true, std::memory_order_relaxed);
+}
+
+void NileProfiler::frame() {
+  auto &s = state();
+  if (s.frames == nullptr) s.frames = registerBuffer("frames");
+  const uint64_t frameEnd = now();
+  if (s.lastFrameNs != 0) s.frames->push("frame", s.lastFrameNs, frameEnd);
+  s.lastFrameNs = frameEnd;
+  s.frameCount++;
+
+  bool isDumpDue = s.isDumpRequested.exchange(false, std::memory_order_relaxed);
+  if (s.traceFrameCount > 0 && s.frameCount == s.traceFrameCount) isDumpDue = true;
+  if (!isDumpDue) return;
+  if (writeTrace(s.tracePath)) {
+    std::cout << "Wrote " << s.frameCount << " frames of cpu zones to " << s.tracePath << "\n";
+  } else {
+    std::cerr << "failed to open " << s.tracePath << " for the trace\n";
+  }
+}
+
+bool NileProfiler::writeTrace(const std::string &path) {
+  std::ofstream file{path};
+  if (!file) return false;
+
+  struct Zone {
+    const char *name;
+    uint64_t beginNs;
+    uint64_t endNs;
+  };
+
+  auto &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  file << std::fixed << std::setprecision(3);
+  bool isFirst = true;
+  auto separate = [&]() {
+    if (!isFirst) file << ",\n";
+    isFirst = false;
+  };
+
+  std::vector<Zone> zones;
+  for (const auto &buffer : s.buffers) {
+    separate();
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+         << ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+    zones.clear();
+    for (uint64_t i = first; i < head; i++) {
+      const Event &event = buffer->events[i % EVENTS_PER_THREAD];
+      zones.push_back(
+          {event.name.load(std::memory_order_relaxed),
+           event.beginNs.load(std::memory_order_relaxed),
+           event.endNs.load(std::memory_order_relaxed)});
+    }
+    // zones the thread overwrote while they were copied, or may have been overwriting
+    const uint64_t headAfter = buffer->head.load(std::memory_order_acquire);
+    const uint64_t firstIntact =
+        headAfter + 1 > EVENTS_PER_THREAD ? headAfter + 1 - EVENTS_PER_THREAD : 0;
+
+    for (uint64_t i = std::max(first, firstIntact); i < head; i++) {
+      const Zone &zone = zones[i - first];
+      separate();
+      file << "{\"name\":\"" << escape(zone.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+           << buffer->threadId << ",\"ts\":" << zone.beginNs / 1000.0
+           << ",\"dur\":" << (zone.endNs - zone.beginNs) / 1000.0 << "}";
+    }
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
+
+}  // namespace nile
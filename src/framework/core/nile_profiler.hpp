@@ -0,0 +1,101 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace nile{
+
+// CPU zones for finding where a frame's time goes, exported as Chrome trace_event JSON for
+// chrome://tracing or ui.perfetto.dev. Built only with -DUSE_PROFILER=ON, which defines
+// NILE_PROFILE, the macros below compile to nothing otherwise:
+//
+//   NILE_PROFILE_ZONE("update buffer");  // times the rest of the enclosing scope
+//
+// A zone's name must outlive the next trace dump, string literals or names of systems that
+// live as long as the app. Every thread writes finished zones into a ring buffer of its own,
+// without locks, keeping its last EVENTS_PER_THREAD zones. NILE_PROFILE_FRAME marks the end of
+// a frame, and writes the trace when F12 was pressed or the frame count set through
+// NILE_PROFILE_TRACE_OUTPUT was reached.
+class NileProfiler {
+ public:
+  static constexpr uint32_t EVENTS_PER_THREAD = 1 << 15;
+
+  // Nanoseconds since the profiler started
+  static uint64_t now();
+
+  // Called by NileProfileZone as it ends
+  static void record(const char *name, uint64_t beginNs, uint64_t endNs);
+
+  // Shown for the calling thread's zones in the trace
+  static void setThreadName(const std::string &name);
+
+  // Where frame() writes the trace, and after how many frames, 0 for only on request
+  static void setTraceOutput(const std::string &path, uint32_t frameCount);
+  // Writes the trace at the end of the current frame, safe to call from any thread
+  static void requestDump();
+  static void frame();
+
+  // Writes every thread's buffered zones, false when path can't be opened
+  static bool writeTrace(const std::string &path);
+
+ private:
+  struct Event {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint64_t> beginNs{0};
+    std::atomic<uint64_t> endNs{0};
+  };
+
+  // Written only by its thread, read by whichever thread writes the trace. head counts every
+  // event ever written, slots older than head - EVENTS_PER_THREAD were overwritten.
+  struct ThreadBuffer {
+    std::unique_ptr<Event[]> events{new Event[EVENTS_PER_THREAD]};
+    std::atomic<uint64_t> head{0};
+    uint32_t threadId = 0;
+    std::string name{};
+
+    void push(const char *name, uint64_t beginNs, uint64_t endNs);
+  };
+
+  struct State;
+  static State &state();
+  static thread_local ThreadBuffer *currentBuffer;
+  static ThreadBuffer &threadBuffer();
+  static ThreadBuffer *registerBuffer(const std::string &name);
+};
+
+// Records the time between its construction and destruction under name
+class NileProfileZone {
+ public:
+  explicit NileProfileZone(const char *name) : name{name}, beginNs{NileProfiler::now()} {}
+  ~NileProfileZone() { NileProfiler::record(name, beginNs, NileProfiler::now()); }
+
+  NileProfileZone(const NileProfileZone &) = delete;
+  NileProfileZone &operator=(const NileProfileZone &) = delete;
+
+ private:
+  const char *name;
+  uint64_t beginNs;
+};
+
+}  // namespace nile
+
+#if defined(NILE_PROFILE)
+#define NILE_PROFILE_CONCAT_(a, b) a##b
+#define NILE_PROFILE_CONCAT(a, b) NILE_PROFILE_CONCAT_(a, b)
+#define NILE_PROFILE_ZONE(name) \
+  ::nile::NileProfileZone NILE_PROFILE_CONCAT(nileProfileZone, __LINE__) { name }
+#define NILE_PROFILE_THREAD(name) ::nile::NileProfiler::setThreadName(name)
+#define NILE_PROFILE_FRAME() ::nile::NileProfiler::frame()
+#define NILE_PROFILE_REQUEST_DUMP() ::nile::NileProfiler::requestDump()
+#define NILE_PROFILE_TRACE_OUTPUT(path, frameCount) \
+  ::nile::NileProfiler::setTraceOutput(path, frameCount)
+#else
+#define NILE_PROFILE_ZONE(name) ((void)0)
+#define NILE_PROFILE_THREAD(name) ((void)0)
+#define NILE_PROFILE_FRAME() ((void)0)
+#define NILE_PROFILE_REQUEST_DUMP() ((void)0)
+#define NILE_PROFILE_TRACE_OUTPUT(path, frameCount) ((void)0)
+#endif
@@ -0,0 +1,660 @@
+#include "nile_render_graph.hpp"
+
+#include "nile_command_recorder.hpp"
+#include "nile_frame_info.hpp"
+#include "nile_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace nile{
+
+static bool isDepthFormat(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool hasStencil(VkFormat format) {
+  return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+         format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+static VkImageAspectFlags aspectMaskFor(VkFormat format) {
+  if (!isDepthFormat(format)) return VK_IMAGE_ASPECT_COLOR_BIT;
+  VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  if (hasStencil(format)) aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  return aspectMask;
+}
+
+NileRenderGraph::PassBuilder &NileRenderGraph::PassBuilder::writesColor(
+    ImageId image, VkClearColorValue clearColor) {
+  assert(
+      !isDepthFormat(graph.images[image].desc.format) &&
+      "Color attachments need a color format");
+  graph.addUse(id, {image, Usage::ColorAttachment, clearColor});
+  return *this;
+}
+
+NileRenderGraph::PassBuilder &NileRenderGraph::PassBuilder::writesDepth(ImageId image) {
+  assert(
+      isDepthFormat(graph.images[image].desc.format) && "Depth attachments need a depth format");
+  graph.addUse(id, {image, Usage::DepthAttachment});
+  return *this;
+}
+
+NileRenderGraph::PassBuilder &NileRenderGraph::PassBuilder::samples(ImageId image) {
+  graph.addUse(id, {image, Usage::Sampled});
+  return *this;
+}
+
+NileRenderGraph::PassBuilder &NileRenderGraph::PassBuilder::recordsSecondaryBuffers() {
+  graph.passes[id].recordsSecondaryBuffers = true;
+  return *this;
+}
+
+NileRenderGraph::NileRenderGraph(NileDevice &device) : device{device} {}
+
+NileRenderGraph::~NileRenderGraph() {
+  for (auto &pass : passes) {
+    vkDestroyFramebuffer(device.device(), pass.framebuffer, nullptr);
+    vkDestroyRenderPass(device.device(), pass.renderPass, nullptr);
+  }
+  for (auto &image : images) {
+    device.retireHandle((uint64_t)(image.view));
+    vkDestroyImageView(device.device(), image.view, nullptr);
+    vkDestroyImage(device.device(), image.image, nullptr);
+  }
+  for (auto &block : memoryBlocks) {
+    vkFreeMemory(device.device(), block.memory, nullptr);
+  }
+  device.retireHandle((uint64_t)(sampler));
+  vkDestroySampler(device.device(), sampler, nullptr);
+}
+
+NileRenderGraph::ImageId NileRenderGraph::createImage(
+    const std::string &name, const ImageDesc &desc) {
+  assert(!isCompiled && "Cannot add images to a compiled render graph");
+  Image image{};
+  image.name = name;
+  image.desc = desc;
+  images.push_back(image);
+  return static_cast<ImageId>(images.size() - 1);
+}
+
+void NileRenderGraph::markOutput(ImageId image) {
+  assert(!isCompiled && "Cannot change a compiled render graph");
+  images[image].isOutput = true;
+}
+
+NileRenderGraph::PassBuilder NileRenderGraph::addPass(const std::string &name, ExecuteFunc func) {
+  return createPass(name, std::move(func), false);
+}
+
+NileRenderGraph::PassBuilder NileRenderGraph::addSwapChainPass(
+    const std::string &name, ExecuteFunc func) {
+  return createPass(name, std::move(func), true);
+}
+
+void NileRenderGraph::setExecute(PassId pass, ExecuteFunc func) {
+  passes[pass].func = std::move(func);
+}
+
+NileRenderGraph::PassBuilder NileRenderGraph::createPass(
+    const std::string &name, ExecuteFunc func, bool isSwapChainPass) {
+  assert(!isCompiled && "Cannot add passes to a compiled render graph");
+  Pass pass{};
+  pass.name = name;
+  pass.func = std::move(func);
+  pass.isSwapChainPass = isSwapChainPass;
+  passes.push_back(std::move(pass));
+  return PassBuilder{*this, static_cast<PassId>(passes.size() - 1)};
+}
+
+void NileRenderGraph::addUse(PassId pass, const ImageUse &use) {
+  assert(!isCompiled && "Cannot change a compiled render graph");
+  assert(use.image < images.size() && "Unknown render graph image");
+  for (const auto &other : passes[pass].uses) {
+    assert(other.image != use.image && "A pass can only use an image one way");
+  }
+  assert(
+      (use.usage == Usage::Sampled || !passes[pass].isSwapChainPass) &&
+      "Swap chain passes render to the swap chain, they can only sample graph images");
+  passes[pass].uses.push_back(use);
+}
+
+bool NileRenderGraph::writes(const Pass &pass, ImageId image) {
+  for (const auto &use : pass.uses) {
+    if (use.image == image && use.usage != Usage::Sampled) return true;
+  }
+  return false;
+}
+
+NileRenderGraph::ImageState NileRenderGraph::stateFor(Usage usage) {
+  switch (usage) {
+    case Usage::ColorAttachment:
+      return {
+          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+          VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+          VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+          true};
+    case Usage::DepthAttachment:
+      return {
+          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+          VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+          true};
+    case Usage::Sampled:
+    default:
+      return {
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+          VK_ACCESS_SHADER_READ_BIT,
+          false};
+  }
+}
+
+void NileRenderGraph::compile() {
+  assert(!isCompiled && "Render graph is already compiled");
+  cullPasses();
+  orderPasses();
+  createImages();
+  allocateMemory();
+  createRenderPasses();
+  createBarriers();
+  createSampler();
+  isCompiled = true;
+
+  stats.passes = static_cast<uint32_t>(executionOrder.size());
+  stats.culledPasses = static_cast<uint32_t>(passes.size() - executionOrder.size());
+}
+
+void NileRenderGraph::cullPasses() {
+  std::vector<PassId> keptPasses{};
+  auto keep = [&](PassId id) {
+    if (!passes[id].isCulled) return;
+    passes[id].isCulled = false;
+    keptPasses.push_back(id);
+  };
+
+  for (PassId id = 0; id < passes.size(); id++) {
+    if (passes[id].isSwapChainPass) keep(id);
+    for (const auto &use : passes[id].uses) {
+      if (use.usage != Usage::Sampled && images[use.image].isOutput) keep(id);
+    }
+  }
+
+  // a kept pass needs every pass that writes an image it uses
+  while (!keptPasses.empty()) {
+    PassId id = keptPasses.back();
+    keptPasses.pop_back();
+    for (const auto &use : passes[id].uses) {
+      for (PassId writer = 0; writer < passes.size(); writer++) {
+        if (writes(passes[writer], use.image)) keep(writer);
+      }
+    }
+  }
+}
+
+void NileRenderGraph::orderPasses() {
+  // every writer of an image runs before the passes sampling it, writers of the same image run
+  // in the order they were added
+  auto dependsOn = [&](PassId pass, PassId other) {
+    for (const auto &use : passes[pass].uses) {
+      if (!writes(passes[other], use.image)) continue;
+      if (use.usage == Usage::Sampled || other < pass) return true;
+    }
+    return false;
+  };
+
+  std::vector<uint32_t> dependencyCount(passes.size(), 0);
+  std::vector<std::vector<PassId>> successors(passes.size());
+  uint32_t keptCount = 0;
+  for (PassId pass = 0; pass < passes.size(); pass++) {
+    if (passes[pass].isCulled) continue;
+    keptCount++;
+    for (PassId other = 0; other < passes.size(); other++) {
+      if (other == pass || passes[other].isCulled || !dependsOn(pass, other)) continue;
+      successors[other].push_back(pass);
+      dependencyCount[pass]++;
+    }
+  }
+
+  // the ready pass that was added first goes next, so independent passes keep their order
+  std::vector<bool> isPlaced(passes.size(), false);
+  while (executionOrder.size() < keptCount) {
+    PassId next = static_cast<PassId>(passes.size());
+    for (PassId pass = 0; pass < passes.size(); pass++) {
+      if (!passes[pass].isCulled && !isPlaced[pass] && dependencyCount[pass] == 0) {
+        next = pass;
+        break;
+      }
+    }
+    if (next == passes.size()) {
+      throw std::runtime_error("render graph passes sample each other's images in a cycle!");
+    }
+    isPlaced[next] = true;
+    passes[next].position = static_cast<uint32_t>(executionOrder.size());
+    executionOrder.push_back(next);
+    for (PassId successor : successors[next]) dependencyCount[successor]--;
+  }
+}
+
+void NileRenderGraph::createImages() {
+  for (PassId id : executionOrder) {
+    const Pass &pass = passes[id];
+    for (const auto &use : pass.uses) {
+      Image &image = images[use.image];
+      if (!image.isUsed) image.firstUse = pass.position;
+      image.isUsed = true;
+      image.lastUse = pass.position;
+      switch (use.usage) {
+        case Usage::ColorAttachment:
+          image.usageFlags |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+          break;
+        case Usage::DepthAttachment:
+          image.usageFlags |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+          break;
+        case Usage::Sampled:
+          image.usageFlags |= VK_IMAGE_USAGE_SAMPLED_BIT;
+          break;
+      }
+    }
+  }
+
+  // images only culled passes used are never created
+  for (auto &image : images) {
+    if (!image.isUsed) continue;
+    if (image.isOutput) image.usageFlags |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = image.desc.format;
+    imageInfo.extent = {image.desc.extent.width, image.desc.extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = image.usageFlags;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(device.device(), &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create render graph image!");
+    }
+    vkGetImageMemoryRequirements(device.device(), image.image, &image.memoryRequirements);
+    stats.unaliasedBytes += image.memoryRequirements.size;
+  }
+}
+
+void NileRenderGraph::allocateMemory() {
+  std::vector<ImageId> usedImages{};
+  for (ImageId id = 0; id < images.size(); id++) {
+    if (images[id].isUsed) usedImages.push_back(id);
+  }
+  std::stable_sort(usedImages.begin(), usedImages.end(), [&](ImageId a, ImageId b) {
+    return images[a].firstUse < images[b].firstUse;
+  });
+
+  // first fit: an image moves into the first block whose images are all done before it starts.
+  // Every image is bound at offset 0, so a block is as large as its largest image.
+  for (ImageId id : usedImages) {
+    const Image &image = images[id];
+    MemoryBlock *target = nullptr;
+    if (!image.isOutput) {
+      for (auto &block : memoryBlocks) {
+        if (block.lastUse < image.firstUse &&
+            (block.memoryTypeBits & image.memoryRequirements.memoryTypeBits) != 0) {
+          target = &block;
+          break;
+        }
+      }
+    }
+    if (target == nullptr) {
+      memoryBlocks.emplace_back();
+      target = &memoryBlocks.back();
+    }
+    target->size = std::max(target->size, image.memoryRequirements.size);
+    target->memoryTypeBits &= image.memoryRequirements.memoryTypeBits;
+    // outputs are sampled outside the graph, their memory is never handed on
+    target->lastUse = image.isOutput ? UINT32_MAX : image.lastUse;
+    target->images.push_back(id);
+  }
+
+  for (auto &block : memoryBlocks) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = block.size;
+    allocInfo.memoryTypeIndex =
+        device.findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate render graph memory!");
+    }
+    stats.memoryBytes += block.size;
+
+    for (ImageId id : block.images) {
+      Image &image = images[id];
+      vkBindImageMemory(device.device(), image.image, block.memory, 0);
+
+      VkImageViewCreateInfo viewInfo{};
+      viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+      viewInfo.image = image.image;
+      viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+      viewInfo.format = image.desc.format;
+      viewInfo.subresourceRange.aspectMask = aspectMaskFor(image.desc.format);
+      viewInfo.subresourceRange.baseMipLevel = 0;
+      viewInfo.subresourceRange.levelCount = 1;
+      viewInfo.subresourceRange.baseArrayLayer = 0;
+      viewInfo.subresourceRange.layerCount = 1;
+      if (vkCreateImageView(device.device(), &viewInfo, nullptr, &image.view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render graph image view!");
+      }
+    }
+  }
+}
+
+void NileRenderGraph::createRenderPasses() {
+  for (PassId id : executionOrder) {
+    Pass &pass = passes[id];
+    if (pass.isSwapChainPass) continue;
+
+    std::vector<VkAttachmentDescription> attachments{};
+    std::vector<VkAttachmentReference> colorRefs{};
+    VkAttachmentReference depthRef{};
+    bool hasDepth = false;
+    std::vector<VkImageView> views{};
+
+    for (const auto &use : pass.uses) {
+      if (use.usage == Usage::Sampled) continue;
+      const Image &image = images[use.image];
+      if (views.empty()) {
+        pass.extent = image.desc.extent;
+      }
+      assert(
+          image.desc.extent.width == pass.extent.width &&
+          image.desc.extent.height == pass.extent.height &&
+          "All attachments of a pass must be the same size");
+
+      // barriers before the pass do the layout transitions, the pass keeps its layouts
+      const ImageState state = stateFor(use.usage);
+      const bool isFirstWrite = image.firstUse == pass.position;
+      const bool isNeededLater = image.isOutput || image.lastUse > pass.position;
+
+      VkAttachmentDescription attachment{};
+      attachment.format = image.desc.format;
+      attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+      attachment.loadOp = isFirstWrite ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+      attachment.storeOp =
+          isNeededLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+      attachment.initialLayout = state.layout;
+      attachment.finalLayout = state.layout;
+
+      VkAttachmentReference reference{static_cast<uint32_t>(attachments.size()), state.layout};
+      VkClearValue clearValue{};
+      if (use.usage == Usage::DepthAttachment) {
+        assert(!hasDepth && "A pass can only write one depth attachment");
+        depthRef = reference;
+        hasDepth = true;
+        clearValue.depthStencil = {1.0f, 0};
+      } else {
+        colorRefs.push_back(reference);
+        clearValue.color = use.clearColor;
+      }
+      attachments.push_back(attachment);
+      pass.clearValues.push_back(clearValue);
+      views.push_back(image.view);
+    }
+    assert(!views.empty() && "Render graph passes need at least one attachment");
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &pass.renderPass) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create render pass!");
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = pass.renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = pass.extent.width;
+    framebufferInfo.height = pass.extent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &pass.framebuffer) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create framebuffer!");
+    }
+  }
+}
+
+void NileRenderGraph::createBarriers() {
+  // where every image is at the end of a frame
+  const std::vector<ImageState> finalStates =
+      trackImageStates(std::vector<ImageState>(images.size()), false);
+
+  // An image's first use in a frame waits for whatever used its memory last: the image before
+  // it in the same block, or for the block's first image the last one of the previous frame
+  std::vector<ImageState> previous(images.size());
+  for (const auto &block : memoryBlocks) {
+    for (size_t i = 0; i < block.images.size(); i++) {
+      const ImageId before = i > 0 ? block.images[i - 1] : block.images.back();
+      previous[block.images[i]] = finalStates[before];
+    }
+  }
+  trackImageStates(previous, true);
+}
+
+std::vector<NileRenderGraph::ImageState> NileRenderGraph::trackImageStates(
+    const std::vector<ImageState> &previous, bool emit) {
+  std::vector<ImageState> states(images.size());
+  std::vector<bool> isTouched(images.size(), false);
+
+  for (PassId id : executionOrder) {
+    Pass &pass = passes[id];
+    for (const auto &use : pass.uses) {
+      const ImageState wanted = stateFor(use.usage);
+      ImageState &current = states[use.image];
+
+      ImageState from = current;
+      bool needsBarrier = true;
+      if (!isTouched[use.image]) {
+        // nothing is kept from the previous occupant, so its contents can be dropped
+        from = previous[use.image];
+        from.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        isTouched[use.image] = true;
+      } else if (current.layout == wanted.layout && !current.isWrite && !wanted.isWrite) {
+        // reading what is already readable
+        needsBarrier = false;
+      }
+
+      if (!needsBarrier) {
+        current.stageMask |= wanted.stageMask;
+        current.accessMask |= wanted.accessMask;
+        continue;
+      }
+      if (emit) {
+        pass.barriers.push_back(makeBarrier(use.image, from, wanted));
+        pass.srcStageMask |=
+            from.stageMask != 0 ? from.stageMask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        pass.dstStageMask |= wanted.stageMask;
+      }
+      current = wanted;
+    }
+  }
+
+  for (ImageId id = 0; id < images.size(); id++) {
+    if (!images[id].isOutput || !isTouched[id]) continue;
+    const ImageState sampled = stateFor(Usage::Sampled);
+    if (states[id].layout == sampled.layout && !states[id].isWrite) continue;
+    if (emit) {
+      finalBarriers.push_back(makeBarrier(id, states[id], sampled));
+      finalSrcStageMask |= states[id].stageMask;
+    }
+    states[id] = sampled;
+  }
+
+  if (emit) {
+    stats.barriersPerFrame = static_cast<uint32_t>(finalBarriers.size());
+    for (const auto &pass : passes) {
+      stats.barriersPerFrame += static_cast<uint32_t>(pass.barriers.size());
+    }
+  }
+  return states;
+}
+
+VkImageMemoryBarrier NileRenderGraph::makeBarrier(
+    ImageId image, const ImageState &from, const ImageState &to) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  // reads only need the execution dependency
+  barrier.srcAccessMask = from.isWrite ? from.accessMask : 0;
+  barrier.dstAccessMask = to.accessMask;
+  barrier.oldLayout = from.layout;
+  barrier.newLayout = to.layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = images[image].image;
+  barrier.subresourceRange.aspectMask = aspectMaskFor(images[image].desc.format);
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  return barrier;
+}
+
+void NileRenderGraph::createSampler() {
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.anisotropyEnable = VK_FALSE;
+  samplerInfo.maxAnisotropy = 1.0f;
+  samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+  samplerInfo.compareEnable = VK_FALSE;
+  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = 1.0f;
+  if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render graph sampler!");
+  }
+}
+
+void NileRenderGraph::execute(FrameInfo &frameInfo, NileRenderer &renderer) {
+  assert(isCompiled && "Render graph must be compiled before it is executed");
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+  for (PassId id : executionOrder) {
+    Pass &pass = passes[id];
+    NILE_PROFILE_ZONE(pass.name.c_str());
+    if (!pass.barriers.empty()) {
+      vkCmdPipelineBarrier(
+          commandBuffer,
+          pass.srcStageMask,
+          pass.dstStageMask,
+          0,
+          0,
+          nullptr,
+          0,
+          nullptr,
+          static_cast<uint32_t>(pass.barriers.size()),
+          pass.barriers.data());
+    }
+
+    const bool useSecondaryBuffers =
+        pass.recordsSecondaryBuffers && frameInfo.commandRecorder != nullptr;
+    const VkSubpassContents contents = useSecondaryBuffers
+                                           ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                           : VK_SUBPASS_CONTENTS_INLINE;
+    if (pass.isSwapChainPass) {
+      renderer.beginSwapChainRenderPass(commandBuffer, contents, pass.name);
+    } else {
+      VkRenderPassBeginInfo beginInfo{};
+      beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+      beginInfo.renderPass = pass.renderPass;
+      beginInfo.framebuffer = pass.framebuffer;
+      beginInfo.renderArea.offset = {0, 0};
+      beginInfo.renderArea.extent = pass.extent;
+      beginInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+      beginInfo.pClearValues = pass.clearValues.data();
+      renderer.beginRenderPass(commandBuffer, beginInfo, contents, pass.name);
+    }
+
+    if (useSecondaryBuffers) frameInfo.commandRecorder->beginPass(frameInfo, renderer);
+    if (pass.func) pass.func(frameInfo);
+    if (useSecondaryBuffers) frameInfo.commandRecorder->endPass(frameInfo);
+
+    if (pass.isSwapChainPass) {
+      renderer.endSwapChainRenderPass(commandBuffer);
+    } else {
+      renderer.endRenderPass(commandBuffer);
+    }
+  }
+
+  if (!finalBarriers.empty()) {
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        finalSrcStageMask,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        static_cast<uint32_t>(finalBarriers.size()),
+        finalBarriers.data());
+  }
+}
+
+VkRenderPass NileRenderGraph::getRenderPass(PassId pass) const {
+  assert(isCompiled && "Render passes are created by compile");
+  assert(!passes[pass].isSwapChainPass && "Swap chain passes use the renderer's render pass");
+  return passes[pass].renderPass;
+}
+
+VkDescriptorImageInfo NileRenderGraph::getImageInfo(ImageId image) const {
+  assert(isCompiled && "Images are created by compile");
+  assert(images[image].isUsed && "Image is only used by culled passes");
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.sampler = sampler;
+  imageInfo.imageView = images[image].view;
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  return imageInfo;
+}
+
+VkFormat NileRenderGraph::findDepthFormat() {
+  return device.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+}
+
+}  // namespace nile
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "nile_device.hpp"
+#include "nile_renderer.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nile{
+
+struct FrameInfo;
+
+// A frame's render passes, declared by the images they render to and sample instead of being
+// begun and ended by hand. compile() then
+//  - culls passes nothing on screen depends on, and skips creating the images only they used
+//  - orders the remaining passes so every image is written before it is sampled
+//  - creates a render pass and framebuffer per pass, storing attachments only when a later pass
+//    or the outside needs them
+//  - works out the image barriers between passes, one vkCmdPipelineBarrier per pass at most
+//  - lets images whose first to last use don't overlap within the frame share memory
+//
+//   auto reflection = graph.createImage("reflection", {{512, 512}, VK_FORMAT_R8G8B8A8_UNORM});
+//   auto depth = graph.createImage("reflection depth", {{512, 512}, graph.findDepthFormat()});
+//   NileRenderGraph::PassId reflectionPass =
+//       graph.addPass("reflection", drawReflection).writesColor(reflection).writesDepth(depth);
+//   graph.addSwapChainPass("scene", drawScene).samples(reflection);
+//   graph.compile();
+//   ...
+//   graph.execute(frameInfo, renderer);  // between beginFrame and endFrame
+//
+// Images hold nothing from one frame to the next, except outputs which are meant to be sampled
+// outside the graph and are left in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+class NileRenderGraph {
+ public:
+  using ImageId = uint32_t;
+  using PassId = uint32_t;
+  using ExecuteFunc = std::function<void(FrameInfo &frameInfo)>;
+
+  struct ImageDesc {
+    VkExtent2D extent{};
+    VkFormat format = VK_FORMAT_UNDEFINED;
+  };
+
+  struct Stats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barriersPerFrame = 0;
+    VkDeviceSize memoryBytes = 0;
+    // what the same images would take with memory of their own
+    VkDeviceSize unaliasedBytes = 0;
+  };
+
+  class PassBuilder {
+   public:
+    PassBuilder(NileRenderGraph &graph, PassId id) : graph{graph}, id{id} {}
+
+    // The first pass to write an image in a frame clears it, later ones load it
+    PassBuilder &writesColor(ImageId image, VkClearColorValue clearColor = {});
+    PassBuilder &writesDepth(ImageId image);
+    // Sampled in the fragment shader
+    PassBuilder &samples(ImageId image);
+
+    // The pass is begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS and frameInfo's
+    // command recorder is started for it, see NileCommandRecorder
+    PassBuilder &recordsSecondaryBuffers();
+
+    operator PassId() const { return id; }
+
+   private:
+    NileRenderGraph &graph;
+    PassId id;
+  };
+
+  explicit NileRenderGraph(NileDevice &device);
+  ~NileRenderGraph();
+
+  NileRenderGraph(const NileRenderGraph &) = delete;
+  NileRenderGraph &operator=(const NileRenderGraph &) = delete;
+
+  ImageId createImage(const std::string &name, const ImageDesc &desc);
+  // Keeps the image and the passes writing it even though no pass samples it
+  void markOutput(ImageId image);
+
+  PassBuilder addPass(const std::string &name, ExecuteFunc func = {});
+  // Renders into the renderer's swap chain pass, what is culled is decided from these passes
+  PassBuilder addSwapChainPass(const std::string &name, ExecuteFunc func = {});
+  // For passes whose systems need getRenderPass, which only exists after compile
+  void setExecute(PassId pass, ExecuteFunc func);
+
+  void compile();
+
+  // Records the passes that survived culling into frameInfo.commandBuffer
+  void execute(FrameInfo &frameInfo, NileRenderer &renderer);
+
+  // VK_NULL_HANDLE for culled passes
+  VkRenderPass getRenderPass(PassId pass) const;
+  // For sampling the image in a descriptor set
+  VkDescriptorImageInfo getImageInfo(ImageId image) const;
+  bool isCulled(PassId pass) const { return passes[pass].isCulled; }
+  const Stats &getStats() const { return stats; }
+
+  VkFormat findDepthFormat();
+
+ private:
+  enum class Usage { ColorAttachment, DepthAttachment, Sampled };
+
+  struct ImageUse {
+    ImageId image;
+    Usage usage;
+    VkClearColorValue clearColor{};
+  };
+
+  struct Pass {
+    std::string name;
+    ExecuteFunc func;
+    std::vector<ImageUse> uses;
+    bool isSwapChainPass = false;
+    bool recordsSecondaryBuffers = false;
+
+    // filled by compile
+    bool isCulled = true;
+    uint32_t position = 0;  // in executionOrder
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    std::vector<VkClearValue> clearValues;
+    std::vector<VkImageMemoryBarrier> barriers;
+    VkPipelineStageFlags srcStageMask = 0;
+    VkPipelineStageFlags dstStageMask = 0;
+  };
+
+  struct Image {
+    std::string name;
+    ImageDesc desc;
+    bool isOutput = false;
+
+    // filled by compile, positions in executionOrder
+    bool isUsed = false;
+    uint32_t firstUse = 0;
+    uint32_t lastUse = 0;
+    VkImageUsageFlags usageFlags = 0;
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkMemoryRequirements memoryRequirements{};
+  };
+
+  // Memory shared by images that are never in use at the same time, in order of first use
+  struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeBits = ~0u;
+    uint32_t lastUse = 0;
+    std::vector<ImageId> images;
+  };
+
+  // How a pass accesses an image, and so what a barrier has to wait for or make visible
+  struct ImageState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stageMask = 0;
+    VkAccessFlags accessMask = 0;
+    bool isWrite = false;
+  };
+
+  PassBuilder createPass(const std::string &name, ExecuteFunc func, bool isSwapChainPass);
+  void addUse(PassId pass, const ImageUse &use);
+  static bool writes(const Pass &pass, ImageId image);
+  static ImageState stateFor(Usage usage);
+
+  void cullPasses();
+  void orderPasses();
+  void createImages();
+  void allocateMemory();
+  void createRenderPasses();
+  void createBarriers();
+  void createSampler();
+  // Runs through a frame's image uses, emitting barriers only when emit is set. Returns the
+  // state every image ends the frame in.
+  std::vector<ImageState> trackImageStates(const std::vector<ImageState> &previous, bool emit);
+  VkImageMemoryBarrier makeBarrier(ImageId image, const ImageState &from, const ImageState &to);
+
+  NileDevice &device;
+  std::vector<Image> images;
+  std::vector<Pass> passes;
+  std::vector<PassId> executionOrder;
+  std::vector<MemoryBlock> memoryBlocks;
+
+  // outputs go back to being sampled at the end of the frame
+  std::vector<VkImageMemoryBarrier> finalBarriers;
+  VkPipelineStageFlags finalSrcStageMask = 0;
+
+  VkSampler sampler = VK_NULL_HANDLE;
+  bool isCompiled = false;
+  Stats stats{};
+};
+
+}  // namespace nile
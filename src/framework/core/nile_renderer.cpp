@@ -1,15 +1,22 @@
 #include "nile_renderer.hpp"
 
+#include "nile_profiler.hpp"
+
 // std
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <stdexcept>
 #include <iostream>
-#include <cassert>
 
 namespace nile{
 
-NileRenderer::NileRenderer(NileWindow& window, NileDevice& device)
-    : nileWindow{window}, nileDevice{device} {
+NileRenderer::NileRenderer(NileWindow& window, NileDevice& device, const FrameSettings& settings)
+    : nileWindow{window},
+      nileDevice{device},
+      frameSettings{settings},
+      gpuProfiler{device} {
+  framePacer.setTargetFps(frameSettings.targetFps);
   recreateSwapChain();
   createCommandBuffers();
 }
@@ -25,21 +32,34 @@ void NileRenderer::recreateSwapChain() {
   vkDeviceWaitIdle(nileDevice.device());
 
   if (nileSwapChain == nullptr) {
-    nileSwapChain = std::make_unique<NileSwapChain>(nileDevice, extent);
+    nileSwapChain = std::make_unique<NileSwapChain>(
+        nileDevice, extent, frameSettings.presentMode, frameSettings.framesInFlight);
   } else {
     std::shared_ptr<NileSwapChain> oldSwapChain = std::move(nileSwapChain);
-    nileSwapChain = std::make_unique<NileSwapChain>(nileDevice, extent, oldSwapChain);
+    nileSwapChain = std::make_unique<NileSwapChain>(
+        nileDevice, extent, oldSwapChain, frameSettings.presentMode, frameSettings.framesInFlight);
     if (!oldSwapChain->compareSwapFormats(*nileSwapChain.get())) {
       throw std::runtime_error("Swap chain image(or depth) format has changed!");
     }
   }
+  // the new swap chain starts from its first fence, the device is idle so any frame can follow
+  currentFrameIndex = 0;
+  isSwapChainStale = false;
+  swapChainGeneration++;
 }
 
-void NileRenderer::createOffScreen() {
-    nileOffScreen = std::make_unique<NileOffScreen>(nileDevice);
+void NileRenderer::setFrameSettings(const FrameSettings& settings) {
+  assert(!isFrameStarted && "Can't change frame settings while frame is in progress");
+  if (settings.presentMode != frameSettings.presentMode ||
+      settings.framesInFlight != frameSettings.framesInFlight) {
+    isSwapChainStale = true;
+  }
+  frameSettings = settings;
+  framePacer.setTargetFps(settings.targetFps);
 }
 
 void NileRenderer::createCommandBuffers() {
+  // enough for any frames in flight setting, so changing it keeps the buffers
   commandBuffers.resize(NileSwapChain::MAX_FRAMES_IN_FLIGHT);
 
   VkCommandBufferAllocateInfo allocInfo{};
@@ -65,6 +85,13 @@ void NileRenderer::freeCommandBuffers() {
 
 VkCommandBuffer NileRenderer::beginFrame() {
   assert(!isFrameStarted && "Can't call beginFrame while already in progress");
+  NILE_PROFILE_ZONE("beginFrame");
+
+  if (isSwapChainStale) recreateSwapChain();
+  {
+    NILE_PROFILE_ZONE("frame pacing");
+    framePacer.wait();
+  }
 
   auto result = nileSwapChain->acquireNextImage(&currentImageIndex);
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -77,6 +104,7 @@ VkCommandBuffer NileRenderer::beginFrame() {
   }
 
   isFrameStarted = true;
+  if (nileDevice.isHeadless()) recordFrameTime();
 
   auto commandBuffer = getCurrentCommandBuffer();
   VkCommandBufferBeginInfo beginInfo{};
@@ -85,17 +113,37 @@ VkCommandBuffer NileRenderer::beginFrame() {
   if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
     throw std::runtime_error("failed to begin recording command buffer!");
   }
+
+  // secondary buffers kept across frames were recorded for the previous statistics query
+  const VkQueryPipelineStatisticFlags lastStatistics = activePass.pipelineStatistics;
+  gpuProfiler.beginFrame(commandBuffer, currentFrameIndex);
+  if (gpuProfiler.getPipelineStatisticFlags() != lastStatistics) swapChainGeneration++;
   return commandBuffer;
 }
 
 void NileRenderer::endFrame() {
   assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
+  NILE_PROFILE_ZONE("endFrame");
   auto commandBuffer = getCurrentCommandBuffer();
+  const auto &headless = nileWindow.getHeadless();
+  const uint32_t frame = nileWindow.getFramesRendered();
+  if (headless.enabled && !headless.captureDirectory.empty() &&
+      frame % std::max(headless.captureInterval, 1u) == 0) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/frame_%06u.ppm", frame);
+    nileSwapChain->recordReadback(
+        commandBuffer, currentImageIndex, headless.captureDirectory + name);
+  }
+  gpuProfiler.endFrame(commandBuffer);
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
     throw std::runtime_error("failed to record command buffer!");
   }
 
   auto result = nileSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+  isFrameStarted = false;
+  nileWindow.countFrame();
+  currentFrameIndex = (currentFrameIndex + 1) % nileSwapChain->getFramesInFlight();
+
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
       nileWindow.wasWindowResized()) {
     nileWindow.resetWindowResizedFlag();
@@ -103,16 +151,37 @@ void NileRenderer::endFrame() {
   } else if (result != VK_SUCCESS) {
     throw std::runtime_error("failed to present swap chain image!");
   }
+  NILE_PROFILE_FRAME();
+}
 
-  isFrameStarted = false;
-  currentFrameIndex = (currentFrameIndex + 1) % NileSwapChain::MAX_FRAMES_IN_FLIGHT;
+void NileRenderer::recordFrameTime() {
+  const auto now = std::chrono::steady_clock::now();
+  if (lastFrameBegin != std::chrono::steady_clock::time_point{}) {
+    frameTimesMs.push_back(
+        std::chrono::duration<float, std::milli>(now - lastFrameBegin).count());
+  }
+  lastFrameBegin = now;
+}
+
+NileRenderer::FrameTimeStats NileRenderer::getFrameTimeStats() const {
+  FrameTimeStats stats{};
+  if (frameTimesMs.empty()) return stats;
+
+  std::vector<float> sorted = frameTimesMs;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0.0;
+  for (float ms : sorted) total += ms;
+  stats.frames = static_cast<uint32_t>(sorted.size());
+  stats.averageMs = total / sorted.size();
+  stats.minMs = sorted.front();
+  stats.p99Ms = sorted[(sorted.size() - 1) * 99 / 100];
+  stats.maxMs = sorted.back();
+  return stats;
 }
 
-void NileRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void NileRenderer::beginSwapChainRenderPass(
+    VkCommandBuffer commandBuffer, VkSubpassContents contents, const std::string &name) {
   assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
-  assert(
-      commandBuffer == getCurrentCommandBuffer() &&
-      "Can't begin render pass on command buffer from a different frame");
 
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -126,65 +195,52 @@ void NileRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-  VkViewport viewport{};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = static_cast<float>(nileSwapChain->getSwapChainExtent().width);
-  viewport.height = static_cast<float>(nileSwapChain->getSwapChainExtent().height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-  VkRect2D scissor{{0, 0}, nileSwapChain->getSwapChainExtent()};
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+  beginRenderPass(commandBuffer, renderPassInfo, contents, name);
 }
 
 void NileRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
-  assert(
-      commandBuffer == getCurrentCommandBuffer() &&
-      "Can't end render pass on command buffer from a different frame");
-  vkCmdEndRenderPass(commandBuffer);
+  endRenderPass(commandBuffer);
 }
 
-void NileRenderer::beginOffScreenRenderPass(VkCommandBuffer commandBuffer) {
-  assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
+void NileRenderer::beginRenderPass(
+    VkCommandBuffer commandBuffer,
+    const VkRenderPassBeginInfo &beginInfo,
+    VkSubpassContents contents,
+    const std::string &name) {
+  assert(isFrameStarted && "Can't call beginRenderPass if frame is not in progress");
   assert(
       commandBuffer == getCurrentCommandBuffer() &&
       "Can't begin render pass on command buffer from a different frame");
-  VkRenderPassBeginInfo renderPassInfo{};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = nileOffScreen->offscreenPass.renderPass;
-  renderPassInfo.framebuffer = nileOffScreen->offscreenPass.frameBuffer;
-  renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent.width = nileOffScreen->offscreenPass.width;
-  renderPassInfo.renderArea.extent.height = nileOffScreen->offscreenPass.height;
-  clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-  clearValues[1].depthStencil = {1.0f, 0};
-  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-  renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  passScope = gpuProfiler.beginScope(commandBuffer, name);
+  vkCmdBeginRenderPass(commandBuffer, &beginInfo, contents);
+  activePass = {
+      beginInfo.renderPass, beginInfo.framebuffer, beginInfo.renderArea.extent, contents,
+      swapChainGeneration, gpuProfiler.getPipelineStatisticFlags()};
+  // secondary buffers set their own viewport and scissor
+  if (contents != VK_SUBPASS_CONTENTS_INLINE) return;
 
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = static_cast<float>(nileOffScreen->offscreenPass.width);
-  viewport.height = static_cast<float>(nileOffScreen->offscreenPass.height);
+  viewport.width = static_cast<float>(beginInfo.renderArea.extent.width);
+  viewport.height = static_cast<float>(beginInfo.renderArea.extent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
-  VkRect2D scissor{{0, 0}, {nileOffScreen->offscreenPass.width, nileOffScreen->offscreenPass.height}};
+  VkRect2D scissor{{0, 0}, beginInfo.renderArea.extent};
   vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
-void NileRenderer::endOffScreenRenderPass(VkCommandBuffer commandBuffer) {
-  assert(isFrameStarted && "Can't call endOffScreenRenderPass if frame is not in progress");
+void NileRenderer::endRenderPass(VkCommandBuffer commandBuffer) {
+  assert(isFrameStarted && "Can't call endRenderPass if frame is not in progress");
   assert(
       commandBuffer == getCurrentCommandBuffer() &&
       "Can't end render pass on command buffer from a different frame");
   vkCmdEndRenderPass(commandBuffer);
+  gpuProfiler.endScope(commandBuffer, passScope);
+  passScope = NileGpuProfiler::NO_SCOPE;
 }
 
 }  // namespace nile
@@ -1,34 +1,79 @@
 #pragma once
 
 #include "nile_device.hpp"
+#include "nile_frame_pacer.hpp"
+#include "nile_gpu_profiler.hpp"
 #include "nile_swap_chain.hpp"
-#include "nile_off_screen.hpp"
 #include "nile_window.hpp"
 
 // std
 #include <cassert>
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 #include <array>
 
 namespace nile{
 class NileRenderer {
  public:
-  NileRenderer(NileWindow &window, NileDevice &device);
+  // Latency against throughput, tuned per deployment without a rebuild
+  struct FrameSettings {
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    int framesInFlight = 2;  // clamped to 1 to NileSwapChain::MAX_FRAMES_IN_FLIGHT
+    float targetFps = 0.f;   // paced by NileFramePacer, 0 leaves it to the present mode
+  };
+
+  NileRenderer(NileWindow &window, NileDevice &device, const FrameSettings &settings = {});
   ~NileRenderer();
 
   NileRenderer(const NileRenderer &) = delete;
   NileRenderer &operator=(const NileRenderer &) = delete;
 
   VkRenderPass getSwapChainRenderPass() const { return nileSwapChain->getRenderPass(); }
-  VkRenderPass getOffScreenRenderPass() const { return nileOffScreen->getRenderPass(); }
-  VkDescriptorImageInfo getOffScreenImageInfo() const { return nileOffScreen->getImageInfo(); }
 
   float getAspectRatio() const { return nileSwapChain->extentAspectRatio(); }
+  VkExtent2D getSwapChainExtent() const { return nileSwapChain->getSwapChainExtent(); }
   bool isFrameInProgress() const { return isFrameStarted; }
   size_t getImageCount() const {return nileSwapChain->imageCount(); }
+  int getFramesInFlight() const { return nileSwapChain->getFramesInFlight(); }
+  VkPresentModeKHR getPresentMode() const { return nileSwapChain->getPresentMode(); }
+
+  // The pacer picks up the target right away. A new present mode or frames in flight count
+  // recreates the swap chain at the next beginFrame, outside of any frame.
+  void setFrameSettings(const FrameSettings &settings);
+  const FrameSettings &getFrameSettings() const { return frameSettings; }
+  const NileFramePacer::Stats &getPacingStats() const { return framePacer.getStats(); }
+
+  // Times every frame and render pass, hand it to FrameInfo::gpuProfiler for system scopes
+  NileGpuProfiler &getGpuProfiler() { return gpuProfiler; }
+
+  // Time from one beginFrame to the next, only recorded headless where runs are benchmarks
+  struct FrameTimeStats {
+    uint32_t frames = 0;
+    double averageMs = 0.0;
+    double minMs = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+  };
+  FrameTimeStats getFrameTimeStats() const;
 
   std::array<VkClearValue, 2> clearValues{};
+
+  // The pass begun by the last begin*RenderPass call, which secondary buffers recorded inside
+  // it inherit. generation changes whenever the swap chain is recreated or the inherited
+  // queries change, buffers that are kept across frames must be re-recorded then even if the
+  // render pass handle was reused.
+  struct ActivePass {
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+    uint32_t generation = 0;
+    // the gpu profiler's statistics query active around the pass
+    VkQueryPipelineStatisticFlags pipelineStatistics = 0;
+  };
+  const ActivePass &getActivePass() const { return activePass; }
   
   VkCommandBuffer getCurrentCommandBuffer() const {
     assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
@@ -41,27 +86,44 @@ class NileRenderer {
   }
 
   VkCommandBuffer beginFrame();
-  //void beginOffScreenRendering();
   void endFrame();
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+  // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass only takes vkCmdExecuteCommands,
+  // see NileCommandRecorder
+  void beginSwapChainRenderPass(
+      VkCommandBuffer commandBuffer,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE,
+      const std::string &name = "swap chain pass");
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
-  void beginOffScreenRenderPass(VkCommandBuffer commandBuffer);
-  void endOffScreenRenderPass(VkCommandBuffer commandBuffer);
+  // Any other pass, e.g. the offscreen passes of NileRenderGraph. The viewport and scissor cover
+  // the render area. The gpu profiler times the pass under name.
+  void beginRenderPass(
+      VkCommandBuffer commandBuffer,
+      const VkRenderPassBeginInfo &beginInfo,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE,
+      const std::string &name = "render pass");
+  void endRenderPass(VkCommandBuffer commandBuffer);
   VkImageView createImageView(const VkImage &textureImage, const VkFormat &format ) { return nileSwapChain->createImageView(textureImage, format); }
-  void createOffScreen();
-  
-  std::shared_ptr<NileOffScreen> nileOffScreen;
-  
+
  private:
   void createCommandBuffers();
   void freeCommandBuffers();
   void recreateSwapChain();
+  void recordFrameTime();
 
   NileWindow &nileWindow;
   NileDevice &nileDevice;
   std::unique_ptr<NileSwapChain> nileSwapChain;
   std::vector<VkCommandBuffer> commandBuffers;
+  FrameSettings frameSettings;
+  NileFramePacer framePacer{};
+  NileGpuProfiler gpuProfiler;
+  uint32_t passScope = NileGpuProfiler::NO_SCOPE;
+  bool isSwapChainStale = false;
 
+  ActivePass activePass{};
+  uint32_t swapChainGeneration = 0;
+  std::vector<float> frameTimesMs;
+  std::chrono::steady_clock::time_point lastFrameBegin{};
   uint32_t currentImageIndex;
   int currentFrameIndex{0};
   bool isFrameStarted{false};
@@ -0,0 +1,114 @@
+#include "nile_static_batch.hpp"
+
+#include "nile_command_recorder.hpp"
+#include "nile_frame_info.hpp"
+
+// std
+#include <stdexcept>
+
+namespace nile{
+
+NileStaticBatch::NileStaticBatch(NileDevice &device) : device{device} {
+  // buffers are re-recorded one at a time, the pool is never reset as a whole
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create static batch command pool!");
+  }
+  cachedBuffers.resize(NileSwapChain::MAX_FRAMES_IN_FLIGHT);
+}
+
+NileStaticBatch::~NileStaticBatch() {
+  vkDestroyCommandPool(device.device(), commandPool, nullptr);
+}
+
+bool NileStaticBatch::draw(FrameInfo &frameInfo, size_t key, const RecordFunc &func) {
+  const NileRenderer::ActivePass *pass =
+      frameInfo.commandRecorder != nullptr ? frameInfo.commandRecorder->getActivePass() : nullptr;
+  if (pass == nullptr) {
+    func(frameInfo.commandBuffer);
+    recordCount++;
+    return true;
+  }
+
+  CachedBuffer &cached = findBuffer(frameInfo.frameIndex, pass->renderPass, pass->generation);
+  const bool isStale = !cached.isValid || cached.key != key ||
+                       cached.extent.width != pass->extent.width ||
+                       cached.extent.height != pass->extent.height;
+  if (isStale) {
+    // the framebuffer is left out so the buffer works with every swap chain image
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = pass->renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+    inheritanceInfo.pipelineStatistics = pass->pipelineStatistics;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // the frame's fence was waited on, so its previous recording is no longer pending
+    if (vkBeginCommandBuffer(cached.commandBuffer, &beginInfo) != VK_SUCCESS) {
+      throw std::runtime_error("failed to begin recording static command buffer!");
+    }
+    NileCommandRecorder::setViewportAndScissor(cached.commandBuffer, pass->extent);
+    func(cached.commandBuffer);
+    if (vkEndCommandBuffer(cached.commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to record static command buffer!");
+    }
+
+    cached.extent = pass->extent;
+    cached.key = key;
+    cached.isValid = true;
+    recordCount++;
+  }
+
+  frameInfo.commandRecorder->execute(frameInfo, cached.commandBuffer);
+  return isStale;
+}
+
+void NileStaticBatch::invalidate() {
+  for (auto &frameBuffers : cachedBuffers) {
+    for (auto &cached : frameBuffers) cached.isValid = false;
+  }
+}
+
+NileStaticBatch::CachedBuffer &NileStaticBatch::findBuffer(
+    int frameIndex, VkRenderPass renderPass, uint32_t generation) {
+  auto &frameBuffers = cachedBuffers[frameIndex];
+  for (auto &cached : frameBuffers) {
+    if (cached.renderPass == renderPass && cached.generation == generation) return cached;
+  }
+
+  // buffers of passes from before the swap chain was recreated are free to take over
+  for (auto &cached : frameBuffers) {
+    if (cached.generation != generation) {
+      cached.renderPass = renderPass;
+      cached.generation = generation;
+      cached.isValid = false;
+      return cached;
+    }
+  }
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  allocInfo.commandPool = commandPool;
+  allocInfo.commandBufferCount = 1;
+
+  CachedBuffer cached{};
+  if (vkAllocateCommandBuffers(device.device(), &allocInfo, &cached.commandBuffer) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate static command buffer!");
+  }
+  cached.renderPass = renderPass;
+  cached.generation = generation;
+  frameBuffers.push_back(cached);
+  return frameBuffers.back();
+}
+
+}  // namespace nile
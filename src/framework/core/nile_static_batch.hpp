@@ -0,0 +1,63 @@
+#pragma once
+
+#include "nile_device.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace nile{
+
+struct FrameInfo;
+
+// Draws that are recorded once into a secondary command buffer and executed again every frame,
+// for geometry that doesn't change between frames. Every frame in flight keeps one buffer per
+// render pass the batch is drawn in. A buffer is re-recorded only when the caller's key changes,
+// or when its pass does, e.g. after the swap chain was recreated.
+//
+// The key must hash every handle and value the recorded commands use (descriptor sets, buffers,
+// push constants), since those are baked into the buffer. Caching needs frameInfo's command
+// recorder to be inside a pass, otherwise the draws are recorded inline every frame.
+class NileStaticBatch {
+ public:
+  using RecordFunc = std::function<void(VkCommandBuffer commandBuffer)>;
+
+  NileStaticBatch(NileDevice &device);
+  ~NileStaticBatch();
+
+  NileStaticBatch(const NileStaticBatch &) = delete;
+  NileStaticBatch &operator=(const NileStaticBatch &) = delete;
+
+  // Executes this frame's buffer for the current pass, calling func to record it first when it
+  // is missing or stale. Returns whether func was called. Call at most once per pass and frame,
+  // from the thread recording the pass.
+  bool draw(FrameInfo &frameInfo, size_t key, const RecordFunc &func);
+
+  // Every buffer is re-recorded the next time it is drawn
+  void invalidate();
+
+  // times func was called since construction
+  uint32_t getRecordCount() const { return recordCount; }
+
+ private:
+  struct CachedBuffer {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    uint32_t generation = 0;
+    size_t key = 0;
+    bool isValid = false;
+  };
+
+  CachedBuffer &findBuffer(int frameIndex, VkRenderPass renderPass, uint32_t generation);
+
+  NileDevice &device;
+  VkCommandPool commandPool = VK_NULL_HANDLE;
+  // indexed by frame, then one per render pass
+  std::vector<std::vector<CachedBuffer>> cachedBuffers;
+  uint32_t recordCount = 0;
+};
+
+}  // namespace nile
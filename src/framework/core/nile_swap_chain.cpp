@@ -1,9 +1,14 @@
 #include "nile_swap_chain.hpp"
 
+#include "nile_profiler.hpp"
+
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <limits>
 #include <set>
@@ -11,20 +16,37 @@
 
 namespace nile{
 
-NileSwapChain::NileSwapChain(NileDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+NileSwapChain::NileSwapChain(
+    NileDevice &deviceRef, VkExtent2D extent, VkPresentModeKHR presentMode, int framesInFlight)
+    : device{deviceRef},
+      windowExtent{extent},
+      framesInFlight{std::clamp(framesInFlight, 1, MAX_FRAMES_IN_FLIGHT)},
+      presentMode{presentMode} {
   init();
 }
 
 NileSwapChain::NileSwapChain(
-    NileDevice &deviceRef, VkExtent2D extent, std::shared_ptr<NileSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+    NileDevice &deviceRef,
+    VkExtent2D extent,
+    std::shared_ptr<NileSwapChain> previous,
+    VkPresentModeKHR presentMode,
+    int framesInFlight)
+    : device{deviceRef},
+      windowExtent{extent},
+      oldSwapChain{previous},
+      framesInFlight{std::clamp(framesInFlight, 1, MAX_FRAMES_IN_FLIGHT)},
+      presentMode{presentMode} {
   init();
   oldSwapChain = nullptr;
 }
 
 void NileSwapChain::init() {
-  createSwapChain();
+  if (device.isHeadless()) {
+    presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    createOffscreenImages();
+  } else {
+    createSwapChain();
+  }
   createImageViews();
   createRenderPass();
   createDepthResources();
@@ -33,11 +55,23 @@ void NileSwapChain::init() {
 }
 
 NileSwapChain::~NileSwapChain() {
+  // frames still being rendered finish their captures
+  for (size_t i = 0; i < readbacks.size(); i++) {
+    if (readbacks[i].path.empty()) continue;
+    vkWaitForFences(device.device(), 1, &inFlightFences[i], VK_TRUE, UINT64_MAX);
+    writeReadback(i);
+  }
+
   for (auto imageView : swapChainImageViews) {
     vkDestroyImageView(device.device(), imageView, nullptr);
   }
   swapChainImageViews.clear();
 
+  for (size_t i = 0; i < offscreenImageMemorys.size(); i++) {
+    vkDestroyImage(device.device(), swapChainImages[i], nullptr);
+    vkFreeMemory(device.device(), offscreenImageMemorys[i], nullptr);
+  }
+
   if (swapChain != nullptr) {
     vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
     swapChain = nullptr;
@@ -56,7 +90,7 @@ NileSwapChain::~NileSwapChain() {
   vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
   // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
     vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
     vkDestroyFence(device.device(), inFlightFences[i], nullptr);
@@ -66,13 +100,25 @@ NileSwapChain::~NileSwapChain() {
 }
 
 VkResult NileSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-      device.device(),
-      1,
-      &inFlightFences[currentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max());
+  {
+    NILE_PROFILE_ZONE("wait for frame fence");
+    vkWaitForFences(
+        device.device(),
+        1,
+        &inFlightFences[currentFrame],
+        VK_TRUE,
+        std::numeric_limits<uint64_t>::max());
+  }
 
+  // there are at least as many images as frames in flight, so the fence also covers the image
+  if (device.isHeadless()) {
+    if (!readbacks[currentFrame].path.empty()) writeReadback(currentFrame);
+    *imageIndex = nextImage;
+    nextImage = (nextImage + 1) % static_cast<uint32_t>(imageCount());
+    return VK_SUCCESS;
+  }
+
+  NILE_PROFILE_ZONE("vkAcquireNextImageKHR");
   VkResult result = vkAcquireNextImageKHR(
       device.device(),
       swapChain,
@@ -85,7 +131,24 @@ VkResult NileSwapChain::acquireNextImage(uint32_t *imageIndex) {
 }
 
 VkResult NileSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+  if (device.isHeadless()) {
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = buffers;
+
+    NILE_PROFILE_ZONE("vkQueueSubmit");
+    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    return VK_SUCCESS;
+  }
+
   if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
+    NILE_PROFILE_ZONE("wait for image fence");
     vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
   }
   imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
@@ -107,9 +170,12 @@ VkResult NileSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uin
   submitInfo.pSignalSemaphores = signalSemaphores;
 
   vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
+  {
+    NILE_PROFILE_ZONE("vkQueueSubmit");
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
   }
 
   VkPresentInfoKHR presentInfo = {};
@@ -124,9 +190,13 @@ VkResult NileSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uin
 
   presentInfo.pImageIndices = imageIndex;
 
-  auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+  VkResult result;
+  {
+    NILE_PROFILE_ZONE("vkQueuePresentKHR");
+    result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+  }
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  currentFrame = (currentFrame + 1) % framesInFlight;
 
   return result;
 }
@@ -135,7 +205,7 @@ void NileSwapChain::createSwapChain() {
   SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
   VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-  VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+  presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, presentMode);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
   uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -192,6 +262,110 @@ void NileSwapChain::createSwapChain() {
   swapChainExtent = extent;
 }
 
+void NileSwapChain::createOffscreenImages() {
+  swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+  swapChainExtent = windowExtent;
+
+  // ImGui's vulkan backend wants at least two images
+  const size_t imageCount = std::max(framesInFlight, 2);
+  swapChainImages.resize(imageCount);
+  offscreenImageMemorys.resize(imageCount);
+  for (size_t i = 0; i < imageCount; i++) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {swapChainExtent.width, swapChainExtent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = swapChainImageFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    device.createImageWithInfo(
+        imageInfo,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        swapChainImages[i],
+        offscreenImageMemorys[i]);
+  }
+  readbacks.resize(framesInFlight);
+}
+
+void NileSwapChain::recordReadback(
+    VkCommandBuffer commandBuffer, uint32_t imageIndex, std::string path) {
+  assert(device.isHeadless() && "Only offscreen images are read back");
+  auto &readback = readbacks[currentFrame];
+  assert(readback.path.empty() && "The frame's last readback was not written yet");
+  if (readback.buffer == nullptr) {
+    readback.buffer = std::make_unique<NileBuffer>(
+        device,
+        4,
+        swapChainExtent.width * swapChainExtent.height,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    readback.buffer->map();
+  }
+
+  // the render pass leaves the image in TRANSFER_SRC_OPTIMAL, its outgoing dependency makes
+  // the color writes visible to the copy
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+  vkCmdCopyImageToBuffer(
+      commandBuffer,
+      swapChainImages[imageIndex],
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      readback.buffer->getBuffer(),
+      1,
+      &region);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = readback.buffer->getBuffer();
+  barrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      0,
+      nullptr,
+      1,
+      &barrier,
+      0,
+      nullptr);
+  readback.path = std::move(path);
+}
+
+void NileSwapChain::writeReadback(size_t frame) {
+  auto &readback = readbacks[frame];
+  readback.buffer->invalidate();
+
+  std::ofstream file{readback.path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error("failed to open " + readback.path + " for writing!");
+  }
+  file << "P6\n" << swapChainExtent.width << " " << swapChainExtent.height << "\n255\n";
+  // rgba to rgb
+  const auto *pixels = static_cast<const uint8_t *>(readback.buffer->getMappedMemory());
+  const size_t pixelCount = size_t{swapChainExtent.width} * swapChainExtent.height;
+  std::vector<uint8_t> rgb(pixelCount * 3);
+  for (size_t i = 0; i < pixelCount; i++) {
+    rgb[i * 3] = pixels[i * 4];
+    rgb[i * 3 + 1] = pixels[i * 4 + 1];
+    rgb[i * 3 + 2] = pixels[i * 4 + 2];
+  }
+  file.write(reinterpret_cast<const char *>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+  readback.path.clear();
+}
+
 void NileSwapChain::createImageViews() {
   swapChainImageViews.resize(swapChainImages.size());
   for (uint32_t i = 0; i < swapChainImages.size(); i++) {
@@ -241,7 +415,9 @@ void NileSwapChain::createRenderPass() {
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  // headless frames may be copied out for a readback instead of being presented
+  colorAttachment.finalLayout = device.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                                    : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
   VkAttachmentReference colorAttachmentRef = {};
   colorAttachmentRef.attachment = 0;
@@ -264,6 +440,15 @@ void NileSwapChain::createRenderPass() {
   dependency.srcStageMask =
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 
+  VkSubpassDependency readbackDependency = {};
+  readbackDependency.srcSubpass = 0;
+  readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+  readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  std::array<VkSubpassDependency, 2> dependencies = {dependency, readbackDependency};
+
   std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
   VkRenderPassCreateInfo renderPassInfo = {};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -271,8 +456,8 @@ void NileSwapChain::createRenderPass() {
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.dependencyCount = device.isHeadless() ? 2 : 1;
+  renderPassInfo.pDependencies = dependencies.data();
 
   if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
@@ -354,9 +539,9 @@ void NileSwapChain::createDepthResources() {
 }
 
 void NileSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+  imageAvailableSemaphores.resize(framesInFlight);
+  renderFinishedSemaphores.resize(framesInFlight);
+  inFlightFences.resize(framesInFlight);
   imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -366,7 +551,7 @@ void NileSwapChain::createSyncObjects() {
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
     if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
@@ -390,21 +575,19 @@ VkSurfaceFormatKHR NileSwapChain::chooseSwapSurfaceFormat(
 }
 
 VkPresentModeKHR NileSwapChain::chooseSwapPresentMode(
-    const std::vector<VkPresentModeKHR> &availablePresentModes) {
+    const std::vector<VkPresentModeKHR> &availablePresentModes, VkPresentModeKHR requestedMode) {
   for (const auto &availablePresentMode : availablePresentModes) {
+    if (availablePresentMode != requestedMode) continue;
     if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
       std::cout << "Present mode: Mailbox" << std::endl;
       return availablePresentMode;
     }
+    if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+      std::cout << "Present mode: Immediate" << std::endl;
+      return availablePresentMode;
+    }
   }
 
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     std::cout << "Present mode: Immediate" << std::endl;
-  //     return availablePresentMode;
-  //   }
-  // }
-
   std::cout << "Present mode: V-Sync" << std::endl;
   return VK_PRESENT_MODE_FIFO_KHR;
 }
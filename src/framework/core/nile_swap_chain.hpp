@@ -1,5 +1,6 @@
 #pragma once
 
+#include "nile_buffer.hpp"
 #include "nile_device.hpp"
 
 // vulkan headers
@@ -14,11 +15,22 @@ namespace nile{
 
 class NileSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+  // Per frame resources are sized for this many frames, the count actually in flight is picked
+  // at runtime up to it
+  static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
 
-  NileSwapChain(NileDevice &deviceRef, VkExtent2D windowExtent);
+  // presentMode falls back to FIFO, which every surface supports, when it isn't available
   NileSwapChain(
-      NileDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<NileSwapChain> previous);
+      NileDevice &deviceRef,
+      VkExtent2D windowExtent,
+      VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR,
+      int framesInFlight = 2);
+  NileSwapChain(
+      NileDevice &deviceRef,
+      VkExtent2D windowExtent,
+      std::shared_ptr<NileSwapChain> previous,
+      VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR,
+      int framesInFlight = 2);
 
    ~NileSwapChain();
 
@@ -34,6 +46,11 @@ class NileSwapChain {
   uint32_t width() { return swapChainExtent.width; }
   uint32_t height() { return swapChainExtent.height; }
 
+  // clamped to 1 to MAX_FRAMES_IN_FLIGHT
+  int getFramesInFlight() const { return framesInFlight; }
+  // the mode in use, FIFO if the requested one wasn't supported, FIFO as well when headless
+  VkPresentModeKHR getPresentMode() const { return presentMode; }
+
   float extentAspectRatio() {
     return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
   }
@@ -42,6 +59,11 @@ class NileSwapChain {
   VkResult acquireNextImage(uint32_t *imageIndex);
    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
 
+  // Headless only. Records a copy of the image into the frame's readback buffer, which is
+  // written to path as a binary ppm once the frame's fence is next waited on, so reading
+  // frames back never stalls the frame that renders them.
+  void recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex, std::string path);
+
    VkImageView createImageView(VkImage image, VkFormat format);
 
   void createImageInfo(VkImageCreateInfo imageInfo, 
@@ -58,6 +80,8 @@ class NileSwapChain {
 
  private:
   void createSwapChain();
+  void createOffscreenImages();
+  void writeReadback(size_t frame);
    void createImageViews();
   void createTextureImageView();
    void createDepthResources();
@@ -70,7 +94,8 @@ private:
   VkSurfaceFormatKHR chooseSwapSurfaceFormat(
       const std::vector<VkSurfaceFormatKHR> &availableFormats);
   VkPresentModeKHR chooseSwapPresentMode(
-      const std::vector<VkPresentModeKHR> &availablePresentModes);
+      const std::vector<VkPresentModeKHR> &availablePresentModes,
+      VkPresentModeKHR requestedMode);
   VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
 
   VkImageView imageView;
@@ -96,9 +121,20 @@ private:
   NileDevice &device;
   VkExtent2D windowExtent;
 
-  VkSwapchainKHR swapChain;
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
   std::shared_ptr<NileSwapChain> oldSwapChain;
 
+  // headless, the images swapChainImages holds instead of the swap chain's
+  std::vector<VkDeviceMemory> offscreenImageMemorys;
+  struct Readback {
+    std::unique_ptr<NileBuffer> buffer;
+    std::string path{};  // empty when nothing is pending
+  };
+  std::vector<Readback> readbacks;  // one per frame in flight
+  uint32_t nextImage = 0;
+  int framesInFlight;
+  VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
   std::vector<VkFence> inFlightFences;
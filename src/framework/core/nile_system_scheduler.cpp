@@ -0,0 +1,186 @@
+#include "nile_system_scheduler.hpp"
+
+#include "nile_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <thread>
+
+namespace nile{
+
+NileSystemScheduler::SystemBuilder &NileSystemScheduler::SystemBuilder::readsResource(
+    const std::string &name) {
+  scheduler.addAccess(index, scheduler.resourceId(name), false);
+  return *this;
+}
+
+NileSystemScheduler::SystemBuilder &NileSystemScheduler::SystemBuilder::writesResource(
+    const std::string &name) {
+  scheduler.addAccess(index, scheduler.resourceId(name), true);
+  return *this;
+}
+
+NileSystemScheduler::SystemBuilder &NileSystemScheduler::SystemBuilder::mainThread() {
+  scheduler.systems[index].onMainThread = true;
+  return *this;
+}
+
+NileSystemScheduler::SystemBuilder &NileSystemScheduler::SystemBuilder::exclusive() {
+  scheduler.systems[index].isExclusive = true;
+  scheduler.graphDirty = true;
+  return *this;
+}
+
+NileSystemScheduler::NileSystemScheduler(
+    NileGameObjectManager &gameObjectManager, NileJobSystem &jobSystem)
+    : gameObjectManager{gameObjectManager}, jobSystem{jobSystem} {}
+
+NileSystemScheduler::SystemBuilder NileSystemScheduler::addSystem(
+    const std::string &name, SystemFunc func) {
+  System system{};
+  system.name = name;
+  system.func = std::move(func);
+  systems.push_back(std::move(system));
+  graphDirty = true;
+  return SystemBuilder{*this, systems.size() - 1};
+}
+
+void NileSystemScheduler::addAccess(size_t index, size_t id, bool write) {
+  auto &ids = write ? systems[index].writeIds : systems[index].readIds;
+  if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+    ids.push_back(id);
+  }
+  graphDirty = true;
+}
+
+size_t NileSystemScheduler::resourceId(const std::string &name) {
+  auto it = std::find(resourceNames.begin(), resourceNames.end(), name);
+  if (it == resourceNames.end()) {
+    resourceNames.push_back(name);
+    return RESOURCE_ID_BASE + resourceNames.size() - 1;
+  }
+  return RESOURCE_ID_BASE + static_cast<size_t>(it - resourceNames.begin());
+}
+
+bool NileSystemScheduler::conflicts(const System &a, const System &b) const {
+  if (a.isExclusive || b.isExclusive) return true;
+
+  auto overlaps = [](const std::vector<size_t> &x, const std::vector<size_t> &y) {
+    for (size_t id : x) {
+      if (std::find(y.begin(), y.end(), id) != y.end()) return true;
+    }
+    return false;
+  };
+  return overlaps(a.writeIds, b.writeIds) || overlaps(a.writeIds, b.readIds) ||
+         overlaps(a.readIds, b.writeIds);
+}
+
+void NileSystemScheduler::buildGraph() {
+  for (auto &system : systems) {
+    system.successors.clear();
+    system.dependencyCount = 0;
+
+    system.access.reads.clear();
+    system.access.writes.clear();
+    for (size_t id : system.readIds) {
+      if (id < RESOURCE_ID_BASE) system.access.reads.push_back(id);
+    }
+    for (size_t id : system.writeIds) {
+      if (id < RESOURCE_ID_BASE) system.access.writes.push_back(id);
+    }
+  }
+
+  // a later system waits for every earlier one it conflicts with
+  for (size_t later = 0; later < systems.size(); later++) {
+    for (size_t earlier = 0; earlier < later; earlier++) {
+      if (conflicts(systems[earlier], systems[later])) {
+        systems[earlier].successors.push_back(later);
+        systems[later].dependencyCount++;
+      }
+    }
+  }
+
+  pendingDependencies = std::make_unique<std::atomic<uint32_t>[]>(systems.size());
+  graphDirty = false;
+}
+
+std::vector<std::vector<std::string>> NileSystemScheduler::getStages() {
+  if (graphDirty) buildGraph();
+
+  // longest path from a root, systems are added in topological order already
+  std::vector<size_t> stage(systems.size(), 0);
+  std::vector<std::vector<std::string>> stages;
+  for (size_t i = 0; i < systems.size(); i++) {
+    for (size_t successor : systems[i].successors) {
+      stage[successor] = std::max(stage[successor], stage[i] + 1);
+    }
+    if (stage[i] >= stages.size()) stages.resize(stage[i] + 1);
+    stages[stage[i]].push_back(systems[i].name);
+  }
+  return stages;
+}
+
+void NileSystemScheduler::run(FrameInfo &frameInfo) {
+  if (graphDirty) buildGraph();
+  if (systems.empty()) return;
+
+  remainingSystems.store(static_cast<uint32_t>(systems.size()), std::memory_order_relaxed);
+  for (size_t i = 0; i < systems.size(); i++) {
+    pendingDependencies[i].store(systems[i].dependencyCount, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < systems.size(); i++) {
+    if (systems[i].dependencyCount == 0) dispatch(i, frameInfo);
+  }
+
+  // run main thread systems as they become ready and help the workers in between
+  while (remainingSystems.load(std::memory_order_acquire) > 0) {
+    size_t next = systems.size();
+    {
+      std::lock_guard<std::mutex> lock(mainThreadMutex);
+      auto it = std::min_element(mainThreadReady.begin(), mainThreadReady.end());
+      if (it != mainThreadReady.end()) {
+        next = *it;
+        mainThreadReady.erase(it);
+      }
+    }
+    if (next < systems.size()) {
+      execute(next, frameInfo);
+    } else if (!jobSystem.runPendingJob()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void NileSystemScheduler::dispatch(size_t index, FrameInfo &frameInfo) {
+  if (systems[index].onMainThread) {
+    std::lock_guard<std::mutex> lock(mainThreadMutex);
+    mainThreadReady.push_back(index);
+    return;
+  }
+  jobSystem.submit([this, index, &frameInfo]() { execute(index, frameInfo); });
+}
+
+void NileSystemScheduler::execute(size_t index, FrameInfo &frameInfo) {
+  auto &system = systems[index];
+
+  // a thread can pick up another system while it helps out inside a wait
+  const NileComponentAccess *previousAccess = currentComponentAccess;
+#ifndef NDEBUG
+  currentComponentAccess = &system.access;
+#endif
+  {
+    NILE_PROFILE_ZONE(system.name.c_str());
+    system.func(frameInfo);
+  }
+  currentComponentAccess = previousAccess;
+
+  for (size_t successor : system.successors) {
+    if (pendingDependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      dispatch(successor, frameInfo);
+    }
+  }
+  // last, run() may return as soon as this reaches zero
+  remainingSystems.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+}  // namespace nile
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "nile_component_store.hpp"
+#include "nile_frame_info.hpp"
+#include "nile_game_object.hpp"
+#include "nile_job_system.hpp"
+
+// std
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nile{
+
+// Runs a frame's systems from what they declare to read and write instead of a hand written
+// order. Two systems conflict when one writes a component type or resource the other reads or
+// writes; conflicting systems run in the order they were added, everything else may run in
+// parallel on the job system.
+//
+//   scheduler.addSystem("point lights", [&](FrameInfo &frameInfo) { ... })
+//       .reads<PointLightComponent>()
+//       .writes<TransformComponent>()
+//       .writesResource("global ubo");
+//
+// In debug builds a system touching a component pool it did not declare asserts. So does a
+// system writing a type it only declared reads of: reads go through pool<const T>() and
+// view<const T>(), pool<T>() and view<T>() count as writes. Undeclared writes are caught
+// before they can race. Pools must not be touched from parallelFor bodies inside a system,
+// resolve components before splitting the work.
+class NileSystemScheduler {
+ public:
+  using SystemFunc = std::function<void(FrameInfo &)>;
+
+  class SystemBuilder {
+   public:
+    SystemBuilder(NileSystemScheduler &scheduler, size_t index)
+        : scheduler{scheduler}, index{index} {}
+
+    template <typename... Ts>
+    SystemBuilder &reads() {
+      (addComponent<Ts>(false), ...);
+      return *this;
+    }
+    template <typename... Ts>
+    SystemBuilder &writes() {
+      (addComponent<Ts>(true), ...);
+      return *this;
+    }
+
+    // Shared state that is not a component, e.g. the global ubo or the frame's command buffer
+    SystemBuilder &readsResource(const std::string &name);
+    SystemBuilder &writesResource(const std::string &name);
+
+    // Runs on the thread that calls run(), for systems that record commands or use GLFW/ImGui
+    SystemBuilder &mainThread();
+
+    // Runs alone, for systems that create or destroy game objects
+    SystemBuilder &exclusive();
+
+   private:
+    template <typename T>
+    void addComponent(bool write) {
+      // create the pool now, systems running in parallel must not be the first to touch it
+      scheduler.gameObjectManager.pool<T>();
+      scheduler.addAccess(index, NileComponentStore::typeIndex<T>(), write);
+    }
+
+    NileSystemScheduler &scheduler;
+    size_t index;
+  };
+
+  NileSystemScheduler(NileGameObjectManager &gameObjectManager, NileJobSystem &jobSystem);
+
+  NileSystemScheduler(const NileSystemScheduler &) = delete;
+  NileSystemScheduler &operator=(const NileSystemScheduler &) = delete;
+
+  SystemBuilder addSystem(const std::string &name, SystemFunc func);
+
+  // Runs every system once and returns when all of them have finished
+  void run(FrameInfo &frameInfo);
+
+  // Groups of systems that have no conflicts with each other, in dependency order
+  std::vector<std::vector<std::string>> getStages();
+
+ private:
+  // resources live after the component type indices so both fit one id space
+  static constexpr size_t RESOURCE_ID_BASE = size_t{1} << 20;
+
+  struct System {
+    std::string name;
+    SystemFunc func;
+    std::vector<size_t> readIds;
+    std::vector<size_t> writeIds;
+    bool onMainThread = false;
+    bool isExclusive = false;
+
+    // filled by buildGraph
+    std::vector<size_t> successors;
+    uint32_t dependencyCount = 0;
+    NileComponentAccess access;
+  };
+
+  void addAccess(size_t index, size_t id, bool write);
+  size_t resourceId(const std::string &name);
+  bool conflicts(const System &a, const System &b) const;
+  void buildGraph();
+  void dispatch(size_t index, FrameInfo &frameInfo);
+  void execute(size_t index, FrameInfo &frameInfo);
+
+  NileGameObjectManager &gameObjectManager;
+  NileJobSystem &jobSystem;
+
+  std::vector<System> systems;
+  std::vector<std::string> resourceNames;
+  bool graphDirty = true;
+
+  // per run state
+  std::unique_ptr<std::atomic<uint32_t>[]> pendingDependencies;
+  std::atomic<uint32_t> remainingSystems{0};
+  std::mutex mainThreadMutex;
+  std::vector<size_t> mainThreadReady;
+};
+
+}  // namespace nile
@@ -105,6 +105,8 @@ namespace nile{
 }
 
 NileTexture::~NileTexture() {
+    mDevice.retireHandle((uint64_t)(mTextureSampler));
+    mDevice.retireHandle((uint64_t)(mTextureImageView));
     vkDestroySampler(mDevice.device(), mTextureSampler, nullptr);
     vkDestroyImageView(mDevice.device(), mTextureImageView, nullptr);
     vkDestroyImage(mDevice.device(), mTextureImage, nullptr);
@@ -0,0 +1,229 @@
+#include "nile_transform_batch.hpp"
+
+// std
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NILE_TRANSFORM_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NILE_TRANSFORM_SSE
+#endif
+
+namespace nile{
+
+namespace {
+
+// Thin wrappers so the kernel below is written once for both vector widths
+#if defined(NILE_TRANSFORM_AVX)
+constexpr size_t kLanes = 8;
+using vfloat = __m256;
+inline vfloat vset(float v) { return _mm256_set1_ps(v); }
+inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+inline void vstore(float *p, vfloat v) { _mm256_storeu_ps(p, v); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+inline vfloat vandnot(vfloat a, vfloat b) { return _mm256_andnot_ps(a, b); }
+inline vfloat vor(vfloat a, vfloat b) { return _mm256_or_ps(a, b); }
+inline vfloat vxor(vfloat a, vfloat b) { return _mm256_xor_ps(a, b); }
+inline vfloat vround(vfloat a) {
+  return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+inline vfloat vfloor(vfloat a) { return _mm256_floor_ps(a); }
+inline vfloat vcmpeq(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline vfloat vcmpge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+#elif defined(NILE_TRANSFORM_SSE)
+constexpr size_t kLanes = 4;
+using vfloat = __m128;
+inline vfloat vset(float v) { return _mm_set1_ps(v); }
+inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+inline void vstore(float *p, vfloat v) { _mm_storeu_ps(p, v); }
+inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat vdiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+inline vfloat vandnot(vfloat a, vfloat b) { return _mm_andnot_ps(a, b); }
+inline vfloat vor(vfloat a, vfloat b) { return _mm_or_ps(a, b); }
+inline vfloat vxor(vfloat a, vfloat b) { return _mm_xor_ps(a, b); }
+// SSE2 has no round/floor instructions, go through int conversion instead
+inline vfloat vround(vfloat a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+inline vfloat vfloor(vfloat a) {
+  vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+  return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.f)));
+}
+inline vfloat vcmpeq(vfloat a, vfloat b) { return _mm_cmpeq_ps(a, b); }
+inline vfloat vcmpge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+#else
+constexpr size_t kLanes = 1;
+#endif
+
+#if defined(NILE_TRANSFORM_AVX) || defined(NILE_TRANSFORM_SSE)
+inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return vor(vand(mask, a), vandnot(mask, b)); }
+
+// sin and cos of every lane. Cody-Waite reduction to [-pi/4, pi/4] around the nearest multiple
+// of pi/2 followed by the cephes sinf/cosf minimax polynomials, roughly 1 ulp for |x| < 8192.
+inline void vsincos(vfloat x, vfloat &outSin, vfloat &outCos) {
+  const vfloat quadrant = vround(vmul(x, vset(0.63661977236f)));  // x * 2/pi
+
+  vfloat r = vsub(x, vmul(quadrant, vset(1.5703125f)));
+  r = vsub(r, vmul(quadrant, vset(4.837512969970703125e-4f)));
+  r = vsub(r, vmul(quadrant, vset(7.54978995489188216e-8f)));
+  const vfloat r2 = vmul(r, r);
+
+  vfloat s = vset(-1.9515295891e-4f);
+  s = vadd(vmul(s, r2), vset(8.3321608736e-3f));
+  s = vadd(vmul(s, r2), vset(-1.6666654611e-1f));
+  s = vadd(vmul(vmul(s, r2), r), r);
+
+  vfloat c = vset(2.443315711809948e-5f);
+  c = vadd(vmul(c, r2), vset(-1.388731625493765e-3f));
+  c = vadd(vmul(c, r2), vset(4.166664568298827e-2f));
+  c = vadd(vmul(vmul(c, r2), r2), vsub(vset(1.f), vmul(r2, vset(0.5f))));
+
+  // quadrant mod 4 selects which polynomial and sign each output takes
+  const vfloat k = vsub(quadrant, vmul(vfloor(vmul(quadrant, vset(0.25f))), vset(4.f)));
+  const vfloat odd = vor(vcmpeq(k, vset(1.f)), vcmpeq(k, vset(3.f)));
+  const vfloat signBit = vset(-0.f);
+  const vfloat sinNegative = vand(vcmpge(k, vset(2.f)), signBit);
+  const vfloat cosNegative = vand(vor(vcmpeq(k, vset(1.f)), vcmpeq(k, vset(2.f))), signBit);
+
+  outSin = vxor(vselect(odd, c, s), sinNegative);
+  outCos = vxor(vselect(odd, s, c), cosNegative);
+}
+#endif
+
+}  // namespace
+
+const size_t NileTransformBatch::LANES = kLanes;
+
+void NileTransformBatch::clear() {
+  for (auto *v : {&translationX, &translationY, &translationZ, &rotationX, &rotationY,
+                  &rotationZ, &scaleX, &scaleY, &scaleZ}) {
+    v->clear();
+  }
+}
+
+void NileTransformBatch::reserve(size_t count) {
+  for (auto *v : {&translationX, &translationY, &translationZ, &rotationX, &rotationY,
+                  &rotationZ, &scaleX, &scaleY, &scaleZ}) {
+    v->reserve(count);
+  }
+}
+
+void NileTransformBatch::push(
+    const glm::vec3 &translation, const glm::vec3 &rotation, const glm::vec3 &scale) {
+  translationX.push_back(translation.x);
+  translationY.push_back(translation.y);
+  translationZ.push_back(translation.z);
+  rotationX.push_back(rotation.x);
+  rotationY.push_back(rotation.y);
+  rotationZ.push_back(rotation.z);
+  scaleX.push_back(scale.x);
+  scaleY.push_back(scale.y);
+  scaleZ.push_back(scale.z);
+}
+
+void NileTransformBatch::computeMatrices(
+    const glm::vec3 &translation,
+    const glm::vec3 &rotation,
+    const glm::vec3 &scale,
+    glm::mat4 &modelMatrix,
+    glm::mat4 &normalMatrix) {
+  // Translate * Ry * Rx * Rz * Scale, see TransformComponent::mat4()
+  const float c3 = std::cos(rotation.z);
+  const float s3 = std::sin(rotation.z);
+  const float c2 = std::cos(rotation.x);
+  const float s2 = std::sin(rotation.x);
+  const float c1 = std::cos(rotation.y);
+  const float s1 = std::sin(rotation.y);
+
+  const glm::vec3 r0{c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1};
+  const glm::vec3 r1{c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3};
+  const glm::vec3 r2{c2 * s1, -s2, c1 * c2};
+  const glm::vec3 invScale = 1.0f / scale;
+
+  modelMatrix = glm::mat4{
+      glm::vec4{scale.x * r0, 0.0f},
+      glm::vec4{scale.y * r1, 0.0f},
+      glm::vec4{scale.z * r2, 0.0f},
+      glm::vec4{translation, 1.0f}};
+  normalMatrix = glm::mat4{
+      glm::vec4{invScale.x * r0, 0.0f},
+      glm::vec4{invScale.y * r1, 0.0f},
+      glm::vec4{invScale.z * r2, 0.0f},
+      glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
+}
+
+void NileTransformBatch::computeMatrices(
+    glm::mat4 *modelMatrices, glm::mat4 *normalMatrices) const {
+  const size_t count = size();
+  size_t i = 0;
+
+#if defined(NILE_TRANSFORM_AVX) || defined(NILE_TRANSFORM_SSE)
+  // per lane results, written out to the column major matrices after each iteration
+  alignas(32) float model[12][kLanes];
+  alignas(32) float normal[9][kLanes];
+
+  for (; i + kLanes <= count; i += kLanes) {
+    vfloat s1, c1, s2, c2, s3, c3;
+    vsincos(vload(&rotationY[i]), s1, c1);
+    vsincos(vload(&rotationX[i]), s2, c2);
+    vsincos(vload(&rotationZ[i]), s3, c3);
+
+    const vfloat s2s3 = vmul(s2, s3);
+    const vfloat c3s2 = vmul(c3, s2);
+    const vfloat rot[9] = {
+        vadd(vmul(c1, c3), vmul(s1, s2s3)),
+        vmul(c2, s3),
+        vsub(vmul(c1, s2s3), vmul(c3, s1)),
+        vsub(vmul(s1, c3s2), vmul(c1, s3)),
+        vmul(c2, c3),
+        vadd(vmul(c1, c3s2), vmul(s1, s3)),
+        vmul(c2, s1),
+        vxor(s2, vset(-0.f)),
+        vmul(c1, c2)};
+
+    const vfloat one = vset(1.f);
+    const vfloat scale[3] = {vload(&scaleX[i]), vload(&scaleY[i]), vload(&scaleZ[i])};
+    const vfloat invScale[3] = {vdiv(one, scale[0]), vdiv(one, scale[1]), vdiv(one, scale[2])};
+    for (int col = 0; col < 3; col++) {
+      for (int row = 0; row < 3; row++) {
+        vstore(model[col * 3 + row], vmul(scale[col], rot[col * 3 + row]));
+        vstore(normal[col * 3 + row], vmul(invScale[col], rot[col * 3 + row]));
+      }
+    }
+    vstore(model[9], vload(&translationX[i]));
+    vstore(model[10], vload(&translationY[i]));
+    vstore(model[11], vload(&translationZ[i]));
+
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      glm::mat4 &m = modelMatrices[i + lane];
+      glm::mat4 &n = normalMatrices[i + lane];
+      for (int col = 0; col < 3; col++) {
+        m[col] = glm::vec4{
+            model[col * 3][lane], model[col * 3 + 1][lane], model[col * 3 + 2][lane], 0.0f};
+        n[col] = glm::vec4{
+            normal[col * 3][lane], normal[col * 3 + 1][lane], normal[col * 3 + 2][lane], 0.0f};
+      }
+      m[3] = glm::vec4{model[9][lane], model[10][lane], model[11][lane], 1.0f};
+      n[3] = glm::vec4{0.0f, 0.0f, 0.0f, 1.0f};
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    computeMatrices(
+        {translationX[i], translationY[i], translationZ[i]},
+        {rotationX[i], rotationY[i], rotationZ[i]},
+        {scaleX[i], scaleY[i], scaleZ[i]},
+        modelMatrices[i],
+        normalMatrices[i]);
+  }
+}
+
+}  // namespace nile
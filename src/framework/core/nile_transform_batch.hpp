@@ -0,0 +1,45 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <vector>
+
+namespace nile{
+
+// Structure of arrays input for batched model/normal matrix generation. Produces the same
+// matrices as TransformComponent::mat4() and normalMatrix(), but several objects at a time
+// with SSE (or AVX when built with USE_AVX) and a vectorized sincos. Targets without SSE
+// use the scalar path.
+class NileTransformBatch {
+ public:
+  // number of objects processed per SIMD iteration
+  static const size_t LANES;
+
+  void clear();
+  void reserve(size_t count);
+  void push(const glm::vec3 &translation, const glm::vec3 &rotation, const glm::vec3 &scale);
+  size_t size() const { return translationX.size(); }
+
+  // Writes size() matrices to each output. Normal matrices are stored as mat4(normalMatrix()),
+  // matching the layout in GameObjectBufferData.
+  void computeMatrices(glm::mat4 *modelMatrices, glm::mat4 *normalMatrices) const;
+
+  // Single object version, used for the tail of a batch and when SIMD is unavailable
+  static void computeMatrices(
+      const glm::vec3 &translation,
+      const glm::vec3 &rotation,
+      const glm::vec3 &scale,
+      glm::mat4 &modelMatrix,
+      glm::mat4 &normalMatrix);
+
+ private:
+  std::vector<float> translationX, translationY, translationZ;
+  std::vector<float> rotationX, rotationY, rotationZ;
+  std::vector<float> scaleX, scaleY, scaleZ;
+};
+
+}  // namespace nile
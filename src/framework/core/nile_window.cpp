@@ -1,11 +1,26 @@
 #include "nile_window.hpp"
 
+#include "nile_profiler.hpp"
+
 // std
+#include <cassert>
 #include <stdexcept>
 
+#if defined(NILE_HEADLESS) && GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR < 4
+#error "USE_HEADLESS needs GLFW 3.4 or later for its null platform"
+#endif
+
 namespace nile{
 
-NileWindow::NileWindow(int w, int h, std::string name) : width{w}, height{h}, windowName{name} {
+NileWindow::NileWindow(int w, int h, std::string name, const Headless &headlessSettings)
+    : width{w}, height{h}, headless{headlessSettings}, windowName{name} {
+  if (headless.enabled) {
+#ifndef NILE_HEADLESS
+    throw std::runtime_error("headless rendering needs a build with -DUSE_HEADLESS=ON");
+#endif
+    width = headless.width;
+    height = headless.height;
+  }
   initWindow();
 }
 
@@ -15,16 +30,28 @@ NileWindow::~NileWindow() {
 }
 
 void NileWindow::initWindow() {
-  glfwInit();
+  // the window only feeds input and ImGui then, the null platform needs no display at all
+#ifdef NILE_HEADLESS
+  if (headless.enabled) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+  if (glfwInit() != GLFW_TRUE) {
+    throw std::runtime_error("failed to initialize glfw!");
+  }
   glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+  glfwWindowHint(GLFW_RESIZABLE, headless.enabled ? GLFW_FALSE : GLFW_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, headless.enabled ? GLFW_FALSE : GLFW_TRUE);
 
   window = glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
+  if (window == nullptr) {
+    throw std::runtime_error("failed to create window!");
+  }
   glfwSetWindowUserPointer(window, this);
   glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+  glfwSetKeyCallback(window, keyCallback);
 }
 
 void NileWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface) {
+  assert(!headless.enabled && "Headless windows have no surface");
   if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS) {
     throw std::runtime_error("failed to create window surface");
   }
@@ -37,4 +64,9 @@ void NileWindow::framebufferResizeCallback(GLFWwindow *window, int width, int he
   nileWindow->height = height;
 }
 
+void NileWindow::keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  // F12 writes the CPU profiler's trace at the end of the frame
+  if (key == GLFW_KEY_F12 && action == GLFW_PRESS) NILE_PROFILE_REQUEST_DUMP();
+}
+
 }  // namespace nile
@@ -3,18 +3,42 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
 #include <string>
 namespace nile{
 
 class NileWindow {
  public:
-  NileWindow(int w, int h, std::string name);
+  // Runs without a display, e.g. on lavapipe in CI. The device creates no surface and the
+  // renderer draws into offscreen images of this size instead of a swap chain. Needs a build
+  // with -DUSE_HEADLESS=ON, whose GLFW 3.4 null platform opens no display connection.
+  struct Headless {
+    bool enabled = false;
+    int width = 1280;
+    int height = 720;
+    uint32_t frameCount = 0;  // shouldClose once this many frames were rendered, 0 never
+    // every captureInterval-th frame is read back into a .ppm here, nothing is when empty
+    std::string captureDirectory{};
+    uint32_t captureInterval = 1;
+  };
+
+  NileWindow(int w, int h, std::string name, const Headless &headlessSettings = {});
   ~NileWindow();
 
   NileWindow(const NileWindow &) = delete;
   NileWindow &operator=(const NileWindow &) = delete;
 
-  bool shouldClose() { return glfwWindowShouldClose(window); }
+  bool shouldClose() {
+    if (headless.enabled && headless.frameCount > 0 && framesRendered >= headless.frameCount) {
+      return true;
+    }
+    return glfwWindowShouldClose(window);
+  }
+  bool isHeadless() const { return headless.enabled; }
+  const Headless &getHeadless() const { return headless; }
+  uint32_t getFramesRendered() const { return framesRendered; }
+  // called by the renderer for every submitted frame
+  void countFrame() { framesRendered++; }
   VkExtent2D getExtent() { return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)}; }
   bool wasWindowResized() { return framebufferResized; }
   void resetWindowResizedFlag() { framebufferResized = false; }
@@ -24,11 +48,14 @@ class NileWindow {
 
  private:
   static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
+  static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
   void initWindow();
 
   int width;
   int height;
   bool framebufferResized = false;
+  Headless headless;
+  uint32_t framesRendered = 0;
 
   std::string windowName;
   GLFWwindow *window;
@@ -7,6 +7,7 @@ namespace nile{
 
 void KeyboardMovementController::moveInPlaneXYZ(
     GLFWwindow* window, float dt, NileGameObject& gameObject) {
+  auto& transform = gameObject.transform();
   glm::vec3 rotate{0};
   if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1.f;
   if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) rotate.y -= 1.f;
@@ -14,14 +15,14 @@ void KeyboardMovementController::moveInPlaneXYZ(
   if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.f;
 
   if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon()) {
-    gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+    transform.rotation += lookSpeed * dt * glm::normalize(rotate);
   }
 
   // limit pitch values between about +/- 85ish degrees
-  gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-  gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
+  transform.rotation.x = glm::clamp(transform.rotation.x, -1.5f, 1.5f);
+  transform.rotation.y = glm::mod(transform.rotation.y, glm::two_pi<float>());
 
-  float yaw = gameObject.transform.rotation.y;
+  float yaw = transform.rotation.y;
   const glm::vec3 forwardDir{sin(yaw), 0.f, cos(yaw)};
   const glm::vec3 rightDir{forwardDir.z, 0.f, -forwardDir.x};
   const glm::vec3 upDir{0.f, -1.f, 0.f};
@@ -35,7 +36,7 @@ void KeyboardMovementController::moveInPlaneXYZ(
   if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
 
   if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
-    gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+    transform.translation += moveSpeed * dt * glm::normalize(moveDir);
   }
 }
 
@@ -52,7 +53,7 @@ void KeyboardMovementController::moveInPlaneXY(
     // if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) moveDir -= upDir;
 
     if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
-      gameObject.transform2d.translation += glm::vec3(moveSpeed * dt * glm::normalize(moveDir), 0.f);
+      gameObject.transform2d().translation += glm::vec3(moveSpeed * dt * glm::normalize(moveDir), 0.f);
     }
   
   }
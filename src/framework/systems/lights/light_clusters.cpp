@@ -0,0 +1,212 @@
+#include "light_clusters.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace nile{
+
+LightClusters::LightClusters(
+    NileDevice &device,
+    NileDescriptorSetLayout &globalSetLayout,
+    NileDescriptorPool &globalPool,
+    int frameCount)
+    : nileDevice{device}, globalSetLayout{globalSetLayout}, globalPool{globalPool} {
+  frames.resize(frameCount);
+  for (auto &frame : frames) {
+    reserve(frame.lights, sizeof(PointLight), 64);
+    reserve(frame.clusters, sizeof(glm::uvec2), CLUSTER_COUNT);
+    reserve(frame.lightIndices, sizeof(uint32_t), 1024);
+
+    // empty clusters until the first update, for apps that have no lights
+    std::memset(frame.clusters->getMappedMemory(), 0, frame.clusters->getBufferSize());
+    frame.clusters->flush();
+  }
+  clusters.resize(CLUSTER_COUNT);
+}
+
+void LightClusters::writeDescriptors(int frameIndex, VkDescriptorSet globalSet) {
+  FrameBuffers &frame = frames[frameIndex];
+  frame.globalSet = globalSet;
+  frame.descriptorRevision++;
+
+  auto lightsInfo = frame.lights->descriptorInfo();
+  auto clustersInfo = frame.clusters->descriptorInfo();
+  auto lightIndicesInfo = frame.lightIndices->descriptorInfo();
+  NileDescriptorWriter(globalSetLayout, globalPool)
+      .writeBuffer(1, &lightsInfo)
+      .writeBuffer(2, &clustersInfo)
+      .writeBuffer(3, &lightIndicesInfo)
+      .overwrite(globalSet);
+}
+
+void LightClusters::update(
+    int frameIndex, const NileCamera &camera, const std::vector<PointLight> &lights,
+    GlobalUbo &ubo) {
+  const glm::mat4 &projection = camera.getProjection();
+  assert(projection[2][3] == 1.f && "Light clusters need a perspective projection");
+  if (projection != boundsProjection) updateClusterBounds(projection);
+
+  // screen position of a view space point along one axis, as a tile index
+  auto toTile = [](float ndc, uint32_t tileCount) {
+    const float tile = std::floor((ndc * .5f + .5f) * tileCount);
+    return static_cast<uint32_t>(std::clamp(tile, 0.f, static_cast<float>(tileCount - 1)));
+  };
+
+  const glm::mat4 &view = camera.getView();
+  assignments.clear();
+  for (uint32_t light = 0; light < lights.size(); light++) {
+    const float range = lights[light].position.w;
+    const glm::vec3 center{view * glm::vec4(glm::vec3(lights[light].position), 1.f)};
+    if (center.z + range < nearPlane || center.z - range > farPlane) continue;
+
+    // the tiles the sphere's bounding box covers on screen, all of them once it reaches past
+    // the near plane
+    glm::uvec2 firstTile{0, 0};
+    glm::uvec2 lastTile{CLUSTERS_X - 1, CLUSTERS_Y - 1};
+    if (center.z - range > nearPlane) {
+      glm::vec2 ndcMin{1.f};
+      glm::vec2 ndcMax{-1.f};
+      for (float depth : {center.z - range, center.z + range}) {
+        for (float offset : {-range, range}) {
+          const glm::vec2 ndc{
+              projection[0][0] * (center.x + offset) / depth,
+              projection[1][1] * (center.y + offset) / depth};
+          ndcMin = glm::min(ndcMin, ndc);
+          ndcMax = glm::max(ndcMax, ndc);
+        }
+      }
+      if (ndcMax.x < -1.f || ndcMax.y < -1.f || ndcMin.x > 1.f || ndcMin.y > 1.f) continue;
+      firstTile = {toTile(ndcMin.x, CLUSTERS_X), toTile(ndcMin.y, CLUSTERS_Y)};
+      lastTile = {toTile(ndcMax.x, CLUSTERS_X), toTile(ndcMax.y, CLUSTERS_Y)};
+    }
+
+    const uint32_t lastSlice = sliceFor(center.z + range);
+    for (uint32_t z = sliceFor(center.z - range); z <= lastSlice; z++) {
+      for (uint32_t y = firstTile.y; y <= lastTile.y; y++) {
+        for (uint32_t x = firstTile.x; x <= lastTile.x; x++) {
+          const uint32_t cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+          const glm::vec3 closest = glm::clamp(center, bounds[cluster].min, bounds[cluster].max);
+          const glm::vec3 offset = center - closest;
+          if (glm::dot(offset, offset) <= range * range) {
+            assignments.emplace_back(cluster, light);
+          }
+        }
+      }
+    }
+  }
+
+  // pack the lists back to back: count, then offsets, then fill
+  stats = Stats{};
+  stats.lights = static_cast<uint32_t>(lights.size());
+  std::fill(clusters.begin(), clusters.end(), glm::uvec2{0, 0});
+  for (const auto &[cluster, light] : assignments) {
+    if (clusters[cluster].y < MAX_LIGHTS_PER_CLUSTER) {
+      clusters[cluster].y++;
+    } else {
+      stats.droppedAssignments++;
+    }
+  }
+  uint32_t offset = 0;
+  for (auto &cluster : clusters) {
+    cluster.x = offset;
+    offset += cluster.y;
+    stats.maxLightsPerCluster = std::max(stats.maxLightsPerCluster, cluster.y);
+    cluster.y = 0;
+  }
+  stats.assignments = offset;
+  lightIndices.resize(offset);
+  for (const auto &[cluster, light] : assignments) {
+    glm::uvec2 &list = clusters[cluster];
+    if (list.y < MAX_LIGHTS_PER_CLUSTER) lightIndices[list.x + list.y++] = light;
+  }
+
+  // the frame's fence was waited on, so nothing reads its buffers and they can be replaced
+  FrameBuffers &frame = frames[frameIndex];
+  const bool lightsGrew = reserve(
+      frame.lights, sizeof(PointLight), std::max<uint32_t>(stats.lights, 1));
+  const bool indicesGrew = reserve(
+      frame.lightIndices, sizeof(uint32_t), std::max<uint32_t>(stats.assignments, 1));
+  if ((lightsGrew || indicesGrew) && frame.globalSet != VK_NULL_HANDLE) {
+    writeDescriptors(frameIndex, frame.globalSet);
+  }
+
+  std::memcpy(frame.lights->getMappedMemory(), lights.data(), lights.size() * sizeof(PointLight));
+  frame.lights->flush();
+  std::memcpy(
+      frame.clusters->getMappedMemory(), clusters.data(), sizeof(glm::uvec2) * CLUSTER_COUNT);
+  frame.clusters->flush();
+  std::memcpy(
+      frame.lightIndices->getMappedMemory(),
+      lightIndices.data(),
+      lightIndices.size() * sizeof(uint32_t));
+  frame.lightIndices->flush();
+
+  ubo.clusterGrid = glm::uvec4{CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, 0};
+  ubo.clusterDepth = glm::vec2{sliceScale, sliceBias};
+  ubo.numLights = static_cast<int>(lights.size());
+}
+
+void LightClusters::updateClusterBounds(const glm::mat4 &projection) {
+  boundsProjection = projection;
+  nearPlane = -projection[3][2] / projection[2][2];
+  farPlane = projection[2][2] * nearPlane / (projection[2][2] - 1.f);
+
+  // slice = log(depth) * scale + bias puts the near plane at 0 and the far plane at CLUSTERS_Z
+  const float logRatio = std::log(farPlane / nearPlane);
+  sliceScale = CLUSTERS_Z / logRatio;
+  sliceBias = -CLUSTERS_Z * std::log(nearPlane) / logRatio;
+
+  bounds.resize(CLUSTER_COUNT);
+  for (uint32_t z = 0; z < CLUSTERS_Z; z++) {
+    const float depths[2] = {
+        nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / CLUSTERS_Z),
+        nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / CLUSTERS_Z)};
+    for (uint32_t y = 0; y < CLUSTERS_Y; y++) {
+      for (uint32_t x = 0; x < CLUSTERS_X; x++) {
+        // a cluster is a frustum piece, its corners are the tile's corners at both depths
+        ClusterBounds &cluster = bounds[(z * CLUSTERS_Y + y) * CLUSTERS_X + x];
+        cluster.min = glm::vec3{std::numeric_limits<float>::max()};
+        cluster.max = glm::vec3{std::numeric_limits<float>::lowest()};
+        for (float depth : depths) {
+          for (uint32_t cornerY = y; cornerY <= y + 1; cornerY++) {
+            for (uint32_t cornerX = x; cornerX <= x + 1; cornerX++) {
+              const float ndcX = 2.f * cornerX / CLUSTERS_X - 1.f;
+              const float ndcY = 2.f * cornerY / CLUSTERS_Y - 1.f;
+              const glm::vec3 corner{
+                  ndcX * depth / projection[0][0], ndcY * depth / projection[1][1], depth};
+              cluster.min = glm::min(cluster.min, corner);
+              cluster.max = glm::max(cluster.max, corner);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+uint32_t LightClusters::sliceFor(float depth) const {
+  if (depth <= nearPlane) return 0;
+  const float slice = std::floor(std::log(depth) * sliceScale + sliceBias);
+  return static_cast<uint32_t>(std::clamp(slice, 0.f, static_cast<float>(CLUSTERS_Z - 1)));
+}
+
+bool LightClusters::reserve(
+    std::unique_ptr<NileBuffer> &buffer, VkDeviceSize instanceSize, uint32_t count) {
+  if (buffer && buffer->getInstanceCount() >= count) return false;
+  // doubling keeps a growing scene from reallocating every frame
+  const uint32_t capacity = buffer ? std::max(count, buffer->getInstanceCount() * 2) : count;
+  buffer = std::make_unique<NileBuffer>(
+      nileDevice,
+      instanceSize,
+      capacity,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+  buffer->map();
+  return true;
+}
+
+}  // namespace nile
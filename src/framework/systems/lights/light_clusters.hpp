@@ -0,0 +1,114 @@
+#pragma once
+
+#include "framework/core/nile_buffer.hpp"
+#include "framework/core/nile_camera.hpp"
+#include "framework/core/nile_descriptors.hpp"
+#include "framework/core/nile_device.hpp"
+#include "framework/core/nile_frame_info.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nile{
+
+// Clustered forward lighting. The view frustum is split into a grid of clusters, CLUSTERS_X by
+// CLUSTERS_Y across the screen and CLUSTERS_Z depth slices spaced exponentially between the near
+// and far plane. Every frame the lights are binned on the CPU into the clusters their range
+// overlaps, and a fragment only shades with the lights of its own cluster.
+//
+// Per frame in flight the global descriptor set gets
+//  - binding 1: PointLight lights[], w of position is the light's range
+//  - binding 2: uvec2 clusters[], offset into the light indices and count for every cluster
+//  - binding 3: uint lightIndices[]
+// and GlobalUbo the grid size and depth slicing to find a fragment's cluster with.
+class LightClusters {
+ public:
+  static constexpr uint32_t CLUSTERS_X = 16;
+  static constexpr uint32_t CLUSTERS_Y = 9;
+  static constexpr uint32_t CLUSTERS_Z = 24;
+  static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+  // Lights past this in a cluster are dropped, it bounds what a single fragment can cost
+  static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+  // Storage buffer descriptors each global descriptor set needs from the pool
+  static constexpr uint32_t DESCRIPTORS_PER_SET = 3;
+
+  struct Stats {
+    uint32_t lights = 0;
+    // light index entries over all clusters
+    uint32_t assignments = 0;
+    uint32_t maxLightsPerCluster = 0;
+    uint32_t droppedAssignments = 0;
+  };
+
+  // The layout and pool the global descriptor sets were made from, see writeDescriptors
+  LightClusters(
+      NileDevice &device,
+      NileDescriptorSetLayout &globalSetLayout,
+      NileDescriptorPool &globalPool,
+      int frameCount);
+
+  LightClusters(const LightClusters &) = delete;
+  LightClusters &operator=(const LightClusters &) = delete;
+
+  // Points bindings 1 to 3 of the frame's global set at its buffers. The set is remembered and
+  // written again whenever the buffers have to grow.
+  void writeDescriptors(int frameIndex, VkDescriptorSet globalSet);
+
+  // Bins lights into the clusters of the camera's perspective projection, fills the frame's
+  // buffers and the cluster fields of the ubo. Call after the frame's fence was waited on.
+  void update(
+      int frameIndex, const NileCamera &camera, const std::vector<PointLight> &lights,
+      GlobalUbo &ubo);
+
+  // Bumped whenever the frame's global set is written, command buffers recorded with the set
+  // bound before that must not be executed again
+  uint64_t getDescriptorRevision(int frameIndex) const {
+    return frames[frameIndex].descriptorRevision;
+  }
+
+  const Stats &getStats() const { return stats; }
+
+ private:
+  struct FrameBuffers {
+    std::unique_ptr<NileBuffer> lights;
+    std::unique_ptr<NileBuffer> clusters;
+    std::unique_ptr<NileBuffer> lightIndices;
+    VkDescriptorSet globalSet = VK_NULL_HANDLE;
+    uint64_t descriptorRevision = 0;
+  };
+
+  // View space bounds of a cluster
+  struct ClusterBounds {
+    glm::vec3 min;
+    glm::vec3 max;
+  };
+
+  void updateClusterBounds(const glm::mat4 &projection);
+  uint32_t sliceFor(float depth) const;
+  // True when the buffer was replaced by a larger one
+  bool reserve(std::unique_ptr<NileBuffer> &buffer, VkDeviceSize instanceSize, uint32_t count);
+
+  NileDevice &nileDevice;
+  NileDescriptorSetLayout &globalSetLayout;
+  NileDescriptorPool &globalPool;
+  std::vector<FrameBuffers> frames;
+
+  // cluster bounds only change with the projection
+  glm::mat4 boundsProjection{0.f};
+  std::vector<ClusterBounds> bounds;
+  float nearPlane = 0.f;
+  float farPlane = 0.f;
+  float sliceScale = 0.f;
+  float sliceBias = 0.f;
+
+  // reused every frame, (cluster, light) pairs and then the packed lists
+  std::vector<std::pair<uint32_t, uint32_t>> assignments;
+  std::vector<glm::uvec2> clusters;
+  std::vector<uint32_t> lightIndices;
+  Stats stats{};
+};
+
+}  // namespace nile
@@ -1,5 +1,8 @@
 #include "point_light_system.hpp"
 
+#include "framework/core/nile_gpu_profiler.hpp"
+#include "framework/core/nile_profiler.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -14,6 +17,9 @@
 
 namespace nile{
 
+// Contribution below which a light is cut off, the shaders fade lights out towards it
+constexpr float LIGHT_CUTOFF = 0.01f;
+
 struct PointLightPushConstants {
   glm::vec4 position{};
   glm::vec4 color{};
@@ -27,9 +33,7 @@ PointLightSystem::PointLightSystem(
   createPipeline(renderPass);
 }
 
-PointLightSystem::~PointLightSystem() {
-  vkDestroyPipelineLayout(nileDevice.device(), pipelineLayout, nullptr);
-}
+PointLightSystem::~PointLightSystem() {}
 
 void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
   VkPushConstantRange pushConstantRange{};
@@ -37,18 +41,8 @@ void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayou
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(PointLightPushConstants);
 
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(nileDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout!");
-  }
+  pipelineLayout =
+      nileDevice.getPipelineRegistry().getPipelineLayout({globalSetLayout}, {pushConstantRange});
 }
 
 void PointLightSystem::createPipeline(VkRenderPass renderPass) {
@@ -66,46 +60,52 @@ void PointLightSystem::createPipeline(VkRenderPass renderPass) {
   pipelineConfig.bindingDescriptions.clear();
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
-  nilePipeline = std::make_unique<NilePipeline>(
-      nileDevice,
+  nilePipeline = nileDevice.getPipelineRegistry().getPipeline(
       "shaders/point_light.vert.spv",
       "shaders/point_light.frag.spv",
       pipelineConfig);
 }
 
-void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo) {
+void PointLightSystem::update(
+    FrameInfo& frameInfo, GlobalUbo& ubo, LightClusters& lightClusters) {
+  NILE_PROFILE_ZONE("point light update");
   auto rotateLight = glm::rotate(glm::mat4(1.f), 0.5f * frameInfo.frameTime, {0.f, -1.f, 0.f});
-  int lightIndex = 0;
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.pointLight == nullptr) continue;
-
-    assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum specified");
-
-    // update light position
-    obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
-
-    // copy light to ubo
-    ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
-    ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-
-    lightIndex += 1;
-  }
-  ubo.numLights = lightIndex;
+  lights.clear();
+  frameInfo.gameObjects.view<TransformComponent, const PointLightComponent>().each(
+      [&](NileGameObject::id_t,
+          TransformComponent& transform,
+          const PointLightComponent& pointLight) {
+        // update light position
+        transform.translation = glm::vec3(rotateLight * glm::vec4(transform.translation, 1.f));
+        transform.markDirty();
+
+        // falloff is 1 / distance squared, the light ends where it drops below LIGHT_CUTOFF
+        const glm::vec3& color = pointLight.color;
+        float brightest = glm::max(color.r, glm::max(color.g, color.b));
+        float range = glm::sqrt(pointLight.lightIntensity * brightest / LIGHT_CUTOFF);
+
+        PointLight& light = lights.emplace_back();
+        light.position = glm::vec4(transform.translation, range);
+        light.color = glm::vec4(pointLight.color, pointLight.lightIntensity);
+      });
+  lightClusters.update(frameInfo.frameIndex, frameInfo.camera, lights, ubo);
+  frameInfo.globalDescriptorRevision = lightClusters.getDescriptorRevision(frameInfo.frameIndex);
 }
 
 void PointLightSystem::render(FrameInfo& frameInfo) {
+  NILE_PROFILE_ZONE("point lights");
+  NileGpuScope scope{frameInfo, "point lights"};
   // sort lights
   std::map<float, NileGameObject::id_t> sorted;
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.pointLight == nullptr) continue;
-
-    // calculate distance
-    auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
-    float disSquared = glm::dot(offset, offset);
-    sorted[disSquared] = obj.getId();
-  }
+  frameInfo.gameObjects.view<const TransformComponent, const PointLightComponent>().each(
+      [&](NileGameObject::id_t id,
+          const TransformComponent& transform,
+          const PointLightComponent&) {
+        // calculate distance
+        auto offset = frameInfo.camera.getPosition() - transform.translation;
+        float disSquared = glm::dot(offset, offset);
+        sorted[disSquared] = id;
+      });
 
   nilePipeline->bind(frameInfo.commandBuffer);
 
@@ -122,12 +122,14 @@ void PointLightSystem::render(FrameInfo& frameInfo) {
   // iterate through sorted lights in reverse order
   for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
     // use game obj id to find light object
-    auto& obj = frameInfo.gameObjects.at(it->second);
+    auto obj = frameInfo.gameObjects.get(it->second);
+    auto& transform = obj.get<const TransformComponent>();
+    auto& pointLight = obj.get<const PointLightComponent>();
 
     PointLightPushConstants push{};
-    push.position = glm::vec4(obj.transform.translation, 1.f);
-    push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-    push.radius = obj.transform.scale.x;
+    push.position = glm::vec4(transform.translation, 1.f);
+    push.color = glm::vec4(pointLight.color, pointLight.lightIntensity);
+    push.radius = transform.scale.x;
 
     vkCmdPushConstants(
         frameInfo.commandBuffer,
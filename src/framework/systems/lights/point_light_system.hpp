@@ -5,6 +5,8 @@
 #include "framework/core/nile_frame_info.hpp"
 #include "framework/core/nile_game_object.hpp"
 #include "framework/core/nile_pipeline.hpp"
+#include "framework/core/nile_pipeline_registry.hpp"
+#include "framework/systems/lights/light_clusters.hpp"
 
 // std
 #include <memory>
@@ -20,7 +22,8 @@ class PointLightSystem {
   PointLightSystem(const PointLightSystem &) = delete;
   PointLightSystem &operator=(const PointLightSystem &) = delete;
 
-  void update(FrameInfo &frameInfo, GlobalUbo &ubo);
+  // Moves the lights and bins them into lightClusters for the frame
+  void update(FrameInfo &frameInfo, GlobalUbo &ubo, LightClusters &lightClusters);
   void render(FrameInfo &frameInfo);
 
  private:
@@ -29,7 +32,10 @@ class PointLightSystem {
 
   NileDevice &nileDevice;
 
-  std::unique_ptr<NilePipeline> nilePipeline;
+  std::shared_ptr<NilePipeline> nilePipeline;
   VkPipelineLayout pipelineLayout;
+
+  // reused by update
+  std::vector<PointLight> lights;
 };
 }  // namespace nile
@@ -1,5 +1,8 @@
 #include "mirror_system.hpp"
 
+#include "framework/core/nile_gpu_profiler.hpp"
+#include "framework/core/nile_profiler.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -19,15 +22,16 @@ struct MirrorPushConstants {
 };
 
 MirrorSystem::MirrorSystem(
-    NileDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout offscreenSetLayout)
-  : nileDevice{device} {
+    NileDevice& device,
+    VkRenderPass renderPass,
+    VkDescriptorSetLayout offscreenSetLayout,
+    ObjectBufferMode objectBufferMode)
+  : nileDevice{device}, objectBufferMode{objectBufferMode} {
   createPipelineLayout(offscreenSetLayout);
   createPipeline(renderPass);
 }
 
-MirrorSystem::~MirrorSystem() {
-  vkDestroyPipelineLayout(nileDevice.device(), pipelineLayout, nullptr);
-}
+MirrorSystem::~MirrorSystem() {}
 
 void MirrorSystem::createPipelineLayout(VkDescriptorSetLayout offscreenSetLayout) {
   VkPushConstantRange pushConstantRange{};
@@ -35,29 +39,17 @@ void MirrorSystem::createPipelineLayout(VkDescriptorSetLayout offscreenSetLayout
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(MirrorPushConstants);
 
-  renderSystemLayout = 
+  auto& registry = nileDevice.getPipelineRegistry();
+  renderSystemLayout = registry.getDescriptorSetLayout(
       NileDescriptorSetLayout::Builder(nileDevice)
           .addBinding(
             0,
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            objectBufferDescriptorType(objectBufferMode),
             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-          .build();
-
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-    offscreenSetLayout,
-    renderSystemLayout->getDescriptorSetLayout()};
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(nileDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout!");
-  }
+          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+  pipelineLayout = registry.getPipelineLayout(
+      {offscreenSetLayout, renderSystemLayout->getDescriptorSetLayout()}, {pushConstantRange});
 }
 
 void MirrorSystem::createPipeline(VkRenderPass renderPass) {
@@ -70,83 +62,82 @@ void MirrorSystem::createPipeline(VkRenderPass renderPass) {
 
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
-  nilePipeline = std::make_unique<NilePipeline>(
-      nileDevice,
+  nilePipeline = nileDevice.getPipelineRegistry().getPipeline(
       "shaders/mirror.vert.spv",
       "shaders/mirror.frag.spv",
       pipelineConfig);
 }
 
 void MirrorSystem::renderMirrorPlane(FrameInfo& frameInfo) {
-  nilePipeline->bind(frameInfo.commandBuffer);
-
-  vkCmdBindDescriptorSets(
-      frameInfo.commandBuffer,
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      pipelineLayout,
-      0,
-      1,
-      &frameInfo.globalDescriptorSet,
-      0,
-      nullptr);
-
-  // Create a map to cache descriptor sets for each game object
-  std::unordered_map<NileGameObject*, VkDescriptorSet> cachedDesriptorSets;
-
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr || !obj.isMirror || obj.getIsHidden()) continue;
-
-    // Check if the descriptor set is already cached
-    auto it = cachedDesriptorSets.find(&obj);
-    if (it != cachedDesriptorSets.end()) {
-      // If cached, bind the cached descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
+  NILE_PROFILE_ZONE("mirror plane");
+  NileGpuScope scope{frameInfo, "mirror plane"};
+  const bool dynamicOffset = objectBufferMode == ObjectBufferMode::DynamicOffset;
+  draws.clear();
+  frameInfo.gameObjects.view<RenderComponent, MirrorComponent>().each(
+      [&](NileGameObject::id_t id, RenderComponent& render, MirrorComponent& mirror) {
+        if (render.model == nullptr || render.isHidden) return;
+        if (!frameInfo.gameObjects.isVisible(id)) return;
+
+        auto bufferInfo =
+            dynamicOffset
+                ? frameInfo.gameObjects.getDynamicBufferInfo(frameInfo.frameIndex)
+                : frameInfo.gameObjects.getBufferInfoForGameObject(frameInfo.frameIndex, id);
+        uint32_t objectOffset =
+            dynamicOffset ? frameInfo.gameObjects.getDynamicOffset(frameInfo.frameIndex, id) : 0;
+        auto diffuseMapInfo = mirror.reflectionImage;
+        VkDescriptorSet gameObjectDescriptorSet;
+        frameInfo.descriptorCache.writer(*renderSystemLayout)
+            .writeBuffer(0, &bufferInfo)
+            .writeImage(1, &diffuseMapInfo)
+            .build(gameObjectDescriptorSet);
+
+        draws.push_back(
+            {gameObjectDescriptorSet,
+             objectOffset,
+             render.model.get(),
+             frameInfo.gameObjects.getMatrices(id).modelMatrix});
+      });
+
+  auto recordRange = [&](VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+    nilePipeline->bind(commandBuffer);
+
+    vkCmdBindDescriptorSets(
+        commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &it->second,
         0,
-        nullptr);
-    } else {
-      auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-      // auto diffuseMapInfo = obj.diffuseMap->getImageInfo();
-      auto diffuseMapInfo =  obj.reflectionTexture->getImageInfo();
-      VkDescriptorSet gameObjectDescriptorSet;
-      NileDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-          .writeBuffer(0, &bufferInfo)
-          .writeImage(1, &diffuseMapInfo)
-          .build(gameObjectDescriptorSet);
-      
-      cachedDesriptorSets[&obj] = gameObjectDescriptorSet;
-
-      // Bind the newly created descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &gameObjectDescriptorSet,
+        1,
+        &frameInfo.globalDescriptorSet,
         0,
         nullptr);
-    }
 
-    MirrorPushConstants push{};
-    push.transform = obj.transform.mat4();
-
-    vkCmdPushConstants(
-      frameInfo.commandBuffer,
-      pipelineLayout,
-      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-      0,
-      sizeof(MirrorPushConstants),
-      &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
-  }
+    for (uint32_t i = begin; i < end; i++) {
+      const MirrorDraw& draw = draws[i];
+      vkCmdBindDescriptorSets(
+          commandBuffer,
+          VK_PIPELINE_BIND_POINT_GRAPHICS,
+          pipelineLayout,
+          1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
+          1,  // set count
+          &draw.descriptorSet,
+          dynamicOffset ? 1u : 0u,
+          &draw.objectOffset);
+
+      MirrorPushConstants push{};
+      push.transform = draw.transform;
+
+      vkCmdPushConstants(
+          commandBuffer,
+          pipelineLayout,
+          VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+          0,
+          sizeof(MirrorPushConstants),
+          &push);
+      draw.model->bind(commandBuffer);
+      draw.model->draw(commandBuffer);
+    }
+  };
+  recordDraws(frameInfo, static_cast<uint32_t>(draws.size()), RECORD_GRAIN_SIZE, recordRange);
 }
 
 }  // namespace nile
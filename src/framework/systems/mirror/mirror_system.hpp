@@ -6,7 +6,10 @@ namespace nile{
 class MirrorSystem{
  public:
   MirrorSystem(
-      NileDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout offscreenSetLayout);
+      NileDevice &device,
+      VkRenderPass renderPass,
+      VkDescriptorSetLayout offscreenSetLayout,
+      ObjectBufferMode objectBufferMode = ObjectBufferMode::DynamicOffset);
   ~MirrorSystem();
 
   MirrorSystem(const MirrorSystem &) = delete;
@@ -19,9 +22,20 @@ class MirrorSystem{
   void createPipeline(VkRenderPass renderPass);
   void createPipelineLayout(VkDescriptorSetLayout offscreenSetLayout);
 
+  // a visible mirror, gathered with its set before the draws are recorded
+  struct MirrorDraw {
+    VkDescriptorSet descriptorSet;
+    uint32_t objectOffset;
+    NileModel *model;
+    glm::mat4 transform;
+  };
+  std::vector<MirrorDraw> draws;
+  static constexpr uint32_t RECORD_GRAIN_SIZE = 64;
+
   NileDevice &nileDevice;
-  std::unique_ptr<NileDescriptorSetLayout> renderSystemLayout;
-  std::unique_ptr<NilePipeline> nilePipeline;
+  ObjectBufferMode objectBufferMode;
+  std::shared_ptr<NileDescriptorSetLayout> renderSystemLayout;
+  std::shared_ptr<NilePipeline> nilePipeline;
   VkPipelineLayout pipelineLayout;
 };
 }  // namespace nile
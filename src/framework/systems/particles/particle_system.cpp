@@ -1,5 +1,8 @@
 #include "particle_system.hpp"
 
+#include "framework/core/nile_gpu_profiler.hpp"
+#include "framework/core/nile_profiler.hpp"
+
 namespace nile {
 
     struct ParticlePushConstants {
@@ -12,19 +15,19 @@ namespace nile {
         NileGameObjectManager& gom,
         VkRenderPass renderPass,
         VkDescriptorSetLayout offscreenSetLayout, 
-        unsigned int amount
+        unsigned int amount,
+        NileJobSystem* jobSystem,
+        ObjectBufferMode objectBufferMode
         )
-        : device(device), gom(gom), amount(amount)
+        : device(device), gom(gom), amount(amount), jobSystem(jobSystem),
+          objectBufferMode(objectBufferMode)
     {
         this->init(gom);
         createPipelineLayout(offscreenSetLayout);
         createPipeline(renderPass);
     }
     
-    ParticleGenerator::~ParticleGenerator()
-    {
-        vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
-    }
+    ParticleGenerator::~ParticleGenerator() {}
 
     void ParticleGenerator::init(
         NileGameObjectManager& gom)
@@ -43,11 +46,11 @@ namespace nile {
 
         // create this->amount default particle instances
         for (unsigned int i = 0; i < this->amount; ++i){
-            auto& particle = gom.makeParticle(0.0f);
-            particle.rigidBody2d.velocity = glm::vec2(0.0f);
-            particle.model = square;
-            particle.transform2d.scale = glm::vec3(.07f);
-            this->particles.push_back(&particle);
+            auto particle = gom.makeParticle(0.0f);
+            particle.rigidBody2d().velocity = glm::vec2(0.0f);
+            particle.render().model = square;
+            particle.transform2d().scale = glm::vec3(.07f);
+            this->particles.push_back(particle);
         }
     }
 
@@ -57,29 +60,18 @@ namespace nile {
         pushConstantRange.offset = 0;
         pushConstantRange.size = sizeof(ParticlePushConstants);
 
-        renderSystemLayout = 
+        auto& registry = device.getPipelineRegistry();
+        renderSystemLayout = registry.getDescriptorSetLayout(
             NileDescriptorSetLayout::Builder(device)
                 .addBinding(
                 0,
-                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                objectBufferDescriptorType(objectBufferMode),
                 VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-                .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-                .build();
-
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-            globalSetLayout, 
-            renderSystemLayout->getDescriptorSetLayout()};
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-            VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
-        }
+                .addBinding(
+                1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+        pipelineLayout = registry.getPipelineLayout(
+            {globalSetLayout, renderSystemLayout->getDescriptorSetLayout()}, {pushConstantRange});
     }
 
     void ParticleGenerator::createPipeline(VkRenderPass renderPass) {
@@ -90,8 +82,7 @@ namespace nile {
         
         pipelineConfig.renderPass = renderPass;
         pipelineConfig.pipelineLayout = pipelineLayout;
-        nilePipeline = std::make_unique<NilePipeline>(
-            device,
+        nilePipeline = device.getPipelineRegistry().getPipeline(
             "shaders/particle.vert.spv",
             "shaders/particle.frag.spv",
             pipelineConfig);
@@ -102,25 +93,39 @@ namespace nile {
             NileGameObject &object, 
             unsigned int newParticles,
             glm::vec2 offset) {
+        NILE_PROFILE_ZONE("particles update");
         // add new particles
         for (unsigned int i = 0; i < newParticles; i++)
         {
             int unusedParticle = this->firstUnusedParticle();
             this->respawnParticle(
-                *this->particles[unusedParticle]->particle, object, offset);
+                this->particles[unusedParticle].get<ParticleComponent>(), object, offset);
         }
 
-        // update all particles
+        // look the components up once, the update below can then run on any thread
+        particleComponents.clear();
         for (unsigned int i = 0; i < this->amount; ++i)
         {
-            ParticleComponent &p = *this->particles[i]->particle;
-            p.Life -= dt; // reduce life
-            if (p.Life > 0.0f)
-            {	// particle is alive, thus update
-               // std::cout<<"Updating particle..."<<std::endl;
-                p.Position -= p.Velocity * dt; 
-                p.Color.a -= dt * 2.5f;
+            particleComponents.push_back(&this->particles[i].get<ParticleComponent>());
+        }
+
+        // update all particles
+        auto updateRange = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                ParticleComponent &p = *particleComponents[i];
+                p.Life -= dt; // reduce life
+                if (p.Life > 0.0f)
+                {	// particle is alive, thus update
+                    p.Position -= p.Velocity * dt; 
+                    p.Color.a -= dt * 2.5f;
+                }
             }
+        };
+        if (jobSystem != nullptr) {
+            jobSystem->parallelFor(this->amount, 1024, updateRange);
+        } else {
+            updateRange(0, this->amount);
         }
     }
 
@@ -128,7 +133,7 @@ namespace nile {
         // first search from last used particle, this will usually return almost instantly
         for (unsigned int i = lastUsedParticle; i < this->amount; i++)
         {
-            if (this->particles[i]->particle->Life <= 0.0f){
+            if (this->particles[i].get<ParticleComponent>().Life <= 0.0f){
                 lastUsedParticle = i;
                 return i;
             }
@@ -136,7 +141,7 @@ namespace nile {
         // otherwise, do a linear search
         for (unsigned int i = 0; i < lastUsedParticle; i++)
         {
-            if (this->particles[i]->particle->Life <= 0.0f){
+            if (this->particles[i].get<ParticleComponent>().Life <= 0.0f){
                 lastUsedParticle = i;
                 return i;
             }
@@ -153,85 +158,86 @@ namespace nile {
     {
         float random = ((rand() % 100) - 50) / 10.0f;
         float rColor = 0.5f + ((rand() % 100) / 100.0f);
-        particle.Position = glm::vec2(object.transform2d.translation.x, 
-                                object.transform2d.translation.y) + random + offset;
+        particle.Position = glm::vec2(object.transform2d().translation.x, 
+                                object.transform2d().translation.y) + random + offset;
         particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
         particle.Life = 1.0f;
-        particle.Velocity = object.rigidBody2d.velocity * 0.1f;
+        particle.Velocity = object.rigidBody2d().velocity * 0.1f;
     }
 
     void ParticleGenerator::render(FrameInfo& frameInfo) {
-        nilePipeline->bind(frameInfo.commandBuffer);
-
-        vkCmdBindDescriptorSets(
-            frameInfo.commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout,
-            0,  // starting set (0 is the globalDescriptorSet)
-            1,  // set count
-            &frameInfo.globalDescriptorSet,
-            0,
-            nullptr);
-
-        // Create a map to cache descriptor sets for each game object
-        std::unordered_map<NileGameObject*, VkDescriptorSet> cachedDesriptorSets;
-
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if (obj.model == nullptr || !obj.isParticle || obj.getIsHidden()) continue;
-            if (obj.particle->Life > 0.0f)
-            {
-                
-                // Check if the descriptor set is already cached
-                auto it = cachedDesriptorSets.find(&obj);
-                if (it != cachedDesriptorSets.end()) {
-                    // If cached, bind the cached descriptor set
-                    vkCmdBindDescriptorSets(
-                        frameInfo.commandBuffer,
-                        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        pipelineLayout,
-                        1,
-                        1,  // set count
-                        &it->second,
-                        0,
-                        nullptr);
-                } else {
-                    auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-                    auto diffuseMapInfo =  obj.diffuseMap->getImageInfo();
-                    VkDescriptorSet gameObjectDescriptorSet;
-                    NileDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-                        .writeBuffer(0, &bufferInfo)
-                        .writeImage(1, &diffuseMapInfo)
-                        .build(gameObjectDescriptorSet);
-            
-                    cachedDesriptorSets[&obj] = gameObjectDescriptorSet;
-
-                    // Bind the newly created descriptor set
-                    vkCmdBindDescriptorSets(
-                        frameInfo.commandBuffer,
-                        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        pipelineLayout,
-                        1,
-                        1,  // set count
-                        &gameObjectDescriptorSet,
-                        0,
-                        nullptr);
-                    }
-
-                    ParticlePushConstants push{};
-                    push.position = glm::vec2(obj.particle->Position);
-                    push.color = glm::vec4(obj.particle->Color);
-
-                    vkCmdPushConstants(
-                        frameInfo.commandBuffer,
-                        pipelineLayout,
-                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                        0,
-                        sizeof(ParticlePushConstants),
-                        &push);
-                    obj.model->bind(frameInfo.commandBuffer);
-                    obj.model->draw(frameInfo.commandBuffer);
-                }
-        }         
+        NILE_PROFILE_ZONE("particles");
+        NileGpuScope scope{frameInfo, "particles"};
+        // particles share one texture, so with dynamic offsets they all bind the same set
+        const bool dynamicOffset = objectBufferMode == ObjectBufferMode::DynamicOffset;
+
+        // the sets are looked up here, the draws may be recorded on other threads
+        draws.clear();
+        frameInfo.gameObjects.view<ParticleComponent, RenderComponent>().each(
+            [&](NileGameObject::id_t id, ParticleComponent& particle, RenderComponent& render) {
+                if (render.model == nullptr || render.isHidden || particle.Life <= 0.0f) return;
+
+                auto bufferInfo =
+                    dynamicOffset
+                        ? frameInfo.gameObjects.getDynamicBufferInfo(frameInfo.frameIndex)
+                        : frameInfo.gameObjects.getBufferInfoForGameObject(frameInfo.frameIndex, id);
+                uint32_t objectOffset =
+                    dynamicOffset ? frameInfo.gameObjects.getDynamicOffset(frameInfo.frameIndex, id) : 0;
+                auto diffuseMapInfo =  render.diffuseMap->getImageInfo();
+                VkDescriptorSet gameObjectDescriptorSet;
+                frameInfo.descriptorCache.writer(*renderSystemLayout)
+                    .writeBuffer(0, &bufferInfo)
+                    .writeImage(1, &diffuseMapInfo)
+                    .build(gameObjectDescriptorSet);
+
+                draws.push_back(
+                    {gameObjectDescriptorSet,
+                     objectOffset,
+                     render.model.get(),
+                     glm::vec2(particle.Position),
+                     glm::vec4(particle.Color)});
+            });
+
+        auto recordRange = [&](VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+            nilePipeline->bind(commandBuffer);
+
+            vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout,
+                0,  // starting set (0 is the globalDescriptorSet)
+                1,  // set count
+                &frameInfo.globalDescriptorSet,
+                0,
+                nullptr);
+
+            for (uint32_t i = begin; i < end; i++) {
+                const ParticleDraw& draw = draws[i];
+                vkCmdBindDescriptorSets(
+                    commandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipelineLayout,
+                    1,
+                    1,  // set count
+                    &draw.descriptorSet,
+                    dynamicOffset ? 1u : 0u,
+                    &draw.objectOffset);
+
+                ParticlePushConstants push{};
+                push.position = draw.position;
+                push.color = draw.color;
+
+                vkCmdPushConstants(
+                    commandBuffer,
+                    pipelineLayout,
+                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    0,
+                    sizeof(ParticlePushConstants),
+                    &push);
+                draw.model->bind(commandBuffer);
+                draw.model->draw(commandBuffer);
+            }
+        };
+        recordDraws(frameInfo, static_cast<uint32_t>(draws.size()), RECORD_GRAIN_SIZE, recordRange);
     }
-}
\ No newline at end of file
+}
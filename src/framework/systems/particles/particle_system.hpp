@@ -1,11 +1,14 @@
+#pragma once
+
 #include "../rendering/render_system.hpp"
+#include "framework/core/nile_job_system.hpp"
 
 namespace nile {
     class ParticleGenerator
     {
     private:
         // state
-        std::vector<NileGameObject*> particles;
+        std::vector<NileGameObject> particles;
         unsigned int amount;
         unsigned int lastUsedParticle = 0; // stores the index of the last particle used (for quick access to next dead particle)
         unsigned int firstUnusedParticle();
@@ -17,10 +20,24 @@ namespace nile {
         
         NileDevice& device;
         NileGameObjectManager& gom;
-        std::unique_ptr<NilePipeline> nilePipeline;
+        NileJobSystem* jobSystem;
+        ObjectBufferMode objectBufferMode;
+        std::vector<ParticleComponent*> particleComponents; // scratch for update
+
+        // a live particle, gathered on the calling thread before the draws are recorded
+        struct ParticleDraw {
+            VkDescriptorSet descriptorSet;
+            uint32_t objectOffset;
+            NileModel* model;
+            glm::vec2 position;
+            glm::vec4 color;
+        };
+        std::vector<ParticleDraw> draws; // scratch for render
+        static constexpr uint32_t RECORD_GRAIN_SIZE = 256;
+        std::shared_ptr<NilePipeline> nilePipeline;
         VkPipelineLayout pipelineLayout;
 
-        std::unique_ptr<NileDescriptorSetLayout> renderSystemLayout;
+        std::shared_ptr<NileDescriptorSetLayout> renderSystemLayout;
         void init(NileGameObjectManager& gom);
 
     public:
@@ -29,7 +46,9 @@ namespace nile {
             NileGameObjectManager& gom,
             VkRenderPass renderPass,
             VkDescriptorSetLayout globalSetLayout, 
-            unsigned int amount
+            unsigned int amount,
+            NileJobSystem* jobSystem = nullptr,
+            ObjectBufferMode objectBufferMode = ObjectBufferMode::DynamicOffset
         );
         ~ParticleGenerator();
 
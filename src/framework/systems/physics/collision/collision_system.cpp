@@ -1,33 +1,39 @@
 #include "collision_system.hpp"
 
+#include "framework/core/nile_profiler.hpp"
+
 namespace nile
 {
  
  SimpleCollisionSystem::SimpleCollisionSystem(){}
  SimpleCollisionSystem::~SimpleCollisionSystem(){}
 
-bool SimpleCollisionSystem::checkCollision1(NileGameObject &one, NileGameObject &two)
+bool SimpleCollisionSystem::checkCollision1(NileGameObject &objOne, NileGameObject &objTwo)
 {
+    auto& one = objOne.transform2d();
+    auto& two = objTwo.transform2d();
     // collision x-axis?
-    bool collisionX = one.transform2d.translation.x + one.transform2d.scale.x >= two.transform2d.translation.x &&
-        two.transform2d.translation.x + two.transform2d.scale.x >= one.transform2d.translation.x;
+    bool collisionX = one.translation.x + one.scale.x >= two.translation.x &&
+        two.translation.x + two.scale.x >= one.translation.x;
     // collision y-axis?
-    bool collisionY = one.transform2d.translation.y + one.transform2d.scale.y >= two.transform2d.translation.y &&
-        two.transform2d.translation.y + two.transform2d.scale.y >= one.transform2d.translation.y;
+    bool collisionY = one.translation.y + one.scale.y >= two.translation.y &&
+        two.translation.y + two.scale.y >= one.translation.y;
     // collision only if on both axes
     return collisionX && collisionY;
 }
 
 SimpleCollisionSystem::Collision SimpleCollisionSystem::checkCollision2(NileGameObject &one, NileGameObject &two)
 {
+    float radius = one.get<BallComponent>().radius;
+    auto& box = two.transform2d();
 
     // get center point circle first
-    glm::vec2 center(one.transform2d.translation + one.ball->radius);
+    glm::vec2 center(one.transform2d().translation + radius);
     // calculate AABB info (center, half-extents)
-    glm::vec2 aabb_half_extents(two.transform2d.scale.x / 2.0f, two.transform2d.scale.y / 2.0f);
+    glm::vec2 aabb_half_extents(box.scale.x / 2.0f, box.scale.y / 2.0f);
     glm::vec2 aabb_center(
-        two.transform2d.translation.x + aabb_half_extents.x,
-        two.transform2d.translation.y + aabb_half_extents.y
+        box.translation.x + aabb_half_extents.x,
+        box.translation.y + aabb_half_extents.y
     );
     // get difference vector between both centers
     glm::vec2 difference = center - aabb_center;
@@ -36,7 +42,7 @@ SimpleCollisionSystem::Collision SimpleCollisionSystem::checkCollision2(NileGame
     glm::vec2 closest = aabb_center + clamped;
     // retrieve vector between center circle and closest point AABB and check if length <= radius
     difference = closest - center;
-    if (glm::length(difference) <= one.ball->radius)
+    if (glm::length(difference) <= radius)
         return std::make_tuple(true, VectorDirection(difference), difference);
     else
         return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
@@ -73,62 +79,74 @@ void SimpleCollisionSystem::doCollisions(
         unsigned int           Level
         )
 {
-    for (NileGameObject::id_t id : Levels[Level].bricks)
+    NILE_PROFILE_ZONE("collisions");
+    auto& ball = ballobj.get<BallComponent>();
+    auto& ballTransform = ballobj.transform2d();
+    auto& ballBody = ballobj.rigidBody2d();
+    auto& playerTransform = player.transform2d();
+    // destroyed after the loop, removing components would invalidate the references above
+    std::vector<NileGameObject> destroyedBricks;
+
+    for (NileGameObject obj : Levels[Level].bricks)
     {
-        auto & obj = frameInfo.gameObjects.at(id);
-        if (!obj.Destroyed)
+        // destroyed bricks leave stale handles behind
+        if (obj.valid())
         {
             Collision collision = checkCollision2(ballobj, obj);
             if (std::get<0>(collision)) // if collision is true
             {
                 // destory block if not solid
-                if (!obj.isSolid)
-                    obj.Destroyed = true;
+                if (!obj.get<BrickComponent>().isSolid)
+                    destroyedBricks.push_back(obj);
                 // collision resolution
                 Direction dir = std::get<1>(collision);
                 glm::vec2 diff_vector = std::get<2>(collision);
                 if (dir == LEFT || dir == RIGHT)  // horizontal collision
                 {
                     // reverse horizontal velocity
-                    ballobj.rigidBody2d.velocity.x = -ballobj.rigidBody2d.velocity.x;
+                    ballBody.velocity.x = -ballBody.velocity.x;
                     // relocate
-                    float penetration = ballobj.ball->radius - std::abs(diff_vector.x);
+                    float penetration = ball.radius - std::abs(diff_vector.x);
                     if (dir == LEFT)
                         // move ball to right
-                        ballobj.transform2d.translation.x += penetration;
+                        ballTransform.translation.x += penetration;
                     else
                         // move ball to left;
-                        ballobj.transform2d.translation.x -= penetration;
+                        ballTransform.translation.x -= penetration;
                 }
                 else  // vertical collision
                 {
                     // reverse vertical velocity
-                    ballobj.rigidBody2d.velocity.y = -ballobj.rigidBody2d.velocity.y;
+                    ballBody.velocity.y = -ballBody.velocity.y;
                     // relocate
-                    float penetration = ballobj.ball->radius - std::abs(diff_vector.y);
+                    float penetration = ball.radius - std::abs(diff_vector.y);
                     if (dir == UP)
                         // move ball back up
-                        ballobj.transform2d.translation.y -= penetration;
+                        ballTransform.translation.y -= penetration;
                     else
                         // move ball back down
-                        ballobj.transform2d.translation.y += penetration;
+                        ballTransform.translation.y += penetration;
                 }
             }
         }
     };
     Collision result = checkCollision2(ballobj, player);
-    if (!ballobj.ball->stuck && std::get<0>(result))
+    if (!ball.stuck && std::get<0>(result))
     {
         // check where it hit the board, and change velocity based on where it hit the board
-        float centerBoard = player.transform2d.translation.x + player.transform2d.scale.x / 2.0f;
-        float distance = (ballobj.transform2d.translation.x + ballobj.ball->radius) - centerBoard;
-        float percentage = distance / (player.transform2d.scale.x / 2.0f);
+        float centerBoard = playerTransform.translation.x + playerTransform.scale.x / 2.0f;
+        float distance = (ballTransform.translation.x + ball.radius) - centerBoard;
+        float percentage = distance / (playerTransform.scale.x / 2.0f);
         // then move accordingly
         float strength = 2.f;
-        glm::vec2 oldVelocity = ballobj.rigidBody2d.velocity;
-        ballobj.rigidBody2d.velocity.x = .05f * percentage * strength; // .04f is the initial ball velocity
-        ballobj.rigidBody2d.velocity.y = -ballobj.rigidBody2d.velocity.y;
-        ballobj.rigidBody2d.velocity = glm::normalize(ballobj.rigidBody2d.velocity) * glm::length(oldVelocity);
+        glm::vec2 oldVelocity = ballBody.velocity;
+        ballBody.velocity.x = .05f * percentage * strength; // .04f is the initial ball velocity
+        ballBody.velocity.y = -ballBody.velocity.y;
+        ballBody.velocity = glm::normalize(ballBody.velocity) * glm::length(oldVelocity);
+    }
+
+    for (auto& obj : destroyedBricks) {
+        frameInfo.gameObjects.destroyGameObject(obj);
     }
 }
 
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "framework/core/nile_game_object.hpp"
+#include "framework/core/nile_job_system.hpp"
+#include "framework/core/nile_profiler.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -10,6 +14,7 @@
 #include <array>
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 namespace nile {
 
@@ -17,44 +22,97 @@ class GravityPhysicsSystem
 {
 
 private:
-    void stepSimulation(std::vector<NileGameObject*>& physicsObjs, float dt) {
-        // Loops through all pairs of objects and applies attractive force between them
-        for (auto iterA = physicsObjs.begin(); iterA != physicsObjs.end(); ++iterA) {
-            auto& objA = *iterA;
-            for (auto iterB = iterA; iterB != physicsObjs.end(); ++iterB) {
-                if (iterA == iterB) continue;
-                auto& objB = *iterB;
-
-                auto force = computeForce(*objA, *objB);
-                objA->rigidBody2d.velocity += dt * -force / objA->rigidBody2d.mass;
-                objB->rigidBody2d.velocity += dt * force / objB->rigidBody2d.mass;
-            }
-        }
+    // bodies per parallelFor chunk, every body visits all others so chunks stay small
+    static constexpr uint32_t GRAIN_SIZE = 16;
 
-        // update each objects position based on its final velocity
+    NileJobSystem *jobSystem;
+
+    // scratch copies of the simulated components, reused across steps
+    std::vector<glm::vec2> positions;
+    std::vector<glm::vec2> velocities;
+    std::vector<float> masses;
+
+    void stepSimulation(std::vector<NileGameObject>& physicsObjs, float dt) {
+        // components are read into flat arrays up front so the parallel step never touches the
+        // component pools
+        positions.clear();
+        velocities.clear();
+        masses.clear();
         for (auto& obj : physicsObjs) {
-            obj->transform2d.translation += dt * obj->rigidBody2d.velocity;
+            positions.push_back(obj.transform2d().translation);
+            velocities.push_back(obj.rigidBody2d().velocity);
+            masses.push_back(obj.rigidBody2d().mass);
+        }
+
+        stepBodies(positions, velocities, masses, dt);
+
+        for (size_t i = 0; i < physicsObjs.size(); i++) {
+            physicsObjs[i].rigidBody2d().velocity = velocities[i];
+            physicsObjs[i].transform2d().translation = positions[i];
         }
     }
 
 public:
-    GravityPhysicsSystem(float strength) : strengthGravity{strength} {}
+    GravityPhysicsSystem(float strength, NileJobSystem *jobSystem = nullptr)
+        : jobSystem{jobSystem}, strengthGravity{strength} {}
 
     const float strengthGravity;
 
     // dt stands for delta time, and specifies the amount of time to advance the simulation
-    // substeps is how many intervals to divide the forward time step in. More substeps result in a 
+    // substeps is how many intervals to divide the forward time step in. More substeps result in a
     // more stable simulation, but takes longer to compute
-    void update(std::vector<NileGameObject*>& objs, float dt, unsigned int substeps = 1) {
+    void update(std::vector<NileGameObject>& objs, float dt, unsigned int substeps = 1) {
+        NILE_PROFILE_ZONE("gravity");
         const float stepDelta = dt / substeps;
         for (int i = 0; i < substeps; i++) {
             stepSimulation(objs, stepDelta);
         }
     }
 
-    glm::vec2 computeForce(NileGameObject& fromObj, NileGameObject& toObj) const 
+    // One step over plain arrays. Each body sums the attraction of all others and only writes
+    // its own velocity, so bodies are split across the job system when there is one.
+    void stepBodies(
+        std::vector<glm::vec2>& bodyPositions,
+        std::vector<glm::vec2>& bodyVelocities,
+        const std::vector<float>& bodyMasses,
+        float dt) const {
+        const uint32_t count = static_cast<uint32_t>(bodyPositions.size());
+
+        auto accelerate = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t a = begin; a < end; a++) {
+                glm::vec2 force{};
+                for (uint32_t b = 0; b < count; b++) {
+                    if (a == b) continue;
+                    force += computeForce(
+                        bodyPositions[a], bodyMasses[a], bodyPositions[b], bodyMasses[b]);
+                }
+                bodyVelocities[a] += dt * -force / bodyMasses[a];
+            }
+        };
+        if (jobSystem != nullptr) {
+            jobSystem->parallelFor(count, GRAIN_SIZE, accelerate);
+        } else {
+            accelerate(0, count);
+        }
+
+        // update each objects position based on its final velocity
+        for (uint32_t i = 0; i < count; i++) {
+            bodyPositions[i] += dt * bodyVelocities[i];
+        }
+    }
+
+    glm::vec2 computeForce(NileGameObject fromObj, NileGameObject toObj) const
+    {
+        return computeForce(
+            fromObj.transform2d().translation,
+            fromObj.rigidBody2d().mass,
+            toObj.transform2d().translation,
+            toObj.rigidBody2d().mass);
+    }
+
+    glm::vec2 computeForce(glm::vec2 fromPos, float fromMass, glm::vec2 toPos, float toMass) const
     {
-        auto offset = fromObj.transform2d.translation - toObj.transform2d.translation;
+        auto offset = fromPos - toPos;
         float distanceSquared = glm::dot(offset, offset);
 
         // return 0 if objects are too clost together...
@@ -62,9 +120,9 @@ public:
             return {.0f, .0f};
         }
 
-        float force = strengthGravity * toObj.rigidBody2d.mass * fromObj.rigidBody2d.mass / distanceSquared;
+        float force = strengthGravity * toMass * fromMass / distanceSquared;
         return force * offset / glm::sqrt(distanceSquared);
 
     }
 };
-}
\ No newline at end of file
+}
@@ -2,6 +2,8 @@
 
 #include "gravity_system.hpp"
 #include "framework/core/nile_game_object.hpp"
+#include "framework/core/nile_job_system.hpp"
+#include "framework/core/nile_profiler.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -18,27 +20,70 @@ class Vec2FieldSystem
 {
 public:
 
+Vec2FieldSystem(NileJobSystem *jobSystem = nullptr) : jobSystem{jobSystem} {}
+
 void update(
     const GravityPhysicsSystem& physicsSystem,
-    NileGameObject::Map& physicsObjs,
-    std::vector<NileGameObject*>& vectorField) {
+    std::vector<NileGameObject>& physicsObjs,
+    std::vector<NileGameObject>& vectorField) {
+    NILE_PROFILE_ZONE("vec2 field");
 
-    // For each field line we calculate the net gravitational force for that point in space
+    // resolve components serially, the parallel part below only sees plain pointers
+    bodyPositions.clear();
+    bodyMasses.clear();
+    for (auto& obj : physicsObjs) {
+        bodyPositions.push_back(obj.transform2d().translation);
+        bodyMasses.push_back(obj.rigidBody2d().mass);
+    }
+    fieldTransforms.clear();
     for (auto& vf : vectorField) {
-        glm::vec2 direction{};
-        for (auto& obj : physicsObjs) {
-            if (!obj.second.isVectorField){
-                direction += physicsSystem.computeForce(obj.second, *vf);
-            }
+        fieldTransforms.push_back(&vf.transform2d());
     }
 
-    // This scales the length of the field line based on the log of the length
-    // values were chosen through trial and error based on what looks good
-    // and then the field line is rotate to point in the direction of the field
-    vf->transform2d.scale.x = 0.005f + 0.045f * glm::clamp(glm::log(glm::length(direction) + 1) / 3.f, 0.f, 1.f);
-    vf->transform2d.rotation = atan2(direction.y, direction.x);
-    }
+    updateField(physicsSystem, bodyPositions, bodyMasses, fieldTransforms);
+}
+
+// For each field line we calculate the net gravitational force for that point in space
+void updateField(
+    const GravityPhysicsSystem& physicsSystem,
+    const std::vector<glm::vec2>& positions,
+    const std::vector<float>& masses,
+    std::vector<TransformComponent2d*>& field) const {
+
+    auto orient = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            auto& transform2d = *field[i];
+            glm::vec2 direction{};
+            for (size_t b = 0; b < positions.size(); b++) {
+                // field points have no body of their own, they sample with the default unit mass
+                direction += physicsSystem.computeForce(
+                    positions[b], masses[b], transform2d.translation, 1.0f);
+            }
+
+            // This scales the length of the field line based on the log of the length
+            // values were chosen through trial and error based on what looks good
+            // and then the field line is rotate to point in the direction of the field
+            transform2d.scale.x = 0.005f + 0.045f * glm::clamp(glm::log(glm::length(direction) + 1) / 3.f, 0.f, 1.f);
+            transform2d.rotation = atan2(direction.y, direction.x);
+        }
+    };
+
+    const uint32_t count = static_cast<uint32_t>(field.size());
+    if (jobSystem != nullptr) {
+        jobSystem->parallelFor(count, GRAIN_SIZE, orient);
+    } else {
+        orient(0, count);
     }
+}
+
+private:
+    static constexpr uint32_t GRAIN_SIZE = 64;
+
+    NileJobSystem *jobSystem;
+
+    std::vector<glm::vec2> bodyPositions;
+    std::vector<float> bodyMasses;
+    std::vector<TransformComponent2d*> fieldTransforms;
 };
 
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "framework/core/nile_model.hpp"
+#include "framework/core/nile_texture.hpp"
+#include "framework/core/nile_utils.hpp"
+
+// std
+#include <cstdint>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nile{
+
+// Groups per instance data of objects that share a model, diffuse map and level of detail, so
+// every group can be drawn with one instanced call. Batches keep the order in which their first
+// object was added and instances keep their order within a batch.
+template <typename InstanceData>
+class InstanceBatches {
+ public:
+  struct Batch {
+    NileModel *model;
+    NileTexture *diffuseMap;
+    uint32_t lod;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+  };
+
+  void clear() {
+    batches.clear();
+    batchLookup.clear();
+    pending.clear();
+    instances.clear();
+  }
+
+  void add(
+      NileModel *model, NileTexture *diffuseMap, const InstanceData &instance, uint32_t lod = 0) {
+    auto [it, inserted] = batchLookup.try_emplace({model, diffuseMap, lod}, batches.size());
+    if (inserted) {
+      batches.push_back({model, diffuseMap, lod, 0, 0});
+    }
+    batches[it->second].instanceCount++;
+    pending.push_back({static_cast<uint32_t>(it->second), instance});
+  }
+
+  // Lays the instances out so each batch is one contiguous range
+  void pack() {
+    uint32_t offset = 0;
+    for (auto &batch : batches) {
+      batch.firstInstance = offset;
+      offset += batch.instanceCount;
+    }
+
+    instances.resize(pending.size());
+    std::vector<uint32_t> cursor(batches.size());
+    for (size_t i = 0; i < batches.size(); i++) cursor[i] = batches[i].firstInstance;
+    for (auto &[batchIndex, instance] : pending) {
+      instances[cursor[batchIndex]++] = instance;
+    }
+  }
+
+  const std::vector<Batch> &getBatches() const { return batches; }
+  const std::vector<InstanceData> &getInstances() const { return instances; }
+
+ private:
+  using Key = std::tuple<NileModel *, NileTexture *, uint32_t>;
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      size_t seed = 0;
+      hashCombine(seed, std::get<0>(key), std::get<1>(key), std::get<2>(key));
+      return seed;
+    }
+  };
+
+  std::vector<Batch> batches;
+  std::unordered_map<Key, size_t, KeyHash> batchLookup;
+  std::vector<std::pair<uint32_t, InstanceData>> pending;
+  std::vector<InstanceData> instances;
+};
+
+}  // namespace nile
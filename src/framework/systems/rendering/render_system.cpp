@@ -1,5 +1,12 @@
 #include "render_system.hpp"
 
+#include "framework/core/nile_frustum.hpp"
+#include "framework/core/nile_gpu_profiler.hpp"
+#include "framework/core/nile_profiler.hpp"
+
+// std
+#include <cstddef>
+
 namespace nile{
 
 struct SimplePushConstantData {
@@ -8,6 +15,84 @@ struct SimplePushConstantData {
   float brightnessFactor;
 };
 
+struct TransformTablePushConstants {
+  uint32_t objectStride;  // in vec4s
+  float brightnessFactor;
+};
+
+struct CullPushConstants {
+  glm::vec4 planes[NileFrustum::PLANE_COUNT];
+  glm::vec4 lodCamera;  // see RenderSystem3D::lodCamera
+  uint32_t objectStride;  // in vec4s
+  uint32_t instanceCount;
+};
+
+// local_size_x of cull.comp
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+static_assert(sizeof(IndirectBatch) == 48, "IndirectBatch must match the std430 Batch in cull.comp");
+
+// Adds the per instance vertex binding, one vec4 attribute per 16 bytes of InstanceData
+template <typename InstanceData>
+static void addInstanceBinding(PipelineConfigInfo& pipelineConfig, uint32_t firstLocation) {
+  static_assert(sizeof(InstanceData) % sizeof(glm::vec4) == 0, "Instance data must be vec4 sized");
+  pipelineConfig.bindingDescriptions.push_back(
+      {1, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE});
+  for (uint32_t i = 0; i < sizeof(InstanceData) / sizeof(glm::vec4); i++) {
+    pipelineConfig.attributeDescriptions.push_back(
+        {firstLocation + i, 1, VK_FORMAT_R32G32B32A32_SFLOAT, i * uint32_t{sizeof(glm::vec4)}});
+  }
+}
+
+// One indirect draw per batch at the level it was collected with, or with allLods one per level
+// of detail in a row, each with room for all of the batch's instances
+static void buildIndirectBatches(
+    const InstanceBatches<InstanceData3D>& batches,
+    bool allLods,
+    std::vector<IndirectBatch>& indirectBatches,
+    std::vector<uint32_t>& drawBatches) {
+  indirectBatches.clear();
+  drawBatches.clear();
+  uint32_t baseInstance = 0;
+  const auto& batchList = batches.getBatches();
+  for (uint32_t b = 0; b < batchList.size(); b++) {
+    const auto& batch = batchList[b];
+    const auto& sphere = batch.model->getBoundingSphere();
+    const uint32_t lodCount = allLods ? batch.model->getLodCount() : 1;
+    for (uint32_t i = 0; i < lodCount; i++) {
+      const uint32_t lod = batch.lod + i;
+      IndirectBatch indirectBatch{};
+      indirectBatch.command = batch.model->getIndirectCommand(batch.instanceCount, lod);
+      indirectBatch.baseInstance = allLods ? baseInstance : batch.firstInstance;
+      indirectBatch.lodError = batch.model->getLod(lod).error;
+      indirectBatch.lodCount = lodCount - i;
+      indirectBatch.boundingSphere = {sphere.center, sphere.radius};
+      indirectBatches.push_back(indirectBatch);
+      drawBatches.push_back(b);
+      baseInstance += batch.instanceCount;
+    }
+  }
+}
+
+// Points every instance at its batch's finest draw, the cull pass adds the level it picks, and
+// zeroes the counts the pass adds up. Returns the visible id slots the draws need.
+static uint32_t buildCullInstances(
+    const InstanceBatches<InstanceData3D>& batches,
+    std::vector<IndirectBatch>& indirectBatches,
+    std::vector<CullInstance>& cullInstances) {
+  const auto& instances = batches.getInstances();
+  const auto& batchList = batches.getBatches();
+  cullInstances.clear();
+  uint32_t firstDraw = 0;
+  for (const auto& batch : batchList) {
+    for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; i++) {
+      cullInstances.push_back({instances[i].objectId, firstDraw});
+    }
+    firstDraw += indirectBatches[firstDraw].lodCount;
+  }
+  for (auto& indirectBatch : indirectBatches) indirectBatch.command.instanceCount = 0;
+  return indirectBatches.back().baseInstance + batchList.back().instanceCount;
+}
+
 SimpleRenderSystem::SimpleRenderSystem(
     NileDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
   : nileDevice{device} 
@@ -16,9 +101,8 @@ SimpleRenderSystem::SimpleRenderSystem(
   // createPipeline(renderPass);
 }
 
-SimpleRenderSystem::~SimpleRenderSystem() {
-  vkDestroyPipelineLayout(nileDevice.device(), pipelineLayout, nullptr);
-}
+// the layout and pipeline belong to the device's pipeline registry
+SimpleRenderSystem::~SimpleRenderSystem() {}
 
 void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
   VkPushConstantRange pushConstantRange{};
@@ -26,29 +110,17 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLay
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(SimplePushConstantData);
 
-  renderSystemLayout =
+  auto& registry = nileDevice.getPipelineRegistry();
+  renderSystemLayout = registry.getDescriptorSetLayout(
       NileDescriptorSetLayout::Builder(nileDevice)
           .addBinding(
               0,
               VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-          .build();
-
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-    globalSetLayout, 
-    renderSystemLayout->getDescriptorSetLayout()};
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(nileDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout!");
-  }
+          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+  pipelineLayout = registry.getPipelineLayout(
+      {globalSetLayout, renderSystemLayout->getDescriptorSetLayout()}, {pushConstantRange});
 }
 
 void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
@@ -58,14 +130,15 @@ void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
   NilePipeline::defaultPipelineConfigInfo(pipelineConfig);
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
-  nilePipeline = std::make_unique<NilePipeline>(
-      nileDevice,
+  nilePipeline = nileDevice.getPipelineRegistry().getPipeline(
       "shaders/simple_shader.vert.spv",
       "shaders/simple_shader.frag.spv",
       pipelineConfig);
 }
 
 void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
+  NILE_PROFILE_ZONE("simple render");
+  NileGpuScope scope{frameInfo, "simple render"};
   nilePipeline->bind(frameInfo.commandBuffer);
 
   vkCmdBindDescriptorSets(
@@ -78,71 +151,46 @@ void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
       0,
       nullptr);
 
-  // Create a map to cache descriptor sets for each game object
-  std::unordered_map<NileGameObject*, VkDescriptorSet> cachedDescriptorSets;
-
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr || obj.getIsHidden() ) continue;
-    
-    // Check if the descriptor set is already cached
-    auto it = cachedDescriptorSets.find(&obj);
-    if (it != cachedDescriptorSets.end()) {
-      // If cached, bind the cached descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &it->second,
-        0,
-        nullptr);
-    }  else {
-      auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-      auto diffuseMapInfo = obj.diffuseMap->getImageInfo();
-      VkDescriptorSet gameObjectDescriptorSet;
-      NileDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-          .writeBuffer(0, &bufferInfo)
-          .writeImage(1, &diffuseMapInfo)
-          .build(gameObjectDescriptorSet);
-
-      cachedDescriptorSets[&obj] = gameObjectDescriptorSet;
-
-      // Bind the newly created descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &gameObjectDescriptorSet,
-        0,
-        nullptr);
-    }
-
-    SimplePushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
-
-    vkCmdPushConstants(
-        frameInfo.commandBuffer,
-        pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(SimplePushConstantData),
-        &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
-  }
+  frameInfo.gameObjects.view<RenderComponent>().each(
+      [&](NileGameObject::id_t id, RenderComponent& render) {
+        if (render.model == nullptr || render.isHidden) return;
+
+        auto bufferInfo =
+            frameInfo.gameObjects.getBufferInfoForGameObject(frameInfo.frameIndex, id);
+        auto diffuseMapInfo = render.diffuseMap->getImageInfo();
+        VkDescriptorSet gameObjectDescriptorSet;
+        frameInfo.descriptorCache.writer(*renderSystemLayout)
+            .writeBuffer(0, &bufferInfo)
+            .writeImage(1, &diffuseMapInfo)
+            .build(gameObjectDescriptorSet);
+
+        vkCmdBindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
+            1,  // set count
+            &gameObjectDescriptorSet,
+            0,
+            nullptr);
+
+        SimplePushConstantData push{};
+        const auto& matrices = frameInfo.gameObjects.getMatrices(id);
+        push.modelMatrix = matrices.modelMatrix;
+        push.normalMatrix = matrices.normalMatrix;
+
+        vkCmdPushConstants(
+            frameInfo.commandBuffer,
+            pipelineLayout,
+            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            0,
+            sizeof(SimplePushConstantData),
+            &push);
+        render.model->bind(frameInfo.commandBuffer);
+        render.model->draw(frameInfo.commandBuffer);
+      });
 }
 
-struct PushConstantData {
-  glm::mat2 transform{1.f};
-  glm::vec3 offset;
-  alignas(16) glm::vec3 color;
-};
-
 RenderSystem2D::RenderSystem2D(
   NileDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
 : SimpleRenderSystem(device, renderPass, globalSetLayout), device{device}
@@ -154,34 +202,14 @@ RenderSystem2D::RenderSystem2D(
 RenderSystem2D::~RenderSystem2D(){}
 
 void RenderSystem2D::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(PushConstantData);
-
-  renderSystemLayout =
+  // transform and color come from the instance buffer, the set only holds the sprite texture
+  auto& registry = device.getPipelineRegistry();
+  renderSystemLayout = registry.getDescriptorSetLayout(
       NileDescriptorSetLayout::Builder(device)
-          .addBinding(
-              0,
-              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-              VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-          .build();
-
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-    globalSetLayout, 
-    renderSystemLayout->getDescriptorSetLayout()};
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout!");
-  }
+          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+  pipelineLayout =
+      registry.getPipelineLayout({globalSetLayout, renderSystemLayout->getDescriptorSetLayout()});
 }
 
 void RenderSystem2D::createPipeline(VkRenderPass renderPass)
@@ -192,22 +220,87 @@ void RenderSystem2D::createPipeline(VkRenderPass renderPass)
   NilePipeline::defaultPipelineConfigInfo(pipelineConfig);
   // pipelineConfig.attributeDescriptions.clear();
   // pipelineConfig.bindingDescriptions.clear();
+  addInstanceBinding<InstanceData2D>(pipelineConfig, 4);
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
 
-    nilePipeline = std::make_unique<NilePipeline>(
-        device,
-        "shaders/simple_shader_2d.vert.spv",
-        "shaders/simple_shader_2d.frag.spv",
+    nilePipeline = device.getPipelineRegistry().getPipeline(
+        "shaders/simple_shader_2d_instanced.vert.spv",
+        "shaders/simple_shader_2d_instanced.frag.spv",
         pipelineConfig);
 }
 
 
+static InstanceData2D makeInstance2D(
+    const TransformComponent2d& transform2d, const RenderComponent& render) {
+  const glm::mat2 transform = transform2d.mat2();
+  InstanceData2D instance{};
+  instance.transform = {transform[0].x, transform[0].y, transform[1].x, transform[1].y};
+  instance.offset = {transform2d.translation, 0.f, 0.f};
+  instance.color = {render.color, 1.f};
+  return instance;
+}
+
 void RenderSystem2D::renderGameObjects(FrameInfo& frameInfo) {
-  nilePipeline->bind(frameInfo.commandBuffer);
+  NILE_PROFILE_ZONE("render 2d");
+  NileGpuScope scope{frameInfo, "render 2d"};
+  auto& particles = frameInfo.gameObjects.pool<ParticleComponent>();
+  auto& staticObjects = frameInfo.gameObjects.pool<StaticComponent>();
+
+  // objects sharing a sprite and texture become one instanced draw
+  batches.clear();
+  frameInfo.gameObjects.view<TransformComponent2d, RenderComponent>().each(
+      [&](NileGameObject::id_t id, TransformComponent2d& transform2d, RenderComponent& render) {
+        if (render.model == nullptr || render.isHidden || particles.contains(id)) return;
+        if (staticObjects.contains(id)) return;
+
+        batches.add(
+            render.model.get(), render.diffuseMap.get(), makeInstance2D(transform2d, render));
+      });
+  batches.pack();
+
+  drawStats = {};
+  // static objects, e.g. level backgrounds and solid bricks, are drawn first and behind
+  renderStatics(frameInfo);
+
+  const auto& instances = batches.getInstances();
+  if (instances.empty()) return;
+  instanceBuffer.write(
+      frameInfo.frameIndex, instances.data(), static_cast<uint32_t>(instances.size()));
+
+  bindPipeline(frameInfo, frameInfo.commandBuffer);
+  instanceBuffer.bind(frameInfo.commandBuffer, frameInfo.frameIndex);
+
+  for (const auto& batch : batches.getBatches()) {
+    auto diffuseMapInfo = batch.diffuseMap->getImageInfo();
+    VkDescriptorSet batchDescriptorSet;
+    frameInfo.descriptorCache.writer(*renderSystemLayout)
+        .writeImage(1, &diffuseMapInfo)
+        .build(batchDescriptorSet);
+
+    vkCmdBindDescriptorSets(
+        frameInfo.commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout,
+        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
+        1,  // set count
+        &batchDescriptorSet,
+        0,
+        nullptr);
+
+    batch.model->bind(frameInfo.commandBuffer);
+    batch.model->draw(frameInfo.commandBuffer, batch.instanceCount, batch.firstInstance);
+    drawStats.drawCalls++;
+    drawStats.instances += batch.instanceCount;
+    drawStats.triangles += uint64_t{batch.model->getLod(0).indexCount / 3} * batch.instanceCount;
+  }
+}
+
+void RenderSystem2D::bindPipeline(FrameInfo& frameInfo, VkCommandBuffer commandBuffer) {
+  nilePipeline->bind(commandBuffer);
 
   vkCmdBindDescriptorSets(
-      frameInfo.commandBuffer,
+      commandBuffer,
       VK_PIPELINE_BIND_POINT_GRAPHICS,
       pipelineLayout,
       0,
@@ -215,65 +308,85 @@ void RenderSystem2D::renderGameObjects(FrameInfo& frameInfo) {
       &frameInfo.globalDescriptorSet,
       0,
       nullptr);
+}
 
-  // Create a map to cache descriptor sets for each game object
-  std::unordered_map<NileGameObject*, VkDescriptorSet> cachedDescriptorSets;
-
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr || obj.isParticle || obj.getIsHidden() || obj.Destroyed ) continue;
-    
-    // Check if the descriptor set is already cached
-    auto it = cachedDescriptorSets.find(&obj);
-    if (it != cachedDescriptorSets.end()) {
-      // If cached, bind the cached descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &it->second,
-        0,
-        nullptr);
-    }  else {
-      auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-      auto diffuseMapInfo = obj.diffuseMap->getImageInfo();
-      VkDescriptorSet gameObjectDescriptorSet;
-      NileDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-          .writeBuffer(0, &bufferInfo)
-          .writeImage(1, &diffuseMapInfo)
-          .build(gameObjectDescriptorSet);
-
-      cachedDescriptorSets[&obj] = gameObjectDescriptorSet;
-
-      // Bind the newly created descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &gameObjectDescriptorSet,
-        0,
-        nullptr);
-    }
+void RenderSystem2D::collectStatics(FrameInfo& frameInfo) {
+  auto& particles = frameInfo.gameObjects.pool<ParticleComponent>();
+
+  // the 2D transform is baked into the instance, moving a static sprite needs markStaticChanged
+  statics.batches.clear();
+  frameInfo.gameObjects.view<TransformComponent2d, RenderComponent, StaticComponent>().each(
+      [&](NileGameObject::id_t id,
+          TransformComponent2d& transform2d,
+          RenderComponent& render,
+          StaticComponent&) {
+        if (render.model == nullptr || render.isHidden || particles.contains(id)) return;
+
+        statics.batches.add(
+            render.model.get(), render.diffuseMap.get(), makeInstance2D(transform2d, render));
+      });
+  statics.batches.pack();
+  statics.version = frameInfo.gameObjects.getStaticVersion();
+  statics.revision++;
+}
 
-    PushConstantData push{};
-    push.offset = obj.transform2d.translation;
-    push.color = obj.color;
-    push.transform = obj.transform2d.mat2();
+void RenderSystem2D::renderStatics(FrameInfo& frameInfo) {
+  if (statics.version != frameInfo.gameObjects.getStaticVersion()) collectStatics(frameInfo);
+  const auto& batchList = statics.batches.getBatches();
+  if (batchList.empty()) return;
 
-    vkCmdPushConstants(
-        frameInfo.commandBuffer,
-        pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(PushConstantData),
-        &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+  const auto& instances = statics.batches.getInstances();
+  if (statics.uploadedVersions[frameInfo.frameIndex] != statics.revision) {
+    staticInstanceBuffer.write(
+        frameInfo.frameIndex, instances.data(), static_cast<uint32_t>(instances.size()));
+    statics.uploadedVersions[frameInfo.frameIndex] = statics.revision;
   }
+
+  // the sets are asked for every frame so the cache keeps them alive, one that was evicted
+  // anyway comes back as a new handle and changes the key
+  size_t key = 0;
+  hashCombine(
+      key,
+      statics.revision,
+      frameInfo.globalDescriptorSet,
+      frameInfo.globalDescriptorRevision,
+      staticInstanceBuffer.getBuffer(frameInfo.frameIndex));
+  statics.descriptorSets.resize(batchList.size());
+  for (size_t b = 0; b < batchList.size(); b++) {
+    auto diffuseMapInfo = batchList[b].diffuseMap->getImageInfo();
+    frameInfo.descriptorCache.writer(*renderSystemLayout)
+        .writeImage(1, &diffuseMapInfo)
+        .build(statics.descriptorSets[b]);
+    hashCombine(key, statics.descriptorSets[b]);
+  }
+
+  const bool recorded =
+      staticBatch.draw(frameInfo, key, [&](VkCommandBuffer commandBuffer) {
+        bindPipeline(frameInfo, commandBuffer);
+        staticInstanceBuffer.bind(commandBuffer, frameInfo.frameIndex);
+        for (size_t b = 0; b < batchList.size(); b++) {
+          vkCmdBindDescriptorSets(
+              commandBuffer,
+              VK_PIPELINE_BIND_POINT_GRAPHICS,
+              pipelineLayout,
+              1,
+              1,
+              &statics.descriptorSets[b],
+              0,
+              nullptr);
+          batchList[b].model->bind(commandBuffer);
+          batchList[b].model->draw(
+              commandBuffer, batchList[b].instanceCount, batchList[b].firstInstance);
+        }
+      });
+
+  drawStats.drawCalls += static_cast<uint32_t>(batchList.size());
+  drawStats.instances += static_cast<uint32_t>(instances.size());
+  for (const auto& batch : batchList) {
+    drawStats.triangles +=
+        uint64_t{batch.model->getLod(batch.lod).indexCount / 3} * batch.instanceCount;
+  }
+  if (!recorded) drawStats.cachedDrawCalls += static_cast<uint32_t>(batchList.size());
 }
 
 // struct SimplePushConstantData {
@@ -287,6 +400,7 @@ RenderSystem3D::RenderSystem3D(
 {
   createPipelineLayout(globalSetLayout);
   createPipeline(renderPass);
+  createCullPipeline();
 }
 
 RenderSystem3D::~RenderSystem3D() {}
@@ -295,31 +409,18 @@ void RenderSystem3D::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
   VkPushConstantRange pushConstantRange{};
   pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
   pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(SimplePushConstantData);
+  pushConstantRange.size = sizeof(TransformTablePushConstants);
 
-  renderSystemLayout =
+  // the whole transform table plus the diffuse map, so a set is shared by every object
+  // with the same texture
+  auto& registry = device.getPipelineRegistry();
+  renderSystemLayout = registry.getDescriptorSetLayout(
       NileDescriptorSetLayout::Builder(device)
-          .addBinding(
-              0,
-              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-              VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-          .build();
-
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-    globalSetLayout, 
-    renderSystemLayout->getDescriptorSetLayout()};
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout!");
-  }
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+  pipelineLayout = registry.getPipelineLayout(
+      {globalSetLayout, renderSystemLayout->getDescriptorSetLayout()}, {pushConstantRange});
 }
 
 void RenderSystem3D::createPipeline(VkRenderPass renderPass) {
@@ -327,32 +428,257 @@ void RenderSystem3D::createPipeline(VkRenderPass renderPass) {
 
   PipelineConfigInfo pipelineConfig{};
   NilePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  pipelineConfig.bindingDescriptions.push_back(
+      {1, sizeof(InstanceData3D), VK_VERTEX_INPUT_RATE_INSTANCE});
+  pipelineConfig.attributeDescriptions.push_back(
+      {4, 1, VK_FORMAT_R32_UINT, offsetof(InstanceData3D, objectId)});
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = pipelineLayout;
   // pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT;
 
-  nilePipeline = std::make_unique<NilePipeline>(
-      device,
+  nilePipeline = device.getPipelineRegistry().getPipeline(
       "shaders/simple_shader.vert.spv",
       "shaders/simple_shader.frag.spv",
       pipelineConfig);
 }
 
+void RenderSystem3D::createCullPipeline() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(CullPushConstants);
+
+  // transform table, cull instances, indirect batches and visible ids
+  auto& registry = device.getPipelineRegistry();
+  cullSetLayout = registry.getDescriptorSetLayout(
+      NileDescriptorSetLayout::Builder(device)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT));
+
+  cullPipelineLayout = registry.getPipelineLayout(
+      {cullSetLayout->getDescriptorSetLayout()}, {pushConstantRange});
+  cullPipeline = registry.getComputePipeline("shaders/cull.comp.spv", cullPipelineLayout);
+}
+
 void RenderSystem3D::updateSceneObject(NileGameObject::id_t target, FrameInfo& frameInfo) {
-    auto& obj = frameInfo.gameObjects.at(target);
+    auto& transform = frameInfo.gameObjects.get(target).transform();
 
     auto rotateObj = glm::rotate(glm::mat4(1.f), 0.5f * frameInfo.frameTime, {0.f, -1.f, 0.f});
 
     // update object position
-    obj.transform.translation = glm::vec3(rotateObj * glm::vec4(obj.transform.translation, 1.f));
+    transform.translation = glm::vec3(rotateObj * glm::vec4(transform.translation, 1.f));
 
 }
 
-void RenderSystem3D::renderGameObjects(FrameInfo& frameInfo) {
-  nilePipeline->bind(frameInfo.commandBuffer);
+void RenderSystem3D::updateLodCamera(FrameInfo& frameInfo) {
+  // a unit at distance d covers projection[1][1] / d of the half height of the view
+  const float pixelsAtUnitDistance =
+      frameInfo.camera.getProjection()[1][1] * lodViewportHeight * .5f / lodPixelError;
+  lodCamera = {frameInfo.camera.getPosition(), pixelsAtUnitDistance};
+}
+
+uint32_t RenderSystem3D::selectLod(
+    FrameInfo& frameInfo, NileGameObject::id_t id, const NileModel& model) const {
+  if (model.getLodCount() == 1) return 0;
+
+  // distance to the nearest point of the bounding sphere, the same as cull.comp
+  const glm::mat4& modelMatrix = frameInfo.gameObjects.getMatrices(id).modelMatrix;
+  const auto& sphere = model.getBoundingSphere();
+  const glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(sphere.center, 1.f));
+  const float scale = glm::max(
+      glm::length(glm::vec3(modelMatrix[0])),
+      glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+  const float distance = glm::length(center - glm::vec3(lodCamera)) - sphere.radius * scale;
+  if (distance <= 0.f) return 0;
+  return model.selectLod(scale * lodCamera.w / distance);
+}
+
+void RenderSystem3D::collectBatches(FrameInfo& frameInfo, CullingMode mode) {
+  auto& mirrors = frameInfo.gameObjects.pool<const MirrorComponent>();
+  auto& staticObjects = frameInfo.gameObjects.pool<const StaticComponent>();
+  const bool skipCulled = mode == CullingMode::Cpu;
+  const bool selectOnCpu = mode != CullingMode::Gpu;
+
+  // objects sharing a model, texture and level of detail become one indirect draw. The Gpu
+  // mode picks the level in the cull pass, so its batches only split by model and texture.
+  batches.clear();
+  frameInfo.gameObjects.view<const RenderComponent>().each(
+      [&](NileGameObject::id_t id, const RenderComponent& render) {
+        if (render.model == nullptr || render.isHidden || mirrors.contains(id)) return;
+        if (staticObjects.contains(id)) return;
+        if (skipCulled && !frameInfo.gameObjects.isVisible(id)) return;
+
+        const uint32_t lod = selectOnCpu ? selectLod(frameInfo, id, *render.model) : 0;
+        batches.add(render.model.get(), render.diffuseMap.get(), {id}, lod);
+      });
+  batches.pack();
+  buildIndirectBatches(batches, !selectOnCpu, indirectBatches, drawBatches);
+}
+
+void RenderSystem3D::cull(FrameInfo& frameInfo) {
+  NILE_PROFILE_ZONE("cull 3d");
+  NileGpuScope scope{frameInfo, "cull 3d"};
+  prepareDraws(frameInfo, cullingMode);
+}
+
+void RenderSystem3D::prepareDraws(FrameInfo& frameInfo, CullingMode mode) {
+  updateLodCamera(frameInfo);
+  collectBatches(frameInfo, mode);
+  isCulled = true;
+
+  drawStats = {};
+  prepareStatics(frameInfo, mode);
+  const auto& instances = batches.getInstances();
+  if (instances.empty()) return;
+
+  if (mode == CullingMode::Gpu) {
+    cullOnGpu(frameInfo);
+  } else {
+    instanceBuffer.write(
+        frameInfo.frameIndex, instances.data(), static_cast<uint32_t>(instances.size()));
+    indirectBuffer.write(
+        frameInfo.frameIndex,
+        indirectBatches.data(),
+        static_cast<uint32_t>(indirectBatches.size()));
+  }
+
+  // the gpu's visible counts are not read back, Gpu mode reports every submitted instance at
+  // its finest level
+  drawStats.drawCalls += static_cast<uint32_t>(indirectBatches.size());
+  if (mode == CullingMode::Gpu) {
+    drawStats.instances += static_cast<uint32_t>(instances.size());
+    for (const auto& batch : batches.getBatches()) {
+      drawStats.triangles +=
+          uint64_t{batch.model->getLod(0).indexCount / 3} * batch.instanceCount;
+    }
+    return;
+  }
+  for (const auto& indirectBatch : indirectBatches) {
+    drawStats.instances += indirectBatch.command.instanceCount;
+    drawStats.triangles +=
+        uint64_t{indirectBatch.command.indexCount / 3} * indirectBatch.command.instanceCount;
+  }
+}
+
+void RenderSystem3D::cullOnGpu(FrameInfo& frameInfo) {
+  const uint32_t visibleCount = buildCullInstances(batches, indirectBatches, cullInstances);
+  cullInstanceBuffer.write(
+      frameInfo.frameIndex, cullInstances.data(), static_cast<uint32_t>(cullInstances.size()));
+  indirectBuffer.write(
+      frameInfo.frameIndex, indirectBatches.data(), static_cast<uint32_t>(indirectBatches.size()));
+  instanceBuffer.reserve(frameInfo.frameIndex, visibleCount);
+  dispatchCull(
+      frameInfo,
+      cullInstanceBuffer,
+      indirectBuffer,
+      instanceBuffer,
+      static_cast<uint32_t>(cullInstances.size()));
+}
 
+void RenderSystem3D::dispatchCull(
+    FrameInfo& frameInfo,
+    NileInstanceBuffer& cullBuffer,
+    NileInstanceBuffer& drawBuffer,
+    NileInstanceBuffer& visibleBuffer,
+    uint32_t instanceCount) {
+  auto transformTableInfo = frameInfo.gameObjects.getTransformTableInfo(frameInfo.frameIndex);
+  auto cullInstanceInfo = cullBuffer.descriptorInfo(frameInfo.frameIndex);
+  auto indirectInfo = drawBuffer.descriptorInfo(frameInfo.frameIndex);
+  auto visibleInfo = visibleBuffer.descriptorInfo(frameInfo.frameIndex);
+  VkDescriptorSet cullDescriptorSet;
+  frameInfo.descriptorCache.writer(*cullSetLayout)
+      .writeBuffer(0, &transformTableInfo)
+      .writeBuffer(1, &cullInstanceInfo)
+      .writeBuffer(2, &indirectInfo)
+      .writeBuffer(3, &visibleInfo)
+      .build(cullDescriptorSet);
+
+  CullPushConstants push{};
+  const NileFrustum frustum = frameInfo.camera.getFrustum();
+  const auto& planes = frustum.getPlanes();
+  for (size_t i = 0; i < planes.size(); i++) {
+    push.planes[i] = planes[i];
+  }
+  push.lodCamera = lodCamera;
+  push.objectStride =
+      static_cast<uint32_t>(frameInfo.gameObjects.getTransformTableStride() / sizeof(glm::vec4));
+  push.instanceCount = instanceCount;
+
+  cullPipeline->bind(frameInfo.commandBuffer);
   vkCmdBindDescriptorSets(
       frameInfo.commandBuffer,
+      VK_PIPELINE_BIND_POINT_COMPUTE,
+      cullPipelineLayout,
+      0,
+      1,
+      &cullDescriptorSet,
+      0,
+      nullptr);
+  vkCmdPushConstants(
+      frameInfo.commandBuffer,
+      cullPipelineLayout,
+      VK_SHADER_STAGE_COMPUTE_BIT,
+      0,
+      sizeof(CullPushConstants),
+      &push);
+  cullPipeline->dispatch(frameInfo.commandBuffer, instanceCount, CULL_GROUP_SIZE);
+
+  // the draws read the counts as indirect commands and the ids as instance data
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+  vkCmdPipelineBarrier(
+      frameInfo.commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+      0,
+      1,
+      &barrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+}
+
+void RenderSystem3D::renderGameObjects(FrameInfo& frameInfo) {
+  NILE_PROFILE_ZONE("render 3d");
+  NileGpuScope scope{frameInfo, "render 3d"};
+  // cull was not called this frame, draw everything
+  if (!isCulled) prepareDraws(frameInfo, CullingMode::None);
+  isCulled = false;
+  renderStatics(frameInfo);
+  if (indirectBatches.empty()) return;
+
+  // sets are written before recording, so the recording threads never wait on the cache's lock
+  auto transformTableInfo = frameInfo.gameObjects.getTransformTableInfo(frameInfo.frameIndex);
+  const auto& batchList = batches.getBatches();
+  batchDescriptorSets.resize(batchList.size());
+  for (size_t b = 0; b < batchList.size(); b++) {
+    auto diffuseMapInfo = batchList[b].diffuseMap->getImageInfo();
+    frameInfo.descriptorCache.writer(*renderSystemLayout)
+        .writeBuffer(0, &transformTableInfo)
+        .writeImage(1, &diffuseMapInfo)
+        .build(batchDescriptorSets[b]);
+  }
+
+  recordDraws(
+      frameInfo,
+      static_cast<uint32_t>(indirectBatches.size()),
+      RECORD_GRAIN_SIZE,
+      [&](VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+        recordBatches(frameInfo, commandBuffer, begin, end);
+      });
+}
+
+void RenderSystem3D::bindPipeline(FrameInfo& frameInfo, VkCommandBuffer commandBuffer) {
+  nilePipeline->bind(commandBuffer);
+
+  vkCmdBindDescriptorSets(
+      commandBuffer,
       VK_PIPELINE_BIND_POINT_GRAPHICS,
       pipelineLayout,
       0,
@@ -361,64 +687,178 @@ void RenderSystem3D::renderGameObjects(FrameInfo& frameInfo) {
       0,
       nullptr);
 
-  // Create a map to cache descriptor sets for each game object
-  std::unordered_map<NileGameObject*, VkDescriptorSet> cachedDescriptorSets;
-
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr || obj.isMirror || obj.getIsHidden() ) continue;
-    
-    // Check if the descriptor set is already cached
-    auto it = cachedDescriptorSets.find(&obj);
-    if (it != cachedDescriptorSets.end()) {
-      // If cached, bind the cached descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &it->second,
-        0,
-        nullptr);
-    }  else {
-      auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-      auto diffuseMapInfo = obj.diffuseMap->getImageInfo();
-      VkDescriptorSet gameObjectDescriptorSet;
-      NileDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-          .writeBuffer(0, &bufferInfo)
-          .writeImage(1, &diffuseMapInfo)
-          .build(gameObjectDescriptorSet);
-
-      cachedDescriptorSets[&obj] = gameObjectDescriptorSet;
-
-      // Bind the newly created descriptor set
-      vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
+  TransformTablePushConstants push{};
+  push.objectStride =
+      static_cast<uint32_t>(frameInfo.gameObjects.getTransformTableStride() / sizeof(glm::vec4));
+  push.brightnessFactor = 10.5f;
+  vkCmdPushConstants(
+      commandBuffer,
+      pipelineLayout,
+      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+      0,
+      sizeof(TransformTablePushConstants),
+      &push);
+}
+
+void RenderSystem3D::recordBatches(
+    FrameInfo& frameInfo, VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+  bindPipeline(frameInfo, commandBuffer);
+
+  const VkBuffer indirectCommands = indirectBuffer.getBuffer(frameInfo.frameIndex);
+  const auto& batchList = batches.getBatches();
+  for (uint32_t d = begin; d < end; d++) {
+    const uint32_t b = drawBatches[d];
+    vkCmdBindDescriptorSets(
+        commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout,
         1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
         1,  // set count
-        &gameObjectDescriptorSet,
+        &batchDescriptorSets[b],
         0,
         nullptr);
+
+    // firstInstance is always 0, the draw's ids start at the bound offset instead
+    batchList[b].model->bind(commandBuffer);
+    instanceBuffer.bind(commandBuffer, frameInfo.frameIndex, 1, indirectBatches[d].baseInstance);
+    batchList[b].model->drawIndirect(commandBuffer, indirectCommands, d * sizeof(IndirectBatch));
+  }
+}
+
+void RenderSystem3D::collectStatics(FrameInfo& frameInfo) {
+  auto& mirrors = frameInfo.gameObjects.pool<const MirrorComponent>();
+
+  // batches split by model and texture only, every level has a draw of its own
+  statics.batches.clear();
+  frameInfo.gameObjects.view<const RenderComponent, const StaticComponent>().each(
+      [&](NileGameObject::id_t id, const RenderComponent& render, const StaticComponent&) {
+        if (render.model == nullptr || render.isHidden || mirrors.contains(id)) return;
+
+        statics.batches.add(render.model.get(), render.diffuseMap.get(), {id});
+      });
+  statics.batches.pack();
+  buildIndirectBatches(statics.batches, true, staticIndirectBatches, staticDrawBatches);
+  statics.version = frameInfo.gameObjects.getStaticVersion();
+  statics.revision++;
+}
+
+void RenderSystem3D::prepareStatics(FrameInfo& frameInfo, CullingMode mode) {
+  if (statics.version != frameInfo.gameObjects.getStaticVersion()) collectStatics(frameInfo);
+  const auto& batchList = statics.batches.getBatches();
+  if (batchList.empty()) return;
+
+  if (mode == CullingMode::Gpu) {
+    const uint32_t visibleCount =
+        buildCullInstances(statics.batches, staticIndirectBatches, staticCullInstances);
+    const uint32_t instanceCount = static_cast<uint32_t>(staticCullInstances.size());
+    staticCullInstanceBuffer.write(
+        frameInfo.frameIndex, staticCullInstances.data(), instanceCount);
+    staticIndirectBuffer.write(
+        frameInfo.frameIndex,
+        staticIndirectBatches.data(),
+        static_cast<uint32_t>(staticIndirectBatches.size()));
+    staticInstanceBuffer.reserve(frameInfo.frameIndex, visibleCount);
+    dispatchCull(
+        frameInfo,
+        staticCullInstanceBuffer,
+        staticIndirectBuffer,
+        staticInstanceBuffer,
+        instanceCount);
+
+    drawStats.instances += instanceCount;
+    for (const auto& batch : batchList) {
+      drawStats.triangles +=
+          uint64_t{batch.model->getLod(0).indexCount / 3} * batch.instanceCount;
     }
+    return;
+  }
 
-    SimplePushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
-    push.brightnessFactor = 10.5f;
+  // the same layout filled on the cpu, each visible instance goes to its level's draw
+  const auto& instances = statics.batches.getInstances();
+  const bool skipCulled = mode == CullingMode::Cpu;
+  for (auto& indirectBatch : staticIndirectBatches) indirectBatch.command.instanceCount = 0;
+  staticVisibleIds.resize(
+      staticIndirectBatches.back().baseInstance + batchList.back().instanceCount);
+  uint32_t firstDraw = 0;
+  for (const auto& batch : batchList) {
+    for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; i++) {
+      const NileGameObject::id_t id = instances[i].objectId;
+      if (skipCulled && !frameInfo.gameObjects.isVisible(id)) continue;
+
+      auto& draw = staticIndirectBatches[firstDraw + selectLod(frameInfo, id, *batch.model)];
+      staticVisibleIds[draw.baseInstance + draw.command.instanceCount++] = {id};
+    }
+    firstDraw += staticIndirectBatches[firstDraw].lodCount;
+  }
+  staticInstanceBuffer.write(
+      frameInfo.frameIndex,
+      staticVisibleIds.data(),
+      static_cast<uint32_t>(staticVisibleIds.size()));
+  staticIndirectBuffer.write(
+      frameInfo.frameIndex,
+      staticIndirectBatches.data(),
+      static_cast<uint32_t>(staticIndirectBatches.size()));
+
+  for (const auto& indirectBatch : staticIndirectBatches) {
+    drawStats.instances += indirectBatch.command.instanceCount;
+    drawStats.triangles +=
+        uint64_t{indirectBatch.command.indexCount / 3} * indirectBatch.command.instanceCount;
+  }
+}
 
-    vkCmdPushConstants(
-        frameInfo.commandBuffer,
-        pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(SimplePushConstantData),
-        &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+void RenderSystem3D::renderStatics(FrameInfo& frameInfo) {
+  const auto& batchList = statics.batches.getBatches();
+  if (batchList.empty()) return;
+
+  // only buffer handles are recorded, the counts and ids prepareStatics writes into them every
+  // frame are read when drawing. The transform table's buffer is replaced when it grows, which
+  // changes the batch sets and so the key.
+  auto transformTableInfo = frameInfo.gameObjects.getTransformTableInfo(frameInfo.frameIndex);
+  size_t key = 0;
+  hashCombine(
+      key,
+      statics.revision,
+      frameInfo.globalDescriptorSet,
+      frameInfo.globalDescriptorRevision,
+      staticInstanceBuffer.getBuffer(frameInfo.frameIndex),
+      staticIndirectBuffer.getBuffer(frameInfo.frameIndex),
+      frameInfo.gameObjects.getTransformTableStride());
+  statics.descriptorSets.resize(batchList.size());
+  for (size_t b = 0; b < batchList.size(); b++) {
+    auto diffuseMapInfo = batchList[b].diffuseMap->getImageInfo();
+    frameInfo.descriptorCache.writer(*renderSystemLayout)
+        .writeBuffer(0, &transformTableInfo)
+        .writeImage(1, &diffuseMapInfo)
+        .build(statics.descriptorSets[b]);
+    hashCombine(key, statics.descriptorSets[b]);
   }
+
+  const bool recorded =
+      staticBatch.draw(frameInfo, key, [&](VkCommandBuffer commandBuffer) {
+        bindPipeline(frameInfo, commandBuffer);
+        const VkBuffer indirectCommands = staticIndirectBuffer.getBuffer(frameInfo.frameIndex);
+        for (uint32_t d = 0; d < staticIndirectBatches.size(); d++) {
+          const uint32_t b = staticDrawBatches[d];
+          vkCmdBindDescriptorSets(
+              commandBuffer,
+              VK_PIPELINE_BIND_POINT_GRAPHICS,
+              pipelineLayout,
+              1,
+              1,
+              &statics.descriptorSets[b],
+              0,
+              nullptr);
+          batchList[b].model->bind(commandBuffer);
+          staticInstanceBuffer.bind(
+              commandBuffer, frameInfo.frameIndex, 1, staticIndirectBatches[d].baseInstance);
+          batchList[b].model->drawIndirect(
+              commandBuffer, indirectCommands, d * sizeof(IndirectBatch));
+        }
+      });
+
+  const auto drawCount = static_cast<uint32_t>(staticIndirectBatches.size());
+  drawStats.drawCalls += drawCount;
+  if (!recorded) drawStats.cachedDrawCalls += drawCount;
 }
 
 }  // namespace nile
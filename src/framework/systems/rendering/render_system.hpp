@@ -1,10 +1,16 @@
 #pragma once
 
 #include "framework/core/nile_camera.hpp"
+#include "framework/core/nile_command_recorder.hpp"
+#include "framework/core/nile_compute_pipeline.hpp"
 #include "framework/core/nile_device.hpp"
 #include "framework/core/nile_frame_info.hpp"
 #include "framework/core/nile_game_object.hpp"
+#include "framework/core/nile_instance_buffer.hpp"
 #include "framework/core/nile_pipeline.hpp"
+#include "framework/core/nile_pipeline_registry.hpp"
+#include "framework/core/nile_static_batch.hpp"
+#include "instance_batches.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -20,6 +26,67 @@
 #include <vector>
 
 namespace nile{
+
+// Counted by the render systems every frame, draw calls drop to one per model/texture pair
+// with instancing. cachedDrawCalls are the static ones executed without being recorded again.
+// triangles follow the levels of detail picked on the cpu, Gpu culling counts the finest ones.
+struct DrawStats {
+  uint32_t drawCalls = 0;
+  uint32_t instances = 0;
+  uint32_t cachedDrawCalls = 0;
+  uint64_t triangles = 0;
+};
+
+// Per instance vertex data, binding 1 of the instanced pipelines. 3D instances only carry the
+// object id, the shader reads the matrices from the object buffer's transform table.
+struct InstanceData3D {
+  uint32_t objectId = 0;
+};
+
+// Read by the cull compute shader, x is the object id and y the batch it is drawn with
+struct CullInstance {
+  uint32_t objectId = 0;
+  uint32_t batchIndex = 0;
+};
+
+// One indirect draw per batch, matches Batch in cull.comp. The command's firstInstance stays 0,
+// the batch's visible ids start at baseInstance in the instance buffer. With Gpu culling a batch
+// has one draw per level of detail in a row and the cull pass picks one for every instance.
+struct IndirectBatch {
+  VkDrawIndexedIndirectCommand command{};
+  uint32_t baseInstance = 0;
+  float lodError = 0.f;  // model space, see NileModel::Lod
+  uint32_t lodCount = 1;  // levels from this draw's one on, coarser draws follow it
+  glm::vec4 boundingSphere{};  // model space, w is the radius
+};
+
+// Instances of StaticComponent objects, collected again only when the manager's static version
+// changes. They are drawn through a NileStaticBatch. RenderSystem2D uploads them once per frame
+// in flight, RenderSystem3D culls them every frame into indirect draws of its own.
+template <typename InstanceData>
+struct StaticInstances {
+  static constexpr uint64_t NO_VERSION = ~0ull;
+
+  InstanceBatches<InstanceData> batches;
+  uint64_t version = NO_VERSION;
+  // bumped whenever batches are rebuilt
+  uint64_t revision = 0;
+  // revision in each frame's instance buffer, RenderSystem2D only
+  std::vector<uint64_t> uploadedVersions =
+      std::vector<uint64_t>(NileSwapChain::MAX_FRAMES_IN_FLIGHT, NO_VERSION);
+  std::vector<VkDescriptorSet> descriptorSets;
+};
+
+// Where RenderSystem3D decides which objects are visible. Gpu culls in a compute pass that writes
+// the indirect commands, Cpu draws what NileGameObjectManager::cull left visible.
+enum class CullingMode { None, Cpu, Gpu };
+
+struct InstanceData2D {
+  glm::vec4 transform{};  // mat2 columns
+  glm::vec4 offset{};     // xyz
+  glm::vec4 color{};      // rgb
+};
+
 class SimpleRenderSystem {
  private:
   NileDevice &nileDevice;
@@ -34,10 +101,13 @@ class SimpleRenderSystem {
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
   SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
+  const DrawStats &getDrawStats() const { return drawStats; }
+
  protected:
-  VkPipelineLayout pipelineLayout;
-  std::unique_ptr<NilePipeline> nilePipeline;
-  std::unique_ptr<NileDescriptorSetLayout> renderSystemLayout;
+  DrawStats drawStats{};
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  std::shared_ptr<NilePipeline> nilePipeline;
+  std::shared_ptr<NileDescriptorSetLayout> renderSystemLayout;
   virtual void renderGameObjects(FrameInfo &frameInfo);
 
 };
@@ -46,9 +116,84 @@ class RenderSystem3D : public SimpleRenderSystem
 {
 private:
     NileDevice& device;
+    // visible object ids, written by the cull pass and read as instance data by the draws
+    NileInstanceBuffer instanceBuffer{
+        device,
+        sizeof(InstanceData3D),
+        1024,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    NileInstanceBuffer cullInstanceBuffer{
+        device, sizeof(CullInstance), 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    NileInstanceBuffer indirectBuffer{
+        device,
+        sizeof(IndirectBatch),
+        64,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    InstanceBatches<InstanceData3D> batches;
+    std::vector<IndirectBatch> indirectBatches;
+    // the batch each indirect draw belongs to
+    std::vector<uint32_t> drawBatches;
+    std::vector<CullInstance> cullInstances;
+    std::vector<VkDescriptorSet> batchDescriptorSets;
+
+    // Static objects have one indirect draw per level of detail with room for all of their
+    // batch's instances, laid out like the Gpu mode's. Culling and picking levels, by the cull
+    // pass or on the cpu, only rewrite the counts and visible ids, so the draws recorded into
+    // the static batch stay valid while what is visible changes.
+    StaticInstances<InstanceData3D> statics;
+    std::vector<IndirectBatch> staticIndirectBatches;
+    std::vector<uint32_t> staticDrawBatches;
+    std::vector<CullInstance> staticCullInstances;
+    std::vector<InstanceData3D> staticVisibleIds;
+    NileInstanceBuffer staticInstanceBuffer{
+        device,
+        sizeof(InstanceData3D),
+        1024,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    NileInstanceBuffer staticCullInstanceBuffer{
+        device, sizeof(CullInstance), 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    NileInstanceBuffer staticIndirectBuffer{
+        device,
+        sizeof(IndirectBatch),
+        64,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+    NileStaticBatch staticBatch{device};
+
+    // until setLodQuality is called a 1080 pixel high view is assumed
+    float lodPixelError = 1.f;
+    uint32_t lodViewportHeight = 1080;
+    // xyz the camera position, w the pixels a model space unit covers at distance 1
+    glm::vec4 lodCamera{0.f};
+
+    // smallest range of batches worth its own secondary command buffer
+    static constexpr uint32_t RECORD_GRAIN_SIZE = 64;
+
+    CullingMode cullingMode = CullingMode::Gpu;
+    bool isCulled = false;
+    VkPipelineLayout cullPipelineLayout;
+    std::shared_ptr<NileDescriptorSetLayout> cullSetLayout;
+    std::shared_ptr<NileComputePipeline> cullPipeline;
 
     void createPipeline(VkRenderPass renderPass) override;
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout) override;
+    void createCullPipeline();
+    void collectBatches(FrameInfo &frameInfo, CullingMode mode);
+    void prepareDraws(FrameInfo &frameInfo, CullingMode mode);
+    void cullOnGpu(FrameInfo &frameInfo);
+    void dispatchCull(
+        FrameInfo &frameInfo,
+        NileInstanceBuffer &cullBuffer,
+        NileInstanceBuffer &drawBuffer,
+        NileInstanceBuffer &visibleBuffer,
+        uint32_t instanceCount);
+    void bindPipeline(FrameInfo &frameInfo, VkCommandBuffer commandBuffer);
+    void recordBatches(
+        FrameInfo &frameInfo, VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end);
+    void updateLodCamera(FrameInfo &frameInfo);
+    uint32_t selectLod(FrameInfo &frameInfo, NileGameObject::id_t id, const NileModel &model) const;
+    void collectStatics(FrameInfo &frameInfo);
+    void prepareStatics(FrameInfo &frameInfo, CullingMode mode);
+    void renderStatics(FrameInfo &frameInfo);
 
 public:
     RenderSystem3D(
@@ -57,6 +202,21 @@ public:
 
     RenderSystem3D(const RenderSystem3D &) = delete;
     RenderSystem3D &operator=(const RenderSystem3D &) = delete;
+
+    void setCullingMode(CullingMode mode) { cullingMode = mode; }
+    CullingMode getCullingMode() const { return cullingMode; }
+
+    // Models with levels of detail are drawn with the coarsest one whose error projects to at
+    // most maxPixelError pixels in a view viewportHeight pixels high
+    void setLodQuality(float maxPixelError, uint32_t viewportHeight) {
+        assert(maxPixelError > 0.f && "The allowed error must be above zero");
+        lodPixelError = maxPixelError;
+        lodViewportHeight = viewportHeight;
+    }
+
+    // Builds this frame's indirect commands, call before the render pass begins since the
+    // Gpu mode records a compute dispatch. Without it renderGameObjects draws everything.
+    void cull(FrameInfo &frameInfo);
     void renderGameObjects(FrameInfo &frameInfo) override;
     void updateSceneObject(NileGameObject::id_t target, FrameInfo& frameInfo);
 };
@@ -65,9 +225,18 @@ class RenderSystem2D : public SimpleRenderSystem
 {
 private:
     NileDevice& device;
+    NileInstanceBuffer instanceBuffer{device, sizeof(InstanceData2D)};
+    InstanceBatches<InstanceData2D> batches;
+
+    StaticInstances<InstanceData2D> statics;
+    NileInstanceBuffer staticInstanceBuffer{device, sizeof(InstanceData2D)};
+    NileStaticBatch staticBatch{device};
 
     void createPipeline(VkRenderPass renderPass) override;
     void createPipelineLayout(VkDescriptorSetLayout globalSetLayout) override;
+    void bindPipeline(FrameInfo &frameInfo, VkCommandBuffer commandBuffer);
+    void collectStatics(FrameInfo &frameInfo);
+    void renderStatics(FrameInfo &frameInfo);
 
 public:
     RenderSystem2D(
@@ -73,8 +73,10 @@ float HeightsGenerator::getSmoothNoise(int x, int z)
 
 float HeightsGenerator::getNoise(int x, int z)
 {
-    gen.seed(x * X_FACTOR + z * Z_FACTOR + seed);
-    return distrib(gen) * 2.0f - 1.0f;
+    // local engine and distribution so terrain rows can be generated from several threads
+    std::mt19937 noiseGen(x * X_FACTOR + z * Z_FACTOR + seed);
+    std::uniform_real_distribution<float> noiseDistrib{-1.0f, 1.0f};
+    return noiseDistrib(noiseGen) * 2.0f - 1.0f;
 }
 
 }
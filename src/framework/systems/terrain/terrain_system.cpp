@@ -4,8 +4,8 @@
 namespace nile
 {
 ProceduralTerrain::ProceduralTerrain(NileDevice &device, int gridX, int gridZ, 
-    std::shared_ptr<MaterialPack> textures, std::string heightMap) 
-    : device{device}
+    std::shared_ptr<MaterialPack> textures, std::string heightMap, NileJobSystem *jobSystem) 
+    : device{device}, jobSystem{jobSystem}
 {
     this->x = gridX * SIZE;
     this->z = gridZ * SIZE;
@@ -64,9 +64,11 @@ std::shared_ptr<NileModel> ProceduralTerrain::generateTerrain(std::shared_ptr<Ma
 
     std::vector<uint32_t> indices(6 * (VERTEX_COUNT - 1) * (VERTEX_COUNT - 1));
 
-    int vertexPointer = 0;
-    for(int i = 0; i < VERTEX_COUNT; i++){
+    // rows are independent, each one only writes its own vertices and heights
+    auto generateRows = [&](uint32_t firstRow, uint32_t endRow) {
+        for(int i = firstRow; i < (int)endRow; i++){
 			for(int j = 0; j < VERTEX_COUNT; j++){
+				int vertexPointer = i * VERTEX_COUNT + j;
 				positions[vertexPointer * 3] = (float)j/((float)VERTEX_COUNT - 1) * SIZE;
 				float height = getHeight(j, i, generator);
 				heights[j][i] = height;
@@ -96,8 +98,13 @@ std::shared_ptr<NileModel> ProceduralTerrain::generateTerrain(std::shared_ptr<Ma
                 textureCoords[vertexPointer * 2 + 1]
                         )};	
 				vertices[vertexPointer] = vertex;
-				vertexPointer++;
 			}
+        }
+    };
+    if (jobSystem != nullptr) {
+        jobSystem->parallelFor(VERTEX_COUNT, 1, generateRows);
+    } else {
+        generateRows(0, VERTEX_COUNT);
     }
     int pointer = 0;
     for(int gz=0;gz<VERTEX_COUNT-1;gz++){
@@ -117,6 +124,12 @@ std::shared_ptr<NileModel> ProceduralTerrain::generateTerrain(std::shared_ptr<Ma
     NileModel::Builder meshBuilder{};
     meshBuilder.vertices = vertices;
     meshBuilder.indices = indices;
+    meshBuilder.computeBounds();
+    const uint32_t lodCount = meshBuilder.generateLods(LOD_COUNT);
+    if (lodCount < LOD_COUNT) {
+        std::cout << "Terrain simplified into " << lodCount << " of " << LOD_COUNT
+                  << " levels of detail" << std::endl;
+    }
     return std::make_shared<NileModel>(device, meshBuilder, textures);
 }
 
@@ -3,6 +3,7 @@
 #include "heights_generator_system.hpp"
 #include "../material/material_pack_system.hpp"
 #include "../../core/nile_model.hpp"
+#include "../../core/nile_job_system.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -24,6 +25,8 @@ private:
     std::shared_ptr<HeightsGenerator> generator;
 
     const int VERTEX_COUNT = 6;
+    // levels of detail generated for the mesh, see NileModel::Builder::generateLods
+    const uint32_t LOD_COUNT = 4;
     std::random_device rd;
     const unsigned int SEED{rd() % 1000000000};
     std::mt19937 gen;
@@ -35,6 +38,8 @@ private:
     
     std::vector<std::vector<float>> heights;
     NileDevice &device;
+    // optional, vertex rows are generated in parallel when set
+    NileJobSystem *jobSystem;
     
 public:
     ProceduralTerrain(
@@ -42,7 +47,8 @@ public:
         int gridX, 
         int gridZ, 
         std::shared_ptr<MaterialPack> textures, 
-        std::string heightMap);
+        std::string heightMap,
+        NileJobSystem *jobSystem = nullptr);
     ~ProceduralTerrain();
 
     std::shared_ptr<NileModel> mesh;
@@ -1,7 +1,12 @@
 #include "water_system.hpp"
 
+#include "framework/core/nile_gpu_profiler.hpp"
+#include "framework/core/nile_profiler.hpp"
+
 // std
+#include <cassert>
 #include <map>
+#include <stdexcept>
 
 namespace nile
 { 
@@ -14,17 +19,44 @@ struct WaterPushConstants {
 WaterSystem::WaterSystem(
     NileDevice& device, 
     VkRenderPass renderPass,
-    VkDescriptorSetLayout offscreenSetLayout
+    VkDescriptorSetLayout offscreenSetLayout,
+    ObjectBufferMode objectBufferMode
     )
-    : device(device)
+    : device(device), objectBufferMode(objectBufferMode)
 {
     createPipelineLayout(offscreenSetLayout);
     createPipeline(renderPass);
 }
 
-WaterSystem::~WaterSystem()
-{
-    vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+WaterSystem::~WaterSystem() {}
+
+WaterSystem::Maps WaterSystem::addMapPasses(NileRenderGraph& graph, VkExtent2D extent) {
+    Maps maps{};
+    maps.reflection = graph.createImage("water reflection", {extent, VK_FORMAT_R8G8B8A8_UNORM});
+    maps.refraction = graph.createImage("water refraction", {extent, VK_FORMAT_R8G8B8A8_UNORM});
+    // the passes run one after the other, so their depth images share memory
+    auto reflectionDepth =
+        graph.createImage("water reflection depth", {extent, graph.findDepthFormat()});
+    auto refractionDepth =
+        graph.createImage("water refraction depth", {extent, graph.findDepthFormat()});
+
+    maps.reflectionPass = graph.addPass("water reflection")
+                              .writesColor(maps.reflection)
+                              .writesDepth(reflectionDepth)
+                              .recordsSecondaryBuffers();
+    maps.refractionPass = graph.addPass("water refraction")
+                              .writesColor(maps.refraction)
+                              .writesDepth(refractionDepth)
+                              .recordsSecondaryBuffers();
+    return maps;
+}
+
+void WaterSystem::checkMapImages(const WaterComponent& water) {
+    if (water.reflectionImage.imageView == VK_NULL_HANDLE ||
+        water.refractionImage.imageView == VK_NULL_HANDLE) {
+        throw std::runtime_error(
+            "water needs its reflection and refraction images, see WaterSystem::addMapPasses");
+    }
 }
 
 void WaterSystem::createPipelineLayout(VkDescriptorSetLayout offscreenSetLayout) {
@@ -33,33 +65,21 @@ void WaterSystem::createPipelineLayout(VkDescriptorSetLayout offscreenSetLayout)
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(WaterPushConstants);
 
-  renderSystemLayout =
+  auto& registry = device.getPipelineRegistry();
+  renderSystemLayout = registry.getDescriptorSetLayout(
      NileDescriptorSetLayout::Builder(device)
          .addBinding(
             0,
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            objectBufferDescriptorType(objectBufferMode),
             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
          .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
          .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
          .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-         .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-         .build();
-
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
-    offscreenSetLayout,
-    renderSystemLayout->getDescriptorSetLayout()};
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout!");
-  }
+         .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+  pipelineLayout = registry.getPipelineLayout(
+      {offscreenSetLayout, renderSystemLayout->getDescriptorSetLayout()}, {pushConstantRange});
 }
 
 void WaterSystem::createPipeline(VkRenderPass renderPass) {
@@ -72,91 +92,76 @@ void WaterSystem::createPipeline(VkRenderPass renderPass) {
     // pipelineConfig.bindingDescriptions.clear();
     pipelineConfig.renderPass = renderPass;
     pipelineConfig.pipelineLayout = pipelineLayout;
-    nilePipeline = std::make_unique<NilePipeline>(
-        device,
+    nilePipeline = device.getPipelineRegistry().getPipeline(
         "shaders/water.vert.spv",
         "shaders/water.frag.spv",
         pipelineConfig);
 }
 
 void WaterSystem::render(FrameInfo& frameInfo) {
-    nilePipeline->bind(frameInfo.commandBuffer);
-
-    vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        0,
-        1,
-        &frameInfo.globalDescriptorSet,
-        0,
-        nullptr);
-
-    for (auto& kv : frameInfo.gameObjects) {
-        auto& obj = kv.second;
-        if (obj.water == nullptr) continue;
-        auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-        auto reflectionImageInfo = obj.reflectionTexture->getImageInfo();
-        auto refractionImageInfo = obj.refractionTexture->getImageInfo();
+    NILE_PROFILE_ZONE("water");
+    NileGpuScope scope{frameInfo, "water"};
+    const bool dynamicOffset = objectBufferMode == ObjectBufferMode::DynamicOffset;
+    draws.clear();
+    frameInfo.gameObjects.view<TransformComponent, RenderComponent, WaterComponent>().each(
+        [&](NileGameObject::id_t id,
+            TransformComponent& transform,
+            RenderComponent& render,
+            WaterComponent& water) {
+        if (!frameInfo.gameObjects.isVisible(id)) return;
+
+        auto bufferInfo =
+            dynamicOffset
+                ? frameInfo.gameObjects.getDynamicBufferInfo(frameInfo.frameIndex)
+                : frameInfo.gameObjects.getBufferInfoForGameObject(frameInfo.frameIndex, id);
+        uint32_t objectOffset =
+            dynamicOffset ? frameInfo.gameObjects.getDynamicOffset(frameInfo.frameIndex, id) : 0;
+        checkMapImages(water);
+        auto reflectionImageInfo = water.reflectionImage;
+        auto refractionImageInfo = water.refractionImage;
 
         VkDescriptorSet gameObjectDescriptorSet;
-        NileDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
+        frameInfo.descriptorCache.writer(*renderSystemLayout)
             .writeBuffer(0, &bufferInfo)
             .writeImage(4, &reflectionImageInfo)
             .writeImage(5, &refractionImageInfo)
             .build(gameObjectDescriptorSet);
 
-        vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &gameObjectDescriptorSet,
-        0,
-        nullptr);
-
-        WaterPushConstants push{};
-        push.position = glm::vec4(obj.transform.translation, 1.f);
-
-        vkCmdPushConstants(
-            frameInfo.commandBuffer,
-            pipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0,
-            sizeof(WaterPushConstants),
-            &push);
-
-        obj.model->bind(frameInfo.commandBuffer);
-        obj.model->draw(frameInfo.commandBuffer);
-        }
+        draws.push_back(
+            {gameObjectDescriptorSet,
+             objectOffset,
+             render.model.get(),
+             glm::vec4(transform.translation, 1.f)});
+        });
+    recordTiles(frameInfo);
 }
 
 void WaterSystem::renderMaps(FrameInfo& frameInfo) {
-    nilePipeline->bind(frameInfo.commandBuffer);
-
-    vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        0,
-        1,
-        &frameInfo.globalDescriptorSet,
-        0,
-        nullptr);
-
-    for (auto& kv : frameInfo.gameObjects) {
-        auto& obj = kv.second;
-        if (obj.water == nullptr) continue;
-        auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-        auto normalImageInfo = obj.normalMap->getImageInfo();
-        auto depthImageInfo = obj.depthMap->getImageInfo();
-        auto dudvImageInfo = obj.dudvMap->getImageInfo();
-        auto reflectionImageInfo = obj.reflectionTexture->getImageInfo();
-        auto refractionImageInfo = obj.refractionTexture->getImageInfo();
+    NILE_PROFILE_ZONE("water maps");
+    const bool dynamicOffset = objectBufferMode == ObjectBufferMode::DynamicOffset;
+    draws.clear();
+    frameInfo.gameObjects.view<TransformComponent, RenderComponent, WaterComponent>().each(
+        [&](NileGameObject::id_t id,
+            TransformComponent& transform,
+            RenderComponent& render,
+            WaterComponent& water) {
+        if (!frameInfo.gameObjects.isVisible(id)) return;
+
+        auto bufferInfo =
+            dynamicOffset
+                ? frameInfo.gameObjects.getDynamicBufferInfo(frameInfo.frameIndex)
+                : frameInfo.gameObjects.getBufferInfoForGameObject(frameInfo.frameIndex, id);
+        uint32_t objectOffset =
+            dynamicOffset ? frameInfo.gameObjects.getDynamicOffset(frameInfo.frameIndex, id) : 0;
+        auto normalImageInfo = water.normalMap->getImageInfo();
+        auto depthImageInfo = water.depthMap->getImageInfo();
+        auto dudvImageInfo = water.dudvMap->getImageInfo();
+        checkMapImages(water);
+        auto reflectionImageInfo = water.reflectionImage;
+        auto refractionImageInfo = water.refractionImage;
 
         VkDescriptorSet gameObjectDescriptorSet;
-        NileDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
+        frameInfo.descriptorCache.writer(*renderSystemLayout)
             .writeBuffer(0, &bufferInfo)
             .writeImage(1, &dudvImageInfo)
             .writeImage(2, &normalImageInfo)
@@ -165,29 +170,57 @@ void WaterSystem::renderMaps(FrameInfo& frameInfo) {
             .writeImage(5, &refractionImageInfo)
             .build(gameObjectDescriptorSet);
 
+        draws.push_back(
+            {gameObjectDescriptorSet,
+             objectOffset,
+             render.model.get(),
+             glm::vec4(transform.translation, 1.f)});
+        });
+    recordTiles(frameInfo);
+}
+
+void WaterSystem::recordTiles(FrameInfo& frameInfo) {
+    const bool dynamicOffset = objectBufferMode == ObjectBufferMode::DynamicOffset;
+    auto recordRange = [&](VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+        nilePipeline->bind(commandBuffer);
+
         vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &gameObjectDescriptorSet,
-        0,
-        nullptr);
-
-        WaterPushConstants push{};
-        push.position = glm::vec4(obj.transform.translation, 1.f);
-
-        vkCmdPushConstants(
-            frameInfo.commandBuffer,
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
             pipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
             0,
-            sizeof(WaterPushConstants),
-            &push);
+            1,
+            &frameInfo.globalDescriptorSet,
+            0,
+            nullptr);
 
-        obj.model->bind(frameInfo.commandBuffer);
-        obj.model->draw(frameInfo.commandBuffer);
+        for (uint32_t i = begin; i < end; i++) {
+            const WaterDraw& draw = draws[i];
+            vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
+            1,  // set count
+            &draw.descriptorSet,
+            dynamicOffset ? 1u : 0u,
+            &draw.objectOffset);
+
+            WaterPushConstants push{};
+            push.position = draw.position;
+
+            vkCmdPushConstants(
+                commandBuffer,
+                pipelineLayout,
+                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                0,
+                sizeof(WaterPushConstants),
+                &push);
+
+            draw.model->bind(commandBuffer);
+            draw.model->draw(commandBuffer);
         }
-    }
-}
\ No newline at end of file
+    };
+    recordDraws(frameInfo, static_cast<uint32_t>(draws.size()), RECORD_GRAIN_SIZE, recordRange);
+}
+}
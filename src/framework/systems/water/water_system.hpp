@@ -1,9 +1,13 @@
+#pragma once
 
 #include "framework/core/nile_texture.hpp"
+#include "framework/core/nile_command_recorder.hpp"
 #include "framework/core/nile_frame_info.hpp"
 #include "framework/core/nile_device.hpp"
 #include "framework/core/nile_pipeline.hpp"
+#include "framework/core/nile_pipeline_registry.hpp"
 #include "framework/core/nile_game_object.hpp"
+#include "framework/core/nile_render_graph.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -22,10 +26,24 @@ class WaterSystem
 public:
 static constexpr float TILE_SIZE = 6.f;
 
+// The images water samples and the graph passes rendering them
+struct Maps {
+    NileRenderGraph::ImageId reflection;
+    NileRenderGraph::ImageId refraction;
+    NileRenderGraph::PassId reflectionPass;
+    NileRenderGraph::PassId refractionPass;
+};
+
+// Declares the reflection and refraction passes before graph.compile(). The pass drawing the
+// water samples both images, the app sets the passes' execute functions and every
+// WaterComponent's images from graph.getImageInfo once it is compiled, as Mirror does.
+static Maps addMapPasses(NileRenderGraph& graph, VkExtent2D extent = {512, 512});
+
 WaterSystem(
     NileDevice& device,
     VkRenderPass renderPass,
-    VkDescriptorSetLayout globalSetLayout);
+    VkDescriptorSetLayout globalSetLayout,
+    ObjectBufferMode objectBufferMode = ObjectBufferMode::DynamicOffset);
 ~WaterSystem();
 
 // int getID();
@@ -49,17 +67,32 @@ private:
 
 void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
 void createPipeline(VkRenderPass renderPass);
+// records the gathered draws, possibly on other threads
+void recordTiles(FrameInfo& frameInfo);
+// throws when the app has not set them
+static void checkMapImages(const WaterComponent& water);
 VkDescriptorImageInfo imageDescriptor;
 
+// a visible water tile, gathered with its set before the draws are recorded
+struct WaterDraw {
+    VkDescriptorSet descriptorSet;
+    uint32_t objectOffset;
+    NileModel* model;
+    glm::vec4 position;
+};
+std::vector<WaterDraw> draws;
+static constexpr uint32_t RECORD_GRAIN_SIZE = 64;
+
 
 std::shared_ptr<NileTexture> dudvTexture;
 std::shared_ptr<NileTexture> normalTexture;
 
 NileDevice& device;
-std::unique_ptr<NilePipeline> nilePipeline;
+ObjectBufferMode objectBufferMode;
+std::shared_ptr<NilePipeline> nilePipeline;
 VkPipelineLayout pipelineLayout;
 
-std::unique_ptr<NileDescriptorSetLayout> renderSystemLayout;
+std::shared_ptr<NileDescriptorSetLayout> renderSystemLayout;
 };
 } // namespace nile
 
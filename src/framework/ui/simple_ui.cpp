@@ -1,5 +1,7 @@
 #include "simple_ui.hpp"
 
+#include "framework/core/nile_profiler.hpp"
+
 namespace nile {
     SimpleUI::SimpleUI(
         NileDevice &device,  
@@ -63,7 +65,7 @@ namespace nile {
         init_info.Device = mDevice.device();
         init_info.QueueFamily = indices.graphicsFamily;
         init_info.Queue = mQueue;
-        init_info.PipelineCache = mPipelineCache;
+        init_info.PipelineCache = mDevice.getPipelineCache().getCache();
         init_info.DescriptorPool = imguiPool;
         init_info.Subpass = 0;
         init_info.MinImageCount = 2;
@@ -119,12 +121,31 @@ void SimpleUI::startUI() {
         ImGui::Begin("Scene config");                          // Create a window called "Hello, world!" and append into it.
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / this->getFrameRate(), this->getFrameRate());
+        ImGui::Text("Object buffer: %u matrices, %llu bytes flushed", matrices_recomputed, (unsigned long long)bytes_flushed);
+        ImGui::Text("Draw calls: %u for %u instances", draw_calls, instances_drawn);
+        ImGui::Text("Triangles: %llu", (unsigned long long)triangles_drawn);
+        ImGui::Text("Frustum culling: %u of %u tested objects visible", objects_visible, objects_tested);
+        ImGui::Text("Descriptor sets: %u written, %u cached", descriptor_sets_written, descriptor_sets_live);
+        ImGui::Text("Secondary command buffers: %u, %u recorded in parallel", secondary_buffers, parallel_ranges);
+        ImGui::Text("Static draw calls: %u replayed without recording", cached_draw_calls);
+        ImGui::Text("Pipelines: %u created in %.1f ms, %s cache", pipelines_created, pipeline_creation_ms, pipeline_cache_warm ? "warm" : "cold");
+        ImGui::Text("Pipeline registry: %u requests shared an existing object", pipeline_registry_hits);
+        ImGui::Text("Point lights: %u, at most %u shade a fragment", lights, max_lights_per_cluster);
+        ImGui::Text("Frame pacing: waited %.2f ms, %.2f ms spinning", pacing_wait_ms, pacing_spin_ms);
 
         ImGui::Checkbox("Settings", &show_demo_window);      // Edit bools storing our window open/close state
         // ImGui::Checkbox("Another Window", &show_another_window);
 
         ImGui::Checkbox("Point Lights", &enable_point_lights);
         ImGui::Checkbox("Terrain", &set_show_model);
+        ImGui::Combo("Culling", &culling_mode, "None\0CPU\0GPU\0");
+        ImGui::SliderFloat("LOD pixel error", &lod_pixel_error, 0.25f, 8.0f);
+        // VkPresentModeKHR numbers immediate, mailbox and fifo 0 to 2
+        int present_mode = static_cast<int>(frame_settings.presentMode);
+        if (ImGui::Combo("Present mode", &present_mode, "Immediate\0Mailbox\0FIFO\0"))
+            frame_settings.presentMode = static_cast<VkPresentModeKHR>(present_mode);
+        ImGui::SliderInt("Frames in flight", &frame_settings.framesInFlight, 1, NileSwapChain::MAX_FRAMES_IN_FLIGHT);
+        ImGui::SliderFloat("Target FPS (0 off)", &frame_settings.targetFps, 0.0f, 240.0f);
 
         ImGui::SliderFloat("Terrain translate x", &terrain_pos.x, 0.0f, 10.0f);            // Edit 1 float using a slider from 0.0f to 1.0f
         ImGui::SliderFloat("Terrain translate y", &terrain_pos.y, 0.0f, 10.0f);            // Edit 1 float using a slider from 0.0f to 1.0f
@@ -139,6 +160,32 @@ void SimpleUI::startUI() {
         ImGui::End();
     }
 
+    if (gpu_profiler != nullptr && gpu_profiler->isSupported())
+    {
+        ImGui::Begin("GPU profiler");
+        ImGui::Text("GPU frame: %.3f ms", gpu_profiler->getFrameMs());
+        const auto& history = gpu_profiler->getHistory();
+        ImGui::PlotLines("ms", history.data(), (int)history.size(), (int)gpu_profiler->getHistoryOffset(), nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+        for (const auto& timing : gpu_profiler->getTimings())
+            ImGui::Text("%*s%s: %.3f ms", (int)timing.depth * 2, "", timing.name.c_str(), timing.ms);
+
+        if (gpu_profiler->supportsPipelineStatistics())
+        {
+            if (ImGui::Checkbox("Pipeline statistics", &pipeline_statistics))
+                gpu_profiler->setPipelineStatistics(pipeline_statistics);
+            if (gpu_profiler->hasPipelineStatistics())
+            {
+                const auto& statistics = gpu_profiler->getPipelineStatistics();
+                ImGui::Text("Input vertices: %llu", (unsigned long long)statistics.inputVertices);
+                ImGui::Text("Vertex invocations: %llu", (unsigned long long)statistics.vertexInvocations);
+                ImGui::Text("Clipping primitives: %llu", (unsigned long long)statistics.clippingPrimitives);
+                ImGui::Text("Fragment invocations: %llu", (unsigned long long)statistics.fragmentInvocations);
+                ImGui::Text("Compute invocations: %llu", (unsigned long long)statistics.computeInvocations);
+            }
+        }
+        ImGui::End();
+    }
+
     // 3. Show another simple window.
     if (show_another_window)
     {
@@ -151,6 +198,7 @@ void SimpleUI::startUI() {
 }
 
 void SimpleUI::renderUI(VkCommandBuffer commandBuffer, NileRenderer& renderer) {
+    NILE_PROFILE_ZONE("ui");
     ImGui::Render();
     ImDrawData* draw_data = ImGui::GetDrawData();
     const bool is_minimized = (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f);
@@ -161,7 +209,10 @@ void SimpleUI::renderUI(VkCommandBuffer commandBuffer, NileRenderer& renderer) {
       renderer.clearValues[0].color.float32[2] = clear_color.z * clear_color.w;
       renderer.clearValues[0].color.float32[3] = clear_color.w;
       // Record dear imgui primitives into command buffer
+      auto& gpuProfiler = renderer.getGpuProfiler();
+      const uint32_t scope = gpuProfiler.beginScope(commandBuffer, "ui");
       ImGui_ImplVulkan_RenderDrawData(draw_data, commandBuffer);
+      gpuProfiler.endScope(commandBuffer, scope);
     }
 }
 
@@ -26,7 +26,6 @@ size_t mImageCount;
 GLFWwindow* mWindow;
 
 // Data
-VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
 QueueFamilyIndices indices = mDevice.findPhysicalQueueFamilies();
 VkQueue mQueue = mDevice.graphicsQueue();
 VkResult err;
@@ -59,6 +58,38 @@ glm::vec3 terrain_rot = glm::vec3(0.f);
 
 glm::vec3 p_lights_pos = glm::vec3(0.f);
 
+// 0 none, 1 cpu, 2 gpu, in the order of CullingMode
+int culling_mode = 2;
+// largest error, in pixels, a level of detail may put on screen
+float lod_pixel_error = 1.f;
+// copied from the renderer before the first frame and handed back to it after startUI
+NileRenderer::FrameSettings frame_settings{};
+// shown in its own window when set
+NileGpuProfiler* gpu_profiler = nullptr;
+bool pipeline_statistics = false;
+
+// Frame stats, filled in by the app before startUI
+uint32_t matrices_recomputed = 0;
+uint64_t bytes_flushed = 0;
+uint32_t draw_calls = 0;
+uint32_t instances_drawn = 0;
+uint64_t triangles_drawn = 0;
+uint32_t objects_tested = 0;
+uint32_t objects_visible = 0;
+uint32_t descriptor_sets_written = 0;
+uint32_t descriptor_sets_live = 0;
+uint32_t secondary_buffers = 0;
+uint32_t parallel_ranges = 0;
+uint32_t cached_draw_calls = 0;
+uint32_t pipelines_created = 0;
+double pipeline_creation_ms = 0.0;
+bool pipeline_cache_warm = false;
+uint32_t pipeline_registry_hits = 0;
+uint32_t lights = 0;
+uint32_t max_lights_per_cluster = 0;
+double pacing_wait_ms = 0.0;
+double pacing_spin_ms = 0.0;
+
 void init();
 // delete copy constructors
 SimpleUI(const SimpleUI &) = delete;
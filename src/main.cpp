@@ -1,18 +1,189 @@
 #include "apps/game/2d/breakout/breakout.hpp"
+#include "apps/sample/2d/gravity.hpp"
+#include "apps/sample/3d/mirror.hpp"
+#include "apps/sample/3d/skybox.hpp"
+#include "apps/sample/3d/terrain.hpp"
+#include "apps/sample/bench/bvh_bench.hpp"
+#include "apps/sample/bench/job_system_bench.hpp"
 
 // std
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// Thrown for a malformed command line, main prints it followed by the usage
+struct UsageError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "       " << program << " --bench-jobs | --bench-bvh\n"
+            << "  --app NAME              breakout, gravity, 3d, mirror, skybox or terrain\n"
+            << "  --headless WxH          render offscreen at this size, builds with\n"
+            << "                          -DUSE_HEADLESS=ON, no display needed\n"
+            << "  --frames N              headless: stop after N frames, 0 never\n"
+            << "  --capture DIR           headless: read frames back into DIR\n"
+            << "  --capture-every N       headless: capture every N-th frame, at least 1\n"
+            << "  --frames-in-flight N    1 to " << nile::NileSwapChain::MAX_FRAMES_IN_FLIGHT
+            << "\n"
+            << "  --present-mode MODE     fifo, mailbox or immediate\n"
+            << "  --target-fps FPS        pace frames to FPS, 0 leaves it to the present mode\n"
+            << "  --trace FILE            write a Chrome trace, builds with -DUSE_PROFILER=ON\n"
+            << "  --trace-frames N        frames per trace, 0 until F12 or exit\n";
+}
+
+// The whole of value as a whole number from min to max
+static long long parseInteger(
+    const std::string &option, const std::string &value, long long min, long long max) {
+  size_t end = 0;
+  long long number = 0;
+  try {
+    number = std::stoll(value, &end);
+  } catch (const std::logic_error &) {
+    end = 0;
+  }
+  if (end == 0 || end != value.size() || number < min || number > max) {
+    throw UsageError{
+        option + " takes a whole number from " + std::to_string(min) + " to " +
+        std::to_string(max) + ", not '" + value + "'"};
+  }
+  return number;
+}
+
+// The whole of value as a finite number of zero or more
+static float parseNonNegative(const std::string &option, const std::string &value) {
+  size_t end = 0;
+  float number = 0.f;
+  try {
+    number = std::stof(value, &end);
+  } catch (const std::logic_error &) {
+    end = 0;
+  }
+  if (end == 0 || end != value.size() || !std::isfinite(number) || number < 0.f) {
+    throw UsageError{option + " takes a number of zero or more, not '" + value + "'"};
+  }
+  return number;
+}
+
+// Runs app and, when headless, reports its frame times, e.g.
+//   NileEngine --app mirror --headless 1280x720 --frames 600 --capture out --capture-every 60
+// Builds with -DUSE_PROFILER=ON also take --trace out.json --trace-frames 300
+template <typename App>
+static int run(const std::string &name, const nile::AppSettings &settings) {
+  auto app = std::make_unique<App>(settings);
+  app->start();
+
+  if (app->nileWindow.isHeadless()) {
+    const auto stats = app->nileRenderer.getFrameTimeStats();
+    std::cout << name << ": " << stats.frames << " frames, " << stats.averageMs << " ms average, "
+              << stats.minMs << " min, " << stats.p99Ms << " p99, " << stats.maxMs << " max\n";
+  }
+  return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[]) {
-  nile::Breakout game;
-  nile::App2D &app = game;
-  
+  NILE_PROFILE_THREAD("main");
+
+  // headless benchmark, runs before any window or device is created
+  if (argc > 1 && std::string(argv[1]) == "--bench-jobs") {
+    nile::JobSystemBench{}.run();
+    return EXIT_SUCCESS;
+  }
+  if (argc > 1 && std::string(argv[1]) == "--bench-bvh") {
+    nile::BvhBench{}.run();
+    return EXIT_SUCCESS;
+  }
+
+  const std::unordered_map<std::string, VkPresentModeKHR> presentModes = {
+      {"fifo", VK_PRESENT_MODE_FIFO_KHR},
+      {"mailbox", VK_PRESENT_MODE_MAILBOX_KHR},
+      {"immediate", VK_PRESENT_MODE_IMMEDIATE_KHR}};
+  constexpr long long maxCount = std::numeric_limits<uint32_t>::max();
+
+  std::string appName = "breakout";
+  nile::AppSettings settings{};
+  nile::NileWindow::Headless &headless = settings.headless;
+  nile::NileRenderer::FrameSettings &frameSettings = settings.frameSettings;
+  std::string tracePath = "trace.json";
+  [[maybe_unused]] uint32_t traceFrames = 0;  // read by profiler builds only
+  bool isTraceSet = false;
   try {
-    app.start();
+    // every option takes exactly one value
+    for (int i = 1; i < argc; i += 2) {
+      const std::string option = argv[i];
+      if (i + 1 == argc) throw UsageError{option + " needs a value"};
+      const std::string value = argv[i + 1];
+      if (option == "--app") {
+        appName = value;
+      } else if (option == "--headless") {
+#ifndef NILE_HEADLESS
+        throw UsageError{"--headless needs a build with -DUSE_HEADLESS=ON"};
+#endif
+        headless.enabled = true;
+        int consumed = 0;
+        const int matched =
+            std::sscanf(value.c_str(), "%dx%d%n", &headless.width, &headless.height, &consumed);
+        if (matched != 2 || consumed != static_cast<int>(value.size()) || headless.width <= 0 ||
+            headless.height <= 0) {
+          throw UsageError{"--headless takes a size like 1280x720, not '" + value + "'"};
+        }
+      } else if (option == "--frames") {
+        headless.frameCount = static_cast<uint32_t>(parseInteger(option, value, 0, maxCount));
+      } else if (option == "--frames-in-flight") {
+        frameSettings.framesInFlight = static_cast<int>(
+            parseInteger(option, value, 1, nile::NileSwapChain::MAX_FRAMES_IN_FLIGHT));
+      } else if (option == "--present-mode") {
+        auto mode = presentModes.find(value);
+        if (mode == presentModes.end()) {
+          throw UsageError{"--present-mode takes fifo, mailbox or immediate, not '" + value + "'"};
+        }
+        frameSettings.presentMode = mode->second;
+      } else if (option == "--target-fps") {
+        frameSettings.targetFps = parseNonNegative(option, value);
+      } else if (option == "--capture") {
+        headless.captureDirectory = value;
+      } else if (option == "--capture-every") {
+        headless.captureInterval = static_cast<uint32_t>(parseInteger(option, value, 1, maxCount));
+      } else if (option == "--trace") {
+        tracePath = value;
+        isTraceSet = true;
+      } else if (option == "--trace-frames") {
+        traceFrames = static_cast<uint32_t>(parseInteger(option, value, 0, maxCount));
+        isTraceSet = true;
+      } else {
+        throw UsageError{"Unknown option " + option};
+      }
+    }
+  } catch (const UsageError &e) {
+    std::cerr << e.what() << '\n';
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (isTraceSet) {
+#if defined(NILE_PROFILE)
+    NILE_PROFILE_TRACE_OUTPUT(tracePath, traceFrames);
+#else
+    std::cerr << "--trace needs a build with -DUSE_PROFILER=ON, ignoring it\n";
+#endif
+  }
 
-  return 0;
+  try {
+    if (appName == "breakout") return run<nile::Breakout>(appName, settings);
+    if (appName == "gravity") return run<nile::Gravity>(appName, settings);
+    if (appName == "3d") return run<nile::App3D>(appName, settings);
+    if (appName == "mirror") return run<nile::Mirror>(appName, settings);
+    if (appName == "skybox") return run<nile::Skybox>(appName, settings);
+    if (appName == "terrain") return run<nile::Terrain>(appName, settings);
+    std::cerr << "Unknown app " << appName
+              << ", expected breakout, gravity, 3d, mirror, skybox or terrain\n";
+    return EXIT_FAILURE;
 
   } catch (const std::runtime_error &e) {
     std::cerr << "Runtime error: " << e.what() << '\n';
@@ -25,4 +196,4 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}